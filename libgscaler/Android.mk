@@ -27,6 +27,7 @@ LOCAL_C_INCLUDES := $(LOCAL_PATH)/include
 
 LOCAL_SRC_FILES := \
 	libgscaler_obj.cpp \
+	libgscaler_broker.cpp \
 	libgscaler.cpp \
 	exynos_subdev.c
 
@@ -393,6 +393,21 @@ int exynos_gsc_stop_exclusive
 int exynos_gsc_free_and_close
 (void *handle);
 
+/*!
+ * Add a G-Scaler H/W instance to the process-wide queue of pixel copies of
+ * libscaler. See exynos_sc_queue_copy_pixels().
+ *
+ * \ingroup exynos_gscaler
+ *
+ * \param dev_num
+ *   G-Scaler H/W instance number. Starts from 0 [in]
+ *
+ * \return
+ *   false if the instance cannot be opened.
+ */
+bool exynos_gsc_add_copy_device(
+    int dev_num);
+
 enum {
     GSC_M2M_MODE = 0,
     GSC_OUTPUT_MODE,
@@ -28,6 +28,8 @@
 
 #include <linux/v4l2-subdev.h>
 
+#include <mutex>
+
 #include "libgscaler_obj.h"
 #include "libgscaler_media.h"
 
@@ -606,3 +608,91 @@ int exynos_gsc_free_and_close(void *handle)
 
     return 0;
 }
+
+static bool exynos_gsc_run_queued_copy(void *handle, struct exynos_sc_pxinfo *pxinfo)
+{
+    unsigned int srcfmt = exynos_sc_pxfmt_to_v4l2(pxinfo->src.pxfmt);
+    unsigned int dstfmt = exynos_sc_pxfmt_to_v4l2(pxinfo->dst.pxfmt);
+    void *addr[3] = {NULL, NULL, NULL};
+
+    if ((srcfmt == 0) || (dstfmt == 0))
+        return false;
+
+    if (exynos_gsc_set_src_format(handle, pxinfo->src.width, pxinfo->src.height,
+                                  pxinfo->src.crop_left, pxinfo->src.crop_top,
+                                  pxinfo->src.crop_width, pxinfo->src.crop_height,
+                                  srcfmt, 0, 0) < 0)
+        return false;
+
+    if (exynos_gsc_set_dst_format(handle, pxinfo->dst.width, pxinfo->dst.height,
+                                  pxinfo->dst.crop_left, pxinfo->dst.crop_top,
+                                  pxinfo->dst.crop_width, pxinfo->dst.crop_height,
+                                  dstfmt, 0, 0) < 0)
+        return false;
+
+    if (exynos_gsc_set_rotation(handle, pxinfo->rotate, pxinfo->hflip, pxinfo->vflip) < 0)
+        return false;
+
+    addr[0] = pxinfo->src.addr;
+    if (exynos_gsc_set_src_addr(handle, addr, V4L2_MEMORY_USERPTR, -1) < 0)
+        return false;
+
+    addr[0] = pxinfo->dst.addr;
+    if (exynos_gsc_set_dst_addr(handle, addr, V4L2_MEMORY_USERPTR, -1) < 0)
+        return false;
+
+    return exynos_gsc_convert(handle) == 0;
+}
+
+static std::mutex gsc_copy_lock;
+static bool gsc_copy_added[NUM_OF_GSC_HW];
+
+bool exynos_gsc_add_copy_device(int dev_num)
+{
+    char name[16];
+
+    if ((dev_num < 0) || (dev_num >= NUM_OF_GSC_HW)) {
+        ALOGE("%s::G-Scaler instance %d is not valid", __func__, dev_num);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(gsc_copy_lock);
+
+    if (gsc_copy_added[dev_num])
+        return true;
+
+    snprintf(name, sizeof(name), "gscaler%d", dev_num);
+
+    // The instance stays open as long as the queue which is never destroyed
+    void *handle = exynos_gsc_create_exclusive(dev_num, GSC_M2M_MODE, 0, 0);
+    if (handle == NULL) {
+        ALOGE("%s::failed to open G-Scaler instance %d", __func__, dev_num);
+        return false;
+    }
+
+    struct exynos_sc_copy_backend backend;
+    backend.name = name;
+    backend.caps.formats = EXYNOS_SC_COPY_FMT(EXYNOS_SC_FMT_RGB32) |
+                           EXYNOS_SC_COPY_FMT(EXYNOS_SC_FMT_BGR32) |
+                           EXYNOS_SC_COPY_FMT(EXYNOS_SC_FMT_RGB565) |
+                           EXYNOS_SC_COPY_FMT(EXYNOS_SC_FMT_RGB555X) |
+                           EXYNOS_SC_COPY_FMT(EXYNOS_SC_FMT_RGB444);
+    backend.caps.max_downscale = 16;
+    backend.caps.max_upscale = 8;
+    backend.caps.min_src_width = GSC_MIN_SRC_W_SIZE;
+    backend.caps.min_src_height = GSC_MIN_SRC_H_SIZE;
+    backend.caps.min_dst_width = GSC_MIN_DST_W_SIZE;
+    backend.caps.min_dst_height = GSC_MIN_DST_H_SIZE;
+    backend.caps.rotate = true;
+    backend.run = exynos_gsc_run_queued_copy;
+    backend.priv = handle;
+
+    if (!exynos_sc_add_copy_backend(&backend)) {
+        exynos_gsc_destroy(handle);
+        return false;
+    }
+
+    gsc_copy_added[dev_num] = true;
+
+    return true;
+}
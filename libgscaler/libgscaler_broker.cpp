@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <chrono>
+
+#include "libgscaler_broker.h"
+
+CGscalerBroker::CGscalerBroker()
+    : m_nNextTicket(0), m_nReleases(0)
+{
+    for (int i = 0; i < NUM_OF_GSC_HW; i++)
+        m_nUsers[i] = 0;
+}
+
+CGscalerBroker &CGscalerBroker::Instance()
+{
+    static CGscalerBroker broker;
+    return broker;
+}
+
+bool CGscalerBroker::IsCandidate(int dev)
+{
+#ifndef USES_ONLY_GSC0_GSC1
+    return (dev != 0) && (dev != 3);
+#else
+    return (dev != 0);
+#endif
+}
+
+int CGscalerBroker::Acquire(const std::function<int(int)> &open,
+                            unsigned int timeout_us, int *fd)
+{
+    using clock = std::chrono::steady_clock;
+    const auto deadline = clock::now() + std::chrono::microseconds(timeout_us);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const uint64_t ticket = m_nNextTicket++;
+    m_waiters.push_back(ticket);
+
+    while (true) {
+        const uint64_t releases = m_nReleases;
+        const bool head = (m_waiters.front() == ticket);
+        if (head) {
+            int devs[NUM_OF_GSC_HW];
+            int num_devs = 0;
+            for (int i = 0; i < NUM_OF_GSC_HW; i++) {
+                if (IsCandidate(i))
+                    devs[num_devs++] = i;
+            }
+            /* The devices with the fewest users in this process first */
+            std::stable_sort(devs, devs + num_devs,
+                             [this](int a, int b) { return m_nUsers[a] < m_nUsers[b]; });
+
+            for (int i = 0; i < num_devs; i++) {
+                /* Opening takes a while, the other waiters keep their turn */
+                lock.unlock();
+                int dev_fd = open(devs[i]);
+                lock.lock();
+                if (dev_fd < 0)
+                    continue;
+
+                m_nUsers[devs[i]]++;
+                m_waiters.pop_front();
+                /* The next waiter may find another free device */
+                m_cond.notify_all();
+                *fd = dev_fd;
+                return devs[i];
+            }
+        }
+
+        auto now = clock::now();
+        if (now >= deadline)
+            break;
+
+        ALOGV("%s::waiting for the gscaler availability", __func__);
+        /* Also catches a release while the devices were being opened */
+        m_cond.wait_until(lock, std::min(deadline,
+                now + std::chrono::microseconds(GSC_WAITING_TIME_FOR_TRYLOCK)),
+                [&] {
+                    return (m_nReleases != releases) ||
+                           (!head && (m_waiters.front() == ticket));
+                });
+    }
+
+    m_waiters.erase(std::find(m_waiters.begin(), m_waiters.end(), ticket));
+    m_cond.notify_all();
+
+    return -1;
+}
+
+void CGscalerBroker::Release(int dev)
+{
+    if ((dev < 0) || (dev >= NUM_OF_GSC_HW))
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_nUsers[dev] == 0) {
+        ALOGE("%s::device %d is not acquired", __func__, dev);
+        return;
+    }
+    m_nUsers[dev]--;
+    m_nReleases++;
+    m_cond.notify_all();
+}
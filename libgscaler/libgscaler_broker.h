@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGSCALER_BROKER_H_
+#define LIBGSCALER_BROKER_H_
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+#include "libgscaler_obj.h"
+
+/*
+ * Hands out the M2M G-Scaler instances shared by the users in this process.
+ *
+ * The driver decides whether a device can be opened again, as before the
+ * broker: a busy device fails to open. The broker only spreads the users of
+ * this process, trying the devices with the fewest users here first, and
+ * queues the callers that find every device busy. Waiters are served in FIFO
+ * order and only the oldest one opens devices, so a late caller cannot take
+ * an instance a queued one is waiting for. Release() of a device acquired
+ * here wakes the waiters immediately. A device held by another process cannot
+ * notify this process, so the devices are tried again every
+ * GSC_WAITING_TIME_FOR_TRYLOCK until the timeout.
+ */
+class CGscalerBroker {
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<uint64_t> m_waiters;
+    uint64_t m_nNextTicket;
+    uint64_t m_nReleases;
+    unsigned int m_nUsers[NUM_OF_GSC_HW];
+
+    CGscalerBroker();
+    static bool IsCandidate(int dev);
+public:
+    static CGscalerBroker &Instance();
+
+    /*
+     * Opens a device with |open|, which returns the fd of the device or a
+     * negative value when it is busy. |open| is called without the broker
+     * lock held. Returns the device number and its fd in |fd|, or -1 when no
+     * device could be opened within |timeout_us|.
+     */
+    int Acquire(const std::function<int(int)> &open, unsigned int timeout_us, int *fd);
+    /* Only for a device returned by Acquire() */
+    void Release(int dev);
+};
+
+#endif // LIBGSCALER_BROKER_H_
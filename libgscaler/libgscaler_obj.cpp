@@ -37,6 +37,7 @@
 
 #include "libgscaler_media.h"
 #include "libgscaler_obj.h"
+#include "libgscaler_broker.h"
 
 // Definitions of values that are not present in enum v4l2_mbus_pixelcode
 #define V4L2_MBUS_FMT_XRGB8888_4X8_LE 0x1009
@@ -238,43 +239,23 @@ bool CGscaler::m_gsc_find_and_create(void *handle)
 {
     Exynos_gsc_In();
 
-    int          i                 = 0;
     bool         flag_find_new_gsc = false;
-    unsigned int total_sleep_time  = 0;
     CGscaler* gsc = GetGscaler(handle);
     if (gsc == NULL) {
         ALOGE("%s::handle == NULL() fail", __func__);
         return false;
     }
 
-    do {
-        for (i = 0; i < NUM_OF_GSC_HW; i++) {
-#ifndef USES_ONLY_GSC0_GSC1
-            if (i == 0 || i == 3)
-#else
-            if (i == 0)
-#endif
-                continue;
-
-            gsc->gsc_id = i;
-            gsc->gsc_fd = gsc->m_gsc_m2m_create(i);
-            if (gsc->gsc_fd < 0) {
-                gsc->gsc_fd = 0;
-                continue;
-            }
-
-            flag_find_new_gsc = true;
-            break;
-        }
-
-        if (flag_find_new_gsc == false) {
-            usleep(GSC_WAITING_TIME_FOR_TRYLOCK);
-            total_sleep_time += GSC_WAITING_TIME_FOR_TRYLOCK;
-            ALOGV("%s::waiting for the gscaler availability", __func__);
-        }
-
-    } while(flag_find_new_gsc == false
-            && total_sleep_time < MAX_GSC_WAITING_TIME_FOR_TRYLOCK);
+    int fd = 0;
+    int dev = CGscalerBroker::Instance().Acquire(
+            [gsc](int i) { return gsc->m_gsc_m2m_create(i); },
+            MAX_GSC_WAITING_TIME_FOR_TRYLOCK, &fd);
+    if (dev >= 0) {
+        gsc->gsc_id = dev;
+        gsc->gsc_fd = fd;
+        gsc->broker_acquired = true;
+        flag_find_new_gsc = true;
+    }
 
     if (flag_find_new_gsc == false)
         ALOGE("%s::we don't have any available gsc.. fail", __func__);
@@ -309,6 +290,11 @@ bool CGscaler::m_gsc_m2m_destroy(void *handle)
     if (0 < gsc->gsc_fd)
         close(gsc->gsc_fd);
     gsc->gsc_fd = 0;
+    /* A device opened by its number from exynos_gsc_create_exclusive() is not the broker's */
+    if (gsc->broker_acquired) {
+        CGscalerBroker::Instance().Release(gsc->gsc_id);
+        gsc->broker_acquired = false;
+    }
 
     Exynos_gsc_Out();
 
@@ -138,6 +138,7 @@ public:
     MediaDevice mdev;
     int out_mode;
     int gsc_id;
+    bool broker_acquired;           /* gsc_id is released to CGscalerBroker */
     bool allow_drm;
     bool protection_enabled;
     int gsc_fd;
@@ -155,6 +156,7 @@ public:
         mode = __mode;
         out_mode = __out_mode;
         gsc_id = __gsc_id;
+        broker_acquired = false;
         allow_drm = __allow_drm;
     }
 
@@ -137,9 +137,14 @@ LOCAL_SRC_FILES := \
 	libdevice/ExynosLayer.cpp \
 	libdevice/HistogramDevice.cpp \
 	libdevice/DisplayTe2Manager.cpp \
+	libdevice/DisplayCommitScheduler.cpp \
+	libdevice/IdleTeAlignmentPolicy.cpp \
 	libmaindisplay/ExynosPrimaryDisplay.cpp \
 	libresource/ExynosMPP.cpp \
 	libresource/ExynosResourceManager.cpp \
+	libresource/BandwidthEstimator.cpp \
+	libresource/M2mCompressionPolicy.cpp \
+	libresource/RotationPlanner.cpp \
 	libexternaldisplay/ExynosExternalDisplay.cpp \
 	libvirtualdisplay/ExynosVirtualDisplay.cpp \
 	libdisplayinterface/ExynosDeviceInterface.cpp \
@@ -152,12 +157,15 @@ LOCAL_SRC_FILES := \
 	libvrr/Power/DisplayStateResidencyProvider.cpp \
 	libvrr/Power/DisplayStateResidencyWatcher.cpp \
 	libvrr/FileNode.cpp \
+	libvrr/PanelHibernateState.cpp \
+	libvrr/PresentTimeout/AdaptivePresentTimeoutScheduler.cpp \
 	libvrr/RefreshRateCalculator/InstantRefreshRateCalculator.cpp \
 	libvrr/RefreshRateCalculator/ExitIdleRefreshRateCalculator.cpp \
 	libvrr/RefreshRateCalculator/PeriodRefreshRateCalculator.cpp \
 	libvrr/RefreshRateCalculator/CombinedRefreshRateCalculator.cpp \
 	libvrr/RefreshRateCalculator/RefreshRateCalculatorFactory.cpp \
 	libvrr/RefreshRateCalculator/VideoFrameRateCalculator.cpp \
+	libvrr/Statistics/PresentTrace.cpp \
 	libvrr/Statistics/VariableRefreshRateStatistic.cpp \
 	libvrr/Utils.cpp \
 	libvrr/VariableRefreshRateController.cpp \
@@ -368,3 +376,67 @@ LOCAL_MODULE_TAGS := optional
 
 include $(TOP)/hardware/google/graphics/common/BoardConfigCFlags.mk
 include $(BUILD_SHARED_LIBRARY)
+
+################################################################################
+# Unit tests of the libexynosdisplay policies that do not need a display.
+
+include $(CLEAR_VARS)
+
+LOCAL_SHARED_LIBRARIES := liblog libcutils libutils libexynosdisplay libacryl \
+	android.hardware.graphics.composer@2.4 \
+	android.hardware.graphics.allocator@2.0 \
+	android.hardware.graphics.mapper@2.0 \
+	libui
+
+LOCAL_SHARED_LIBRARIES += android.hardware.graphics.composer3-V4-ndk \
+                          android.hardware.drm-V1-ndk \
+                          com.google.hardware.pixel.display-V13-ndk \
+                          libbinder_ndk \
+                          libbase
+
+LOCAL_PROPRIETARY_MODULE := true
+LOCAL_HEADER_LIBRARIES := libhardware_legacy_headers libbinder_headers google_hal_headers
+LOCAL_HEADER_LIBRARIES += libgralloc_headers
+
+LOCAL_CFLAGS := -DHLOG_CODE=0
+LOCAL_CFLAGS += -DLOG_TAG=\"hwc-test\"
+LOCAL_CFLAGS += -DSOC_VERSION=$(soc_ver)
+LOCAL_CFLAGS += -Wall -Werror
+
+LOCAL_C_INCLUDES += \
+	$(TOP)/hardware/google/graphics/common/include \
+	$(TOP)/hardware/google/graphics/common/libhwc2.1/libdevice \
+	$(TOP)/hardware/google/graphics/common/libhwc2.1/libmaindisplay \
+	$(TOP)/hardware/google/graphics/common/libhwc2.1/libexternaldisplay \
+	$(TOP)/hardware/google/graphics/common/libhwc2.1/libvirtualdisplay \
+	$(TOP)/hardware/google/graphics/common/libhwc2.1/libhwchelper \
+	$(TOP)/hardware/google/graphics/common/libhwc2.1/libresource \
+	$(TOP)/hardware/google/graphics/$(soc_ver)/libhwc2.1 \
+	$(TOP)/hardware/google/graphics/$(soc_ver)/libhwc2.1/libmaindisplay \
+	$(TOP)/hardware/google/graphics/$(soc_ver)/libhwc2.1/libexternaldisplay \
+	$(TOP)/hardware/google/graphics/$(soc_ver)/libhwc2.1/libvirtualdisplay \
+	$(TOP)/hardware/google/graphics/$(soc_ver)/libhwc2.1/libcolormanager \
+	$(TOP)/hardware/google/graphics/$(soc_ver)/libhwc2.1/libresource \
+	$(TOP)/hardware/google/graphics/$(soc_ver)/libhwc2.1/libdevice \
+	$(TOP)/hardware/google/graphics/$(soc_ver)/libhwc2.1/libdisplayinterface \
+	$(TOP)/hardware/google/graphics/$(soc_ver)/include \
+	$(TOP)/hardware/google/graphics/common/libhwc2.1/libhwcService \
+	$(TOP)/hardware/google/graphics/common/libhwc2.1/libdisplayinterface \
+	$(TOP)/hardware/google/graphics/common/libhwc2.1/libdrmresource/include \
+	$(TOP)/hardware/google/graphics/common/libhwc2.1/libvrr \
+	$(TOP)/hardware/google/graphics/common/libhwc2.1/libvrr/interface \
+	$(TOP)/hardware/google/graphics/$(soc_ver)
+
+LOCAL_SRC_FILES := \
+	test/IdleTeAlignmentPolicyTest.cpp \
+	test/M2mCompressionPolicyTest.cpp \
+	test/RotationPlannerTest.cpp
+
+LOCAL_MODULE := libexynosdisplay_test
+LOCAL_LICENSE_KINDS := SPDX-license-identifier-Apache-2.0
+LOCAL_LICENSE_CONDITIONS := notice
+LOCAL_NOTICE_FILE := $(LOCAL_PATH)/NOTICE
+LOCAL_MODULE_TAGS := optional
+
+include $(TOP)/hardware/google/graphics/common/BoardConfigCFlags.mk
+include $(BUILD_NATIVE_TEST)
@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG (ATRACE_TAG_GRAPHICS | ATRACE_TAG_HAL)
+
+#include "DisplayCommitScheduler.h"
+
+#include <cutils/properties.h>
+#include <utils/Timers.h>
+#include <utils/Trace.h>
+
+#include <algorithm>
+#include <cinttypes>
+
+#include "ExynosDisplay.h"
+#include "ExynosHWCHelper.h"
+
+DisplayCommitScheduler::DisplayCommitScheduler()
+      : mStaggerEnabled(property_get_bool("vendor.display.commit_stagger.enabled", false)),
+        mContentionBandwidth(
+                property_get_int64("vendor.display.commit_stagger.contention_mbps",
+                                   kDefaultContentionBandwidth / 1000000) * 1000000) {}
+
+void DisplayCommitScheduler::onPreCommit(ExynosDisplay* display, uint64_t fetchBandwidth) {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    auto& phase = mDisplayPhases[display->mDisplayId];
+    // The retire fence signals on the vsync which latched the previous frame, which anchors the
+    // vsync phase of the display.
+    nsecs_t signalTime = getSignalTime(display->mLastRetireFence);
+    if (signalTime != SIGNAL_TIME_INVALID && signalTime != SIGNAL_TIME_PENDING && signalTime > 0) {
+        phase.vsyncTimestampNs = signalTime;
+    }
+    phase.vsyncPeriodNs = display->mVsyncPeriod;
+    phase.fetchBandwidth = fetchBandwidth;
+    phase.lastCommitNs = now;
+    phase.staggerCapable = display->isVrrSupported();
+
+    // Without a known phase, assume the frame is fetched right away.
+    int64_t startNs = now;
+    if ((phase.vsyncTimestampNs > 0) && (phase.vsyncPeriodNs > 0)) {
+        int64_t elapsedNs = now - phase.vsyncTimestampNs;
+        startNs = phase.vsyncTimestampNs +
+                ((elapsedNs + phase.vsyncPeriodNs - 1) / phase.vsyncPeriodNs) * phase.vsyncPeriodNs;
+    }
+    mTimeline.push_back({.displayId = display->mDisplayId,
+                         .startNs = startNs,
+                         .endNs = getFetchWindowEndLocked(phase, startNs),
+                         .bandwidth = fetchBandwidth});
+    pruneTimelineLocked(now);
+
+    uint64_t combined = getCombinedBandwidthAtLocked(startNs);
+    mPeakCombinedBandwidth = std::max(mPeakCombinedBandwidth, combined);
+    ATRACE_INT64("CombinedFetchBandwidthKBps", combined / 1000);
+}
+
+int64_t DisplayCommitScheduler::adjustExpectedPresentTime(ExynosDisplay* display,
+                                                          int64_t expectedPresentNs) {
+    if (!mStaggerEnabled) return expectedPresentNs;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto it = mDisplayPhases.find(display->mDisplayId);
+    if (it == mDisplayPhases.end()) return expectedPresentNs;
+    const auto& phase = it->second;
+    if (!phase.staggerCapable || phase.vsyncPeriodNs <= 0) return expectedPresentNs;
+
+    int64_t overlapEndNs = 0;
+    uint64_t overlapBandwidth = 0;
+    if (!findOverlapLocked(display->mDisplayId, expectedPresentNs,
+                           getFetchWindowEndLocked(phase, expectedPresentNs),
+                           phase.fetchBandwidth, &overlapEndNs, &overlapBandwidth)) {
+        return expectedPresentNs;
+    }
+    // Overlapping windows that the memory subsystem sustains are not worth a later present.
+    if (phase.fetchBandwidth + overlapBandwidth <= mContentionBandwidth) {
+        return expectedPresentNs;
+    }
+
+    // Move to the first TE after the overlapping fetch window, if it is close enough.
+    const int64_t teNs = phase.vsyncPeriodNs;
+    int64_t nudgedNs =
+            expectedPresentNs + ((overlapEndNs - expectedPresentNs + teNs - 1) / teNs) * teNs;
+    if (nudgedNs - expectedPresentNs > kMaxNudgeTeIntervals * teNs) {
+        return expectedPresentNs;
+    }
+    // The nudged window may run into the next window of another display; only move if it leaves
+    // the contention.
+    int64_t nudgedOverlapEndNs = 0;
+    uint64_t nudgedOverlapBandwidth = 0;
+    if (findOverlapLocked(display->mDisplayId, nudgedNs, getFetchWindowEndLocked(phase, nudgedNs),
+                          phase.fetchBandwidth, &nudgedOverlapEndNs, &nudgedOverlapBandwidth) &&
+        (phase.fetchBandwidth + nudgedOverlapBandwidth > mContentionBandwidth)) {
+        return expectedPresentNs;
+    }
+
+    ATRACE_NAME("nudgeExpectedPresentTime");
+    ++mNumNudgedCommits;
+    return nudgedNs;
+}
+
+void DisplayCommitScheduler::onExpectedPresentTime(ExynosDisplay* display,
+                                                   int64_t expectedPresentNs) {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto it = mDisplayPhases.find(display->mDisplayId);
+    if (it == mDisplayPhases.end()) return;
+
+    for (auto rit = mTimeline.rbegin(); rit != mTimeline.rend(); ++rit) {
+        if (rit->displayId == display->mDisplayId) {
+            rit->startNs = expectedPresentNs;
+            rit->endNs = getFetchWindowEndLocked(it->second, expectedPresentNs);
+            break;
+        }
+    }
+    uint64_t combined = getCombinedBandwidthAtLocked(expectedPresentNs);
+    mPeakCombinedBandwidth = std::max(mPeakCombinedBandwidth, combined);
+}
+
+uint64_t DisplayCommitScheduler::getPeakCombinedBandwidth() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mPeakCombinedBandwidth;
+}
+
+uint64_t DisplayCommitScheduler::getCombinedBandwidthAt(int64_t timeNs) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return getCombinedBandwidthAtLocked(timeNs);
+}
+
+uint64_t DisplayCommitScheduler::getCombinedBandwidthAtLocked(int64_t timeNs) const {
+    uint64_t combined = 0;
+    for (const auto& window : mTimeline) {
+        if ((window.startNs <= timeNs) && (timeNs < window.endNs)) {
+            combined += window.bandwidth;
+        }
+    }
+    return combined;
+}
+
+void DisplayCommitScheduler::dump(String8& result) {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    result.appendFormat("DisplayCommitScheduler: stagger %s, contention(%" PRIu64
+                        " KB/s), nudged commits(%" PRIu64 "), peak combined fetch bandwidth(%" PRIu64
+                        " KB/s)\n",
+                        mStaggerEnabled ? "enabled" : "disabled", mContentionBandwidth / 1000,
+                        mNumNudgedCommits, mPeakCombinedBandwidth / 1000);
+    for (const auto& [displayId, phase] : mDisplayPhases) {
+        bool active = (now - phase.lastCommitNs) < kInactiveDisplayTimeoutNs;
+        result.appendFormat("\tdisplay(%u): vsync phase(%" PRId64 "), period(%" PRId64
+                            "), fetch bandwidth(%" PRIu64 " KB/s), %s%s\n",
+                            displayId,
+                            phase.vsyncPeriodNs ? phase.vsyncTimestampNs % phase.vsyncPeriodNs : 0,
+                            phase.vsyncPeriodNs, phase.fetchBandwidth / 1000,
+                            active ? "active" : "inactive",
+                            phase.staggerCapable ? ", stagger capable" : "");
+    }
+    // Combined bandwidth timeline, sampled at the start of the most recent fetch windows.
+    result.appendFormat("\tcombined bandwidth timeline (time offset ms: KB/s):");
+    const size_t first = mTimeline.size() - std::min(mTimeline.size(), kMaxDumpTimelineEntries);
+    for (size_t i = first; i < mTimeline.size(); i++) {
+        const auto& window = mTimeline[i];
+        result.appendFormat(" %.1f: %" PRIu64, (window.startNs - now) / 1000000.0,
+                            getCombinedBandwidthAtLocked(window.startNs) / 1000);
+    }
+    result.appendFormat("\n");
+}
+
+int64_t DisplayCommitScheduler::getFetchWindowEndLocked(const DisplayPhase& phase,
+                                                        int64_t startNs) const {
+    return startNs + (phase.vsyncPeriodNs * kFetchWindowPercent) / 100;
+}
+
+bool DisplayCommitScheduler::findOverlapLocked(uint32_t displayId, int64_t startNs,
+                                               int64_t endNs, uint64_t bandwidth,
+                                               int64_t* outOverlapEndNs,
+                                               uint64_t* outOverlapBandwidth) const {
+    bool found = false;
+    for (const auto& [otherId, other] : mDisplayPhases) {
+        if ((otherId == displayId) || (other.vsyncPeriodNs <= 0) ||
+            (other.vsyncTimestampNs <= 0) ||
+            ((startNs - other.lastCommitNs) > kInactiveDisplayTimeoutNs)) {
+            continue;
+        }
+        // The lighter display yields to the heavier one; ties are broken by display id.
+        if ((other.fetchBandwidth < bandwidth) ||
+            ((other.fetchBandwidth == bandwidth) && (otherId > displayId))) {
+            continue;
+        }
+        // Check the fetch windows of |other| around |startNs|.
+        int64_t index = (startNs - other.vsyncTimestampNs) / other.vsyncPeriodNs;
+        bool overlaps = false;
+        for (int64_t k = index - 1; k <= index + 1; ++k) {
+            int64_t windowStartNs = other.vsyncTimestampNs + k * other.vsyncPeriodNs;
+            int64_t windowEndNs = getFetchWindowEndLocked(other, windowStartNs);
+            if ((windowStartNs < endNs) && (startNs < windowEndNs)) {
+                *outOverlapEndNs = found ? std::max(*outOverlapEndNs, windowEndNs) : windowEndNs;
+                found = true;
+                overlaps = true;
+            }
+        }
+        if (overlaps) *outOverlapBandwidth += other.fetchBandwidth;
+    }
+    return found;
+}
+
+void DisplayCommitScheduler::pruneTimelineLocked(int64_t nowNs) {
+    while (!mTimeline.empty() &&
+           ((mTimeline.size() > kMaxTimelineEntries) ||
+            (nowNs - mTimeline.front().endNs > kMaxTimelineDurationNs))) {
+        mTimeline.pop_front();
+    }
+    // Forget displays that stopped committing, e.g. a disconnected external display. A display
+    // that commits again gets its phase recorded anew by onPreCommit().
+    for (auto it = mDisplayPhases.begin(); it != mDisplayPhases.end();) {
+        if (nowNs - it->second.lastCommitNs > kMaxTimelineDurationNs) {
+            it = mDisplayPhases.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
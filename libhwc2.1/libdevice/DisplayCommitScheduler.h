@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _DISPLAY_COMMIT_SCHEDULER_H_
+#define _DISPLAY_COMMIT_SCHEDULER_H_
+
+#include <utils/String8.h>
+
+#include <deque>
+#include <map>
+#include <mutex>
+
+class ExynosDisplay;
+
+// DisplayCommitScheduler keeps track of the vsync phase and the window fetch bandwidth of every
+// display, and maintains the combined DPU fetch bandwidth timeline across displays.
+//
+// When several displays are active (e.g. both panels of a foldable, or a panel plus an external
+// display), their fetch windows may line up and the memory subsystem has to absorb the summed
+// peak. If staggering is enabled, a display whose panel accepts an arbitrary TE aligned present
+// time (VRR) gets its expected present time nudged past the fetch window of a heavier display,
+// as long as the combined bandwidth of the overlapping windows exceeds the contention threshold
+// and the delay stays within |kMaxNudgeTeIntervals| TE periods.
+class DisplayCommitScheduler {
+public:
+    DisplayCommitScheduler();
+
+    // Called right before the atomic commit of |display| with the fetch bandwidth of the frame
+    // in bytes per second.
+    void onPreCommit(ExynosDisplay* display, uint64_t fetchBandwidth);
+
+    // Returns the expected present time to program for |display|. It equals |expectedPresentNs|
+    // unless the frame is moved out of an overlapping fetch window of another display, and the
+    // moved window is clear of contention.
+    int64_t adjustExpectedPresentTime(ExynosDisplay* display, int64_t expectedPresentNs);
+
+    // Called with the expected present time finally programmed for the frame of |display|
+    // passed to the last onPreCommit(), which moves its fetch window on the timeline.
+    void onExpectedPresentTime(ExynosDisplay* display, int64_t expectedPresentNs);
+
+    // Peak combined fetch bandwidth over the recorded timeline, in bytes per second.
+    uint64_t getPeakCombinedBandwidth();
+
+    // Sum of the fetch bandwidth of all displays at |timeNs|, in bytes per second.
+    uint64_t getCombinedBandwidthAt(int64_t timeNs);
+
+    void dump(String8& result);
+
+private:
+    struct DisplayPhase {
+        int64_t vsyncTimestampNs = 0;
+        int64_t vsyncPeriodNs = 0;
+        uint64_t fetchBandwidth = 0;
+        int64_t lastCommitNs = 0;
+        bool staggerCapable = false;
+    };
+
+    struct FetchWindow {
+        uint32_t displayId;
+        int64_t startNs;
+        int64_t endNs;
+        uint64_t bandwidth;
+    };
+
+    static constexpr int64_t kMaxTimelineDurationNs = 1000000000; // 1 s
+    static constexpr size_t kMaxTimelineEntries = 512;
+    // A display that has not committed for this long no longer contributes to bandwidth peaks.
+    static constexpr int64_t kInactiveDisplayTimeoutNs = 100000000; // 100 ms
+    // Portion of a refresh period during which the DPU fetches the frame.
+    static constexpr int kFetchWindowPercent = 50;
+    static constexpr int kMaxNudgeTeIntervals = 1;
+    // Combined fetch bandwidth above which overlapping fetch windows are staggered, in bytes
+    // per second. Overridden by vendor.display.commit_stagger.contention_mbps.
+    static constexpr uint64_t kDefaultContentionBandwidth = 6000000000;
+    // Most recent timeline entries shown in the dump.
+    static constexpr size_t kMaxDumpTimelineEntries = 16;
+
+    uint64_t getCombinedBandwidthAtLocked(int64_t timeNs) const;
+    int64_t getFetchWindowEndLocked(const DisplayPhase& phase, int64_t startNs) const;
+    bool findOverlapLocked(uint32_t displayId, int64_t startNs, int64_t endNs,
+                           uint64_t bandwidth, int64_t* outOverlapEndNs,
+                           uint64_t* outOverlapBandwidth) const;
+    void pruneTimelineLocked(int64_t nowNs);
+
+    std::mutex mMutex;
+    bool mStaggerEnabled;
+    uint64_t mContentionBandwidth;
+    std::map<uint32_t, DisplayPhase> mDisplayPhases;
+    std::deque<FetchWindow> mTimeline;
+    uint64_t mPeakCombinedBandwidth = 0;
+    uint64_t mNumNudgedCommits = 0;
+};
+
+#endif // _DISPLAY_COMMIT_SCHEDULER_H_
@@ -108,6 +108,7 @@ ExynosDevice::ExynosDevice(bool vrrApiSupported)
      * ExynosResourceManager::updateRestrictions()
      */
     mResourceManager = new ExynosResourceManagerModule(this);
+    mCommitScheduler = std::make_unique<DisplayCommitScheduler>();
 
     for (size_t i = 0; i < AVAILABLE_DISPLAY_UNITS.size(); i++) {
         exynos_display_t display_t = AVAILABLE_DISPLAY_UNITS[i];
@@ -154,7 +155,7 @@ ExynosDevice::ExynosDevice(bool vrrApiSupported)
 #endif
     }
 
-    memset(mCallbackInfos, 0, sizeof(mCallbackInfos));
+    mCallbackTable = std::make_shared<const CallbackTable>();
 
     dynamicRecompositionThreadCreate();
 
@@ -181,6 +182,7 @@ ExynosDevice::ExynosDevice(bool vrrApiSupported)
     }
 
     mDisplayOffAsync = property_get_bool("vendor.display.async_off.supported", false);
+    mReleaseBufsInTUI = property_get_bool("vendor.display.tui.release_buffers", false);
     initDeviceInterface(mInterfaceType);
 
     // registerRestrictions();
@@ -447,6 +449,7 @@ void ExynosDevice::dump(String8& result, const std::vector<std::string>& args) {
 
     result.appendFormat("\n");
     mResourceManager->dump(result);
+    mCommitScheduler->dump(result);
 
     result.appendFormat("special plane num: %d:\n", getSpecialPlaneNum());
     for (uint32_t index = 0; index < getSpecialPlaneNum(); index++) {
@@ -480,19 +483,29 @@ int32_t ExynosDevice::registerCallback (
     if (descriptor < 0 || descriptor > HWC2_CALLBACK_SEAMLESS_POSSIBLE)
         return HWC2_ERROR_BAD_PARAMETER;
 
-    Mutex::Autolock lock(mDeviceCallbackMutex);
-    mCallbackInfos[descriptor].callbackData = callbackData;
-    mCallbackInfos[descriptor].funcPointer = point;
+    {
+        Mutex::Autolock lock(mDeviceCallbackMutex);
+        auto table = std::make_shared<CallbackTable>(*getCallbackTable());
+        table->hwc2[descriptor].callbackData = callbackData;
+        table->hwc2[descriptor].funcPointer = point;
+        publishCallbackTableLocked(std::move(table));
+    }
 
     /* Call hotplug callback for primary display*/
     if (descriptor == HWC2_CALLBACK_HOTPLUG) {
-        HWC2_PFN_HOTPLUG callbackFunc =
-                reinterpret_cast<HWC2_PFN_HOTPLUG>(mCallbackInfos[descriptor].funcPointer);
-        if (callbackFunc != nullptr) {
-            for (auto it : mDisplays) {
-                if (it->mPlugState)
-                    callbackFunc(callbackData, getDisplayId(it->mType, it->mIndex),
-                            HWC2_CONNECTION_CONNECTED);
+        if (point != nullptr) {
+            /* The callback may have been replaced since, so call it from the table */
+            Mutex::Autolock lock(mHotplugMutex);
+            const CallbackTableReader table(*this);
+            if (isCallbackRegistered(*table, HWC2_CALLBACK_HOTPLUG)) {
+                HWC2_PFN_HOTPLUG callbackFunc = reinterpret_cast<HWC2_PFN_HOTPLUG>(
+                        table->hwc2[HWC2_CALLBACK_HOTPLUG].funcPointer);
+                for (auto it : mDisplays) {
+                    if (it->mPlugState)
+                        callbackFunc(table->hwc2[HWC2_CALLBACK_HOTPLUG].callbackData,
+                                     getDisplayId(it->mType, it->mIndex),
+                                     HWC2_CONNECTION_CONNECTED);
+                }
             }
         } else {
             // unregistering callback can be used as a sign of ComposerClient's death
@@ -508,14 +521,57 @@ int32_t ExynosDevice::registerCallback (
     return HWC2_ERROR_NONE;
 }
 
-bool ExynosDevice::isCallbackRegisteredLocked(int32_t descriptor) {
+ExynosDevice::CallbackTableReader::CallbackTableReader(ExynosDevice &device) : mDevice(device) {
+    /*
+     * Count in the readers of the current epoch before taking the table. A writer
+     * that advanced the epoch meanwhile may have already found no reader, so count
+     * in the new epoch instead. The increment and the second epoch load are
+     * sequentially consistent, like the epoch increment and the reader count load
+     * of the writer, so that either the writer sees this reader or this reader
+     * sees the new epoch.
+     */
+    while (true) {
+        mEpoch = mDevice.mCallbackEpoch.load(std::memory_order_acquire);
+        mDevice.mCallbackReaders[mEpoch & 1].fetch_add(1, std::memory_order_seq_cst);
+        if (mDevice.mCallbackEpoch.load(std::memory_order_seq_cst) == mEpoch) break;
+        mDevice.mCallbackReaders[mEpoch & 1].fetch_sub(1, std::memory_order_release);
+    }
+    mTable = mDevice.getCallbackTable();
+}
+
+ExynosDevice::CallbackTableReader::~CallbackTableReader() {
+    mDevice.mCallbackReaders[mEpoch & 1].fetch_sub(1, std::memory_order_release);
+}
+
+void ExynosDevice::publishCallbackTableLocked(std::shared_ptr<const CallbackTable> table) {
+    std::atomic_store(&mCallbackTable, std::move(table));
+    const uint32_t epoch = mCallbackEpoch.fetch_add(1, std::memory_order_seq_cst);
+
+    /*
+     * Wait for the callbacks being called from the previous table to return,
+     * since the client may free the data of a callback once it is replaced.
+     * The wait is bounded, since a callback may itself register a callback.
+     */
+    const nsecs_t deadline = systemTime(SYSTEM_TIME_MONOTONIC) + kCallbackDrainTimeoutNs;
+    int32_t readers;
+    while ((readers = mCallbackReaders[epoch & 1].load(std::memory_order_seq_cst)) > 0) {
+        if (systemTime(SYSTEM_TIME_MONOTONIC) >= deadline) {
+            ALOGE("%s: %d callbacks of the previous table did not return in %d ms", __func__,
+                  readers, static_cast<int>(ns2ms(kCallbackDrainTimeoutNs)));
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+bool ExynosDevice::isCallbackRegistered(const CallbackTable &table, int32_t descriptor) {
     if (descriptor < 0 || descriptor > HWC2_CALLBACK_SEAMLESS_POSSIBLE) {
         ALOGE("%s:: %d callback is unknown", __func__, descriptor);
         return false;
     }
 
-    if (mCallbackInfos[descriptor].callbackData == nullptr ||
-        mCallbackInfos[descriptor].funcPointer == nullptr) {
+    if (table.hwc2[descriptor].callbackData == nullptr ||
+        table.hwc2[descriptor].funcPointer == nullptr) {
         ALOGE("%s:: %d callback is not registered", __func__, descriptor);
         return false;
     }
@@ -523,9 +579,20 @@ bool ExynosDevice::isCallbackRegisteredLocked(int32_t descriptor) {
     return true;
 }
 
+const exynos_callback_info_t *ExynosDevice::findHwc3Callback(const CallbackTable &table,
+                                                             uint32_t descriptor) {
+    const auto &callback = table.hwc3.find(descriptor);
+    if (callback == table.hwc3.end()) return nullptr;
+
+    const auto &callbackInfo = callback->second;
+    if (callbackInfo.funcPointer == nullptr || callbackInfo.callbackData == nullptr)
+        return nullptr;
+
+    return &callbackInfo;
+}
+
 bool ExynosDevice::isCallbackAvailable(int32_t descriptor) {
-    Mutex::Autolock lock(mDeviceCallbackMutex);
-    return isCallbackRegisteredLocked(descriptor);
+    return isCallbackRegistered(*getCallbackTable(), descriptor);
 }
 
 using DisplayHotplugEvent = aidl::android::hardware::graphics::common::DisplayHotplugEvent;
@@ -550,7 +617,7 @@ ExynosDisplay* ExynosDevice::findPoweredOffPrimaryDisplay(ExynosDisplay* exclude
 }
 
 void ExynosDevice::onHotPlug(uint32_t displayId, bool status, int hotplugErrorCode) {
-    Mutex::Autolock lock(mDeviceCallbackMutex);
+    Mutex::Autolock lock(mHotplugMutex);
 
     // If we detect a hotplug of an external display on a foldable device, and we have a
     // primary/built-in display in a powered off state, we need to use the powered off display's
@@ -591,36 +658,35 @@ void ExynosDevice::onHotPlug(uint32_t displayId, bool status, int hotplugErrorCo
         }
     }
 
+    const CallbackTableReader table(*this);
+
     // If the new HotplugEvent API is available, use it, otherwise fall back
     // to the old V2 API with onVsync hack, if necessary.
-    const auto& hotplugEventCallback =
-            mHwc3CallbackInfos.find(IComposerCallback::TRANSACTION_onHotplugEvent);
-    if (hotplugEventCallback != mHwc3CallbackInfos.end()) {
-        const auto& callbackInfo = hotplugEventCallback->second;
-        if (callbackInfo.funcPointer != nullptr && callbackInfo.callbackData != nullptr) {
-            auto callbackFunc = reinterpret_cast<
-                    void (*)(hwc2_callback_data_t callbackData, hwc2_display_t hwcDisplay,
-                             aidl::android::hardware::graphics::common::DisplayHotplugEvent)>(
-                    callbackInfo.funcPointer);
-            callbackFunc(callbackInfo.callbackData, displayId,
-                         hotplug_event_to_aidl(status, hotplugErrorCode));
-            return;
-        }
+    const auto* hotplugEventCallback =
+            findHwc3Callback(*table, IComposerCallback::TRANSACTION_onHotplugEvent);
+    if (hotplugEventCallback != nullptr) {
+        auto callbackFunc = reinterpret_cast<
+                void (*)(hwc2_callback_data_t callbackData, hwc2_display_t hwcDisplay,
+                         aidl::android::hardware::graphics::common::DisplayHotplugEvent)>(
+                hotplugEventCallback->funcPointer);
+        callbackFunc(hotplugEventCallback->callbackData, displayId,
+                     hotplug_event_to_aidl(status, hotplugErrorCode));
+        return;
     }
 
-    if (!isCallbackRegisteredLocked(HWC2_CALLBACK_HOTPLUG)) return;
+    if (!isCallbackRegistered(*table, HWC2_CALLBACK_HOTPLUG)) return;
 
     if (hotplugErrorCode) {
         // We need to pass the error code to SurfaceFlinger, but we cannot modify the HWC
         // HAL interface, so for now we'll send the hotplug error via a onVsync callback with
         // a negative time value indicating the hotplug error.
-        if (isCallbackRegisteredLocked(HWC2_CALLBACK_VSYNC_2_4)) {
+        if (isCallbackRegistered(*table, HWC2_CALLBACK_VSYNC_2_4)) {
             ALOGD("%s: hotplugErrorCode=%d sending to SF via onVsync_2_4", __func__,
                   hotplugErrorCode);
             hwc2_callback_data_t vsyncCallbackData =
-                    mCallbackInfos[HWC2_CALLBACK_VSYNC_2_4].callbackData;
+                    table->hwc2[HWC2_CALLBACK_VSYNC_2_4].callbackData;
             HWC2_PFN_VSYNC_2_4 vsyncCallbackFunc = reinterpret_cast<HWC2_PFN_VSYNC_2_4>(
-                    mCallbackInfos[HWC2_CALLBACK_VSYNC_2_4].funcPointer);
+                    table->hwc2[HWC2_CALLBACK_VSYNC_2_4].funcPointer);
             vsyncCallbackFunc(vsyncCallbackData, displayId, -hotplugErrorCode, ~0);
             return;
         } else {
@@ -630,9 +696,9 @@ void ExynosDevice::onHotPlug(uint32_t displayId, bool status, int hotplugErrorCo
         }
     }
 
-    hwc2_callback_data_t callbackData = mCallbackInfos[HWC2_CALLBACK_HOTPLUG].callbackData;
+    hwc2_callback_data_t callbackData = table->hwc2[HWC2_CALLBACK_HOTPLUG].callbackData;
     HWC2_PFN_HOTPLUG callbackFunc =
-            reinterpret_cast<HWC2_PFN_HOTPLUG>(mCallbackInfos[HWC2_CALLBACK_HOTPLUG].funcPointer);
+            reinterpret_cast<HWC2_PFN_HOTPLUG>(table->hwc2[HWC2_CALLBACK_HOTPLUG].funcPointer);
     callbackFunc(callbackData, displayId,
                  status ? HWC2_CONNECTION_CONNECTED : HWC2_CONNECTION_DISCONNECTED);
 }
@@ -644,9 +710,12 @@ void ExynosDevice::onRefreshDisplays() {
 }
 
 void ExynosDevice::onRefresh(uint32_t displayId) {
-    Mutex::Autolock lock(mDeviceCallbackMutex);
+    const CallbackTableReader table(*this);
+
+    if (!isCallbackRegistered(*table, HWC2_CALLBACK_REFRESH)) return;
 
-    if (!isCallbackRegisteredLocked(HWC2_CALLBACK_REFRESH)) return;
+    /* Frames are dropped until TUI exits, which requests its own refresh */
+    if (isInTUI()) return;
 
     if (!checkDisplayConnection(displayId)) return;
 
@@ -656,31 +725,31 @@ void ExynosDevice::onRefresh(uint32_t displayId) {
              (display->mPowerModeState.value() == (hwc2_power_mode_t)HWC_POWER_MODE_OFF))
         return;
 
-    hwc2_callback_data_t callbackData = mCallbackInfos[HWC2_CALLBACK_REFRESH].callbackData;
+    hwc2_callback_data_t callbackData = table->hwc2[HWC2_CALLBACK_REFRESH].callbackData;
     HWC2_PFN_REFRESH callbackFunc =
-            reinterpret_cast<HWC2_PFN_REFRESH>(mCallbackInfos[HWC2_CALLBACK_REFRESH].funcPointer);
+            reinterpret_cast<HWC2_PFN_REFRESH>(table->hwc2[HWC2_CALLBACK_REFRESH].funcPointer);
     callbackFunc(callbackData, displayId);
 }
 
 void ExynosDevice::onVsync(uint32_t displayId, int64_t timestamp) {
-    Mutex::Autolock lock(mDeviceCallbackMutex);
+    const CallbackTableReader table(*this);
 
-    if (!isCallbackRegisteredLocked(HWC2_CALLBACK_VSYNC)) return;
+    if (!isCallbackRegistered(*table, HWC2_CALLBACK_VSYNC)) return;
 
-    hwc2_callback_data_t callbackData = mCallbackInfos[HWC2_CALLBACK_VSYNC].callbackData;
+    hwc2_callback_data_t callbackData = table->hwc2[HWC2_CALLBACK_VSYNC].callbackData;
     HWC2_PFN_VSYNC callbackFunc =
-            reinterpret_cast<HWC2_PFN_VSYNC>(mCallbackInfos[HWC2_CALLBACK_VSYNC].funcPointer);
+            reinterpret_cast<HWC2_PFN_VSYNC>(table->hwc2[HWC2_CALLBACK_VSYNC].funcPointer);
     callbackFunc(callbackData, displayId, timestamp);
 }
 
 bool ExynosDevice::onVsync_2_4(uint32_t displayId, int64_t timestamp, uint32_t vsyncPeriod) {
-    Mutex::Autolock lock(mDeviceCallbackMutex);
+    const CallbackTableReader table(*this);
 
-    if (!isCallbackRegisteredLocked(HWC2_CALLBACK_VSYNC_2_4)) return false;
+    if (!isCallbackRegistered(*table, HWC2_CALLBACK_VSYNC_2_4)) return false;
 
-    hwc2_callback_data_t callbackData = mCallbackInfos[HWC2_CALLBACK_VSYNC_2_4].callbackData;
+    hwc2_callback_data_t callbackData = table->hwc2[HWC2_CALLBACK_VSYNC_2_4].callbackData;
     HWC2_PFN_VSYNC_2_4 callbackFunc = reinterpret_cast<HWC2_PFN_VSYNC_2_4>(
-            mCallbackInfos[HWC2_CALLBACK_VSYNC_2_4].funcPointer);
+            table->hwc2[HWC2_CALLBACK_VSYNC_2_4].funcPointer);
     callbackFunc(callbackData, displayId, timestamp, vsyncPeriod);
 
     return true;
@@ -688,52 +757,50 @@ bool ExynosDevice::onVsync_2_4(uint32_t displayId, int64_t timestamp, uint32_t v
 
 void ExynosDevice::onVsyncPeriodTimingChanged(uint32_t displayId,
                                               hwc_vsync_period_change_timeline_t *timeline) {
-    Mutex::Autolock lock(mDeviceCallbackMutex);
+    const CallbackTableReader table(*this);
 
     if (!timeline) {
         ALOGE("vsync period change timeline is null");
         return;
     }
 
-    if (!isCallbackRegisteredLocked(HWC2_CALLBACK_VSYNC_PERIOD_TIMING_CHANGED)) return;
+    if (!isCallbackRegistered(*table, HWC2_CALLBACK_VSYNC_PERIOD_TIMING_CHANGED)) return;
 
     hwc2_callback_data_t callbackData =
-            mCallbackInfos[HWC2_CALLBACK_VSYNC_PERIOD_TIMING_CHANGED].callbackData;
+            table->hwc2[HWC2_CALLBACK_VSYNC_PERIOD_TIMING_CHANGED].callbackData;
     HWC2_PFN_VSYNC_PERIOD_TIMING_CHANGED callbackFunc =
             reinterpret_cast<HWC2_PFN_VSYNC_PERIOD_TIMING_CHANGED>(
-                    mCallbackInfos[HWC2_CALLBACK_VSYNC_PERIOD_TIMING_CHANGED].funcPointer);
+                    table->hwc2[HWC2_CALLBACK_VSYNC_PERIOD_TIMING_CHANGED].funcPointer);
     callbackFunc(callbackData, displayId, timeline);
 }
 
 void ExynosDevice::onContentProtectionUpdated(uint32_t displayId, HdcpLevels hdcpLevels) {
-    Mutex::Autolock lock(mDeviceCallbackMutex);
+    const CallbackTableReader table(*this);
 
     // If the new HdcpLevelsChanged HAL API is available, use it, otherwise fall back
     // to the old V2 API with onVsync hack, if necessary.
-    const auto& hdcpLevelsChangedCallback =
-            mHwc3CallbackInfos.find(IComposerCallback::TRANSACTION_onHdcpLevelsChanged);
-    if (hdcpLevelsChangedCallback != mHwc3CallbackInfos.end()) {
-        const auto& callbackInfo = hdcpLevelsChangedCallback->second;
-        if (callbackInfo.funcPointer != nullptr && callbackInfo.callbackData != nullptr) {
-            auto callbackFunc = reinterpret_cast<
-                    void (*)(hwc2_callback_data_t callbackData, hwc2_display_t hwcDisplay,
-                             aidl::android::hardware::drm::HdcpLevels)>(callbackInfo.funcPointer);
-            ALOGD("%s: displayId=%u hdcpLevels=%s sending to SF via v3 HAL", __func__, displayId,
-                  hdcpLevels.toString().c_str());
-            callbackFunc(callbackInfo.callbackData, displayId, hdcpLevels);
-            return;
-        }
+    const auto* hdcpLevelsChangedCallback =
+            findHwc3Callback(*table, IComposerCallback::TRANSACTION_onHdcpLevelsChanged);
+    if (hdcpLevelsChangedCallback != nullptr) {
+        auto callbackFunc = reinterpret_cast<
+                void (*)(hwc2_callback_data_t callbackData, hwc2_display_t hwcDisplay,
+                         aidl::android::hardware::drm::HdcpLevels)>(
+                hdcpLevelsChangedCallback->funcPointer);
+        ALOGD("%s: displayId=%u hdcpLevels=%s sending to SF via v3 HAL", __func__, displayId,
+              hdcpLevels.toString().c_str());
+        callbackFunc(hdcpLevelsChangedCallback->callbackData, displayId, hdcpLevels);
+        return;
     }
 
     // Workaround to pass content protection updates to SurfaceFlinger
     // without changing HWC HAL interface.
-    if (isCallbackRegisteredLocked(HWC2_CALLBACK_VSYNC_2_4)) {
+    if (isCallbackRegistered(*table, HWC2_CALLBACK_VSYNC_2_4)) {
         ALOGI("%s: displayId=%u hdcpLevels=%s sending to SF via onVsync_2_4", __func__, displayId,
               hdcpLevels.toString().c_str());
         hwc2_callback_data_t vsyncCallbackData =
-                mCallbackInfos[HWC2_CALLBACK_VSYNC_2_4].callbackData;
+                table->hwc2[HWC2_CALLBACK_VSYNC_2_4].callbackData;
         HWC2_PFN_VSYNC_2_4 vsyncCallbackFunc = reinterpret_cast<HWC2_PFN_VSYNC_2_4>(
-                mCallbackInfos[HWC2_CALLBACK_VSYNC_2_4].funcPointer);
+                table->hwc2[HWC2_CALLBACK_VSYNC_2_4].funcPointer);
         int32_t connectedLevel = static_cast<int32_t>(hdcpLevels.connectedLevel);
         int32_t maxLevel = static_cast<int32_t>(hdcpLevels.maxLevel);
         int32_t timestampValue = (connectedLevel & 0xFF) | ((maxLevel & 0xFF) << 8);
@@ -1327,65 +1394,113 @@ uint64_t ExynosDevice::getSpecialPlaneAttr(uint32_t index)
 int32_t ExynosDevice::registerHwc3Callback(uint32_t descriptor, hwc2_callback_data_t callbackData,
                                            hwc2_function_pointer_t point) {
     Mutex::Autolock lock(mDeviceCallbackMutex);
-    mHwc3CallbackInfos[descriptor].callbackData = callbackData;
-    mHwc3CallbackInfos[descriptor].funcPointer = point;
+    auto table = std::make_shared<CallbackTable>(*getCallbackTable());
+    table->hwc3[descriptor].callbackData = callbackData;
+    table->hwc3[descriptor].funcPointer = point;
+    publishCallbackTableLocked(std::move(table));
 
     return HWC2_ERROR_NONE;
 }
 
 void ExynosDevice::onVsyncIdle(hwc2_display_t displayId) {
-    Mutex::Autolock lock(mDeviceCallbackMutex);
-    const auto &idleCallback = mHwc3CallbackInfos.find(IComposerCallback::TRANSACTION_onVsyncIdle);
+    const CallbackTableReader table(*this);
+    const auto *callbackInfo = findHwc3Callback(*table, IComposerCallback::TRANSACTION_onVsyncIdle);
 
-    if (idleCallback == mHwc3CallbackInfos.end()) return;
-
-    const auto &callbackInfo = idleCallback->second;
-    if (callbackInfo.funcPointer == nullptr || callbackInfo.callbackData == nullptr) return;
+    if (callbackInfo == nullptr) return;
 
     auto callbackFunc =
             reinterpret_cast<void (*)(hwc2_callback_data_t callbackData,
-                                      hwc2_display_t hwcDisplay)>(callbackInfo.funcPointer);
-    callbackFunc(callbackInfo.callbackData, displayId);
+                                      hwc2_display_t hwcDisplay)>(callbackInfo->funcPointer);
+    callbackFunc(callbackInfo->callbackData, displayId);
 }
 
 void ExynosDevice::handleHotplug() {
-    bool hpdStatus = false;
-
     for (size_t i = 0; i < mDisplays.size(); i++) {
         if (mDisplays[i] == nullptr) {
             continue;
         }
 
-        // Lock mDisplayMutex during hotplug processing.
-        // Must-have for unplug handling so that in-flight calls to
-        // validateDisplay() and presentDisplay() don't race with
-        // the display being removed.
-        Mutex::Autolock lock(mDisplays[i]->mDisplayMutex);
+        handleDisplayHotplug(mDisplays[i]);
+    }
+}
+
+void ExynosDevice::handleDisplayHotplug(ExynosDisplay *display) {
+    bool hpdStatus = false;
+
+    // Lock mDisplayMutex during hotplug processing.
+    // Must-have for unplug handling so that in-flight calls to
+    // validateDisplay() and presentDisplay() don't race with
+    // the display being removed.
+    Mutex::Autolock lock(display->mDisplayMutex);
 
-        if (mDisplays[i]->checkHotplugEventUpdated(hpdStatus)) {
-            mDisplays[i]->handleHotplugEvent(hpdStatus);
-            mDisplays[i]->hotplug();
-            mDisplays[i]->invalidate();
+    if (display->checkHotplugEventUpdated(hpdStatus)) {
+        display->handleHotplugEvent(hpdStatus);
+        display->hotplug();
+        display->invalidate();
+    }
+}
+
+void ExynosDevice::enterToTUI() {
+    ATRACE_CALL();
+    if (mIsInTUI.exchange(true)) return;
+
+    ALOGI("%s: frames are dropped until TUI exits", __func__);
+    /*
+     * Buffers in use keep the last composition for the first frame after TUI.
+     * Only the preallocated ones are released, and predicted again on exit.
+     */
+    if (mReleaseBufsInTUI) mResourceManager->releasePreallocatedDstBufs();
+}
+
+void ExynosDevice::exitFromTUI() {
+    ATRACE_CALL();
+    if (!mIsInTUI.load()) return;
+
+    if (mReleaseBufsInTUI) {
+        for (auto display : mDisplays) {
+            bool powerOn;
+            uint32_t xres, yres;
+            {
+                Mutex::Autolock lock(display->mDisplayMutex);
+                powerOn = display->mPowerModeState.has_value() &&
+                        (display->mPowerModeState.value() !=
+                         (hwc2_power_mode_t)HWC_POWER_MODE_OFF);
+                xres = display->mXres;
+                yres = display->mYres;
+            }
+            if (powerOn) mResourceManager->predictDstBufs(display, xres, yres);
         }
     }
+
+    mTUIExitTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    mIsInTUI = false;
+    /* The layers still hold the plan of the last frame before TUI */
+    onRefreshDisplays();
+}
+
+void ExynosDevice::onFrameCommitted(uint32_t displayId) {
+    if (mTUIExitTime.load(std::memory_order_relaxed) == 0) return;
+
+    const nsecs_t exitTime = mTUIExitTime.exchange(0);
+    if (exitTime == 0) return;
+
+    ALOGI("%s: display %u committed the first frame %.2f ms after TUI exit", __func__, displayId,
+          (systemTime(SYSTEM_TIME_MONOTONIC) - exitTime) / 1000000.0f);
 }
 
 void ExynosDevice::onRefreshRateChangedDebug(hwc2_display_t displayId, uint32_t vsyncPeriod,
                                              uint32_t refreshPeriod) {
-    Mutex::Autolock lock(mDeviceCallbackMutex);
-    const auto &refreshRateCallback =
-            mHwc3CallbackInfos.find(IComposerCallback::TRANSACTION_onRefreshRateChangedDebug);
-
-    if (refreshRateCallback == mHwc3CallbackInfos.end()) return;
+    const CallbackTableReader table(*this);
+    const auto *callbackInfo =
+            findHwc3Callback(*table, IComposerCallback::TRANSACTION_onRefreshRateChangedDebug);
 
-    const auto &callbackInfo = refreshRateCallback->second;
-    if (callbackInfo.funcPointer == nullptr || callbackInfo.callbackData == nullptr) return;
+    if (callbackInfo == nullptr) return;
 
     ATRACE_INT("Refresh rate indicator callback",
                static_cast<int>(std::nano::den / (refreshPeriod ?: vsyncPeriod)));
 
     auto callbackFunc =
             reinterpret_cast<void (*)(hwc2_callback_data_t callbackData, hwc2_display_t hwcDisplay,
-                                      hwc2_vsync_period_t, int32_t)>(callbackInfo.funcPointer);
-    callbackFunc(callbackInfo.callbackData, displayId, vsyncPeriod, refreshPeriod ?: vsyncPeriod);
+                                      hwc2_vsync_period_t, int32_t)>(callbackInfo->funcPointer);
+    callbackFunc(callbackInfo->callbackData, displayId, vsyncPeriod, refreshPeriod ?: vsyncPeriod);
 }
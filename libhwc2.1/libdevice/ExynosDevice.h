@@ -35,8 +35,10 @@
 
 #include <atomic>
 #include <map>
+#include <memory>
 #include <thread>
 
+#include "DisplayCommitScheduler.h"
 #include "ExynosDeviceInterface.h"
 #include "ExynosHWC.h"
 #include "ExynosHWCHelper.h"
@@ -167,6 +169,11 @@ class ExynosDevice {
          */
         ExynosResourceManager *mResourceManager;
 
+        /**
+         * Tracks the fetch bandwidth of all displays and staggers their commits
+         */
+        std::unique_ptr<DisplayCommitScheduler> mCommitScheduler;
+
         /**
          * Geometry change will be saved by bit map.
          * ex) Display create/destory.
@@ -190,11 +197,27 @@ class ExynosDevice {
          * - HotplugCallback: Hot plug event by new display hardware.
          */
 
-        /** TODO : Array size shuld be checked */
-        exynos_callback_info_t mCallbackInfos[HWC2_CALLBACK_SEAMLESS_POSSIBLE + 1];
+        struct CallbackTable {
+            /** TODO : Array size shuld be checked */
+            exynos_callback_info_t hwc2[HWC2_CALLBACK_SEAMLESS_POSSIBLE + 1] = {};
+            std::map<uint32_t, exynos_callback_info_t> hwc3;
+        };
 
-        std::map<uint32_t, exynos_callback_info_t> mHwc3CallbackInfos;
+        /**
+         * Callbacks are called from a snapshot of the table without a lock, so that
+         * the callbacks of a display don't wait for the delivery to another display.
+         * A caller counts itself in mCallbackReaders for the parity of the epoch it
+         * read the table in. Registration publishes a new table under
+         * mDeviceCallbackMutex, advances mCallbackEpoch and waits, for up to
+         * kCallbackDrainTimeoutNs, for the readers of the previous epoch to return.
+         * mHotplugMutex keeps hotplug events in order without blocking registration.
+         */
+        std::shared_ptr<const CallbackTable> mCallbackTable;
+        std::atomic<uint32_t> mCallbackEpoch = 0;
+        std::atomic<int32_t> mCallbackReaders[2] = {0, 0};
+        static constexpr nsecs_t kCallbackDrainTimeoutNs = 500000000;
         Mutex mDeviceCallbackMutex;
+        Mutex mHotplugMutex;
 
         /**
          * Thread variables
@@ -371,20 +394,51 @@ class ExynosDevice {
         Mutex mCaptureMutex;
         Condition mCaptureCondition;
         std::atomic<bool> mIsWaitingReadbackReqDone = false;
-        bool isCallbackRegisteredLocked(int32_t descriptor);
+        std::shared_ptr<const CallbackTable> getCallbackTable() const {
+            return std::atomic_load(&mCallbackTable);
+        }
+        /* Holds a snapshot of the callback table while callbacks are called from it */
+        class CallbackTableReader {
+        public:
+            explicit CallbackTableReader(ExynosDevice &device);
+            ~CallbackTableReader();
+            const CallbackTable &operator*() const { return *mTable; }
+            const CallbackTable *operator->() const { return mTable.get(); }
+
+        private:
+            ExynosDevice &mDevice;
+            uint32_t mEpoch;
+            std::shared_ptr<const CallbackTable> mTable;
+        };
+        void publishCallbackTableLocked(std::shared_ptr<const CallbackTable> table);
+        static bool isCallbackRegistered(const CallbackTable &table, int32_t descriptor);
+        static const exynos_callback_info_t *findHwc3Callback(const CallbackTable &table,
+                                                              uint32_t descriptor);
 
     public:
-        void enterToTUI() { mIsInTUI = true; };
-        void exitFromTUI() { mIsInTUI = false; };
-        bool isInTUI() { return mIsInTUI; };
+        /*
+         * While the kernel owns the display for TUI, validate and present are
+         * no-ops, refresh requests are not sent and the layers keep their last
+         * composition. Exiting requests a refresh that starts from that plan.
+         */
+        void enterToTUI();
+        void exitFromTUI();
+        bool isInTUI() { return mIsInTUI.load(std::memory_order_relaxed); };
+        /* Called when a frame is committed to measure the first frame after TUI */
+        void onFrameCommitted(uint32_t displayId);
 
     private:
-        bool mIsInTUI;
+        std::atomic<bool> mIsInTUI;
+        /* Whether preallocated M2M dst buffers are released during TUI */
+        bool mReleaseBufsInTUI = false;
+        /* Time of the last TUI exit until a frame is committed, 0 otherwise */
+        std::atomic<nsecs_t> mTUIExitTime = 0;
         bool mDisplayOffAsync;
         bool mVrrApiSupported = false;
 
     public:
         void handleHotplug();
+        void handleDisplayHotplug(ExynosDisplay *display);
 };
 
 #endif //_EXYNOSDEVICE_H
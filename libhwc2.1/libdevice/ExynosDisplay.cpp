@@ -840,6 +840,7 @@ ExynosCompositionInfo::ExynosCompositionInfo(uint32_t type)
         mCompressionInfo.type = COMP_TYPE_NONE;
     else
         mCompressionInfo.type = COMP_TYPE_AFBC;
+    mDefaultCompressionType = mCompressionInfo.type;
 
     memset(&mSkipSrcInfo, 0, sizeof(mSkipSrcInfo));
     for (int i = 0; i < NUM_SKIP_STATIC_LAYER; i++) {
@@ -1063,7 +1064,7 @@ ExynosDisplay::ExynosDisplay(uint32_t type, uint32_t index, ExynosDevice* device
 
     mDisplayConfigs.clear();
 
-    mPowerModeState = std::nullopt;
+    setPowerModeState(std::nullopt);
 
     mVsyncState = HWC2_VSYNC_DISABLE;
 
@@ -1200,6 +1201,7 @@ int32_t ExynosDisplay::destroyLayer(hwc2_layer_t outLayer) {
     layer->resetAssignedResource();
 
     delete layer;
+    publishLayerListState();
 
     if (mPlugState == false) {
         DISPLAY_LOGI("%s : destroyLayer is done. But display is already disconnected",
@@ -1226,6 +1228,7 @@ void ExynosDisplay::destroyLayers() {
         it = mIgnoreLayers.erase(it);
         delete layer;
     }
+    publishLayerListState();
 }
 
 ExynosLayer *ExynosDisplay::checkLayer(hwc2_layer_t addr) {
@@ -1758,6 +1761,36 @@ bool ExynosDisplay::shouldSignalNonIdle(void) {
     return false;
 }
 
+void ExynosDisplay::updateIdleTeAlignment() {
+    if (!mIdleTeAlignmentPolicy.isIdle()) return;
+
+    bool m2mUpdated = false;
+    uint64_t damagedArea = 0;
+    for (size_t i = 0; i < mLayers.size(); i++) {
+        ExynosLayer* layer = mLayers[i];
+        if (layer->mLastLayerBuffer == layer->mLayerBuffer) continue;
+
+        if ((layer->mM2mMPP != nullptr) ||
+            (layer->mExynosCompositionType == HWC2_COMPOSITION_EXYNOS)) {
+            m2mUpdated = true;
+            break;
+        }
+
+        const uint64_t frameArea =
+                static_cast<uint64_t>(WIDTH(layer->mDisplayFrame)) * HEIGHT(layer->mDisplayFrame);
+        /* No damage rect means the whole layer is damaged */
+        uint64_t layerArea = (layer->mDamageNum == 0) ? frameArea : 0;
+        for (size_t j = 0; j < layer->mDamageRects.size(); j++) {
+            layerArea += static_cast<uint64_t>(WIDTH(layer->mDamageRects[j])) *
+                    HEIGHT(layer->mDamageRects[j]);
+        }
+        damagedArea += std::min(layerArea, frameArea);
+    }
+
+    mIdleTeAlignmentPolicy.onFrame(mGeometryChanged != 0, m2mUpdated, damagedArea,
+                                   static_cast<uint64_t>(mXres) * mYres);
+}
+
 /**
  * @return int
  */
@@ -1848,6 +1881,10 @@ int ExynosDisplay::doExynosComposition() {
             return -EINVAL;
         }
 
+        /* The output compression was decided in validate by assignCompositionTarget() */
+        if (mExynosCompositionInfo.mDefaultCompressionType == COMP_TYPE_AFBC)
+            mExynosCompositionInfo.mDstImg.compressionInfo = mExynosCompositionInfo.mCompressionInfo;
+
         if ((ret = mExynosCompositionInfo.mM2mMPP->doPostProcessing(
                      mExynosCompositionInfo.mDstImg)) != NO_ERROR) {
             DISPLAY_LOGE("exynosComposition doPostProcessing fail ret(%d)", ret);
@@ -2983,7 +3020,7 @@ bool ExynosDisplay::checkFrameValidation() {
 
 int32_t ExynosDisplay::acceptDisplayChanges() {
     int32_t type = 0;
-    if (mDropFrameDuringResSwitch) {
+    if (mDropFrameDuringResSwitch || mDevice->isInTUI()) {
         return HWC2_ERROR_NONE;
     }
     if (mRenderingState != RENDERING_STATE_VALIDATED) {
@@ -3032,13 +3069,14 @@ int32_t ExynosDisplay::createLayer(hwc2_layer_t* outLayer) {
 
     *outLayer = (hwc2_layer_t)layer;
     setGeometryChanged(GEOMETRY_DISPLAY_LAYER_ADDED);
+    publishLayerListState();
 
     return HWC2_ERROR_NONE;
 }
 
 int32_t ExynosDisplay::getActiveConfig(hwc2_config_t* outConfig)
 {
-    Mutex::Autolock lock(mDisplayMutex);
+    /* mActiveConfig is published, the config domain is not taken for reads */
     return getActiveConfigInternal(outConfig);
 }
 
@@ -3087,7 +3125,7 @@ int32_t ExynosDisplay::getLayerCompositionTypeForValidationType(uint32_t layerIn
 int32_t ExynosDisplay::getChangedCompositionTypes(
         uint32_t* outNumElements, hwc2_layer_t* outLayers,
         int32_t* /*hwc2_composition_t*/ outTypes) {
-    if (mDropFrameDuringResSwitch) {
+    if (mDropFrameDuringResSwitch || mDevice->isInTUI()) {
         if ((outLayers == NULL) || (outTypes == NULL)) {
             *outNumElements = 0;
         }
@@ -3258,7 +3296,7 @@ int32_t ExynosDisplay::getDisplayRequests(
     String8 errString;
     *outDisplayRequests = 0;
 
-    if (mDropFrameDuringResSwitch) {
+    if (mDropFrameDuringResSwitch || mDevice->isInTUI()) {
         if ((outLayers == NULL) || (outLayerRequests == NULL)) {
             *outNumElements = 0;
         }
@@ -3691,6 +3729,11 @@ int32_t ExynosDisplay::presentDisplay(int32_t* outRetireFence) {
         ALOGD("presentDisplay: drop invalid frame during resolution switch");
     }
 
+    {
+        Mutex::Autolock lock(mDRMutex);
+        publishLayerListState();
+    }
+
     if (!mHpdStatus || mDropFrameDuringResSwitch || mPauseDisplay || mDevice->isInTUI()) {
         closeFencesForSkipFrame(RENDERING_STATE_PRESENTED);
         *outRetireFence = -1;
@@ -3885,11 +3928,23 @@ int32_t ExynosDisplay::presentDisplay(int32_t* outRetireFence) {
 
     setDisplayWinConfigData();
 
+    mBandwidthEstimate = BandwidthEstimator::estimate(*this);
+    DISPLAY_ATRACE_INT64("DpuFetchBandwidthKBps", mBandwidthEstimate.dpuFetchBandwidth / 1000);
+    DISPLAY_ATRACE_INT64("M2mBandwidthKBps",
+                         (mBandwidthEstimate.m2mReadBandwidth +
+                          mBandwidthEstimate.m2mWriteBandwidth) / 1000);
+    DISPLAY_ATRACE_INT("BandwidthPowerProxyMw",
+                       static_cast<int32_t>(mBandwidthEstimate.powerProxy));
+    mDevice->mCommitScheduler->onPreCommit(this, mBandwidthEstimate.dpuFetchBandwidth);
+    updateIdleTeAlignment();
+
     if ((ret = deliverWinConfigData()) != NO_ERROR) {
         HWC_LOGE(this, "%s:: fail to deliver win_config (%d)", __func__, ret);
         if (mDpuData.retire_fence > 0)
             fence_close(mDpuData.retire_fence, this, FENCE_TYPE_RETIRE, FENCE_IP_DPP);
         mDpuData.retire_fence = -1;
+    } else {
+        mDevice->onFrameCommitted(mDisplayId);
     }
 
     setReleaseFences();
@@ -4052,7 +4107,7 @@ int32_t ExynosDisplay::setActiveConfigInternal(hwc2_config_t config, bool force)
         return HWC2_ERROR_NONE;
     }
 
-    DISPLAY_LOGD(eDebugDisplayConfig, "(current %d) : %dx%d, %dms, %d Xdpi, %d Ydpi", mActiveConfig,
+    DISPLAY_LOGD(eDebugDisplayConfig, "(current %d) : %dx%d, %dms, %d Xdpi, %d Ydpi", mActiveConfig.load(),
             mXres, mYres, mVsyncPeriod, mXdpi, mYdpi);
     DISPLAY_LOGD(eDebugDisplayConfig, "(requested %d) : %dx%d, %dms, %d Xdpi, %d Ydpi", config,
             mDisplayConfigs[config].width, mDisplayConfigs[config].height, mDisplayConfigs[config].vsyncPeriod,
@@ -4384,7 +4439,7 @@ void ExynosDisplay::calculateTimelineLocked(
     DISPLAY_LOGD(eDebugDisplayConfig,
                  "requested config : %d(%d)->%d(%d), "
                  "desired %" PRId64 ", newVsyncAppliedTimeNanos : %" PRId64 "",
-                 mActiveConfig, mDisplayConfigs[mActiveConfig].vsyncPeriod, config,
+                 mActiveConfig.load(), mDisplayConfigs[mActiveConfig].vsyncPeriod, config,
                  mDisplayConfigs[config].vsyncPeriod,
                  mVsyncPeriodChangeConstraints.desiredTimeNanos,
                  outTimeline->newVsyncAppliedTimeNanos);
@@ -4399,7 +4454,7 @@ int32_t ExynosDisplay::setActiveConfigWithConstraints(hwc2_config_t config,
     const nsecs_t current = systemTime(SYSTEM_TIME_MONOTONIC);
     const nsecs_t diffMs = ns2ms(vsyncPeriodChangeConstraints->desiredTimeNanos - current);
     DISPLAY_LOGD(eDebugDisplayConfig, "config(%d->%d), seamless(%d), diff(%" PRId64 ")",
-                 mActiveConfig, config, vsyncPeriodChangeConstraints->seamlessRequired, diffMs);
+                 mActiveConfig.load(), config, vsyncPeriodChangeConstraints->seamlessRequired, diffMs);
 
     if (CC_UNLIKELY(ATRACE_ENABLED())) ATRACE_NAME(("diff:" + std::to_string(diffMs)).c_str());
 
@@ -4435,6 +4490,7 @@ int32_t ExynosDisplay::setActiveConfigWithConstraints(hwc2_config_t config,
         mRenderingState = RENDERING_STATE_NONE;
         setGeometryChanged(GEOMETRY_DISPLAY_RESOLUTION_CHANGED);
         updateInternalDisplayConfigVariables(config, false);
+        mResourceManager->predictDstBufs(this, mXres, mYres);
     } else if (vsyncPeriodChangeConstraints->seamlessRequired) {
         if ((mDisplayInterface->setActiveConfigWithConstraints(config, true)) != NO_ERROR) {
             DISPLAY_LOGD(eDebugDisplayConfig, "Case : Seamless is not possible");
@@ -4556,6 +4612,7 @@ int32_t ExynosDisplay::updateInternalDisplayConfigVariables(
     getDisplayAttribute(mActiveConfig, HWC2_ATTRIBUTE_DPI_X, (int32_t*)&mXdpi);
     getDisplayAttribute(mActiveConfig, HWC2_ATTRIBUTE_DPI_Y, (int32_t*)&mYdpi);
     mHdrFullScrenAreaThreshold = mXres * mYres * kHdrFullScreen;
+    mIdleTeAlignmentPolicy.reset();
     if (updateVsync) {
         resetConfigRequestStateLocked(config);
     }
@@ -4829,7 +4886,7 @@ int32_t ExynosDisplay::setPowerMode(
 
     ALOGD("%s:: mode(%d))", __func__, mode);
 
-    mPowerModeState = (hwc2_power_mode_t)mode;
+    setPowerModeState((hwc2_power_mode_t)mode);
 
     if (mode == HWC_POWER_MODE_OFF) {
         /* It should be called from validate() when the screen is on */
@@ -4888,6 +4945,11 @@ int32_t ExynosDisplay::validateDisplay(
     gettimeofday(&updateTimeInfo.lastValidateTime, NULL);
     Mutex::Autolock lock(mDisplayMutex);
 
+    {
+        Mutex::Autolock lock(mDRMutex);
+        publishLayerListState();
+    }
+
     if (!mHpdStatus) {
         ALOGD("validateDisplay: drop frame: mHpdStatus == false");
         return HWC2_ERROR_NONE;
@@ -4895,6 +4957,13 @@ int32_t ExynosDisplay::validateDisplay(
 
     if (mPauseDisplay) return HWC2_ERROR_NONE;
 
+    /* Keep the composition of the last frame, presentDisplay() drops frames during TUI */
+    if (mDevice->isInTUI()) {
+        *outNumTypes = 0;
+        *outNumRequests = 0;
+        return HWC2_ERROR_NONE;
+    }
+
     mDropFrameDuringResSwitch =
             (mGeometryChanged & GEOMETRY_DISPLAY_RESOLUTION_CHANGED) && !isFullScreenComposition();
     if (mDropFrameDuringResSwitch) {
@@ -5135,6 +5204,8 @@ void ExynosDisplay::dumpLocked(String8& result) {
                         mColorTransformHint, mMountOrientation);
     mClientCompositionInfo.dump(result);
     mExynosCompositionInfo.dump(result);
+    mBandwidthEstimate.dump(result);
+    mIdleTeAlignmentPolicy.dump(result);
 
     result.appendFormat("PanelGammaSource (%d)\n\n", GetCurrentPanelGammaSource());
 
@@ -5311,6 +5382,7 @@ int32_t ExynosDisplay::initializeValidateInfos()
     mClientCompositionInfo.setExynosImage(src_img, dst_img);
 
     mExynosCompositionInfo.initializeInfos(this);
+    mExynosCompositionInfo.setCompressionType(mExynosCompositionInfo.mDefaultCompressionType);
     setCompositionTargetExynosImage(COMPOSITION_EXYNOS, &src_img, &dst_img);
     mExynosCompositionInfo.setExynosImage(src_img, dst_img);
 
@@ -5707,21 +5779,26 @@ int32_t ExynosDisplay::addExynosCompositionLayer(uint32_t layerIndex, float tota
 }
 
 bool ExynosDisplay::isPowerModeOff() const {
-    ATRACE_CALL();
-    Mutex::Autolock lock(mDisplayMutex);
-    return mPowerModeState.has_value() && mPowerModeState.value() == HWC2_POWER_MODE_OFF;
+    return mPowerModeOff;
 }
 
 bool ExynosDisplay::isSecureContentPresenting() const {
-    ATRACE_CALL();
-    Mutex::Autolock lock(mDRMutex);
+    return mHasSecureLayer;
+}
+
+void ExynosDisplay::publishLayerListState() {
+    bool hasSecureLayer = false;
+    nsecs_t lastUpdateTime = 0;
     for (uint32_t i = 0; i < mLayers.size(); i++) {
         ExynosLayer *layer = mLayers[i];
-        if (layer != NULL && layer->isDrm()) { /* there is some DRM layer */
-            return true;
-        }
+        if (layer == NULL) continue;
+        if (layer->isDrm()) hasSecureLayer = true; /* there is some DRM layer */
+        // The update from refresh rate indicator layer should be ignored
+        if (layer->mRequestedCompositionType != HWC2_COMPOSITION_REFRESH_RATE_INDICATOR)
+            lastUpdateTime = max(lastUpdateTime, layer->mLastUpdateTime);
     }
-    return false;
+    mHasSecureLayer = hasSecureLayer;
+    mLastLayerUpdateTime = lastUpdateTime;
 }
 
 bool ExynosDisplay::windowUpdateExceptions()
@@ -6825,15 +6902,7 @@ int32_t ExynosDisplay::setRefreshRateChangedCallbackDebugEnabled(bool enabled) {
 }
 
 nsecs_t ExynosDisplay::getLastLayerUpdateTime() {
-    Mutex::Autolock lock(mDRMutex);
-    nsecs_t time = 0;
-    for (size_t i = 0; i < mLayers.size(); ++i) {
-        // The update from refresh rate indicator layer should be ignored
-        if (mLayers[i]->mRequestedCompositionType == HWC2_COMPOSITION_REFRESH_RATE_INDICATOR)
-            continue;
-        time = max(time, mLayers[i]->mLastUpdateTime);
-    }
-    return time;
+    return mLastLayerUpdateTime;
 }
 
 void ExynosDisplay::SysfsBasedRRIHandler::checkOnPresentDisplay() {
@@ -6956,6 +7025,7 @@ void ExynosDisplay::storePrevValidateCompositionType() {
     for (uint32_t i = 0; i < mLayers.size(); i++) {
         ExynosLayer *layer = mLayers[i];
         layer->mPrevValidateCompositionType = layer->getValidateCompositionType();
+        layer->updateCompositionTypeHistory();
     }
     mClientCompositionInfo.mPrevHasCompositionLayer = mClientCompositionInfo.mHasCompositionLayer;
 }
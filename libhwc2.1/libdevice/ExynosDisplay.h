@@ -28,6 +28,7 @@
 #include <chrono>
 #include <set>
 
+#include "BandwidthEstimator.h"
 #include "DeconHeader.h"
 #include "ExynosDisplayInterface.h"
 #include "ExynosHWC.h"
@@ -36,6 +37,7 @@
 #include "ExynosHwc3Types.h"
 #include "ExynosMPP.h"
 #include "ExynosResourceManager.h"
+#include "IdleTeAlignmentPolicy.h"
 #include "drmeventlistener.h"
 #include "worker.h"
 
@@ -348,6 +350,8 @@ class ExynosCompositionInfo : public ExynosMPPSource {
 
         int32_t mWindowIndex;
         CompressionInfo mCompressionInfo;
+        /* Compression the target is validated with; M2M may write it uncompressed */
+        uint32_t mDefaultCompressionType;
 
         void initializeInfos(ExynosDisplay *display);
         void initializeInfosComplete(ExynosDisplay *display);
@@ -485,11 +489,29 @@ class ExynosDisplay {
         const String8 mDisplayName;
         const String8 mDisplayTraceName;
         HwcMountOrientation mMountOrientation = HwcMountOrientation::ROT_0;
+        /*
+         * Display state is split into lock domains, always taken in this order:
+         *   mDisplayMutex: frame pipeline (validate/present), config and mode changes
+         *   mDRMutex: the layer list
+         * Validate and present are phases of one frame and stay serialized on
+         * mDisplayMutex. Layer buffer updates from hwc3 only take mDRMutex. The
+         * active config, the power mode and the layer list state are published in
+         * atomics, so that getActiveConfig() and the auxiliary controllers
+         * (histogram, brightness) take neither lock.
+         * ACQUIRED_AFTER documents the order only: it is checked by
+         * -Wthread-safety-beta, which this module does not enable, and there is no
+         * runtime lock order checker.
+         */
         mutable Mutex mDisplayMutex;
 
         /** State variables */
         bool mPlugState;
         std::optional<hwc2_power_mode_t> mPowerModeState;
+        void setPowerModeState(std::optional<hwc2_power_mode_t> mode) {
+            mPowerModeState = mode;
+            mPowerModeOff = mode.has_value() && (mode.value() == HWC2_POWER_MODE_OFF);
+            mIdleTeAlignmentPolicy.reset();
+        }
         hwc2_vsync_t mVsyncState;
         bool mHasSingleBuffer;
         bool mPauseDisplay = false;
@@ -553,7 +575,18 @@ class ExynosDisplay {
         dynamic_recomp_mode mDynamicReCompMode;
         bool mDREnable;
         bool mDRDefault;
-        mutable Mutex mDRMutex;
+        mutable Mutex mDRMutex ACQUIRED_AFTER(mDisplayMutex);
+
+        /*
+         * Layer list and mode state published for readers that don't take the locks.
+         * The layer list state is published on layer creation and destruction, and
+         * once per validate and present. Buffer updates only raise mHasSecureLayer
+         * and advance mLastLayerUpdateTime.
+         */
+        std::atomic<bool> mPowerModeOff = false;
+        std::atomic<bool> mHasSecureLayer = false;
+        std::atomic<nsecs_t> mLastLayerUpdateTime = 0;
+        void publishLayerListState() REQUIRES(mDRMutex);
 
         nsecs_t  mLastFpsTime;
         uint64_t mFrameCount;
@@ -572,6 +605,16 @@ class ExynosDisplay {
          */
         exynos_dpu_data mDpuData;
 
+        /**
+         * DRAM bandwidth and power estimate of the last presented frame plan.
+         */
+        FrameBandwidthEstimate mBandwidthEstimate;
+
+        /**
+         * Whether the frames after a panel idle enter are presented on the idle TE.
+         */
+        IdleTeAlignmentPolicy mIdleTeAlignmentPolicy;
+
         /**
          * Last win_config data is used as WIN_CONFIG skip decision or debugging.
          */
@@ -645,7 +688,8 @@ class ExynosDisplay {
         hwc_request_state_t mConfigRequestState;
         hwc2_config_t mDesiredConfig;
 
-        hwc2_config_t mActiveConfig = UINT_MAX;
+        /* Written in the config domain, read without it by getActiveConfig() */
+        std::atomic<hwc2_config_t> mActiveConfig = UINT_MAX;
         hwc2_config_t mPendingConfig = UINT_MAX;
         int64_t mLastVsyncTimestamp = 0;
 
@@ -1344,6 +1388,7 @@ class ExynosDisplay {
         virtual uint64_t getPendingExpectedPresentTime() { return 0; }
         virtual int getPendingFrameInterval() { return 0; }
         virtual void applyExpectedPresentTime() {}
+        virtual void onExpectedPresentTimeAdjusted(uint64_t __unused timestamp) {}
         virtual int32_t getDisplayIdleTimerSupport(bool& outSupport);
         virtual int32_t getDisplayMultiThreadedPresentSupport(bool& outSupport);
         virtual int32_t setDisplayIdleTimer(const int32_t __unused timeoutMs) {
@@ -1469,6 +1514,8 @@ class ExynosDisplay {
         bool skipStaticLayerChanged(ExynosCompositionInfo& compositionInfo);
 
         bool shouldSignalNonIdle();
+        /* Classify the frame to present for mIdleTeAlignmentPolicy */
+        void updateIdleTeAlignment();
 
         /// minimum possible dim rate in the case hbm peak is 1000 nits and norml
         // display brightness is 2 nits
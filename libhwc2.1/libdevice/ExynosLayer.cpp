@@ -18,6 +18,7 @@
 #include <aidl/android/hardware/graphics/common/Transform.h>
 #include <hardware/exynos/ion.h>
 #include <hardware/hwcomposer_defs.h>
+#include <inttypes.h>
 #include <linux/videodev2.h>
 #include <sys/mman.h>
 #include <utils/Errors.h>
@@ -425,9 +426,16 @@ int32_t ExynosLayer::setLayerBuffer(buffer_handle_t buffer, int32_t acquireFence
         checkFps(mLastLayerBuffer != mLayerBuffer);
         if (mLayerBuffer != mLastLayerBuffer) {
             mLastUpdateTime = systemTime(CLOCK_MONOTONIC);
-            if (mRequestedCompositionType != HWC2_COMPOSITION_REFRESH_RATE_INDICATOR)
+            if (mRequestedCompositionType != HWC2_COMPOSITION_REFRESH_RATE_INDICATOR) {
                 mDisplay->mBufferUpdates++;
+                mDisplay->mLastLayerUpdateTime = mLastUpdateTime;
+            }
         }
+        /*
+         * Secure content is reported before the frame is presented. The flag is
+         * only raised here, validate and present publish the whole layer list.
+         */
+        if (isDrm()) mDisplay->mHasSecureLayer = true;
     }
     mPrevAcquireFence =
             fence_close(mPrevAcquireFence, mDisplay, FENCE_TYPE_SRC_ACQUIRE, FENCE_IP_UNDEFINED);
@@ -1025,6 +1033,38 @@ void ExynosLayer::setSrcAcquireFence() {
     }
 }
 
+void ExynosLayer::updateCompositionTypeHistory() {
+    /* Overlay reasons that depend on what other layers use this frame */
+    constexpr uint32_t kResourcePressure =
+            eInsufficientWindow | eInsufficientMPP | eMPPUnsupported | eSandwichedBetweenGLES;
+
+    bool isClient = (mValidateCompositionType == HWC2_COMPOSITION_CLIENT);
+    auto& history = mCompositionTypeHistory;
+    if (mOverlayInfo & eCompositionHysteresis) history.numHeldFrames++;
+
+    if ((history.framesInType > 0) && (history.isClient == isClient)) {
+        history.framesInType++;
+        return;
+    }
+    if (history.framesInType > 0) history.numFlips++;
+    history.isClient = isClient;
+    history.isClientOptional = isClient && (history.framesInType > 0) &&
+            ((mOverlayInfo & ~kResourcePressure) == 0) && (mOverlayInfo & kResourcePressure);
+    history.framesInType = 1;
+}
+
+bool ExynosLayer::needHoldClientComposition() {
+    const auto& history = mCompositionTypeHistory;
+    if (!history.isClient || !history.isClientOptional ||
+        (history.framesInType >= kMinFramesInClientComposition))
+        return false;
+
+    /* Protected content and decoration layers can't be composited by client */
+    if (isDrm() || (mCompositionType == HWC2_COMPOSITION_DISPLAY_DECORATION)) return false;
+
+    return true;
+}
+
 void ExynosLayer::dump(String8& result)
 {
     int format = HAL_PIXEL_FORMAT_IMPLEMENTATION_DEFINED;
@@ -1096,6 +1136,8 @@ void ExynosLayer::dump(String8& result)
                           .build()
                           .c_str());
 
+    if (mTransform & HAL_TRANSFORM_ROT_90) mRotationPlanner.dump(result);
+
     if ((mDisplay != NULL) && (mDisplay->mResourceManager != NULL)) {
         result.appendFormat("MPPFlags for otfMPP\n");
         for (uint32_t i = 0; i < mDisplay->mResourceManager->getOtfMPPSize(); i++) {
@@ -1211,6 +1253,11 @@ void ExynosLayer::printLayer()
             mDisplayFrame.left, mDisplayFrame.top, mDisplayFrame.right, mDisplayFrame.bottom);
     result.appendFormat("\ttype: %2d, exynosType: %2d, validateType: %2d\n",
             mCompositionType, mExynosCompositionType, mValidateCompositionType);
+    result.appendFormat("\tcomposition history: %s for %u frames, flips: %" PRIu64
+                        ", held frames: %" PRIu64 "\n",
+                        mCompositionTypeHistory.isClient ? "client" : "device",
+                        mCompositionTypeHistory.framesInType, mCompositionTypeHistory.numFlips,
+                        mCompositionTypeHistory.numHeldFrames);
     result.appendFormat("\toverlayInfo: 0x%8x, supportedMPPFlag: 0x%8x, geometryChanged: 0x%" PRIx64 "\n",
             mOverlayInfo, mSupportedMPPFlag, mGeometryChanged);
 
@@ -1249,8 +1296,10 @@ void ExynosLayer::setGeometryChanged(uint64_t changedBit)
 {
     mLastUpdateTime = systemTime(CLOCK_MONOTONIC);
     mGeometryChanged |= changedBit;
-    if (mRequestedCompositionType != HWC2_COMPOSITION_REFRESH_RATE_INDICATOR)
+    if (mRequestedCompositionType != HWC2_COMPOSITION_REFRESH_RATE_INDICATOR) {
         mDisplay->setGeometryChanged(changedBit);
+        mDisplay->mLastLayerUpdateTime = mLastUpdateTime;
+    }
 }
 
 int ExynosLayer::allocMetaParcel()
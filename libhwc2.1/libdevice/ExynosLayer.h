@@ -29,6 +29,7 @@
 #include "ExynosDisplay.h"
 #include "ExynosHWC.h"
 #include "ExynosHWCHelper.h"
+#include "RotationPlanner.h"
 #include "VendorGraphicBuffer.h"
 #include "VendorVideoAPI.h"
 
@@ -127,6 +128,27 @@ class ExynosLayer : public ExynosMPPSource {
          */
         int32_t mValidateExynosCompositionType;
 
+        /**
+         * History of validated composition types. A layer that resource assigning
+         * moved to client composition stays there for a minimum number of frames,
+         * so that it doesn't alternate between client and device composition when
+         * the assignment result flips on tiny geometry or timing changes.
+         */
+        struct CompositionTypeHistory {
+            bool isClient = false;
+            /* Client composition was caused by resource pressure, not required */
+            bool isClientOptional = false;
+            uint32_t framesInType = 0;
+            uint64_t numFlips = 0;
+            uint64_t numHeldFrames = 0;
+        } mCompositionTypeHistory;
+        static constexpr uint32_t kMinFramesInClientComposition = 8;
+
+        /* Called once per validated frame with the final composition type */
+        void updateCompositionTypeHistory();
+        /* Whether the layer should stay in client composition in this validation */
+        bool needHoldClientComposition();
+
         uint32_t mOverlayInfo;
 
         /**
@@ -148,6 +170,11 @@ class ExynosLayer : public ExynosMPPSource {
          */
         float mFps;
 
+        /**
+         * Whether DPP or M2M rotates the layer
+         */
+        RotationPlanner mRotationPlanner;
+
         /**
          * Assign priority, when priority changing is needded by order infomation in mGeometryChanged
          */
@@ -954,8 +954,8 @@ void HistogramDevice::checkQueryResult(std::vector<char16_t>* histogramBuffer,
     ATRACE_CALL();
 
     /*
-     * It may take for a while in isSecureContentPresenting() and isPowerModeOff().
-     * We should not hold any lock from the caller.
+     * isSecureContentPresenting() and isPowerModeOff() read the state published by
+     * the display and don't wait for the display locks.
      */
     if (mDisplay->isSecureContentPresenting()) {
         HIST_BLOB_CH_LOG(V, blobId, channelId,
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG (ATRACE_TAG_GRAPHICS | ATRACE_TAG_HAL)
+
+#include "IdleTeAlignmentPolicy.h"
+
+#include <utils/Trace.h>
+
+#include <cinttypes>
+
+void IdleTeAlignmentPolicy::onIdleEnter(uint32_t idleTeRefreshRate, int64_t nowNs) {
+    if (idleTeRefreshRate == 0) return;
+
+    if (!mIdle) mNumIdleEnters++;
+    mIdle = true;
+    mIdleEnterNs = nowNs;
+    mIdleTePeriodNs = 1000000000 / idleTeRefreshRate;
+    ATRACE_INT("IdleTeAlignment", 1);
+}
+
+bool IdleTeAlignmentPolicy::onFrame(bool geometryChanged, bool m2mUpdated,
+                                    uint64_t damagedArea, uint64_t displayArea) {
+    mEligible = false;
+    if (!mIdle) return false;
+
+    if (geometryChanged || m2mUpdated || (displayArea == 0) ||
+        (damagedArea * 100 > displayArea * kEligibleDamagePercent)) {
+        mIdle = false;
+        mNumIdleExits++;
+        ATRACE_INT("IdleTeAlignment", 0);
+        return false;
+    }
+
+    mEligible = true;
+    mNumEligibleFrames++;
+    return true;
+}
+
+void IdleTeAlignmentPolicy::reset() {
+    mEligible = false;
+    if (!mIdle) return;
+
+    mIdle = false;
+    mNumIdleExits++;
+    ATRACE_INT("IdleTeAlignment", 0);
+}
+
+int64_t IdleTeAlignmentPolicy::alignPresentTime(int64_t expectedPresentNs, int64_t maxDelayNs) {
+    if (!mEligible || (mIdleTePeriodNs <= 0) || (expectedPresentNs <= mIdleEnterNs))
+        return expectedPresentNs;
+
+    // The idle TE is anchored at the idle enter event.
+    const int64_t elapsedNs = expectedPresentNs - mIdleEnterNs;
+    const int64_t alignedNs = mIdleEnterNs +
+            ((elapsedNs + mIdleTePeriodNs - 1) / mIdleTePeriodNs) * mIdleTePeriodNs;
+    // At a low idle TE rate the next slot can be up to a second away.
+    if (alignedNs - expectedPresentNs > maxDelayNs) return expectedPresentNs;
+
+    if (alignedNs != expectedPresentNs) {
+        ATRACE_NAME("alignToIdleTe");
+        mNumAlignedCommits++;
+    }
+    return alignedNs;
+}
+
+void IdleTeAlignmentPolicy::dump(String8& result) const {
+    result.appendFormat("Idle TE alignment: %s, idle TE period(%" PRId64 "), enters(%" PRIu64
+                        "), exits(%" PRIu64 "), eligible frames(%" PRIu64
+                        "), aligned commits(%" PRIu64 ")\n",
+                        mIdle ? "idle" : "active", mIdleTePeriodNs, mNumIdleEnters,
+                        mNumIdleExits, mNumEligibleFrames, mNumAlignedCommits);
+}
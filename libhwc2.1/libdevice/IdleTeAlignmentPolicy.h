@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _IDLE_TE_ALIGNMENT_POLICY_H_
+#define _IDLE_TE_ALIGNMENT_POLICY_H_
+
+#include <utils/String8.h>
+
+#include <cstdint>
+
+// IdleTeAlignmentPolicy tracks whether the frames that follow a panel idle enter (self-refresh or
+// a lower TE rate) are small enough to be presented on the idle TE.
+//
+// While idle, a frame is eligible if the geometry did not change, no updated layer goes through
+// an M2M MPP and the damaged area stays under |kEligibleDamagePercent| of the display, e.g. a
+// blinking cursor or a clock tick. An eligible frame is still validated, presented and committed
+// as usual; only its expected present time is moved to the next idle TE, if that does not delay
+// it by more than the caller allows, so consecutive small updates are latched on idle TE slots.
+// The first other frame leaves idle mode and is presented right away. Power mode and display
+// config changes also leave idle mode.
+class IdleTeAlignmentPolicy {
+public:
+    // Called when the panel entered idle at |idleTeRefreshRate|.
+    void onIdleEnter(uint32_t idleTeRefreshRate, int64_t nowNs);
+
+    // Called before the commit of every frame. Returns true if the frame is eligible for idle TE
+    // alignment, false if the display is not idle or the frame leaves idle mode.
+    bool onFrame(bool geometryChanged, bool m2mUpdated, uint64_t damagedArea,
+                 uint64_t displayArea);
+
+    // Returns the expected present time to program for the frame last passed to onFrame(),
+    // aligned to the idle TE if the frame is eligible and the next idle TE is at most |maxDelayNs|
+    // later.
+    int64_t alignPresentTime(int64_t expectedPresentNs, int64_t maxDelayNs);
+
+    // Called when the panel left idle or its state is no longer known.
+    void reset();
+
+    bool isIdle() const { return mIdle; }
+
+    void dump(String8& result) const;
+
+private:
+    static constexpr uint64_t kEligibleDamagePercent = 1;
+
+    bool mIdle = false;
+    bool mEligible = false;
+    int64_t mIdleEnterNs = 0;
+    int64_t mIdleTePeriodNs = 0;
+
+    uint64_t mNumIdleEnters = 0;
+    uint64_t mNumIdleExits = 0;
+    uint64_t mNumEligibleFrames = 0;
+    uint64_t mNumAlignedCommits = 0;
+};
+
+#endif // _IDLE_TE_ALIGNMENT_POLICY_H_
@@ -20,6 +20,8 @@
 #include <drm/samsung_drm.h>
 #include <hardware/hwcomposer_defs.h>
 
+#include <charconv>
+
 #include "ExynosDevice.h"
 #include "ExynosDisplay.h"
 #include "ExynosDisplayDrmInterface.h"
@@ -125,9 +127,14 @@ void ExynosDeviceDrmInterface::init(ExynosDevice *exynosDevice) {
 }
 
 void ExynosDeviceDrmInterface::postInit() {
+    updateDisplayRoutes();
     mDrmDevice->event_listener()->InitWorker();
 }
 
+void ExynosDeviceDrmInterface::updateDisplayRoutes() {
+    if (mExynosDrmEventHandler) mExynosDrmEventHandler->updateRoutes();
+}
+
 int32_t ExynosDeviceDrmInterface::initDisplayInterface(
         std::unique_ptr<ExynosDisplayInterface> &dispInterface) {
     ExynosDisplayDrmInterface *displayInterface =
@@ -241,24 +248,66 @@ void ExynosDeviceDrmInterface::ExynosDrmEventHandler::init(ExynosDevice *exynosD
     mDrmDevice = drmDevice;
 }
 
+void ExynosDeviceDrmInterface::ExynosDrmEventHandler::updateRoutes() {
+    auto routes = std::make_shared<Routes>();
+
+    for (auto display : mExynosDevice->mDisplays) {
+        /* Virtual displays have no CRTC or connector */
+        if (!display->mDisplayInterface ||
+            (display->mDisplayInterface->mType != INTERFACE_TYPE_DRM))
+            continue;
+
+        ExynosDisplayDrmInterface *displayInterface =
+                static_cast<ExynosDisplayDrmInterface *>(display->mDisplayInterface.get());
+
+        if (displayInterface->getCrtcId() != 0)
+            routes->crtcs[displayInterface->getCrtcId()] = display;
+        if (displayInterface->getConnectorId() != 0)
+            routes->connectors[displayInterface->getConnectorId()] = display;
+    }
+
+    std::atomic_store(&mRoutes, std::shared_ptr<const Routes>(std::move(routes)));
+}
+
+ExynosDisplay *ExynosDeviceDrmInterface::ExynosDrmEventHandler::findDisplayByCrtc(
+        uint32_t crtcId) const {
+    const auto routes = std::atomic_load(&mRoutes);
+    const auto it = routes->crtcs.find(crtcId);
+    return (it != routes->crtcs.end()) ? it->second : nullptr;
+}
+
+ExynosDisplay *ExynosDeviceDrmInterface::ExynosDrmEventHandler::findDisplayByConnector(
+        uint32_t connectorId) const {
+    const auto routes = std::atomic_load(&mRoutes);
+    const auto it = routes->connectors.find(connectorId);
+    return (it != routes->connectors.end()) ? it->second : nullptr;
+}
+
 void ExynosDeviceDrmInterface::ExynosDrmEventHandler::handleEvent(uint64_t timestamp_us) {
     mExynosDevice->handleHotplug();
 }
 
+void ExynosDeviceDrmInterface::ExynosDrmEventHandler::handleConnectorEvent(uint32_t connector_id,
+                                                                           uint64_t timestamp_us) {
+    /* Only the display of the connector is locked and probed */
+    ExynosDisplay *display = findDisplayByConnector(connector_id);
+    if (display && display->mDisplayInterface &&
+        (display->mDisplayInterface->mType == INTERFACE_TYPE_DRM)) {
+        mExynosDevice->handleDisplayHotplug(display);
+        return;
+    }
+
+    ALOGD("%s: no display for connector_id=%u, checking all displays", __func__, connector_id);
+    handleEvent(timestamp_us);
+}
+
 void ExynosDeviceDrmInterface::ExynosDrmEventHandler::handleHistogramEvent(uint32_t crtc_id,
                                                                            void *bin) {
-    ExynosDisplayDrmInterface *displayInterface;
-    DrmProperty crtc;
-    uint32_t id;
+    ExynosDisplay *display = findDisplayByCrtc(crtc_id);
+    if (!display) return;
 
-    for (auto display : mExynosDevice->mDisplays) {
-        displayInterface =
-                static_cast<ExynosDisplayDrmInterface *>(display->mDisplayInterface.get());
-        id = displayInterface->getCrtcId();
-        if (id == crtc_id) {
-            displayInterface->setHistogramData(bin);
-        }
-    }
+    static_cast<ExynosDisplayDrmInterface *>(display->mDisplayInterface.get())
+            ->setHistogramData(bin);
 }
 
 #if defined(EXYNOS_DRM_HISTOGRAM_CHANNEL_EVENT)
@@ -266,19 +315,16 @@ void ExynosDeviceDrmInterface::ExynosDrmEventHandler::handleHistogramChannelEven
     struct exynos_drm_histogram_channel_event *histogram_channel_event =
             (struct exynos_drm_histogram_channel_event *)event;
 
-    for (auto display : mExynosDevice->mDisplays) {
-        ExynosDisplayDrmInterface *displayInterface =
-                static_cast<ExynosDisplayDrmInterface *>(display->mDisplayInterface.get());
-        if (histogram_channel_event->crtc_id == displayInterface->getCrtcId()) {
-            if (display->mHistogramController) {
-                display->mHistogramController->handleDrmEvent(histogram_channel_event);
-            } else {
-                ALOGE("%s: no valid mHistogramController for crtc_id (%u)", __func__,
-                      histogram_channel_event->crtc_id);
-            }
-
-            return;
+    ExynosDisplay *display = findDisplayByCrtc(histogram_channel_event->crtc_id);
+    if (display) {
+        if (display->mHistogramController) {
+            display->mHistogramController->handleDrmEvent(histogram_channel_event);
+        } else {
+            ALOGE("%s: no valid mHistogramController for crtc_id (%u)", __func__,
+                  histogram_channel_event->crtc_id);
         }
+
+        return;
     }
 
     ALOGE("%s: no display with crtc_id (%u)", __func__, histogram_channel_event->crtc_id);
@@ -292,19 +338,16 @@ void ExynosDeviceDrmInterface::ExynosDrmEventHandler::handleContextHistogramEven
     struct exynos_drm_context_histogram_event* context_histogram_event =
             (struct exynos_drm_context_histogram_event*)event;
 
-    for (auto display : mExynosDevice->mDisplays) {
-        ExynosDisplayDrmInterface* displayInterface =
-                static_cast<ExynosDisplayDrmInterface*>(display->mDisplayInterface.get());
-        if (context_histogram_event->crtc_id == displayInterface->getCrtcId()) {
-            if (display->mHistogramController) {
-                display->mHistogramController->handleContextDrmEvent(context_histogram_event);
-            } else {
-                ALOGE("%s: no valid mHistogramController for crtc_id (%u)", __func__,
-                      context_histogram_event->crtc_id);
-            }
-
-            return;
+    ExynosDisplay* display = findDisplayByCrtc(context_histogram_event->crtc_id);
+    if (display) {
+        if (display->mHistogramController) {
+            display->mHistogramController->handleContextDrmEvent(context_histogram_event);
+        } else {
+            ALOGE("%s: no valid mHistogramController for crtc_id (%u)", __func__,
+                  context_histogram_event->crtc_id);
         }
+
+        return;
     }
 
     ALOGE("%s: no display with crtc_id (%u)", __func__, context_histogram_event->crtc_id);
@@ -323,7 +366,6 @@ void ExynosDeviceDrmInterface::ExynosDrmEventHandler::handleTUIEvent() {
     } else {
         /* Received TUI Exit event */
         if (mExynosDevice->isInTUI()) {
-            mExynosDevice->onRefreshDisplays();
             mExynosDevice->exitFromTUI();
             ALOGV("%s:: DRM device out TUI", __func__);
         }
@@ -333,33 +375,26 @@ void ExynosDeviceDrmInterface::ExynosDrmEventHandler::handleTUIEvent() {
 constexpr size_t IDLE_ENTER_EVENT_DATA_SIZE = 3;
 void ExynosDeviceDrmInterface::ExynosDrmEventHandler::handleIdleEnterEvent(char const *event) {
     /* PANEL_IDLE_ENTER=<display index>,<vrefresh>,<idle te vrefresh> */
-    std::string_view idle_event_str(event);
-    auto prefix_shift_pos = idle_event_str.find("=");
-    if (prefix_shift_pos == std::string::npos) {
+    const char *pos = strchr(event, '=');
+    if (pos == nullptr) {
         ALOGE("%s: idle enter event format is incorrect", __func__);
+        return;
     }
 
-    int count = 0;
+    const char *end = pos + strlen(pos);
     int value[IDLE_ENTER_EVENT_DATA_SIZE] = {0};
     const auto &[displayIndex, vrefresh, idleTeVrefresh] = value;
 
-    auto start_pos = prefix_shift_pos + 1;
-    auto end_pos = idle_event_str.find(",", start_pos);
-    while (end_pos != std::string::npos && count < IDLE_ENTER_EVENT_DATA_SIZE) {
-        auto info = idle_event_str.substr(start_pos, end_pos - start_pos);
-
-        value[count++] = atoi(info.data());
-        start_pos = end_pos + 1;
-        end_pos = idle_event_str.find(",", start_pos);
-        if (end_pos == std::string::npos) {
-            info = idle_event_str.substr(start_pos, idle_event_str.size() - start_pos);
-            value[count++] = atoi(info.data());
+    for (size_t i = 0; i < IDLE_ENTER_EVENT_DATA_SIZE; i++) {
+        /* Skip '=' before the first value and ',' before the others */
+        pos++;
+        auto [next, ec] = std::from_chars(pos, end, value[i]);
+        if ((ec != std::errc()) ||
+            ((i + 1 < IDLE_ENTER_EVENT_DATA_SIZE) && ((next == end) || (*next != ',')))) {
+            ALOGE("%s: idle enter event is incomplete", __func__);
+            return;
         }
-    }
-
-    if (count != IDLE_ENTER_EVENT_DATA_SIZE) {
-        ALOGE("%s: idle enter event is incomplete", __func__);
-        return;
+        pos = next;
     }
 
     ExynosDisplay *primaryDisplay =
@@ -377,11 +412,11 @@ void ExynosDeviceDrmInterface::ExynosDrmEventHandler::handleIdleEnterEvent(char
 void ExynosDeviceDrmInterface::ExynosDrmEventHandler::handleDrmPropertyUpdate(unsigned connector_id,
                                                                               unsigned prop_id) {
     ALOGD("%s: connector_id=%u prop_id=%u", __func__, connector_id, prop_id);
-    for (auto display : mExynosDevice->mDisplays) {
-        ExynosDisplayDrmInterface* displayInterface =
-                static_cast<ExynosDisplayDrmInterface*>(display->mDisplayInterface.get());
-        if (displayInterface) displayInterface->handleDrmPropertyUpdate(connector_id, prop_id);
-    }
+    ExynosDisplay* display = findDisplayByConnector(connector_id);
+    if (!display) return;
+
+    static_cast<ExynosDisplayDrmInterface*>(display->mDisplayInterface.get())
+            ->handleDrmPropertyUpdate(connector_id, prop_id);
 }
 
 int32_t ExynosDeviceDrmInterface::registerSysfsEventHandler(
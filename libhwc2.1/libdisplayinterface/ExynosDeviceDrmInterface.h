@@ -17,6 +17,9 @@
 #ifndef _EXYNOSDEVICEDRMINTERFACE_H
 #define _EXYNOSDEVICEDRMINTERFACE_H
 
+#include <memory>
+#include <unordered_map>
+
 #include "resourcemanager.h"
 #include "ExynosDeviceInterface.h"
 
@@ -35,6 +38,7 @@ class ExynosDeviceDrmInterface : public ExynosDeviceInterface {
         virtual int32_t registerSysfsEventHandler(
                 std::shared_ptr<DrmSysfsEventHandler> handler) override;
         virtual int32_t unregisterSysfsEventHandler(int sysfsFd) override;
+        virtual void updateDisplayRoutes() override;
 
     protected:
         class ExynosDrmEventHandler : public DrmEventHandler,
@@ -46,6 +50,7 @@ class ExynosDeviceDrmInterface : public ExynosDeviceInterface {
                                       public DrmPropertyUpdateHandler {
         public:
             void handleEvent(uint64_t timestamp_us) override;
+            void handleConnectorEvent(uint32_t connector_id, uint64_t timestamp_us) override;
             void handleHistogramEvent(uint32_t crtc_id, void *bin) override;
             void handleHistogramChannelEvent(void *event) override;
             void handleContextHistogramEvent(void* event) override;
@@ -53,10 +58,22 @@ class ExynosDeviceDrmInterface : public ExynosDeviceInterface {
             void handleIdleEnterEvent(char const *event) override;
             void handleDrmPropertyUpdate(unsigned connector_id, unsigned prop_id) override;
             void init(ExynosDevice *exynosDevice, DrmDevice *drmDevice);
+            /* Rebuild the tables routing events to displays by CRTC and connector id */
+            void updateRoutes();
 
         private:
+            /* Immutable once published, so events are routed without a lock */
+            struct Routes {
+                std::unordered_map<uint32_t, ExynosDisplay *> crtcs;
+                std::unordered_map<uint32_t, ExynosDisplay *> connectors;
+            };
+
+            ExynosDisplay *findDisplayByCrtc(uint32_t crtcId) const;
+            ExynosDisplay *findDisplayByConnector(uint32_t connectorId) const;
+
             ExynosDevice *mExynosDevice;
             DrmDevice *mDrmDevice;
+            std::shared_ptr<const Routes> mRoutes = std::make_shared<const Routes>();
         };
         ResourceManager mDrmResourceManager;
         DrmDevice *mDrmDevice;
@@ -98,6 +98,8 @@ class ExynosDeviceInterface {
         virtual int32_t unregisterSysfsEventHandler(int __unused sysfsFd) {
             return android::INVALID_OPERATION;
         }
+        /* Called when displays are added or removed or their CRTCs are swapped */
+        virtual void updateDisplayRoutes() {}
 
         uint32_t getNumDPPChs() { return mDPUInfo.dpuInfo.dpp_chs.size(); };
         uint32_t getNumSPPChs() { return mDPUInfo.dpuInfo.spp_chs.size(); };
@@ -2233,6 +2233,27 @@ int32_t ExynosDisplayDrmInterface::deliverWinConfigData()
         }
 
         if (!ignoreExpectedPresentTime) {
+            const auto requestedPresentTime = expectedPresentTime;
+            expectedPresentTime = mExynosDisplay->mDevice->mCommitScheduler
+                                          ->adjustExpectedPresentTime(mExynosDisplay,
+                                                                      expectedPresentTime);
+            /*
+             * Frames eligible for idle TE alignment may wait for the idle TE, but the nudge
+             * above and the alignment together must not delay a frame by more than a vsync
+             */
+            const int64_t nudgeDelay =
+                    static_cast<int64_t>(expectedPresentTime - requestedPresentTime);
+            const int64_t maxAlignDelay =
+                    std::max(static_cast<int64_t>(mExynosDisplay->mVsyncPeriod) - nudgeDelay,
+                             static_cast<int64_t>(0));
+            expectedPresentTime =
+                    mExynosDisplay->mIdleTeAlignmentPolicy.alignPresentTime(expectedPresentTime,
+                                                                            maxAlignDelay);
+            mExynosDisplay->mDevice->mCommitScheduler->onExpectedPresentTime(mExynosDisplay,
+                                                                             expectedPresentTime);
+            if (expectedPresentTime != requestedPresentTime) {
+                mExynosDisplay->onExpectedPresentTimeAdjusted(expectedPresentTime);
+            }
             if ((ret = drmReq.atomicAddProperty(mDrmCrtc->id(),
                                                 mDrmCrtc->expected_present_time_property(),
                                                 expectedPresentTime)) < 0) {
@@ -3169,5 +3190,7 @@ int32_t ExynosDisplayDrmInterface::swapCrtcs(ExynosDisplay* anotherDisplay) {
     } else {
         mBorrowedCrtcFrom = anotherDisplay;
     }
+
+    mExynosDisplay->mDevice->mDeviceInterface->updateDisplayRoutes();
     return 0;
 }
@@ -434,6 +434,7 @@ class ExynosDisplayDrmInterface :
         int32_t getPanelFullResolutionHSize() { return mPanelFullResolutionHSize; }
         int32_t getPanelFullResolutionVSize() { return mPanelFullResolutionVSize; }
         uint32_t getCrtcId() { return mDrmCrtc->id(); }
+        uint32_t getConnectorId() { return mDrmConnector ? mDrmConnector->id() : 0; }
         int32_t triggerClearDisplayPlanes();
 
         virtual void setXrrSettings(const XrrSettings_t& settings) override;
@@ -325,7 +325,10 @@ void DrmEventListener::UEventHandler() {
     if (!hotplug_handler_)
       return;
 
-    hotplug_handler_->handleEvent(timestamp);
+    if (have_connector_id)
+      hotplug_handler_->handleConnectorEvent(connector_id, timestamp);
+    else
+      hotplug_handler_->handleEvent(timestamp);
   }
 }
 
@@ -39,6 +39,13 @@ class DrmEventHandler {
   }
 
   virtual void handleEvent(uint64_t timestamp_us) = 0;
+
+  // Hotplug event of a known connector. Handled as a hotplug of any
+  // connector unless the handler can do better.
+  virtual void handleConnectorEvent(uint32_t /*connector_id*/,
+                                    uint64_t timestamp_us) {
+    handleEvent(timestamp_us);
+  }
 };
 
 class DrmHistogramEventHandler {
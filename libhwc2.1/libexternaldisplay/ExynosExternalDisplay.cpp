@@ -54,7 +54,7 @@ ExynosExternalDisplay::ExynosExternalDisplay(uint32_t index, ExynosDevice* devic
 
     //TODO : Hard coded currently
     mNumMaxPriorityAllowed = 1;
-    mPowerModeState = (hwc2_power_mode_t)HWC_POWER_MODE_OFF;
+    setPowerModeState((hwc2_power_mode_t)HWC_POWER_MODE_OFF);
 }
 
 ExynosExternalDisplay::~ExynosExternalDisplay()
@@ -105,7 +105,7 @@ void ExynosExternalDisplay::closeExternalDisplay()
         }
     }
 
-    mPowerModeState = (hwc2_power_mode_t)HWC_POWER_MODE_OFF;
+    setPowerModeState((hwc2_power_mode_t)HWC_POWER_MODE_OFF);
 
     DISPLAY_LOGD(eDebugExternalDisplay, "Close fd for External Display");
 
@@ -167,6 +167,7 @@ int ExynosExternalDisplay::getDisplayConfigs(uint32_t* outNumConfigs, hwc2_confi
         mYres = displayConfig.height;
         mVsyncPeriod = displayConfig.vsyncPeriod;
         mRefreshRate = displayConfig.refreshRate;
+        mResourceManager->predictDstBufs(this, mXres, mYres);
 
         if (mDisplayInterface->mType == INTERFACE_TYPE_DRM) {
             ret = mDisplayInterface->setActiveConfig(mActiveConfig);
@@ -451,7 +452,7 @@ int ExynosExternalDisplay::enable()
     }
 
     mEnabled = true;
-    mPowerModeState = (hwc2_power_mode_t)HWC_POWER_MODE_NORMAL;
+    setPowerModeState((hwc2_power_mode_t)HWC_POWER_MODE_NORMAL);
 
     reportUsage(true);
 
@@ -491,7 +492,7 @@ int ExynosExternalDisplay::disable()
     if (mEnabled) reportUsage(false);
 
     mEnabled = false;
-    mPowerModeState = (hwc2_power_mode_t)HWC_POWER_MODE_OFF;
+    setPowerModeState((hwc2_power_mode_t)HWC_POWER_MODE_OFF);
 
     ALOGI("[ExternalDisplay] %s -", __func__);
 
@@ -582,6 +583,7 @@ void ExynosExternalDisplay::handleHotplugEvent(bool hpdStatus)
         disable();
         closeExternalDisplay();
         mDREnable = false;
+        mResourceManager->predictDstBufs(this, 0, 0);
     }
     mDevice->checkDynamicRecompositionThread();
 
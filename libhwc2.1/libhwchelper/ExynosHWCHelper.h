@@ -359,6 +359,7 @@ enum {
     eExceedMaxLayerNum = 0x00080000,
     eExceedSdrDimRatio = 0x00100000,
     eIgnoreLayer = 0x00200000,
+    eCompositionHysteresis = 0x00400000,
     eSkipStartFrame = 0x008000000,
     eResourceAssignFail = 0x20000000,
     eMPPUnsupported = 0x40000000,
@@ -745,6 +746,7 @@ inline std::string transOvlInfoToString(const int32_t ovlInfo) {
     if (ovlInfo & eExceedMaxLayerNum) ret += "OverMaxLayer ";
     if (ovlInfo & eExceedSdrDimRatio) ret += "OverSdrDimRatio ";
     if (ovlInfo & eIgnoreLayer) ret += "Ignore ";
+    if (ovlInfo & eCompositionHysteresis) ret += "Hysteresis ";
     if (ovlInfo & eSkipStartFrame) ret += "SkipFirstFrame ";
     if (ovlInfo & eResourceAssignFail) ret += "ResourceAssignFail ";
     if (ovlInfo & eMPPUnsupported) ret += "MPPUnspported ";
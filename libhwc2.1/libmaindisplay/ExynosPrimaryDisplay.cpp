@@ -327,6 +327,7 @@ void ExynosPrimaryDisplay::setDDIScalerEnable(int width, int height) {
     mNewScaledHeight = height;
     mXres = width;
     mYres = height;
+    mResourceManager->predictDstBufs(this, mXres, mYres);
 }
 
 int ExynosPrimaryDisplay::getDDIScalerMode(int width, int height) {
@@ -493,7 +494,7 @@ int32_t ExynosPrimaryDisplay::setPowerOn() {
 
     {
         std::lock_guard<std::mutex> lock(mPowerModeMutex);
-        mPowerModeState = HWC2_POWER_MODE_ON;
+        setPowerModeState(HWC2_POWER_MODE_ON);
         if (mNotifyPowerOn) {
             mPowerOnCondition.notify_one();
             mNotifyPowerOn = false;
@@ -521,7 +522,7 @@ int32_t ExynosPrimaryDisplay::setPowerOff() {
 
     {
         std::lock_guard<std::mutex> lock(mPowerModeMutex);
-        mPowerModeState = HWC2_POWER_MODE_OFF;
+        setPowerModeState(HWC2_POWER_MODE_OFF);
     }
 
     /* It should be called from validate() when the screen is on */
@@ -555,7 +556,7 @@ int32_t ExynosPrimaryDisplay::setPowerDoze(hwc2_power_mode_t mode) {
 
     {
         std::lock_guard<std::mutex> lock(mPowerModeMutex);
-        mPowerModeState = mode;
+        setPowerModeState(mode);
     }
 
     // LHBM will be disabled in the kernel while entering AOD mode if it's
@@ -1182,6 +1183,18 @@ void ExynosPrimaryDisplay::applyExpectedPresentTime() {
     mExpectedPresentTimeAndInterval.clear_dirty();
 }
 
+void ExynosPrimaryDisplay::onExpectedPresentTimeAdjusted(uint64_t timestamp) {
+    DISPLAY_ATRACE_INT64("expectedPresentTimeAdjustment",
+                         static_cast<int64_t>(timestamp) -
+                                 std::get<0>(mExpectedPresentTimeAndInterval.get()));
+    // The refresh listener plans frame insertions from the expected present time, so it has to
+    // know the one actually programmed.
+    const auto refreshListener = getRefreshListener();
+    if (refreshListener) {
+        refreshListener->setExpectedPresentTime(timestamp, getPendingFrameInterval());
+    }
+}
+
 int32_t ExynosPrimaryDisplay::setDisplayIdleTimer(const int32_t timeoutMs) {
     bool support = false;
     if (getDisplayIdleTimerSupport(support) || support == false) {
@@ -1325,7 +1338,9 @@ void ExynosPrimaryDisplay::handleDisplayIdleEnter(const uint32_t idleTeRefreshRa
     {
         Mutex::Autolock lock1(mDisplayMutex);
         uint32_t btsRefreshRate = getBtsRefreshRate();
+        const nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
         if (idleTeRefreshRate <= btsRefreshRate) {
+            mIdleTeAlignmentPolicy.onIdleEnter(idleTeRefreshRate, now);
             return;
         }
         Mutex::Autolock lock2(mDRMutex);
@@ -1336,6 +1351,12 @@ void ExynosPrimaryDisplay::handleDisplayIdleEnter(const uint32_t idleTeRefreshRa
                 break;
             }
         }
+        /* The kernel leaves idle on the next commit if the planes can't be fetched at idle TE */
+        if (needed) {
+            mIdleTeAlignmentPolicy.reset();
+        } else {
+            mIdleTeAlignmentPolicy.onIdleEnter(idleTeRefreshRate, now);
+        }
     }
 
     setDisplayNeedHandleIdleExit(needed, false);
@@ -1620,7 +1641,7 @@ void ExynosPrimaryDisplay::calculateTimelineLocked(
                                  ", newVsyncAppliedTimeNanos : %" PRId64
                                  ", refreshTimeNanos:%" PRId64
                                  ", mLastRefreshRateAppliedNanos:%" PRId64,
-                                 mActiveConfig, mDisplayConfigs[mActiveConfig].vsyncPeriod, config,
+                                 mActiveConfig.load(), mDisplayConfigs[mActiveConfig].vsyncPeriod, config,
                                  mDisplayConfigs[config].vsyncPeriod, isDelayed,
                                  ns2ms(lastUpdateDelta), ns2ms(threshold - lastUpdateDelta),
                                  ns2ms(threshold), ns2ms(now), ns2ms(origDesiredUpdateTimeNanos),
@@ -49,6 +49,7 @@ class ExynosPrimaryDisplay : public ExynosDisplay {
         virtual uint64_t getPendingExpectedPresentTime() override;
         virtual int getPendingFrameInterval() override;
         virtual void applyExpectedPresentTime();
+        virtual void onExpectedPresentTimeAdjusted(uint64_t timestamp) override;
         virtual int32_t setDisplayIdleTimer(const int32_t timeoutMs) override;
         virtual void handleDisplayIdleEnter(const uint32_t idleTeRefreshRate) override;
 
@@ -0,0 +1,452 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ReferenceDpu.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace android::hardware::graphics::composer::reference {
+
+namespace {
+
+struct Texel {
+    uint32_t r;
+    uint32_t g;
+    uint32_t b;
+    uint32_t a;
+};
+
+struct TexelF {
+    float r;
+    float g;
+    float b;
+    float a;
+};
+
+// The coordinate transform from a display frame pixel to the source crop.
+struct PlaneMapping {
+    // Size of the display frame before the rotation is applied.
+    int32_t preRotationWidth;
+    int32_t preRotationHeight;
+    int32_t cropWidth;
+    int32_t cropHeight;
+};
+
+uint32_t expandTo10Bit(uint32_t value, uint32_t bits) {
+    // Replicate the most significant bits into the new least significant bits.
+    uint32_t shift = kOutputPrecisionBits - bits;
+    uint32_t result = value << shift;
+    for (int32_t remaining = shift; remaining > 0; remaining -= bits) {
+        result |= (remaining >= static_cast<int32_t>(bits)) ? (value << (remaining - bits))
+                                                           : (value >> (bits - remaining));
+    }
+    return result;
+}
+
+Texel colorToTexel(uint32_t argb) {
+    return {.r = expandTo10Bit((argb >> 16) & 0xff, 8),
+            .g = expandTo10Bit((argb >> 8) & 0xff, 8),
+            .b = expandTo10Bit(argb & 0xff, 8),
+            .a = expandTo10Bit((argb >> 24) & 0xff, 8)};
+}
+
+Texel readTexel(const Buffer& buffer, int32_t x, int32_t y) {
+    const size_t index = static_cast<size_t>(y) * buffer.stride + x;
+    switch (buffer.format) {
+        case HAL_PIXEL_FORMAT_RGBA_8888:
+        case HAL_PIXEL_FORMAT_RGBX_8888: {
+            const uint8_t* p = static_cast<const uint8_t*>(buffer.data) + index * 4;
+            return {.r = expandTo10Bit(p[0], 8),
+                    .g = expandTo10Bit(p[1], 8),
+                    .b = expandTo10Bit(p[2], 8),
+                    .a = (buffer.format == HAL_PIXEL_FORMAT_RGBX_8888) ? kOutputMax
+                                                                      : expandTo10Bit(p[3], 8)};
+        }
+        case HAL_PIXEL_FORMAT_BGRA_8888: {
+            const uint8_t* p = static_cast<const uint8_t*>(buffer.data) + index * 4;
+            return {.r = expandTo10Bit(p[2], 8),
+                    .g = expandTo10Bit(p[1], 8),
+                    .b = expandTo10Bit(p[0], 8),
+                    .a = expandTo10Bit(p[3], 8)};
+        }
+        case HAL_PIXEL_FORMAT_RGB_888: {
+            const uint8_t* p = static_cast<const uint8_t*>(buffer.data) + index * 3;
+            return {.r = expandTo10Bit(p[0], 8),
+                    .g = expandTo10Bit(p[1], 8),
+                    .b = expandTo10Bit(p[2], 8),
+                    .a = kOutputMax};
+        }
+        case HAL_PIXEL_FORMAT_RGB_565: {
+            uint16_t v = static_cast<const uint16_t*>(buffer.data)[index];
+            return {.r = expandTo10Bit((v >> 11) & 0x1f, 5),
+                    .g = expandTo10Bit((v >> 5) & 0x3f, 6),
+                    .b = expandTo10Bit(v & 0x1f, 5),
+                    .a = kOutputMax};
+        }
+        case HAL_PIXEL_FORMAT_RGBA_1010102: {
+            uint32_t v = static_cast<const uint32_t*>(buffer.data)[index];
+            return {.r = v & 0x3ff,
+                    .g = (v >> 10) & 0x3ff,
+                    .b = (v >> 20) & 0x3ff,
+                    .a = expandTo10Bit(v >> 30, 2)};
+        }
+        default:
+            return {0, 0, 0, 0};
+    }
+}
+
+TexelF toFloat(const Texel& t) {
+    return {.r = static_cast<float>(t.r) / kOutputMax,
+            .g = static_cast<float>(t.g) / kOutputMax,
+            .b = static_cast<float>(t.b) / kOutputMax,
+            .a = static_cast<float>(t.a) / kOutputMax};
+}
+
+bool isDataspaceCompatible(android_dataspace plane, android_dataspace output) {
+    const uint32_t p = static_cast<uint32_t>(plane);
+    const uint32_t o = static_cast<uint32_t>(output);
+    for (uint32_t mask : {static_cast<uint32_t>(HAL_DATASPACE_STANDARD_MASK),
+                          static_cast<uint32_t>(HAL_DATASPACE_TRANSFER_MASK),
+                          static_cast<uint32_t>(HAL_DATASPACE_RANGE_MASK)}) {
+        // An unspecified field matches anything.
+        if ((p & mask) && (o & mask) && ((p & mask) != (o & mask))) return false;
+    }
+    return true;
+}
+
+bool validatePlane(const Plane& plane, android_dataspace outputDataspace, size_t index,
+                   PlaneMapping* mapping, std::string* error) {
+    std::ostringstream os;
+    os << "plane " << index << ": ";
+    if (plane.displayFrame.isEmpty()) {
+        os << "empty display frame";
+        *error = os.str();
+        return false;
+    }
+    if ((plane.planeAlpha < 0.0f) || (plane.planeAlpha > 1.0f)) {
+        os << "plane alpha " << plane.planeAlpha << " out of range";
+        *error = os.str();
+        return false;
+    }
+    const bool rotated = (plane.transform & HAL_TRANSFORM_ROT_90) != 0;
+    mapping->preRotationWidth = rotated ? plane.displayFrame.height() : plane.displayFrame.width();
+    mapping->preRotationHeight = rotated ? plane.displayFrame.width() : plane.displayFrame.height();
+    if (plane.isColor) {
+        mapping->cropWidth = 1;
+        mapping->cropHeight = 1;
+        return true;
+    }
+
+    const Buffer& buffer = plane.buffer;
+    if (!buffer.data || !isFormatSupported(buffer.format)) {
+        os << "unsupported buffer (format " << buffer.format << ")";
+        *error = os.str();
+        return false;
+    }
+    if (buffer.stride < buffer.width) {
+        os << "stride " << buffer.stride << " is smaller than width " << buffer.width;
+        *error = os.str();
+        return false;
+    }
+    const Rect& crop = plane.sourceCrop;
+    if (crop.isEmpty() || (crop.left < 0) || (crop.top < 0) ||
+        (crop.right > static_cast<int32_t>(buffer.width)) ||
+        (crop.bottom > static_cast<int32_t>(buffer.height))) {
+        os << "source crop [" << crop.left << ", " << crop.top << ", " << crop.right << ", "
+           << crop.bottom << "] is outside of the " << buffer.width << "x" << buffer.height
+           << " buffer";
+        *error = os.str();
+        return false;
+    }
+    if (!isDataspaceCompatible(plane.dataspace, outputDataspace)) {
+        os << "dataspace 0x" << std::hex << plane.dataspace << " needs a conversion to 0x"
+           << outputDataspace;
+        *error = os.str();
+        return false;
+    }
+    mapping->cropWidth = crop.width();
+    mapping->cropHeight = crop.height();
+    return true;
+}
+
+// Maps a pixel of the display frame to the pixel of the pre-rotation frame that samples it.
+void toPreTransform(const Plane& plane, const PlaneMapping& mapping, int32_t dx, int32_t dy,
+                    int32_t* px, int32_t* py) {
+    const int32_t frameWidth = plane.displayFrame.width();
+    if (plane.transform & HAL_TRANSFORM_ROT_90) {
+        // A 90 degree clockwise rotation moves (x, y) to (h - 1 - y, x).
+        *px = dy;
+        *py = frameWidth - 1 - dx;
+    } else {
+        *px = dx;
+        *py = dy;
+    }
+    if (plane.transform & HAL_TRANSFORM_FLIP_H) *px = mapping.preRotationWidth - 1 - *px;
+    if (plane.transform & HAL_TRANSFORM_FLIP_V) *py = mapping.preRotationHeight - 1 - *py;
+}
+
+Rect clipToOutput(const Rect& frame, uint32_t width, uint32_t height) {
+    return {.left = std::max(frame.left, 0),
+            .top = std::max(frame.top, 0),
+            .right = std::min(frame.right, static_cast<int32_t>(width)),
+            .bottom = std::min(frame.bottom, static_cast<int32_t>(height))};
+}
+
+uint32_t mul10(uint32_t a, uint32_t b) {
+    return (a * b + kOutputMax / 2) / kOutputMax;
+}
+
+// Source position of a pre-rotation pixel center, in 16.16 fixed point texel units relative to the
+// source crop, as programmed in the DPU scaler.
+int64_t scalerPosition(int32_t index, int32_t cropSize, int32_t frameSize) {
+    return ((2 * static_cast<int64_t>(index) + 1) * cropSize * 65536) / (2 * frameSize) - 32768;
+}
+
+Texel sampleDpu(const Plane& plane, const PlaneMapping& mapping, int32_t px, int32_t py) {
+    if (plane.isColor) return colorToTexel(plane.color);
+
+    constexpr uint32_t kPhases = 1 << ReferenceDpu::kScalerPhaseBits;
+    const Rect& crop = plane.sourceCrop;
+    const int64_t sx = scalerPosition(px, mapping.cropWidth, mapping.preRotationWidth);
+    const int64_t sy = scalerPosition(py, mapping.cropHeight, mapping.preRotationHeight);
+    // Positions are clamped to the crop, so edge texels are never blended with outside pixels.
+    auto split = [](int64_t pos, int32_t size, int32_t* i0, int32_t* i1, uint32_t* phase) {
+        pos = std::clamp<int64_t>(pos, 0, static_cast<int64_t>(size - 1) * 65536);
+        *i0 = static_cast<int32_t>(pos >> 16);
+        *i1 = std::min(*i0 + 1, size - 1);
+        *phase = static_cast<uint32_t>((pos & 0xffff) >> (16 - ReferenceDpu::kScalerPhaseBits));
+    };
+    int32_t x0, x1, y0, y1;
+    uint32_t fx, fy;
+    split(sx, mapping.cropWidth, &x0, &x1, &fx);
+    split(sy, mapping.cropHeight, &y0, &y1, &fy);
+
+    const Texel t00 = readTexel(plane.buffer, crop.left + x0, crop.top + y0);
+    const Texel t10 = readTexel(plane.buffer, crop.left + x1, crop.top + y0);
+    const Texel t01 = readTexel(plane.buffer, crop.left + x0, crop.top + y1);
+    const Texel t11 = readTexel(plane.buffer, crop.left + x1, crop.top + y1);
+    constexpr uint32_t kShift = 2 * ReferenceDpu::kScalerPhaseBits;
+    auto filter = [&](uint32_t c00, uint32_t c10, uint32_t c01, uint32_t c11) {
+        uint32_t top = c00 * (kPhases - fx) + c10 * fx;
+        uint32_t bottom = c01 * (kPhases - fx) + c11 * fx;
+        return (top * (kPhases - fy) + bottom * fy + (1 << (kShift - 1))) >> kShift;
+    };
+    return {.r = filter(t00.r, t10.r, t01.r, t11.r),
+            .g = filter(t00.g, t10.g, t01.g, t11.g),
+            .b = filter(t00.b, t10.b, t01.b, t11.b),
+            .a = filter(t00.a, t10.a, t01.a, t11.a)};
+}
+
+TexelF sampleClient(const Plane& plane, const PlaneMapping& mapping, int32_t px, int32_t py) {
+    if (plane.isColor) return toFloat(colorToTexel(plane.color));
+
+    const Rect& crop = plane.sourceCrop;
+    auto position = [](int32_t index, int32_t cropSize, int32_t frameSize) {
+        double pos = (index + 0.5) * cropSize / frameSize - 0.5;
+        return std::clamp(pos, 0.0, static_cast<double>(cropSize - 1));
+    };
+    const double sx = position(px, mapping.cropWidth, mapping.preRotationWidth);
+    const double sy = position(py, mapping.cropHeight, mapping.preRotationHeight);
+    const int32_t x0 = static_cast<int32_t>(sx);
+    const int32_t y0 = static_cast<int32_t>(sy);
+    const int32_t x1 = std::min(x0 + 1, mapping.cropWidth - 1);
+    const int32_t y1 = std::min(y0 + 1, mapping.cropHeight - 1);
+    const float fx = static_cast<float>(sx - x0);
+    const float fy = static_cast<float>(sy - y0);
+
+    const TexelF t00 = toFloat(readTexel(plane.buffer, crop.left + x0, crop.top + y0));
+    const TexelF t10 = toFloat(readTexel(plane.buffer, crop.left + x1, crop.top + y0));
+    const TexelF t01 = toFloat(readTexel(plane.buffer, crop.left + x0, crop.top + y1));
+    const TexelF t11 = toFloat(readTexel(plane.buffer, crop.left + x1, crop.top + y1));
+    auto filter = [&](float c00, float c10, float c01, float c11) {
+        return (c00 * (1 - fx) + c10 * fx) * (1 - fy) + (c01 * (1 - fx) + c11 * fx) * fy;
+    };
+    return {.r = filter(t00.r, t10.r, t01.r, t11.r),
+            .g = filter(t00.g, t10.g, t01.g, t11.g),
+            .b = filter(t00.b, t10.b, t01.b, t11.b),
+            .a = filter(t00.a, t10.a, t01.a, t11.a)};
+}
+
+uint16_t quantize(float value) {
+    return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * kOutputMax));
+}
+
+} // namespace
+
+bool isFormatSupported(int32_t format) {
+    switch (format) {
+        case HAL_PIXEL_FORMAT_RGBA_8888:
+        case HAL_PIXEL_FORMAT_RGBX_8888:
+        case HAL_PIXEL_FORMAT_BGRA_8888:
+        case HAL_PIXEL_FORMAT_RGB_888:
+        case HAL_PIXEL_FORMAT_RGB_565:
+        case HAL_PIXEL_FORMAT_RGBA_1010102:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool ReferenceDpu::render(const std::vector<Plane>& planes, uint32_t width, uint32_t height,
+                          android_dataspace outputDataspace, Image* output, std::string* error) {
+    *output = Image(width, height);
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            output->at(x, y).a = kOutputMax;
+        }
+    }
+
+    for (size_t i = 0; i < planes.size(); ++i) {
+        const Plane& plane = planes[i];
+        PlaneMapping mapping;
+        if (!validatePlane(plane, outputDataspace, i, &mapping, error)) return false;
+
+        const uint32_t planeAlpha = static_cast<uint32_t>(std::lround(plane.planeAlpha * kOutputMax));
+        const Rect clipped = clipToOutput(plane.displayFrame, width, height);
+        for (int32_t y = clipped.top; y < clipped.bottom; ++y) {
+            for (int32_t x = clipped.left; x < clipped.right; ++x) {
+                int32_t px, py;
+                toPreTransform(plane, mapping, x - plane.displayFrame.left,
+                               y - plane.displayFrame.top, &px, &py);
+                Texel src = sampleDpu(plane, mapping, px, py);
+
+                uint32_t alpha;
+                switch (plane.blendMode) {
+                    case BlendMode::kPremultiplied:
+                        alpha = mul10(src.a, planeAlpha);
+                        src = {mul10(src.r, planeAlpha), mul10(src.g, planeAlpha),
+                               mul10(src.b, planeAlpha), alpha};
+                        break;
+                    case BlendMode::kCoverage:
+                        alpha = mul10(src.a, planeAlpha);
+                        src = {mul10(src.r, alpha), mul10(src.g, alpha), mul10(src.b, alpha),
+                               alpha};
+                        break;
+                    case BlendMode::kNone:
+                    default:
+                        alpha = planeAlpha;
+                        src = {mul10(src.r, alpha), mul10(src.g, alpha), mul10(src.b, alpha),
+                               alpha};
+                        break;
+                }
+
+                Pixel& dst = output->at(x, y);
+                const uint32_t inverse = kOutputMax - alpha;
+                dst.r = std::min(kOutputMax, src.r + mul10(dst.r, inverse));
+                dst.g = std::min(kOutputMax, src.g + mul10(dst.g, inverse));
+                dst.b = std::min(kOutputMax, src.b + mul10(dst.b, inverse));
+                dst.a = std::min(kOutputMax, src.a + mul10(dst.a, inverse));
+            }
+        }
+    }
+    return true;
+}
+
+bool ReferenceClientCompositor::render(const std::vector<Plane>& planes, uint32_t width,
+                                       uint32_t height, android_dataspace outputDataspace,
+                                       Image* output, std::string* error) {
+    std::vector<TexelF> accumulator(static_cast<size_t>(width) * height, {0, 0, 0, 1});
+
+    for (size_t i = 0; i < planes.size(); ++i) {
+        const Plane& plane = planes[i];
+        PlaneMapping mapping;
+        if (!validatePlane(plane, outputDataspace, i, &mapping, error)) return false;
+
+        const Rect clipped = clipToOutput(plane.displayFrame, width, height);
+        for (int32_t y = clipped.top; y < clipped.bottom; ++y) {
+            for (int32_t x = clipped.left; x < clipped.right; ++x) {
+                int32_t px, py;
+                toPreTransform(plane, mapping, x - plane.displayFrame.left,
+                               y - plane.displayFrame.top, &px, &py);
+                TexelF src = sampleClient(plane, mapping, px, py);
+
+                float alpha;
+                float colorScale;
+                switch (plane.blendMode) {
+                    case BlendMode::kPremultiplied:
+                        alpha = src.a * plane.planeAlpha;
+                        colorScale = plane.planeAlpha;
+                        break;
+                    case BlendMode::kCoverage:
+                        alpha = src.a * plane.planeAlpha;
+                        colorScale = alpha;
+                        break;
+                    case BlendMode::kNone:
+                    default:
+                        alpha = plane.planeAlpha;
+                        colorScale = alpha;
+                        break;
+                }
+
+                // The render target saturates on every blend, like the DPU blender.
+                TexelF& dst = accumulator[static_cast<size_t>(y) * width + x];
+                dst.r = std::min(1.0f, src.r * colorScale + dst.r * (1 - alpha));
+                dst.g = std::min(1.0f, src.g * colorScale + dst.g * (1 - alpha));
+                dst.b = std::min(1.0f, src.b * colorScale + dst.b * (1 - alpha));
+                dst.a = std::min(1.0f, alpha + dst.a * (1 - alpha));
+            }
+        }
+    }
+
+    *output = Image(width, height);
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            const TexelF& c = accumulator[static_cast<size_t>(y) * width + x];
+            output->at(x, y) = {quantize(c.r), quantize(c.g), quantize(c.b), quantize(c.a)};
+        }
+    }
+    return true;
+}
+
+std::string ImageDiff::toString() const {
+    std::ostringstream os;
+    os << "max difference = " << maxDifference << ", mismatched pixels = " << numMismatchedPixels;
+    if (numMismatchedPixels) {
+        os << ", first mismatch at (" << firstX << ", " << firstY << ")";
+    }
+    return os.str();
+}
+
+ImageDiff compareImages(const Image& a, const Image& b, uint32_t tolerance) {
+    ImageDiff diff;
+    if ((a.getWidth() != b.getWidth()) || (a.getHeight() != b.getHeight())) {
+        diff.maxDifference = kOutputMax;
+        diff.numMismatchedPixels = std::max(static_cast<uint64_t>(a.getWidth()) * a.getHeight(),
+                                            static_cast<uint64_t>(b.getWidth()) * b.getHeight());
+        return diff;
+    }
+    for (uint32_t y = 0; y < a.getHeight(); ++y) {
+        for (uint32_t x = 0; x < a.getWidth(); ++x) {
+            const Pixel& pa = a.at(x, y);
+            const Pixel& pb = b.at(x, y);
+            uint32_t d = std::max({std::abs(pa.r - pb.r), std::abs(pa.g - pb.g),
+                                   std::abs(pa.b - pb.b), std::abs(pa.a - pb.a)});
+            diff.maxDifference = std::max(diff.maxDifference, d);
+            if (d > tolerance) {
+                if (diff.numMismatchedPixels == 0) {
+                    diff.firstX = x;
+                    diff.firstY = y;
+                }
+                ++diff.numMismatchedPixels;
+            }
+        }
+    }
+    return diff;
+}
+
+} // namespace android::hardware::graphics::composer::reference
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <system/graphics.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace android::hardware::graphics::composer::reference {
+
+// Same values as hwc2_blend_mode_t.
+enum class BlendMode : int32_t {
+    kNone = 1,
+    kPremultiplied = 2,
+    kCoverage = 3,
+};
+
+struct Rect {
+    int32_t left = 0;
+    int32_t top = 0;
+    int32_t right = 0;
+    int32_t bottom = 0;
+
+    int32_t width() const { return right - left; }
+    int32_t height() const { return bottom - top; }
+    bool isEmpty() const { return (width() <= 0) || (height() <= 0); }
+};
+
+// A CPU accessible input buffer. |stride| is in pixels.
+struct Buffer {
+    const void* data = nullptr;
+    int32_t format = HAL_PIXEL_FORMAT_RGBA_8888;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t stride = 0;
+};
+
+// Final per-plane state of a commit, in the same terms as exynos_win_config_data. See
+// WinConfigConverter.h to build it from the committed window state.
+struct Plane {
+    // A solid color plane (dim layer) uses |color| (ARGB8888) instead of |buffer|.
+    bool isColor = false;
+    uint32_t color = 0;
+    Buffer buffer;
+    Rect sourceCrop;
+    Rect displayFrame;
+    uint32_t transform = 0;
+    BlendMode blendMode = BlendMode::kNone;
+    float planeAlpha = 1.0f;
+    android_dataspace dataspace = HAL_DATASPACE_UNKNOWN;
+};
+
+// Output pixel with |kOutputPrecisionBits| per channel, not premultiplied.
+struct Pixel {
+    uint16_t r = 0;
+    uint16_t g = 0;
+    uint16_t b = 0;
+    uint16_t a = 0;
+};
+
+static constexpr uint32_t kOutputPrecisionBits = 10;
+static constexpr uint32_t kOutputMax = (1 << kOutputPrecisionBits) - 1;
+
+class Image {
+public:
+    Image() = default;
+    Image(uint32_t width, uint32_t height) : mWidth(width), mHeight(height) {
+        mPixels.resize(static_cast<size_t>(width) * height);
+    }
+
+    uint32_t getWidth() const { return mWidth; }
+    uint32_t getHeight() const { return mHeight; }
+    Pixel& at(uint32_t x, uint32_t y) { return mPixels[static_cast<size_t>(y) * mWidth + x]; }
+    const Pixel& at(uint32_t x, uint32_t y) const {
+        return mPixels[static_cast<size_t>(y) * mWidth + x];
+    }
+
+private:
+    uint32_t mWidth = 0;
+    uint32_t mHeight = 0;
+    std::vector<Pixel> mPixels;
+};
+
+// Renders planes the way the DPU does: blending in |kOutputPrecisionBits| fixed point in the
+// encoded (non-linear) domain, and scaling with a bilinear filter of |kScalerPhaseBits| phases.
+// Planes are given in z-order, bottom first, and are blended over an opaque black background.
+class ReferenceDpu {
+public:
+    static constexpr uint32_t kScalerPhaseBits = 6;
+
+    // Returns false and sets |error| if a plane can not be modeled, e.g. an unsupported format or
+    // a dataspace that would need a color conversion in the DPU.
+    static bool render(const std::vector<Plane>& planes, uint32_t width, uint32_t height,
+                       android_dataspace outputDataspace, Image* output, std::string* error);
+};
+
+// Renders the same planes the way client (GPU) composition does, in floating point with an exact
+// bilinear filter, quantized to |kOutputPrecisionBits| only at the end.
+class ReferenceClientCompositor {
+public:
+    static bool render(const std::vector<Plane>& planes, uint32_t width, uint32_t height,
+                       android_dataspace outputDataspace, Image* output, std::string* error);
+};
+
+struct ImageDiff {
+    uint32_t maxDifference = 0;
+    uint64_t numMismatchedPixels = 0;
+    // Coordinates of the first mismatched pixel, valid if |numMismatchedPixels| is not 0.
+    uint32_t firstX = 0;
+    uint32_t firstY = 0;
+
+    std::string toString() const;
+};
+
+// Compares two images of the same size. A pixel mismatches if any channel differs by more than
+// |tolerance| in units of the output precision.
+ImageDiff compareImages(const Image& a, const Image& b, uint32_t tolerance);
+
+// Returns true if |format| can be read by the reference renderers.
+bool isFormatSupported(int32_t format);
+
+} // namespace android::hardware::graphics::composer::reference
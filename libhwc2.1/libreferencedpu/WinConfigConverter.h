@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ReferenceDpu.h"
+
+namespace android::hardware::graphics::composer::reference {
+
+// Converts the committed window state, exynos_win_config_data in exynos_dpu_data::configs, into
+// the planes rendered by |ReferenceDpu|. Windows are given in z-order, bottom first.
+//
+// |WinConfig| is exynos_win_config_data. It is a template parameter so that this header does not
+// pull libexynosdisplay into host builds; any type with the same members converts the same way.
+// Buffers in the commit path are not CPU mapped, so |mapBuffer| returns a CPU view of the buffer
+// of a window, or std::nullopt if it cannot provide one (e.g. a compressed or protected buffer).
+// The width, height and format of the view are taken from the window.
+//
+// Returns false and sets |error| if a window can not be modeled.
+template <typename WinConfig, typename BufferMapper>
+bool convertWinConfigs(const std::vector<WinConfig>& configs, BufferMapper&& mapBuffer,
+                       std::vector<Plane>* planes, std::string* error) {
+    planes->clear();
+    for (size_t i = 0; i < configs.size(); ++i) {
+        const WinConfig& config = configs[i];
+        if ((config.state != WinConfig::WIN_STATE_COLOR) &&
+            (config.state != WinConfig::WIN_STATE_BUFFER) &&
+            (config.state != WinConfig::WIN_STATE_CURSOR)) {
+            continue;
+        }
+
+        std::ostringstream os;
+        os << "window " << i << ": ";
+        if (config.hdr_enable || config.needColorTransform) {
+            os << "HDR processing and color transforms are not modeled";
+            *error = os.str();
+            return false;
+        }
+
+        Plane plane;
+        plane.displayFrame = {.left = config.dst.x,
+                              .top = config.dst.y,
+                              .right = config.dst.x + static_cast<int32_t>(config.dst.w),
+                              .bottom = config.dst.y + static_cast<int32_t>(config.dst.h)};
+        plane.planeAlpha = config.plane_alpha;
+        plane.blendMode = static_cast<BlendMode>(config.blending);
+        if (config.state == WinConfig::WIN_STATE_COLOR) {
+            plane.isColor = true;
+            plane.color = config.color;
+            planes->push_back(plane);
+            continue;
+        }
+
+        std::optional<Buffer> buffer = mapBuffer(config);
+        if (!buffer.has_value()) {
+            os << "buffer is not CPU accessible";
+            *error = os.str();
+            return false;
+        }
+        plane.buffer = buffer.value();
+        plane.buffer.format = config.format;
+        plane.buffer.width = config.src.f_w;
+        plane.buffer.height = config.src.f_h;
+        plane.sourceCrop = {.left = config.src.x,
+                            .top = config.src.y,
+                            .right = config.src.x + static_cast<int32_t>(config.src.w),
+                            .bottom = config.src.y + static_cast<int32_t>(config.src.h)};
+        plane.transform = config.transform;
+        plane.dataspace = config.dataspace;
+        planes->push_back(plane);
+    }
+    return true;
+}
+
+} // namespace android::hardware::graphics::composer::reference
@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <random>
+
+#include "../../DeconCommonHeader.h"
+#include "ReferenceDpu.h"
+#include "WinConfigConverter.h"
+
+namespace android::hardware::graphics::composer::reference {
+namespace {
+
+// The members of exynos_win_config_data read by convertWinConfigs().
+struct TestWinConfig {
+    enum {
+        WIN_STATE_DISABLED = 0,
+        WIN_STATE_COLOR,
+        WIN_STATE_BUFFER,
+        WIN_STATE_UPDATE,
+        WIN_STATE_CURSOR,
+        WIN_STATE_RCD,
+    } state = WIN_STATE_DISABLED;
+
+    uint32_t color = 0;
+    uint64_t buffer_id = 0;
+    float plane_alpha = 1;
+    int32_t blending = static_cast<int32_t>(BlendMode::kNone);
+    int format = 0;
+    uint32_t transform = 0;
+    android_dataspace dataspace = HAL_DATASPACE_UNKNOWN;
+    bool hdr_enable = false;
+    struct decon_frame src = {0, 0, 0, 0, 0, 0};
+    struct decon_frame dst = {0, 0, 0, 0, 0, 0};
+    bool needColorTransform = false;
+};
+
+constexpr uint32_t kOutputWidth = 64;
+constexpr uint32_t kOutputHeight = 48;
+
+// CPU buffers standing in for the graphic buffers of a commit, looked up by buffer id.
+class TestBuffers {
+public:
+    uint64_t allocate(int32_t format, uint32_t width, uint32_t height, std::mt19937* rng) {
+        const uint32_t bytesPerPixel = (format == HAL_PIXEL_FORMAT_RGB_888) ? 3
+                : (format == HAL_PIXEL_FORMAT_RGB_565)                     ? 2
+                                                                           : 4;
+        // Pad the stride to check that it is honored.
+        const uint32_t stride = width + 3;
+        auto& storage = mStorage[++mLastId];
+        storage.resize(static_cast<size_t>(stride) * height * bytesPerPixel);
+        std::uniform_int_distribution<int> byte(0, 255);
+        for (auto& b : storage) b = static_cast<uint8_t>(byte(*rng));
+        mBuffers[mLastId] = {.data = storage.data(), .stride = stride};
+        return mLastId;
+    }
+
+    std::optional<Buffer> map(const TestWinConfig& config) const {
+        auto it = mBuffers.find(config.buffer_id);
+        if (it == mBuffers.end()) return std::nullopt;
+        return it->second;
+    }
+
+private:
+    uint64_t mLastId = 0;
+    std::map<uint64_t, std::vector<uint8_t>> mStorage;
+    std::map<uint64_t, Buffer> mBuffers;
+};
+
+TestWinConfig makeColorWindow(uint32_t argb, decon_frame dst) {
+    TestWinConfig config;
+    config.state = TestWinConfig::WIN_STATE_COLOR;
+    config.color = argb;
+    config.dst = dst;
+    return config;
+}
+
+TestWinConfig makeBufferWindow(uint64_t bufferId, int32_t format, decon_frame src,
+                               decon_frame dst) {
+    TestWinConfig config;
+    config.state = TestWinConfig::WIN_STATE_BUFFER;
+    config.buffer_id = bufferId;
+    config.format = format;
+    config.src = src;
+    config.dst = dst;
+    return config;
+}
+
+bool convert(const std::vector<TestWinConfig>& configs, const TestBuffers& buffers,
+             std::vector<Plane>* planes, std::string* error) {
+    return convertWinConfigs(
+            configs, [&buffers](const TestWinConfig& config) { return buffers.map(config); },
+            planes, error);
+}
+
+TEST(WinConfigConverterTest, ConvertsEnabledWindowsInOrder) {
+    std::mt19937 rng(1);
+    TestBuffers buffers;
+    const uint64_t id = buffers.allocate(HAL_PIXEL_FORMAT_RGBA_8888, 32, 16, &rng);
+
+    std::vector<TestWinConfig> configs(4);
+    configs[0] = makeColorWindow(0xff102030, {0, 0, kOutputWidth, kOutputHeight, 0, 0});
+    configs[2] = makeBufferWindow(id, HAL_PIXEL_FORMAT_RGBA_8888, {4, 2, 20, 10, 32, 16},
+                                  {8, 6, 40, 20, kOutputWidth, kOutputHeight});
+    configs[2].blending = static_cast<int32_t>(BlendMode::kPremultiplied);
+    configs[2].plane_alpha = 0.5f;
+    configs[2].transform = HAL_TRANSFORM_FLIP_H;
+
+    std::vector<Plane> planes;
+    std::string error;
+    ASSERT_TRUE(convert(configs, buffers, &planes, &error)) << error;
+    ASSERT_EQ(planes.size(), 2u);
+
+    EXPECT_TRUE(planes[0].isColor);
+    EXPECT_EQ(planes[0].color, 0xff102030);
+    EXPECT_EQ(planes[0].displayFrame.right, static_cast<int32_t>(kOutputWidth));
+
+    const Plane& plane = planes[1];
+    EXPECT_FALSE(plane.isColor);
+    EXPECT_EQ(plane.buffer.width, 32u);
+    EXPECT_EQ(plane.buffer.height, 16u);
+    EXPECT_EQ(plane.buffer.stride, 35u);
+    EXPECT_EQ(plane.sourceCrop.left, 4);
+    EXPECT_EQ(plane.sourceCrop.top, 2);
+    EXPECT_EQ(plane.sourceCrop.right, 24);
+    EXPECT_EQ(plane.sourceCrop.bottom, 12);
+    EXPECT_EQ(plane.displayFrame.left, 8);
+    EXPECT_EQ(plane.displayFrame.bottom, 26);
+    EXPECT_EQ(plane.blendMode, BlendMode::kPremultiplied);
+    EXPECT_FLOAT_EQ(plane.planeAlpha, 0.5f);
+    EXPECT_EQ(plane.transform, static_cast<uint32_t>(HAL_TRANSFORM_FLIP_H));
+}
+
+TEST(WinConfigConverterTest, RejectsUnmappedBuffer) {
+    TestBuffers buffers;
+    std::vector<TestWinConfig> configs = {
+            makeBufferWindow(42, HAL_PIXEL_FORMAT_RGBA_8888, {0, 0, 8, 8, 8, 8},
+                             {0, 0, 8, 8, kOutputWidth, kOutputHeight})};
+    std::vector<Plane> planes;
+    std::string error;
+    EXPECT_FALSE(convert(configs, buffers, &planes, &error));
+    EXPECT_NE(error.find("window 0"), std::string::npos) << error;
+}
+
+TEST(WinConfigConverterTest, RejectsHdrProcessing) {
+    std::vector<TestWinConfig> configs = {
+            makeColorWindow(0xffffffff, {0, 0, 8, 8, kOutputWidth, kOutputHeight})};
+    configs[0].hdr_enable = true;
+    std::vector<Plane> planes;
+    std::string error;
+    EXPECT_FALSE(convert(configs, TestBuffers(), &planes, &error));
+}
+
+TEST(ReferenceDpuTest, UnscaledStackMatchesClientComposition) {
+    std::mt19937 rng(2);
+    TestBuffers buffers;
+    const uint64_t id = buffers.allocate(HAL_PIXEL_FORMAT_RGBA_8888, kOutputWidth, kOutputHeight,
+                                         &rng);
+    std::vector<TestWinConfig> configs = {
+            makeColorWindow(0xff336699, {0, 0, kOutputWidth, kOutputHeight, 0, 0}),
+            makeBufferWindow(id, HAL_PIXEL_FORMAT_RGBA_8888,
+                             {0, 0, kOutputWidth, kOutputHeight, kOutputWidth, kOutputHeight},
+                             {0, 0, kOutputWidth, kOutputHeight, kOutputWidth, kOutputHeight})};
+    configs[1].blending = static_cast<int32_t>(BlendMode::kCoverage);
+    configs[1].plane_alpha = 0.75f;
+
+    std::vector<Plane> planes;
+    std::string error;
+    ASSERT_TRUE(convert(configs, buffers, &planes, &error)) << error;
+    Image dpu, client;
+    ASSERT_TRUE(ReferenceDpu::render(planes, kOutputWidth, kOutputHeight, HAL_DATASPACE_UNKNOWN,
+                                     &dpu, &error))
+            << error;
+    ASSERT_TRUE(ReferenceClientCompositor::render(planes, kOutputWidth, kOutputHeight,
+                                                  HAL_DATASPACE_UNKNOWN, &client, &error))
+            << error;
+    // Only the fixed point rounding of the two blends differs.
+    auto diff = compareImages(dpu, client, 2);
+    EXPECT_EQ(diff.numMismatchedPixels, 0u) << diff.toString();
+}
+
+TEST(ReferenceDpuTest, RejectsDataspaceConversion) {
+    std::mt19937 rng(3);
+    TestBuffers buffers;
+    const uint64_t id = buffers.allocate(HAL_PIXEL_FORMAT_RGBA_8888, 8, 8, &rng);
+    std::vector<TestWinConfig> configs = {
+            makeBufferWindow(id, HAL_PIXEL_FORMAT_RGBA_8888, {0, 0, 8, 8, 8, 8},
+                             {0, 0, 8, 8, kOutputWidth, kOutputHeight})};
+    configs[0].dataspace = HAL_DATASPACE_V0_SRGB;
+
+    std::vector<Plane> planes;
+    std::string error;
+    ASSERT_TRUE(convert(configs, buffers, &planes, &error)) << error;
+    Image dpu;
+    EXPECT_FALSE(ReferenceDpu::render(planes, kOutputWidth, kOutputHeight,
+                                      HAL_DATASPACE_DISPLAY_P3, &dpu, &error));
+}
+
+// Renders random window stacks with both renderers. The DPU model must stay within the
+// precision of its blender and of its 64 phase scaler of client composition: on noise, a phase
+// error of 1/128 pixel in both directions, plus the rounding of up to 4 blends.
+TEST(ReferenceDpuTest, RandomStacksMatchClientComposition) {
+    constexpr int kNumStacks = 200;
+    const int32_t kFormats[] = {HAL_PIXEL_FORMAT_RGBA_8888, HAL_PIXEL_FORMAT_RGBX_8888,
+                                HAL_PIXEL_FORMAT_BGRA_8888, HAL_PIXEL_FORMAT_RGB_888,
+                                HAL_PIXEL_FORMAT_RGB_565,   HAL_PIXEL_FORMAT_RGBA_1010102};
+    const uint32_t kTransforms[] = {0,
+                                    HAL_TRANSFORM_FLIP_H,
+                                    HAL_TRANSFORM_FLIP_V,
+                                    HAL_TRANSFORM_ROT_90,
+                                    HAL_TRANSFORM_FLIP_H | HAL_TRANSFORM_FLIP_V,
+                                    HAL_TRANSFORM_FLIP_H | HAL_TRANSFORM_FLIP_V |
+                                            HAL_TRANSFORM_ROT_90};
+    const BlendMode kBlendModes[] = {BlendMode::kNone, BlendMode::kPremultiplied,
+                                     BlendMode::kCoverage};
+
+    constexpr uint32_t kTolerance = 32;
+    std::mt19937 rng(4);
+    auto uniform = [&rng](int32_t min, int32_t max) {
+        return std::uniform_int_distribution<int32_t>(min, max)(rng);
+    };
+    for (int n = 0; n < kNumStacks; ++n) {
+        TestBuffers buffers;
+        std::vector<TestWinConfig> configs;
+        const int numWindows = uniform(1, 4);
+        for (int i = 0; i < numWindows; ++i) {
+            decon_frame dst;
+            dst.x = uniform(-8, kOutputWidth - 8);
+            dst.y = uniform(-8, kOutputHeight - 8);
+            dst.w = uniform(4, kOutputWidth);
+            dst.h = uniform(4, kOutputHeight);
+            dst.f_w = kOutputWidth;
+            dst.f_h = kOutputHeight;
+            if (uniform(0, 4) == 0) {
+                configs.push_back(makeColorWindow(static_cast<uint32_t>(rng()), dst));
+            } else {
+                const int32_t format = kFormats[uniform(0, std::size(kFormats) - 1)];
+                const uint32_t width = uniform(4, 40);
+                const uint32_t height = uniform(4, 40);
+                const uint64_t id = buffers.allocate(format, width, height, &rng);
+                decon_frame src;
+                src.x = uniform(0, width - 2);
+                src.y = uniform(0, height - 2);
+                src.w = uniform(2, width - src.x);
+                src.h = uniform(2, height - src.y);
+                src.f_w = width;
+                src.f_h = height;
+                configs.push_back(makeBufferWindow(id, format, src, dst));
+                configs.back().transform = kTransforms[uniform(0, std::size(kTransforms) - 1)];
+            }
+            configs.back().blending =
+                    static_cast<int32_t>(kBlendModes[uniform(0, std::size(kBlendModes) - 1)]);
+            configs.back().plane_alpha = uniform(0, 100) / 100.0f;
+        }
+
+        std::vector<Plane> planes;
+        std::string error;
+        ASSERT_TRUE(convert(configs, buffers, &planes, &error)) << error;
+        Image dpu, client;
+        ASSERT_TRUE(ReferenceDpu::render(planes, kOutputWidth, kOutputHeight,
+                                         HAL_DATASPACE_UNKNOWN, &dpu, &error))
+                << "stack " << n << ": " << error;
+        ASSERT_TRUE(ReferenceClientCompositor::render(planes, kOutputWidth, kOutputHeight,
+                                                      HAL_DATASPACE_UNKNOWN, &client, &error))
+                << "stack " << n << ": " << error;
+        auto diff = compareImages(dpu, client, kTolerance);
+        EXPECT_EQ(diff.numMismatchedPixels, 0u) << "stack " << n << ": " << diff.toString();
+    }
+}
+
+} // namespace
+} // namespace android::hardware::graphics::composer::reference
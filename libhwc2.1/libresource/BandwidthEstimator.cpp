@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BandwidthEstimator.h"
+
+#include <cinttypes>
+#include <ratio>
+
+#include "ExynosDisplay.h"
+#include "ExynosLayer.h"
+
+void FrameBandwidthEstimate::dump(String8& result) const {
+    result.appendFormat("bandwidth estimate: dpu fetch(%" PRIu64 " KB/s, peak %" PRIu64
+                        " KB/s), m2m read(%" PRIu64 " KB/s), m2m write(%" PRIu64
+                        " KB/s), planes(%u), m2m jobs(%u), power proxy(%.1f mW)\n",
+                        dpuFetchBandwidth / 1000, dpuPeakFetchBandwidth / 1000,
+                        m2mReadBandwidth / 1000, m2mWriteBandwidth / 1000, numPlanes, numM2mJobs,
+                        powerProxy);
+}
+
+uint32_t BandwidthEstimator::getCompressionRatioPercent(int format,
+                                                        const CompressionInfo& compression) {
+    if (compression.type == COMP_TYPE_AFBC) return kAfbcRatioPercent;
+
+    for (unsigned int i = 0; i < FORMAT_MAX_CNT; i++) {
+        if (exynos_format_desc[i].halFormat != format) continue;
+        switch (exynos_format_desc[i].type & FORMAT_SBWC_MASK) {
+            case SBWC_LOSSLESS:
+                return kSbwcLosslessRatioPercent;
+            case SBWC_LOSSY_40:
+                return 40;
+            case SBWC_LOSSY_50:
+                return 50;
+            case SBWC_LOSSY_60:
+                return 60;
+            case SBWC_LOSSY_75:
+                return 75;
+            case SBWC_LOSSY_80:
+                return 80;
+            default:
+                return 100;
+        }
+    }
+    return 100;
+}
+
+uint64_t BandwidthEstimator::getImageBytes(const exynos_image& image) {
+    uint64_t bytes = static_cast<uint64_t>(image.w) * image.h * formatToBpp(image.format) / 8;
+    return bytes * getCompressionRatioPercent(image.format, image.compressionInfo) / 100;
+}
+
+uint64_t BandwidthEstimator::getPlaneFetchBytes(const exynos_image& src, const exynos_image& dst) {
+    uint64_t bytes = getImageBytes(src);
+    /*
+     * Compressed buffers are fetched by blocks in any direction, but a rotated
+     * linear buffer is fetched with partially used bursts.
+     */
+    if ((dst.transform & HAL_TRANSFORM_ROT_90) && (src.compressionInfo.type == COMP_TYPE_NONE) &&
+        !isFormatSBWC(src.format)) {
+        bytes = bytes * kLinearRotationOverheadPercent / 100;
+    }
+    return bytes;
+}
+
+uint64_t BandwidthEstimator::getM2mReadBytes(const exynos_image& src) {
+    return getImageBytes(src);
+}
+
+uint64_t BandwidthEstimator::getM2mWriteBytes(const exynos_image& dst) {
+    return getImageBytes(dst);
+}
+
+uint64_t BandwidthEstimator::toBandwidth(uint64_t bytesPerFrame, uint32_t vsyncPeriodNs) {
+    if (vsyncPeriodNs == 0) return 0;
+    return bytesPerFrame * std::nano::den / vsyncPeriodNs;
+}
+
+uint64_t BandwidthEstimator::getWinConfigFetchBytes(const exynos_win_config_data& config) {
+    exynos_image src;
+    src.w = config.src.w;
+    src.h = config.src.h;
+    src.format = config.format;
+    src.compressionInfo = config.compressionInfo;
+    exynos_image dst;
+    dst.transform = config.transform;
+    return getPlaneFetchBytes(src, dst);
+}
+
+float BandwidthEstimator::getPowerProxy(const FrameBandwidthEstimate& estimate,
+                                        uint64_t m2mPixelRate) {
+    /* pJ/s to mW */
+    constexpr double kPicoJoulePerSecToMilliWatt = 1e-9;
+    double energy = static_cast<double>(estimate.getTotalBandwidth()) * kDramEnergyPerByte +
+            static_cast<double>(m2mPixelRate) * kM2mEnergyPerPixel;
+    return static_cast<float>(energy * kPicoJoulePerSecToMilliWatt);
+}
+
+FrameBandwidthEstimate BandwidthEstimator::estimate(const ExynosDisplay& display) {
+    FrameBandwidthEstimate estimate;
+    const uint32_t vsyncPeriod = display.mVsyncPeriod;
+
+    for (const auto& config : display.mDpuData.configs) {
+        if ((config.state != config.WIN_STATE_BUFFER) &&
+            (config.state != config.WIN_STATE_CURSOR))
+            continue;
+        uint64_t bandwidth = toBandwidth(getWinConfigFetchBytes(config), vsyncPeriod);
+        estimate.dpuFetchBandwidth += bandwidth;
+        /* A plane shorter than the display is fetched in a shorter scan-out window */
+        if ((config.dst.h > 0) && (config.dst.h < display.mYres)) {
+            bandwidth = bandwidth * display.mYres / config.dst.h;
+        }
+        estimate.dpuPeakFetchBandwidth += bandwidth;
+        estimate.numPlanes++;
+    }
+
+    /* An M2M MPP that reuses its previous output costs no M2M traffic in this frame */
+    uint64_t m2mPixels = 0;
+    for (size_t i = 0; i < display.mLayers.size(); i++) {
+        const ExynosLayer* layer = display.mLayers[i];
+        if ((layer->mM2mMPP == nullptr) || !layer->mM2mMPP->mFrameProcessed) continue;
+        estimate.m2mReadBandwidth += toBandwidth(getM2mReadBytes(layer->mSrcImg), vsyncPeriod);
+        estimate.m2mWriteBandwidth += toBandwidth(getM2mWriteBytes(layer->mMidImg), vsyncPeriod);
+        m2mPixels += static_cast<uint64_t>(layer->mMidImg.w) * layer->mMidImg.h;
+        estimate.numM2mJobs++;
+    }
+
+    const ExynosCompositionInfo& exynosComposition = display.mExynosCompositionInfo;
+    if (exynosComposition.mHasCompositionLayer && (exynosComposition.mM2mMPP != nullptr) &&
+        exynosComposition.mM2mMPP->mFrameProcessed) {
+        for (size_t i = 0; i < display.mLayers.size(); i++) {
+            const ExynosLayer* layer = display.mLayers[i];
+            if (layer->getValidateCompositionType() != HWC2_COMPOSITION_EXYNOS) continue;
+            estimate.m2mReadBandwidth +=
+                    toBandwidth(getM2mReadBytes(layer->mSrcImg), vsyncPeriod);
+        }
+        estimate.m2mWriteBandwidth +=
+                toBandwidth(getM2mWriteBytes(exynosComposition.mDstImg), vsyncPeriod);
+        m2mPixels += static_cast<uint64_t>(exynosComposition.mDstImg.w) *
+                exynosComposition.mDstImg.h;
+        estimate.numM2mJobs++;
+    }
+
+    estimate.powerProxy = getPowerProxy(estimate, toBandwidth(m2mPixels, vsyncPeriod));
+    return estimate;
+}
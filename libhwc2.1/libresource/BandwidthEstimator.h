@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _BANDWIDTH_ESTIMATOR_H_
+#define _BANDWIDTH_ESTIMATOR_H_
+
+#include <utils/String8.h>
+
+#include "ExynosHWCHelper.h"
+
+class ExynosDisplay;
+struct exynos_win_config_data;
+
+/**
+ * DRAM bandwidth and power a frame plan costs. Bandwidths are in bytes per second
+ * at the refresh rate of the display.
+ */
+struct FrameBandwidthEstimate {
+    /* Window fetch of all DPU planes, averaged over the refresh period */
+    uint64_t dpuFetchBandwidth = 0;
+    /* Fetch bandwidth while every plane is scanned out at the same time */
+    uint64_t dpuPeakFetchBandwidth = 0;
+    /* Source read and destination write of M2M (G2D, MSC) jobs */
+    uint64_t m2mReadBandwidth = 0;
+    uint64_t m2mWriteBandwidth = 0;
+    uint32_t numPlanes = 0;
+    uint32_t numM2mJobs = 0;
+    /* Estimated DRAM and M2M engine power in mW */
+    float powerProxy = 0;
+
+    uint64_t getTotalBandwidth() const {
+        return dpuFetchBandwidth + m2mReadBandwidth + m2mWriteBandwidth;
+    }
+    void dump(String8& result) const;
+};
+
+class BandwidthEstimator {
+public:
+    /* Percentage of the uncompressed size actually transferred for |format| and |compression| */
+    static uint32_t getCompressionRatioPercent(int format, const CompressionInfo& compression);
+
+    /* Bytes transferred to read or write the crop of |image| once */
+    static uint64_t getImageBytes(const exynos_image& image);
+
+    /*
+     * Bytes the DPU fetches per frame for a plane reading |src| into |dst|,
+     * including the rotation overhead for uncompressed buffers
+     */
+    static uint64_t getPlaneFetchBytes(const exynos_image& src, const exynos_image& dst);
+
+    /* Bytes an M2M job reading |src| and writing |dst| transfers per frame */
+    static uint64_t getM2mReadBytes(const exynos_image& src);
+    static uint64_t getM2mWriteBytes(const exynos_image& dst);
+
+    static uint64_t toBandwidth(uint64_t bytesPerFrame, uint32_t vsyncPeriodNs);
+
+    /*
+     * Estimate the frame plan of |display|: DPU planes from its window configs and
+     * M2M jobs from the layers and the exynos composition assigned to M2M MPPs
+     */
+    static FrameBandwidthEstimate estimate(const ExynosDisplay& display);
+
+    /* DRAM access energy in pJ per byte and M2M engine energy in pJ per pixel */
+    static constexpr uint32_t kDramEnergyPerByte = 40;
+    static constexpr uint32_t kM2mEnergyPerPixel = 100;
+
+private:
+    static uint64_t getWinConfigFetchBytes(const exynos_win_config_data& config);
+    static float getPowerProxy(const FrameBandwidthEstimate& estimate, uint64_t m2mPixelRate);
+
+    /* Fetch overhead of rotating an uncompressed (linear) buffer in DPU */
+    static constexpr uint32_t kLinearRotationOverheadPercent = 150;
+    static constexpr uint32_t kAfbcRatioPercent = 50;
+    static constexpr uint32_t kSbwcLosslessRatioPercent = 70;
+};
+
+#endif // _BANDWIDTH_ESTIMATOR_H_
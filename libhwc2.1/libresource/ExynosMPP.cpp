@@ -163,13 +163,22 @@ ExynosMPP::ExynosMPP(ExynosResourceManager* resourceManager,
     mCurrentDstBuf(0),
     mPrivDstBuf(-1),
     mNeedCompressedTarget(false),
+    mCompressDstBuf(true),
     mDstAllocatedSize(DST_SIZE_UNKNOWN),
+    mPreallocatedWidth(0),
+    mPreallocatedHeight(0),
+    mPreallocatedFormat(0),
+    mPreallocatedUsage(0),
+    mPreallocatedTime(0),
+    mPreallocGeneration(0),
+    mLastDstAllocUsage(0),
     mUseM2MSrcFence(false),
     mAttr(0),
     mAssignOrder(0),
     mAXIPortId(0),
     mHWBlockId(0),
-    mNeedSolidColorLayer(false)
+    mNeedSolidColorLayer(false),
+    mFrameProcessed(false)
 {
     if (mPhysicalType < MPP_DPP_NUM) {
         mClockKhz = VPP_CLOCK;
@@ -258,6 +267,9 @@ ExynosMPP::ExynosMPP(ExynosResourceManager* resourceManager,
         mDstImgs[i].acrylicAcquireFenceFd = -1;
         mDstImgs[i].acrylicReleaseFenceFd = -1;
     }
+    for (uint32_t i = 0; i < NUM_MPP_DST_BUFS_DEFAULT; i++) {
+        mPreallocatedDstBufs[i] = NULL;
+    }
 
     for (uint32_t i = 0; i < DISPLAY_MODE_NUM; i++)
     {
@@ -949,7 +961,9 @@ int32_t ExynosMPP::allocOutBuf(uint32_t w, uint32_t h, uint32_t format, uint64_t
 
     status_t error = NO_ERROR;
 
-    {
+    if (takePreallocatedOutBuf(w, h, format, allocUsage, &dstBuffer)) {
+        MPP_LOGD(eDebugMPP|eDebugBuf, "\tuse preallocated buffer %p", dstBuffer);
+    } else {
         ATRACE_CALL();
 
         VendorGraphicBufferAllocator& gAllocator(VendorGraphicBufferAllocator::get());
@@ -987,6 +1001,144 @@ int32_t ExynosMPP::allocOutBuf(uint32_t w, uint32_t h, uint32_t format, uint64_t
     return NO_ERROR;
 }
 
+/**
+ * Allocate destination buffers for a display of |xres| x |yres| that is about
+ * to use this MPP. The buffers are kept aside until allocOutBuf() asks for the
+ * same size, format and usage, so the first frames don't wait for allocation.
+ * The usage of the last allocation is reused, since the layers of the display
+ * are not known yet.
+ * @param xres
+ * @param yres
+ * @return int32_t
+ */
+int32_t ExynosMPP::preallocOutBufs(uint32_t xres, uint32_t yres) {
+    ATRACE_CALL();
+    uint32_t bufAlign = getOutBufAlign();
+    uint32_t w = ALIGN_UP(xres, bufAlign);
+    uint32_t h = ALIGN_UP(yres, bufAlign);
+    uint32_t format = DEFAULT_MPP_DST_FORMAT;
+    uint64_t allocUsage;
+    uint32_t generation;
+
+    {
+        Mutex::Autolock lock(mPreallocMutex);
+        allocUsage = mLastDstAllocUsage;
+        if (allocUsage == 0) {
+            allocUsage = getBufferUsage(0);
+            if (!needCompressDstBuf()) {
+                allocUsage |= VendorGraphicBufferUsage::NO_AFBC;
+            }
+        }
+        if ((mPreallocatedWidth == w) && (mPreallocatedHeight == h) &&
+            (mPreallocatedFormat == format) && (mPreallocatedUsage == allocUsage))
+            return NO_ERROR;
+        releasePreallocatedOutBufsLocked();
+        generation = mPreallocGeneration;
+    }
+
+    buffer_handle_t buffers[NUM_MPP_DST_BUFS_DEFAULT] = {};
+    int32_t ret = NO_ERROR;
+    for (uint32_t i = 0; i < NUM_MPP_DST_BUFS(mLogicalType); i++) {
+        uint32_t dstStride = 0;
+        VendorGraphicBufferAllocator& gAllocator(VendorGraphicBufferAllocator::get());
+        status_t error = gAllocator.allocate(w, h, format, 1, allocUsage, &buffers[i],
+                                             &dstStride, "HWC");
+        if ((error != NO_ERROR) || (buffers[i] == NULL)) {
+            MPP_LOGE("failed to preallocate destination buffer(%dx%d): %d", w, h, error);
+            buffers[i] = NULL;
+            ret = -EINVAL;
+            break;
+        }
+    }
+
+    Mutex::Autolock lock(mPreallocMutex);
+    if (generation != mPreallocGeneration) {
+        /* Released while allocating, the buffers are not wanted anymore */
+        MPP_LOGD(eDebugBuf, "preallocation of %dx%d is cancelled", w, h);
+        for (uint32_t i = 0; i < NUM_MPP_DST_BUFS_DEFAULT; i++) {
+            freePreallocatedOutBuf(buffers[i]);
+        }
+        return ret;
+    }
+    for (uint32_t i = 0; i < NUM_MPP_DST_BUFS_DEFAULT; i++) {
+        mPreallocatedDstBufs[i] = buffers[i];
+    }
+    mPreallocatedWidth = w;
+    mPreallocatedHeight = h;
+    mPreallocatedFormat = format;
+    mPreallocatedUsage = allocUsage;
+    mPreallocatedTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    MPP_LOGD(eDebugBuf, "preallocated dst buffers %dx%d, format: 0x%8x, usage: 0x%" PRIx64, w, h,
+             format, allocUsage);
+
+    return ret;
+}
+
+void ExynosMPP::freePreallocatedOutBuf(buffer_handle_t buffer) {
+    if (buffer == NULL) return;
+    exynos_mpp_img_info freeDstBuf;
+    memset(&freeDstBuf, 0, sizeof(freeDstBuf));
+    freeDstBuf.acrylicAcquireFenceFd = -1;
+    freeDstBuf.acrylicReleaseFenceFd = -1;
+    freeDstBuf.bufferHandle = buffer;
+    freeOutBuf(freeDstBuf);
+}
+
+void ExynosMPP::releasePreallocatedOutBufsLocked() {
+    for (uint32_t i = 0; i < NUM_MPP_DST_BUFS_DEFAULT; i++) {
+        freePreallocatedOutBuf(mPreallocatedDstBufs[i]);
+        mPreallocatedDstBufs[i] = NULL;
+    }
+    mPreallocatedWidth = 0;
+    mPreallocatedHeight = 0;
+    mPreallocatedFormat = 0;
+    mPreallocatedUsage = 0;
+    mPreallocatedTime = 0;
+    mPreallocGeneration++;
+}
+
+void ExynosMPP::releasePreallocatedOutBufs() {
+    Mutex::Autolock lock(mPreallocMutex);
+    releasePreallocatedOutBufsLocked();
+}
+
+/**
+ * Release the preallocated buffers that no frame took within |timeout|.
+ * @return true if preallocated buffers are left
+ */
+bool ExynosMPP::releaseIdlePreallocatedOutBufs(nsecs_t timeout) {
+    Mutex::Autolock lock(mPreallocMutex);
+    bool preallocated = false;
+    for (uint32_t i = 0; i < NUM_MPP_DST_BUFS_DEFAULT; i++) {
+        if (mPreallocatedDstBufs[i] != NULL) preallocated = true;
+    }
+    if (!preallocated) return false;
+
+    if (systemTime(SYSTEM_TIME_MONOTONIC) - mPreallocatedTime < timeout) return true;
+
+    MPP_LOGD(eDebugBuf, "release unused preallocated dst buffers %dx%d", mPreallocatedWidth,
+             mPreallocatedHeight);
+    releasePreallocatedOutBufsLocked();
+    return false;
+}
+
+bool ExynosMPP::takePreallocatedOutBuf(uint32_t w, uint32_t h, uint32_t format,
+                                       uint64_t allocUsage, buffer_handle_t* outBuffer) {
+    Mutex::Autolock lock(mPreallocMutex);
+    mLastDstAllocUsage = allocUsage;
+    if ((mPreallocatedWidth != w) || (mPreallocatedHeight != h) ||
+        (mPreallocatedFormat != format) || (mPreallocatedUsage != allocUsage))
+        return false;
+
+    for (uint32_t i = 0; i < NUM_MPP_DST_BUFS_DEFAULT; i++) {
+        if (mPreallocatedDstBufs[i] == NULL) continue;
+        *outBuffer = mPreallocatedDstBufs[i];
+        mPreallocatedDstBufs[i] = NULL;
+        return true;
+    }
+    return false;
+}
+
 /**
  * @param outbuf
  * @return int32_t
@@ -1057,8 +1209,12 @@ uint64_t ExynosMPP::getBufferUsage(uint64_t usage)
     return allocUsage;
 }
 
+void ExynosMPP::latchCompressDstBuf() {
+    mCompressDstBuf = mCompressionPolicy.shouldCompress();
+}
+
 bool ExynosMPP::needCompressDstBuf() const {
-    return (mMaxSrcLayerNum > 1) && mNeedCompressedTarget;
+    return (mMaxSrcLayerNum > 1) && mNeedCompressedTarget && mCompressDstBuf;
 }
 
 uint32_t ExynosMPP::getAlignedDstFullWidth(struct exynos_image& dst) {
@@ -1696,6 +1852,7 @@ int32_t ExynosMPP::doPostProcessing(struct exynos_image& dst) {
 
     int ret = NO_ERROR;
     bool realloc = false;
+    mFrameProcessed = false;
     if (mAssignedSources.size() == 0) {
         MPP_LOGE("Assigned source size(%zu) is not valid",
                 mAssignedSources.size());
@@ -1739,6 +1896,7 @@ int32_t ExynosMPP::doPostProcessing(struct exynos_image& dst) {
     if ((realloc == false) && canUsePrevFrame()) {
         mCurrentDstBuf = (mCurrentDstBuf + NUM_MPP_DST_BUFS(mLogicalType) - 1)% NUM_MPP_DST_BUFS(mLogicalType);
         MPP_LOGD(eDebugMPP|eDebugFence, "Reuse previous frame, dstImg[%d]", mCurrentDstBuf);
+        mCompressionPolicy.onFrame(false);
         for (uint32_t i = 0; i < mAssignedSources.size(); i++) {
             mAssignedSources[i]->mSrcImg.acquireFenceFd =
                 fence_close(mAssignedSources[i]->mSrcImg.acquireFenceFd,
@@ -1753,6 +1911,8 @@ int32_t ExynosMPP::doPostProcessing(struct exynos_image& dst) {
                 __func__, ret);
         goto save_frame_info;
     }
+    mCompressionPolicy.onFrame(true);
+    mFrameProcessed = true;
 
 save_frame_info:
     /* Save current frame information for next frame*/
@@ -2920,7 +3080,7 @@ void ExynosMPP::dump(String8& result)
             mPrevAssignedState, mPrevAssignedDisplayType, mReservedDisplay);
     result.appendFormat("\tassinedSourceNum(%zu), Capacity(%f), CapaUsed(%f), mCurrentDstBuf(%d)\n",
             mAssignedSources.size(), mCapacity, mUsedCapacity, mCurrentDstBuf);
-
+    if (mNeedCompressedTarget) mCompressionPolicy.dump(result);
 }
 
 void ExynosMPP::closeFences()
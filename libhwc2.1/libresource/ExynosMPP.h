@@ -28,12 +28,14 @@
 #include <utils/StrongPointer.h>
 #include <utils/List.h>
 #include <utils/Vector.h>
+#include <atomic>
 #include <map>
 #include <hardware/exynos/acryl.h>
 #include <map>
 #include "ExynosHWCModule.h"
 #include "ExynosHWCHelper.h"
 #include "ExynosMPPType.h"
+#include "M2mCompressionPolicy.h"
 
 class ExynosDisplay;
 class ExynosMPP;
@@ -555,12 +557,34 @@ public:
     int32_t mCurrentDstBuf;
     int32_t mPrivDstBuf;
     bool mNeedCompressedTarget;
+    M2mCompressionPolicy mCompressionPolicy;
+    /*
+     * Decision of mCompressionPolicy latched by validate, so that present and
+     * DstBufMgrThread use the compression that validate budgeted
+     */
+    std::atomic<bool> mCompressDstBuf;
     struct restriction_size mSrcSizeRestrictions[RESTRICTION_MAX];
     struct restriction_size mDstSizeRestrictions[RESTRICTION_MAX];
 
     // Force Dst buffer reallocation
     dst_alloc_buf_size_t mDstAllocatedSize;
 
+    /*
+     * Destination buffers allocated ahead of a hotplug or mode change, before the
+     * display uses this MPP. allocOutBuf() takes them instead of allocating.
+     */
+    Mutex mPreallocMutex;
+    buffer_handle_t mPreallocatedDstBufs[NUM_MPP_DST_BUFS_DEFAULT];
+    uint32_t mPreallocatedWidth;
+    uint32_t mPreallocatedHeight;
+    uint32_t mPreallocatedFormat;
+    uint64_t mPreallocatedUsage;
+    nsecs_t mPreallocatedTime;
+    /* Changes whenever the preallocated buffers are released */
+    uint32_t mPreallocGeneration;
+    /* Usage of the last dst buffer allocation, 0 if none yet */
+    uint64_t mLastDstAllocUsage;
+
     /* For libacryl */
     Acrylic *mAcrylicHandle;
 
@@ -573,6 +597,8 @@ public:
     uint32_t mHWBlockId;
 
     bool mNeedSolidColorLayer;
+    /* The last doPostProcessing() ran the M2M job instead of reusing the previous output */
+    bool mFrameProcessed;
 
     ExynosMPP(ExynosResourceManager* resourceManager,
             uint32_t physicalType, uint32_t logicalType, const char *name,
@@ -580,6 +606,11 @@ public:
     virtual ~ExynosMPP();
 
     int32_t allocOutBuf(uint32_t w, uint32_t h, uint32_t format, uint64_t usage, uint32_t index);
+    int32_t preallocOutBufs(uint32_t xres, uint32_t yres);
+    void releasePreallocatedOutBufs();
+    bool releaseIdlePreallocatedOutBufs(nsecs_t timeout);
+    bool takePreallocatedOutBuf(uint32_t w, uint32_t h, uint32_t format, uint64_t allocUsage,
+                                buffer_handle_t* outBuffer);
     int32_t setOutBuf(buffer_handle_t outbuf, int32_t fence);
     int32_t freeOutBuf(exynos_mpp_img_info dst);
     int32_t doPostProcessing(struct exynos_image& dst);
@@ -663,6 +694,8 @@ public:
     int32_t reserveMPP(int32_t displayType = -1);
 
     bool isAssignableState(ExynosDisplay *display, struct exynos_image &src, struct exynos_image &dst);
+    void latchCompressDstBuf();
+    bool needCompressDstBuf() const;
     bool isAssignable(ExynosDisplay *display, struct exynos_image &src, struct exynos_image &dst,
                       float totalUsedCapacity);
     int32_t assignMPP(ExynosDisplay *display, ExynosMPPSource* mppSource);
@@ -708,7 +741,8 @@ protected:
     uint32_t getBufferType(uint64_t usage);
     uint32_t getBufferType(const buffer_handle_t handle);
     uint64_t getBufferUsage(uint64_t usage);
-    bool needCompressDstBuf() const;
+    void freePreallocatedOutBuf(buffer_handle_t buffer);
+    void releasePreallocatedOutBufsLocked();
     uint32_t getAlignedDstFullWidth(struct exynos_image& dst);
     bool needDstBufRealloc(struct exynos_image &dst, uint32_t index);
     bool canUsePrevFrame();
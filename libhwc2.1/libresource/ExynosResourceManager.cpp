@@ -37,6 +37,8 @@
 
 using namespace std::chrono_literals;
 constexpr float msecsPerSec = std::chrono::milliseconds(1s).count();
+/* Preallocated dst buffers that no frame takes meanwhile are released */
+constexpr nsecs_t kPreallocIdleTimeout = std::chrono::nanoseconds(5s).count();
 
 using namespace android;
 using namespace vendor::graphics;
@@ -87,7 +89,8 @@ ExynosResourceManager::DstBufMgrThread::DstBufMgrThread(ExynosResourceManager *e
 : mExynosResourceManager(exynosResourceManager),
     mRunning(false),
     mBufXres(0),
-    mBufYres(0)
+    mBufYres(0),
+    mReallocRequested(false)
 {
 }
 
@@ -178,6 +181,7 @@ ExynosResourceManager::~ExynosResourceManager()
     mM2mMPPs.clear();
 
     mDstBufMgrThread->mRunning = false;
+    mDstBufMgrThread->wakeup();
     mDstBufMgrThread->requestExitAndWait();
 }
 
@@ -234,6 +238,84 @@ void ExynosResourceManager::doReallocDstBufs(uint32_t Xres, uint32_t Yres)
     mDstBufMgrThread->reallocDstBufs(Xres, Yres);
 }
 
+void ExynosResourceManager::predictDstBufs(ExynosDisplay *display, uint32_t Xres, uint32_t Yres)
+{
+    if (display == NULL)
+        return;
+    HDEBUGLOGD(eDebugBuf, "M2M dst prealloc call: display %d, %d x %d", display->mDisplayId, Xres,
+               Yres);
+    mDstBufMgrThread->predictDstBufs(display, Xres, Yres);
+}
+
+void ExynosResourceManager::doPreallocDstBufs(ExynosDisplay *display, uint32_t Xres, uint32_t Yres)
+{
+    ATRACE_CALL();
+    for (uint32_t i = 0; i < mM2mMPPs.size(); i++) {
+        ExynosMPP *m2mMPP = mM2mMPPs[i];
+        /* Buffers of the primary display are allocated by doAllocDstBufs() */
+        if (!m2mMPP->mEnable || !m2mMPP->mAllocOutBufFlag || m2mMPP->needPreAllocation())
+            continue;
+        if ((m2mMPP->mPreAssignDisplayList[mDevice->mDisplayMode] &
+             display->getDisplayPreAssignBit()) == 0)
+            continue;
+
+        if ((Xres == 0) || (Yres == 0)) {
+            HDEBUGLOGD(eDebugBuf, "%s release preallocated dst buffers", m2mMPP->mName.c_str());
+            m2mMPP->releasePreallocatedOutBufs();
+        } else if (m2mMPP->preallocOutBufs(Xres, Yres) != NO_ERROR) {
+            HWC_LOGE(display, "%s:: %s fail to preallocate dst buffers", __func__,
+                     m2mMPP->mName.c_str());
+        }
+    }
+}
+
+void ExynosResourceManager::releasePreallocatedDstBufs()
+{
+    ATRACE_CALL();
+    /* Wait for the predictions in flight so their buffers are released as well */
+    android::Mutex::Autolock preallocLock(mDstBufMgrThread->mPreallocMutex);
+    {
+        /* Drop pending predictions so they don't allocate the buffers again */
+        android::Mutex::Autolock lock(mDstBufMgrThread->mMutex);
+        mDstBufMgrThread->mPredictions.clear();
+    }
+
+    for (uint32_t i = 0; i < mM2mMPPs.size(); i++) {
+        HDEBUGLOGD(eDebugBuf, "%s release preallocated dst buffers", mM2mMPPs[i]->mName.c_str());
+        mM2mMPPs[i]->releasePreallocatedOutBufs();
+    }
+}
+
+bool ExynosResourceManager::releaseIdlePreallocatedDstBufs(nsecs_t timeout)
+{
+    bool preallocated = false;
+    for (uint32_t i = 0; i < mM2mMPPs.size(); i++) {
+        if (mM2mMPPs[i]->releaseIdlePreallocatedOutBufs(timeout)) preallocated = true;
+    }
+    return preallocated;
+}
+
+void ExynosResourceManager::DstBufMgrThread::predictDstBufs(ExynosDisplay *display, uint32_t Xres,
+                                                            uint32_t Yres)
+{
+    android::Mutex::Autolock lock(mMutex);
+    /* Only the latest mode of a display matters */
+    for (auto it = mPredictions.begin(); it != mPredictions.end(); it++) {
+        if (it->display == display) {
+            mPredictions.erase(it);
+            break;
+        }
+    }
+    mPredictions.push_back({display, Xres, Yres});
+    mCondition.signal();
+}
+
+void ExynosResourceManager::DstBufMgrThread::wakeup()
+{
+    android::Mutex::Autolock lock(mMutex);
+    mCondition.signal();
+}
+
 bool ExynosResourceManager::DstBufMgrThread::needDstRealloc(uint32_t Xres, uint32_t Yres, ExynosMPP *m2mMPP)
 {
     bool ret = false;
@@ -267,6 +349,7 @@ void ExynosResourceManager::DstBufMgrThread::reallocDstBufs(uint32_t Xres, uint3
         if (mExynosResourceManager->mForceReallocState == DST_REALLOC_DONE) {
             mExynosResourceManager->mForceReallocState = DST_REALLOC_START;
             android::Mutex::Autolock lock(mMutex);
+            mReallocRequested = true;
             mCondition.signal();
         } else {
             HDEBUGLOGD(eDebugBuf, "M2M dst alloc thread : queue aready.");
@@ -276,9 +359,52 @@ void ExynosResourceManager::DstBufMgrThread::reallocDstBufs(uint32_t Xres, uint3
 
 bool ExynosResourceManager::DstBufMgrThread::threadLoop()
 {
+    bool preallocated = false;
     while(mRunning) {
-        Mutex::Autolock lock(mMutex);
-        mCondition.wait(mMutex);
+        std::vector<DstBufPrediction> predictions;
+        bool reallocRequested = false;
+        bool idleTimeout = false;
+        {
+            Mutex::Autolock lock(mMutex);
+            while (mRunning && mPredictions.empty() && !mReallocRequested) {
+                if (!preallocated) {
+                    mCondition.wait(mMutex);
+                } else if (mCondition.waitRelative(mMutex, kPreallocIdleTimeout) == TIMED_OUT) {
+                    idleTimeout = true;
+                    break;
+                }
+            }
+        }
+
+        if (idleTimeout) {
+            Mutex::Autolock preallocLock(mPreallocMutex);
+            preallocated = mExynosResourceManager->releaseIdlePreallocatedDstBufs(
+                    kPreallocIdleTimeout);
+            continue;
+        }
+
+        {
+            /*
+             * Take the predictions under mPreallocMutex, so that
+             * releasePreallocatedDstBufs() either drops them or waits for them
+             */
+            Mutex::Autolock preallocLock(mPreallocMutex);
+            {
+                Mutex::Autolock lock(mMutex);
+                predictions.swap(mPredictions);
+                reallocRequested = mReallocRequested;
+                mReallocRequested = false;
+            }
+
+            /* Allocate without mMutex so that new events are queued meanwhile */
+            for (const auto &prediction : predictions) {
+                mExynosResourceManager->doPreallocDstBufs(prediction.display, prediction.xres,
+                                                          prediction.yres);
+                preallocated = true;
+            }
+        }
+        if (!reallocRequested)
+            continue;
 
         ExynosDevice *device = mExynosResourceManager->mDevice;
         if (device == NULL)
@@ -566,6 +692,14 @@ int32_t ExynosResourceManager::assignResourceInternal(ExynosDisplay *display)
                 HWC_LOGE(display, "Handle HWC2_COMPOSITION_CLIENT type layers, but addClientCompositionLayer failed (%d)", ret);
                 return ret;
             }
+        } else if (layer->needHoldClientComposition()) {
+            /* Keep the layer in client composition that it recently moved to */
+            layer->updateValidateCompositionType(HWC2_COMPOSITION_CLIENT, eCompositionHysteresis);
+            if (((ret = display->addClientCompositionLayer(i)) != NO_ERROR) &&
+                 (ret != EXYNOS_ERROR_CHANGED)) {
+                HWC_LOGE(display, "Hold client composition, but addClientCompositionLayer failed (%d)", ret);
+                return ret;
+            }
         }
     }
 
@@ -998,6 +1132,17 @@ int32_t ExynosResourceManager::assignCompositionTarget(ExynosDisplay * display,
             HWC_LOGE(display, "%s:: fail to assign M2mMPP (%d)",__func__, ret);
             return eInsufficientMPP;
         }
+
+        /*
+         * The M2M MPP decides if its output is compressed, depending on the output
+         * lifetime. Decide it before the DPU resources and bandwidth are budgeted.
+         */
+        compositionInfo->mM2mMPP->latchCompressDstBuf();
+        if ((compositionInfo->mDefaultCompressionType == COMP_TYPE_AFBC) &&
+            !compositionInfo->mM2mMPP->needCompressDstBuf()) {
+            compositionInfo->setCompressionType(COMP_TYPE_NONE);
+            display->setCompositionTargetExynosImage(targetType, &src_img, &dst_img);
+        }
     }
 
     if ((compositionInfo->mFirstIndex < 0) ||
@@ -1453,6 +1598,12 @@ int32_t ExynosResourceManager::assignLayer(ExynosDisplay *display, ExynosLayer *
     layer->setExynosImage(src_img, dst_img);
     layer->setExynosMidImage(dst_img);
 
+    /*
+     * otfMPP that can rotate the layer by itself, kept as the fallback
+     * while m2mMPP is tried first because it rotates at lower cost
+     */
+    ExynosMPP *rotationFallbackOtfMPP = nullptr;
+
     validateFlag = validateLayer(layer_index, display, layer);
     if ((display->mUseDpu) &&
         (display->mWindowNumUsed >= display->mMaxWindowNum))
@@ -1469,6 +1620,11 @@ int32_t ExynosResourceManager::assignLayer(ExynosDisplay *display, ExynosLayer *
         (validateFlag == eDimLayer)) {
         bool isAssignableFlag = false;
         uint64_t isSupported = 0;
+        const uint32_t refreshRate = display->getBtsRefreshRate();
+        const bool preferM2mRotation = (src_img.transform & HAL_TRANSFORM_ROT_90) &&
+                (refreshRate > 0) &&
+                layer->mRotationPlanner.preferM2m(src_img, dst_img,
+                                                  layer->getFps() / refreshRate);
         /* 1. Find available otfMPP */
         if (validateFlag != eInsufficientWindow) {
             otfMppReordering(display, mOtfMPPs, src_img, dst_img);
@@ -1493,6 +1649,11 @@ int32_t ExynosResourceManager::assignLayer(ExynosDisplay *display, ExynosLayer *
                     HDEBUGLOGD(eDebugResourceAssigning, "\t\t\t isSupported(%" PRIx64 ")",
                                -isSupported);
                     if (isSupported == NO_ERROR) {
+                        if (preferM2mRotation) {
+                            if (rotationFallbackOtfMPP == nullptr)
+                                rotationFallbackOtfMPP = mOtfMPPs[j];
+                            continue;
+                        }
                         *otfMPP = mOtfMPPs[j];
                         return HWC2_COMPOSITION_DEVICE;
                     }
@@ -1509,6 +1670,12 @@ int32_t ExynosResourceManager::assignLayer(ExynosDisplay *display, ExynosLayer *
                 (mM2mMPPs[j]->mLogicalType == MPP_LOGICAL_G2D_RGB))
                 continue;
 
+            /* Exynos composition costs more than the otfMPP rotation */
+            if ((rotationFallbackOtfMPP != nullptr) &&
+                ((mM2mMPPs[j]->mLogicalType == MPP_LOGICAL_G2D_RGB) ||
+                 (mM2mMPPs[j]->mLogicalType == MPP_LOGICAL_G2D_COMBO)))
+                continue;
+
             /* Only G2D can be assigned if layer is supported by G2D
              * when window is not sufficient
              */
@@ -1623,6 +1790,13 @@ int32_t ExynosResourceManager::assignLayer(ExynosDisplay *display, ExynosLayer *
             }
         }
     }
+    if (rotationFallbackOtfMPP != nullptr) {
+        HDEBUGLOGD(eDebugResourceAssigning, "\t\t m2mMPP rotation is not available, %s rotates",
+                   rotationFallbackOtfMPP->mName.c_str());
+        *otfMPP = rotationFallbackOtfMPP;
+        return HWC2_COMPOSITION_DEVICE;
+    }
+
     /* Fail to assign resource */
     if (validateFlag != NO_ERROR)
         overlayInfo = validateFlag;
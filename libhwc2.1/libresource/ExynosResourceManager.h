@@ -22,6 +22,7 @@
 #define _EXYNOSRESOURCEMANAGER_H
 
 #include <unordered_map>
+#include <vector>
 #include "ExynosDevice.h"
 #include "ExynosDisplay.h"
 #include "ExynosHWCHelper.h"
@@ -90,9 +91,21 @@ class ExynosResourceManager {
             Mutex mMutex;
             Mutex mStateMutex;
             Mutex mResInfoMutex;
+            /* Serializes preallocation with releasePreallocatedDstBufs() */
+            Mutex mPreallocMutex;
             uint32_t mBufXres;
             uint32_t mBufYres;
+            bool mReallocRequested;
+            /* Displays whose dst buffers are allocated before their first frame */
+            struct DstBufPrediction {
+                ExynosDisplay *display;
+                uint32_t xres;
+                uint32_t yres;
+            };
+            std::vector<DstBufPrediction> mPredictions;
             void reallocDstBufs(uint32_t Xres, uint32_t Yres);
+            void predictDstBufs(ExynosDisplay *display, uint32_t Xres, uint32_t Yres);
+            void wakeup();
             bool needDstRealloc(uint32_t Xres, uint32_t Yres, ExynosMPP *m2mMPP);
             DstBufMgrThread(ExynosResourceManager *exynosResourceManager);
             ~DstBufMgrThread();
@@ -120,6 +133,17 @@ class ExynosResourceManager {
         void setTargetDisplayDevice(int device);
         int32_t doPreProcessing();
         void doReallocDstBufs(uint32_t Xres, uint32_t Yres);
+        /*
+         * Allocate in the background the dst buffers of M2M MPPs that |display|
+         * will use at |Xres| x |Yres|, as soon as a hotplug or mode change is known.
+         * Zero size releases them.
+         */
+        void predictDstBufs(ExynosDisplay *display, uint32_t Xres, uint32_t Yres);
+        void doPreallocDstBufs(ExynosDisplay *display, uint32_t Xres, uint32_t Yres);
+        /* Release dst buffers that are preallocated and not used by any frame yet */
+        void releasePreallocatedDstBufs();
+        /* Release the preallocated dst buffers unused for |timeout|, true if some are left */
+        bool releaseIdlePreallocatedDstBufs(nsecs_t timeout);
         int32_t doAllocDstBufs(uint32_t mXres, uint32_t mYres);
         int32_t assignResource(ExynosDisplay *display);
         int32_t assignResourceInternal(ExynosDisplay *display);
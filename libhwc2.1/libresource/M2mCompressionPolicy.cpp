@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "M2mCompressionPolicy.h"
+
+#include <inttypes.h>
+
+#include <algorithm>
+
+#include "BandwidthEstimator.h"
+
+float M2mCompressionPolicy::getCompressionSavings(float lifetime) {
+    const float bytesPerPixel = kOutputBytesPerPixel;
+    CompressionInfo afbc;
+    afbc.type = COMP_TYPE_AFBC;
+    const float ratio =
+            BandwidthEstimator::getCompressionRatioPercent(HAL_PIXEL_FORMAT_RGBA_8888, afbc) /
+            100.0f;
+    /* One write and |lifetime| reads of the output */
+    const float transfers = 1.0f + lifetime;
+    const float linearCost = bytesPerPixel * BandwidthEstimator::kDramEnergyPerByte * transfers;
+    const float compressedCost = kEncodeEnergyPerPixel + kDecodeEnergyPerPixel * lifetime +
+            bytesPerPixel * ratio * BandwidthEstimator::kDramEnergyPerByte * transfers;
+    return linearCost - compressedCost;
+}
+
+void M2mCompressionPolicy::onFrame(bool regenerated) {
+    if (regenerated) {
+        if (mCurrentLifetime > 0) {
+            mAverageLifetime += kLifetimeWeight * (mCurrentLifetime - mAverageLifetime);
+        }
+        mCurrentLifetime = 1;
+        mNumRegenerated++;
+    } else {
+        mCurrentLifetime++;
+        mNumReused++;
+    }
+
+    if (++mFramesSinceSwitch < kMinFramesBetweenSwitch) return;
+
+    /* An output that already outlived the average counts before it is replaced */
+    const float lifetime = std::max(mAverageLifetime, static_cast<float>(mCurrentLifetime));
+    const float margin = kSwitchMarginRatio * kOutputBytesPerPixel *
+            BandwidthEstimator::kDramEnergyPerByte * (1.0f + lifetime);
+    const float savings = getCompressionSavings(lifetime);
+    if ((!mCompress && (savings > margin)) || (mCompress && (savings < -margin))) {
+        mCompress = !mCompress;
+        mFramesSinceSwitch = 0;
+        mNumSwitches++;
+    }
+}
+
+void M2mCompressionPolicy::dump(String8& result) const {
+    result.appendFormat("\tcompression policy: compress(%d), average lifetime(%.2f), "
+                        "regenerated(%" PRIu64 "), reused(%" PRIu64 "), switches(%" PRIu64 ")\n",
+                        mCompress, mAverageLifetime, mNumRegenerated, mNumReused, mNumSwitches);
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _M2M_COMPRESSION_POLICY_H_
+#define _M2M_COMPRESSION_POLICY_H_
+
+#include <utils/String8.h>
+
+#include <cstdint>
+
+/**
+ * Decides whether an M2M MPP writes its output compressed, based on how many
+ * frames an output stays valid and is scanned out by DPU.
+ *
+ * A compressed output costs the encoder on every write and the decoder on every
+ * scan-out, and saves DRAM traffic on both. A composited surface that stays
+ * static for many frames gains from compression, while one that is regenerated
+ * every frame may not. The decision only changes with a margin and after a
+ * minimum number of frames, since every change reallocates the output buffers.
+ */
+class M2mCompressionPolicy {
+public:
+    /* Called once per frame the output is used, |regenerated| if M2M wrote a new output */
+    void onFrame(bool regenerated);
+
+    bool shouldCompress() const { return mCompress; }
+
+    /* Average number of frames an output is scanned out */
+    float getAverageLifetime() const { return mAverageLifetime; }
+
+    /*
+     * Energy saved per output pixel over the lifetime of one output when it is
+     * compressed, in pJ. Negative when compression costs more than it saves.
+     */
+    static float getCompressionSavings(float lifetime);
+
+    void dump(String8& result) const;
+
+private:
+    /* Energy of AFBC encode in M2M and decode in DPU, in pJ per pixel */
+    static constexpr float kEncodeEnergyPerPixel = 200.0f;
+    static constexpr float kDecodeEnergyPerPixel = 20.0f;
+    static constexpr uint32_t kOutputBytesPerPixel = 4;
+    /* Savings relative to the uncompressed cost of one output to change the decision */
+    static constexpr float kSwitchMarginRatio = 0.1f;
+    static constexpr uint32_t kMinFramesBetweenSwitch = 60;
+    /* Weight of the newest lifetime sample in the moving average */
+    static constexpr float kLifetimeWeight = 0.125f;
+
+    bool mCompress = true;
+    float mAverageLifetime = 1.0f;
+    uint32_t mCurrentLifetime = 0;
+    uint32_t mFramesSinceSwitch = 0;
+
+    uint64_t mNumRegenerated = 0;
+    uint64_t mNumReused = 0;
+    uint64_t mNumSwitches = 0;
+};
+
+#endif // _M2M_COMPRESSION_POLICY_H_
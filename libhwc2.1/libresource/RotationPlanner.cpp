@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RotationPlanner.h"
+
+#include <inttypes.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "BandwidthEstimator.h"
+#include "ExynosMPP.h"
+
+float RotationPlanner::getDppRotationCost(const exynos_image& src, const exynos_image& dst) {
+    exynos_image rotated = dst;
+    rotated.transform = src.transform;
+    return static_cast<float>(BandwidthEstimator::getPlaneFetchBytes(src, rotated)) *
+            BandwidthEstimator::kDramEnergyPerByte;
+}
+
+float RotationPlanner::getM2mRotationCost(const exynos_image& src, const exynos_image& dst,
+                                          float contentRatio) {
+    /* M2M writes an unrotated image of the destination size that DPU fetches */
+    exynos_image mid = dst;
+    mid.transform = 0;
+    mid.format = isFormatYUV(src.format) ? DEFAULT_MPP_DST_YUV_FORMAT : src.format;
+    mid.compressionInfo.type = COMP_TYPE_NONE;
+
+    const float midPixels = static_cast<float>(mid.w) * mid.h;
+    const float m2mCost = static_cast<float>(BandwidthEstimator::getM2mReadBytes(src) +
+                                             BandwidthEstimator::getM2mWriteBytes(mid)) *
+                    BandwidthEstimator::kDramEnergyPerByte +
+            midPixels * BandwidthEstimator::kM2mEnergyPerPixel;
+    const float fetchCost = static_cast<float>(BandwidthEstimator::getPlaneFetchBytes(mid, mid)) *
+            BandwidthEstimator::kDramEnergyPerByte;
+    return m2mCost * contentRatio + fetchCost;
+}
+
+uint32_t RotationPlanner::quantizeContentRatio(float contentRatio) {
+    if (contentRatio <= 0.0f) return kUnknownContentRatio;
+    const float step = std::round(std::min(contentRatio, 1.0f) * kContentRatioSteps);
+    return std::max(static_cast<uint32_t>(step), 1u);
+}
+
+bool RotationPlanner::preferM2m(const exynos_image& src, const exynos_image& dst,
+                                float contentRatio) {
+    Key key;
+    key.srcW = src.w;
+    key.srcH = src.h;
+    key.format = src.format;
+    key.compressionType = src.compressionInfo.type;
+    key.transform = src.transform;
+    key.dstW = dst.w;
+    key.dstH = dst.h;
+    key.contentRatioStep = quantizeContentRatio(contentRatio);
+
+    if (mValid && (key == mKey)) return mPreferM2m;
+
+    /* The frame rate of a new layer is not known yet, assume it updates every refresh */
+    const float ratio = (key.contentRatioStep == kUnknownContentRatio)
+            ? 1.0f
+            : static_cast<float>(key.contentRatioStep) / kContentRatioSteps;
+
+    mDppCost = getDppRotationCost(src, dst);
+    mM2mCost = getM2mRotationCost(src, dst, ratio);
+    mNumEvaluations++;
+
+    /* Moving to M2M needs the margin and moving back to DPP needs M2M to cost more */
+    const bool preferM2m = (mValid && mPreferM2m && mKey.hasSameGeometry(key))
+            ? (mM2mCost < mDppCost)
+            : (mM2mCost + kM2mMarginRatio * mDppCost < mDppCost);
+    if (mValid && (preferM2m != mPreferM2m)) mNumSwitches++;
+
+    mKey = key;
+    mValid = true;
+    mPreferM2m = preferM2m;
+
+    return mPreferM2m;
+}
+
+void RotationPlanner::dump(String8& result) const {
+    if (!mValid) return;
+
+    result.appendFormat("rotation planner: prefer m2m(%d), content ratio(%u/%u), "
+                        "dpp cost(%.0f pJ), m2m cost(%.0f pJ), "
+                        "evaluations(%" PRIu64 "), switches(%" PRIu64 ")\n",
+                        mPreferM2m, mKey.contentRatioStep, kContentRatioSteps, mDppCost,
+                        mM2mCost, mNumEvaluations, mNumSwitches);
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ROTATION_PLANNER_H_
+#define _ROTATION_PLANNER_H_
+
+#include <utils/String8.h>
+
+#include "ExynosHWCHelper.h"
+
+/**
+ * Decides whether a layer rotated by 90 or 270 degrees that DPP can rotate is
+ * better rotated by an M2M MPP, based on the DRAM and engine energy of each path.
+ *
+ * DPP rotates on every scan-out, and a rotated linear buffer is fetched with
+ * partially used bursts, while a compressed buffer is fetched by blocks in any
+ * direction. M2M rotates once per buffer the layer queues and DPU then fetches
+ * an unrotated output, so it can save energy for a linear buffer updated less
+ * often than the display refreshes. M2M also adds a frame of latency, so DPP is
+ * kept unless M2M saves a margin, and M2M is kept until it stops saving energy.
+ * A decision is cached for the geometry of the layer and its content ratio
+ * quantized to kContentRatioSteps, and only reevaluated when either changes, so
+ * frame rate jitter does not move the layer between DPP and M2M.
+ */
+class RotationPlanner {
+public:
+    /*
+     * |src| and |dst| are the source and destination images of the layer and
+     * |contentRatio| is the layer frame rate over the refresh rate, up to 1.
+     * A ratio of 0, for a layer whose frame rate is not known yet, counts as 1
+     * until the frame rate is known.
+     */
+    bool preferM2m(const exynos_image& src, const exynos_image& dst, float contentRatio);
+
+    /* Energy of each path per refresh period, in pJ */
+    static float getDppRotationCost(const exynos_image& src, const exynos_image& dst);
+    static float getM2mRotationCost(const exynos_image& src, const exynos_image& dst,
+                                    float contentRatio);
+
+    uint64_t getNumEvaluations() const { return mNumEvaluations; }
+    uint64_t getNumSwitches() const { return mNumSwitches; }
+
+    void dump(String8& result) const;
+
+private:
+    /* M2M saving relative to the DPP cost to prefer M2M */
+    static constexpr float kM2mMarginRatio = 0.1f;
+    /* Steps of the content ratio in the cache key */
+    static constexpr uint32_t kContentRatioSteps = 8;
+    /* Cache key step of a layer whose frame rate is not known yet */
+    static constexpr uint32_t kUnknownContentRatio = 0;
+
+    /* Returns kUnknownContentRatio, or a step from 1 to kContentRatioSteps */
+    static uint32_t quantizeContentRatio(float contentRatio);
+
+    struct Key {
+        uint32_t srcW = 0;
+        uint32_t srcH = 0;
+        uint32_t format = 0;
+        uint32_t compressionType = COMP_TYPE_NONE;
+        uint32_t transform = 0;
+        uint32_t dstW = 0;
+        uint32_t dstH = 0;
+        uint32_t contentRatioStep = kUnknownContentRatio;
+
+        bool hasSameGeometry(const Key& other) const {
+            return (srcW == other.srcW) && (srcH == other.srcH) && (format == other.format) &&
+                    (compressionType == other.compressionType) &&
+                    (transform == other.transform) && (dstW == other.dstW) &&
+                    (dstH == other.dstH);
+        }
+
+        bool operator==(const Key& other) const {
+            return hasSameGeometry(other) && (contentRatioStep == other.contentRatioStep);
+        }
+    };
+
+    Key mKey;
+    bool mValid = false;
+    bool mPreferM2m = false;
+    float mDppCost = 0;
+    float mM2mCost = 0;
+
+    uint64_t mNumEvaluations = 0;
+    uint64_t mNumSwitches = 0;
+};
+
+#endif // _ROTATION_PLANNER_H_
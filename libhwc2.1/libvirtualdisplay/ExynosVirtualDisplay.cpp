@@ -86,6 +86,7 @@ void ExynosVirtualDisplay::createVirtualDisplay(uint32_t width, uint32_t height,
     mXres = width;
     mYres = height;
     mGLESFormat = *format;
+    mResourceManager->predictDstBufs(this, mXres, mYres);
 }
 
 void ExynosVirtualDisplay::destroyVirtualDisplay()
@@ -105,6 +106,7 @@ void ExynosVirtualDisplay::destroyVirtualDisplay()
     mResourceManager->reloadResourceForHWFC();
     mResourceManager->setTargetDisplayLuminance(mMinTargetLuminance, mMaxTargetLuminance);
     mResourceManager->setTargetDisplayDevice(mSinkDeviceType);
+    mResourceManager->predictDstBufs(this, 0, 0);
     mNeedReloadResourceForHWFC = false;
 }
 
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PanelHibernateState.h"
+
+#include <algorithm>
+#include <string>
+
+#include "interface/Panel_def.h"
+
+namespace android::hardware::graphics::composer {
+
+std::optional<uint32_t> PanelHibernateState::enter(int64_t nowNs,
+                                                   std::optional<uint32_t> refreshControl,
+                                                   uint32_t lowestRefreshRate) {
+    if (isHibernating()) {
+        return std::nullopt;
+    }
+    mEnterTimeNs = nowNs;
+    ++mCount;
+    mPendingRefreshControl = std::nullopt;
+    mRefreshControlToRestore = std::nullopt;
+    if (!refreshControl.has_value()) {
+        return std::nullopt;
+    }
+    uint32_t hibernateCommand = refreshControl.value() & kPanelRefreshCtrlStateBitsMask;
+    // Let the panel self-refresh at the lowest supported rate without any frame insertion
+    // requested from software.
+    hibernateCommand |= kPanelRefreshCtrlFrameInsertionAutoMode;
+    hibernateCommand = (hibernateCommand & ~kPanelRefreshCtrlMinimumRefreshRateMask) |
+            ((lowestRefreshRate << kPanelRefreshCtrlMinimumRefreshRateOffset) &
+             kPanelRefreshCtrlMinimumRefreshRateMask);
+    mPendingRefreshControl = refreshControl;
+    return hibernateCommand;
+}
+
+void PanelHibernateState::onPanelReprogrammed() {
+    if (!isHibernating()) {
+        return;
+    }
+    mRefreshControlToRestore = mPendingRefreshControl;
+    mPendingRefreshControl = std::nullopt;
+}
+
+std::optional<uint32_t> PanelHibernateState::exit(int64_t nowNs) {
+    if (!isHibernating()) {
+        return std::nullopt;
+    }
+    mDurationNs += std::max(nowNs - mEnterTimeNs.value(), static_cast<int64_t>(0));
+    mEnterTimeNs = std::nullopt;
+    mPendingRefreshControl = std::nullopt;
+    auto refreshControl = mRefreshControlToRestore;
+    mRefreshControlToRestore = std::nullopt;
+    return refreshControl;
+}
+
+int64_t PanelHibernateState::getDurationNs(int64_t nowNs) const {
+    if (!isHibernating()) {
+        return mDurationNs;
+    }
+    return mDurationNs + std::max(nowNs - mEnterTimeNs.value(), static_cast<int64_t>(0));
+}
+
+} // namespace android::hardware::graphics::composer
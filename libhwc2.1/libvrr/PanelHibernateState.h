@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+namespace android::hardware::graphics::composer {
+
+// |PanelHibernateState| keeps the bookkeeping of the VRR controller hibernate state: the refresh
+// control command to restore on exit, and the hibernate count and residency.
+//
+// While hibernating, the panel self-refreshes at its lowest refresh rate in hardware frame
+// insertion mode. |enter| derives that command from the last one written to the panel; once the
+// caller has written it, |onPanelReprogrammed| arms the restore that |exit| hands back. Entering
+// twice or exiting without entering is a no-op, so that stale events racing with a present do not
+// skew the statistics.
+class PanelHibernateState {
+public:
+    PanelHibernateState() = default;
+
+    // Enters hibernate at |nowNs|. |refreshControl| is the last refresh control command written to
+    // the panel, or empty if the panel must be left untouched. Returns the command to write, if
+    // any.
+    std::optional<uint32_t> enter(int64_t nowNs, std::optional<uint32_t> refreshControl,
+                                  uint32_t lowestRefreshRate);
+
+    // Records that the command returned by |enter| has been written to the panel.
+    void onPanelReprogrammed();
+
+    // Leaves hibernate at |nowNs|. Returns the refresh control command to restore, if any.
+    std::optional<uint32_t> exit(int64_t nowNs);
+
+    bool isHibernating() const { return mEnterTimeNs.has_value(); }
+
+    uint64_t getCount() const { return mCount; }
+
+    // Returns the total hibernate residency, including the ongoing hibernate if any.
+    int64_t getDurationNs(int64_t nowNs) const;
+
+private:
+    std::optional<int64_t> mEnterTimeNs;
+    std::optional<uint32_t> mPendingRefreshControl;
+    std::optional<uint32_t> mRefreshControlToRestore;
+    uint64_t mCount = 0;
+    int64_t mDurationNs = 0;
+};
+
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AdaptivePresentTimeoutScheduler.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+namespace android::hardware::graphics::composer {
+
+void AdaptivePresentTimeoutScheduler::onPresent(int64_t presentTimeNs, int32_t frameIntervalNs) {
+    if (isCadenceChanged(frameIntervalNs)) {
+        mIntervals.clear();
+    }
+    mFrameIntervalNs = frameIntervalNs;
+    if (mLastPresentTimeNs >= 0) {
+        int64_t intervalNs = presentTimeNs - mLastPresentTimeNs;
+        if ((intervalNs > 0) && (intervalNs <= kMaxTrackedIntervalNs)) {
+            mIntervals.next() = intervalNs;
+        }
+    }
+    mLastPresentTimeNs = presentTimeNs;
+}
+
+void AdaptivePresentTimeoutScheduler::reset() {
+    mIntervals.clear();
+    mLastPresentTimeNs = -1;
+    mFrameIntervalNs = 0;
+}
+
+void AdaptivePresentTimeoutScheduler::setTeInterval(int64_t teIntervalNs) {
+    if (mTeIntervalNs != teIntervalNs) {
+        mTeIntervalNs = teIntervalNs;
+        reset();
+    }
+}
+
+std::optional<std::vector<int64_t>> AdaptivePresentTimeoutScheduler::getSchedule(
+        int64_t presentTimeoutNs, const std::vector<int64_t>& staticSchedule) {
+    if ((presentTimeoutNs <= 0) || (mTeIntervalNs <= 0) || (mIntervals.size() < kMinSamples)) {
+        ++mNumStaticSchedules;
+        return std::nullopt;
+    }
+
+    std::vector<int64_t> intervals;
+    intervals.reserve(mIntervals.size());
+    for (size_t i = 0; i < mIntervals.size(); ++i) {
+        intervals.push_back(mIntervals[i]);
+    }
+    std::sort(intervals.begin(), intervals.end());
+    const int64_t p10 = intervals[intervals.size() / 10];
+    const int64_t p50 = intervals[intervals.size() / 2];
+    const int64_t p90 = intervals[(intervals.size() * 9) / 10];
+
+    // Only plan ahead for a stable cadence that is slow enough to need insertions at all.
+    const int64_t maxSpreadNs =
+            std::max(p50 / kMaxSpreadDenominator, kMaxSpreadTeIntervals * mTeIntervalNs);
+    if ((p90 - p10 > maxSpreadNs) || (p90 <= presentTimeoutNs)) {
+        ++mNumStaticSchedules;
+        return std::nullopt;
+    }
+
+    // The fewest insertions that keep every gap up to the expected next present within the
+    // timeout, evenly spaced and aligned to TE. The spacing is rounded up to TE, which keeps the
+    // last gap within the timeout as well since it never exceeds |maxSpacingNs|.
+    const int64_t maxSpacingNs =
+            std::max(mTeIntervalNs, (presentTimeoutNs / mTeIntervalNs) * mTeIntervalNs);
+    const int64_t numInsertions = (p90 + maxSpacingNs - 1) / maxSpacingNs - 1;
+    if (numInsertions <= 0) {
+        ++mNumStaticSchedules;
+        return std::nullopt;
+    }
+    const int64_t spacingNs =
+            ((p90 / (numInsertions + 1) + mTeIntervalNs - 1) / mTeIntervalNs) * mTeIntervalNs;
+    std::vector<int64_t> schedule;
+    schedule.reserve(numInsertions + staticSchedule.size());
+    for (int64_t i = 1; i <= numInsertions; ++i) {
+        schedule.push_back(i * spacingNs);
+    }
+    // If the present does not arrive as predicted, continue with the static schedule relative to
+    // the last inserted frame.
+    const int64_t fallbackBaseNs = schedule.back() + presentTimeoutNs;
+    for (const auto& whenNs : staticSchedule) {
+        schedule.push_back(fallbackBaseNs + whenNs);
+    }
+    ++mNumAdaptiveSchedules;
+    return schedule;
+}
+
+std::string AdaptivePresentTimeoutScheduler::dump() const {
+    std::ostringstream os;
+    os << "AdaptivePresentTimeoutScheduler: samples = " << mIntervals.size()
+       << ", frame interval = " << mFrameIntervalNs << "ns, adaptive schedules = "
+       << mNumAdaptiveSchedules << ", static schedules = " << mNumStaticSchedules;
+    return os.str();
+}
+
+bool AdaptivePresentTimeoutScheduler::isCadenceChanged(int32_t frameIntervalNs) const {
+    if (mFrameIntervalNs <= 0) return false;
+    return std::abs(static_cast<int64_t>(frameIntervalNs) - mFrameIntervalNs) >
+            (mFrameIntervalNs / kCadenceChangeDenominator);
+}
+
+} // namespace android::hardware::graphics::composer
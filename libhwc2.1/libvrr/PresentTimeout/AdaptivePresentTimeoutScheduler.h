@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../RingBuffer.h"
+
+namespace android::hardware::graphics::composer {
+
+// |AdaptivePresentTimeoutScheduler| learns the inter-present interval distribution of the
+// current content cadence and plans the frame insertions issued after a present timeout.
+//
+// The static schedule inserts the first frame |presentTimeoutNs| after a present, which for a
+// slow periodic cadence (e.g. 10 or 24 fps) places the insertion right before the next present and
+// leaves very uneven refresh gaps. When the cadence is stable, the adaptive schedule instead
+// spreads the minimum number of insertions evenly across the expected interval so that no gap
+// exceeds |presentTimeoutNs|, the longest gap the panel tolerates without flicker. Once the
+// adaptive insertions are exhausted, or whenever the cadence is not stable enough, the static
+// schedule applies unchanged.
+class AdaptivePresentTimeoutScheduler {
+public:
+    AdaptivePresentTimeoutScheduler() = default;
+
+    // Record a present at |presentTimeNs| whose declared frame interval is |frameIntervalNs|.
+    void onPresent(int64_t presentTimeNs, int32_t frameIntervalNs);
+
+    void reset();
+
+    void setTeInterval(int64_t teIntervalNs);
+
+    // Returns the insertion times relative to the present time. |staticSchedule| holds the static
+    // schedule relative to the first timeout at |presentTimeoutNs|, and is appended as the
+    // fallback after the adaptive insertions. Returns std::nullopt when the static schedule should
+    // be used as is.
+    std::optional<std::vector<int64_t>> getSchedule(int64_t presentTimeoutNs,
+                                                    const std::vector<int64_t>& staticSchedule);
+
+    std::string dump() const;
+
+private:
+    static constexpr size_t kHistorySize = 32;
+    static constexpr size_t kMinSamples = 8;
+    // Intervals longer than this are treated as the content going idle rather than its cadence.
+    static constexpr int64_t kMaxTrackedIntervalNs = 1000000000; // 1 s
+    // Allowed spread (p90 - p10) of the intervals, as a fraction of the median interval.
+    static constexpr int kMaxSpreadDenominator = 8;
+    static constexpr int kMaxSpreadTeIntervals = 2;
+    // The declared frame interval must change by more than this fraction to restart learning.
+    static constexpr int kCadenceChangeDenominator = 10;
+
+    bool isCadenceChanged(int32_t frameIntervalNs) const;
+
+    RingBuffer<int64_t, kHistorySize> mIntervals;
+    int64_t mLastPresentTimeNs = -1;
+    int32_t mFrameIntervalNs = 0;
+    int64_t mTeIntervalNs = 0;
+
+    uint64_t mNumAdaptiveSchedules = 0;
+    uint64_t mNumStaticSchedules = 0;
+};
+
+} // namespace android::hardware::graphics::composer
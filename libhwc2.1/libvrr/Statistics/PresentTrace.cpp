@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PresentTrace.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <ratio>
+#include <sstream>
+
+namespace android::hardware::graphics::composer {
+
+std::string PresentTrace::dump() const {
+    std::ostringstream os;
+    for (size_t i = 0; i < mEvents.size(); ++i) {
+        const auto& event = mEvents[i];
+        os << static_cast<int>(event.mType) << "," << event.mTimeNs << ","
+           << event.mFrameIntervalNs << "\n";
+    }
+    return os.str();
+}
+
+std::vector<PresentTraceEvent> PresentTrace::parse(std::istream& is) {
+    std::vector<PresentTraceEvent> events;
+    std::string line;
+    while (std::getline(is, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream iss(line);
+        int type;
+        char sep0, sep1;
+        PresentTraceEvent event;
+        if (!(iss >> type >> sep0 >> event.mTimeNs >> sep1 >> event.mFrameIntervalNs) ||
+            (sep0 != ',') || (sep1 != ',') ||
+            (type < static_cast<int>(PresentTraceEventType::kNotifyExpectedPresent)) ||
+            (type > static_cast<int>(PresentTraceEventType::kFrameInsertion))) {
+            continue;
+        }
+        event.mType = static_cast<PresentTraceEventType>(type);
+        events.emplace_back(event);
+    }
+    return events;
+}
+
+double VrrPolicyScore::getAverageRefreshRate() const {
+    if (mDurationNs <= 0) return 0.0;
+    return static_cast<double>(mNumPresents + mNumInsertedFrames) * std::nano::den / mDurationNs;
+}
+
+std::string VrrPolicyScore::toString() const {
+    std::ostringstream os;
+    os << "duration = " << (mDurationNs / 1000000) << "ms, ";
+    os << "presents = " << mNumPresents << ", ";
+    os << "inserted frames = " << mNumInsertedFrames << ", ";
+    os << "judder events = " << mNumJudderEvents << ", ";
+    os << "long gaps = " << mNumLongGaps << ", ";
+    os << "average refresh rate = " << getAverageRefreshRate() << ", ";
+    os << "power proxy = " << mPowerProxy;
+    return os.str();
+}
+
+void VrrPolicyScorer::onPresent(int64_t presentTimeNs, int32_t frameIntervalNs) {
+    onRefresh(presentTimeNs);
+    ++mScore.mNumPresents;
+    mScore.mPowerProxy += 1.0;
+    // A present judders when it lands further than half a TE away from the cadence declared with
+    // the previous frame.
+    if ((mLastPresentTimeNs >= 0) && (mLastFrameIntervalNs > 0) && (mTeIntervalNs > 0)) {
+        int64_t deviationNs =
+                std::abs((presentTimeNs - mLastPresentTimeNs) - mLastFrameIntervalNs);
+        if ((deviationNs > mTeIntervalNs / 2) &&
+            (presentTimeNs - mLastPresentTimeNs) < 2 * mLastFrameIntervalNs) {
+            ++mScore.mNumJudderEvents;
+        }
+    }
+    mLastPresentTimeNs = presentTimeNs;
+    mLastFrameIntervalNs = frameIntervalNs;
+}
+
+void VrrPolicyScorer::onFrameInsertion(int64_t refreshTimeNs) {
+    onRefresh(refreshTimeNs);
+    ++mScore.mNumInsertedFrames;
+    mScore.mPowerProxy += kInsertedFramePowerCost;
+}
+
+void VrrPolicyScorer::reset() {
+    mScore = VrrPolicyScore();
+    mFirstRefreshTimeNs = -1;
+    mLastRefreshTimeNs = -1;
+    mLastPresentTimeNs = -1;
+    mLastFrameIntervalNs = 0;
+}
+
+void VrrPolicyScorer::onRefresh(int64_t timeNs) {
+    if (mFirstRefreshTimeNs < 0) {
+        mFirstRefreshTimeNs = timeNs;
+    }
+    mScore.mDurationNs = std::max(mScore.mDurationNs, timeNs - mFirstRefreshTimeNs);
+    if ((mMaxRefreshGapNs > 0) && (mLastRefreshTimeNs >= 0) &&
+        (timeNs - mLastRefreshTimeNs > mMaxRefreshGapNs)) {
+        ++mScore.mNumLongGaps;
+    }
+    mLastRefreshTimeNs = timeNs;
+}
+
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "../RingBuffer.h"
+
+namespace android::hardware::graphics::composer {
+
+enum class PresentTraceEventType {
+    kNotifyExpectedPresent = 0,
+    kExpectedPresentTime,
+    kPresent,
+    kFrameInsertion,
+};
+
+typedef struct PresentTraceEvent {
+    PresentTraceEventType mType;
+    int64_t mTimeNs;
+    int32_t mFrameIntervalNs;
+} PresentTraceEvent;
+
+// |PresentTrace| keeps the most recent present related events received by the VRR controller. The
+// dump format is one "type,timeNs,frameIntervalNs" record per line, which |parse| accepts back, so
+// a trace captured from a device can be replayed on the host (see test/PresentTraceReplayer.h).
+class PresentTrace {
+public:
+    static constexpr size_t kDefaultCapacity = 1024;
+
+    void record(PresentTraceEventType type, int64_t timeNs, int32_t frameIntervalNs = 0) {
+        mEvents.next() = {.mType = type, .mTimeNs = timeNs, .mFrameIntervalNs = frameIntervalNs};
+    }
+
+    void clear() { mEvents.clear(); }
+
+    std::string dump() const;
+
+    // Parses records in the dump format. Empty lines, lines starting with '#' and malformed
+    // records are skipped.
+    static std::vector<PresentTraceEvent> parse(std::istream& is);
+
+private:
+    RingBuffer<PresentTraceEvent, kDefaultCapacity> mEvents;
+};
+
+// |VrrPolicyScore| condenses the refresh behaviour produced by a VRR policy into the metrics used
+// to compare policies against each other over the same trace.
+typedef struct VrrPolicyScore {
+    int64_t mDurationNs = 0;
+    uint64_t mNumPresents = 0;
+    uint64_t mNumInsertedFrames = 0;
+    uint64_t mNumJudderEvents = 0;
+    // Refresh gaps longer than the maximum gap the panel tolerates without flicker.
+    uint64_t mNumLongGaps = 0;
+    // Relative panel power. A presented frame costs one unit (DPU fetch plus panel scan), while
+    // an inserted frame only costs the panel scan.
+    double mPowerProxy = 0.0;
+
+    double getAverageRefreshRate() const;
+
+    std::string toString() const;
+} VrrPolicyScore;
+
+class VrrPolicyScorer {
+public:
+    static constexpr double kInsertedFramePowerCost = 0.5;
+
+    void onPresent(int64_t presentTimeNs, int32_t frameIntervalNs);
+
+    void onFrameInsertion(int64_t refreshTimeNs);
+
+    // |teIntervalNs| bounds the tolerated deviation of a present from its expected cadence.
+    void setTeInterval(int64_t teIntervalNs) { mTeIntervalNs = teIntervalNs; }
+
+    // |maxRefreshGapNs| is the longest gap between two refreshes, presented or inserted, that is
+    // not counted as a long gap. 0 disables the check.
+    void setMaxRefreshGap(int64_t maxRefreshGapNs) { mMaxRefreshGapNs = maxRefreshGapNs; }
+
+    const VrrPolicyScore& getScore() const { return mScore; }
+
+    void reset();
+
+private:
+    void onRefresh(int64_t timeNs);
+
+    VrrPolicyScore mScore;
+    int64_t mTeIntervalNs = 0;
+    int64_t mMaxRefreshGapNs = 0;
+    int64_t mFirstRefreshTimeNs = -1;
+    int64_t mLastRefreshTimeNs = -1;
+    int64_t mLastPresentTimeNs = -1;
+    int32_t mLastFrameIntervalNs = 0;
+};
+
+} // namespace android::hardware::graphics::composer
@@ -19,6 +19,7 @@
 #include "VariableRefreshRateController.h"
 
 #include <android-base/logging.h>
+#include <android-base/properties.h>
 #include <processgroup/sched_policy.h>
 #include <sync/sync.h>
 #include <utils/Trace.h>
@@ -26,7 +27,9 @@
 #include "ExynosHWCHelper.h"
 #include "drmmode.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cinttypes>
 #include <tuple>
 
 #include "RefreshRateCalculator/RefreshRateCalculatorFactory.h"
@@ -200,6 +203,9 @@ VariableRefreshRateController::VariableRefreshRateController(ExynosDisplay* disp
     mResidencyWatcher =
             ndk::SharedRefBase::make<DisplayStateResidencyWatcher>(mDisplayContextProvider,
                                                                    mVariableRefreshRateStatistic);
+
+    mAdaptivePresentTimeoutEnabled =
+            android::base::GetBoolProperty("vendor.display.vrr.adaptive_present_timeout", true);
 }
 
 VariableRefreshRateController::~VariableRefreshRateController() {
@@ -220,6 +226,11 @@ int VariableRefreshRateController::notifyExpectedPresent(int64_t timestamp,
     {
         const std::lock_guard<std::mutex> lock(mMutex);
         mRecord.mNextExpectedPresentTime = {mVrrActiveConfig, timestamp, frameIntervalNs};
+        mPresentTrace.record(PresentTraceEventType::kNotifyExpectedPresent, timestamp,
+                             frameIntervalNs);
+        // Resume from hibernation right away rather than waiting for the controller thread, so the
+        // panel is back to its rendering settings before the announced frame arrives.
+        exitHibernateLocked();
         // Post kNotifyExpectedPresentConfig event.
         postEvent(VrrControllerEventType::kNotifyExpectedPresentConfig, getSteadyClockTimeNs());
     }
@@ -251,6 +262,10 @@ void VariableRefreshRateController::reset() {
     const std::lock_guard<std::mutex> lock(mMutex);
     mEventQueue.mPriorityQueue = std::priority_queue<VrrControllerEvent>();
     mRecord.clear();
+    mPresentTrace.clear();
+    mPolicyScorer.reset();
+    mAdaptivePresentTimeoutScheduler.reset();
+    mPendingAdaptiveSchedule = std::nullopt;
     dropEventLocked();
     if (mLastPresentFence.has_value()) {
         if (close(mLastPresentFence.value())) {
@@ -299,6 +314,8 @@ void VariableRefreshRateController::setActiveVrrConfiguration(hwc2_config_t conf
                            << " , mMaximumRefreshRateTimeoutNs = " << mMaximumRefreshRateTimeoutNs;
             }
         }
+        mPolicyScorer.setTeInterval(mVrrConfigs[mVrrActiveConfig].vsyncPeriodNs);
+        mAdaptivePresentTimeoutScheduler.setTeInterval(mVrrConfigs[mVrrActiveConfig].vsyncPeriodNs);
         if (mVariableRefreshRateStatistic) {
             mVariableRefreshRateStatistic
                     ->setActiveVrrConfiguration(config,
@@ -309,6 +326,7 @@ void VariableRefreshRateController::setActiveVrrConfiguration(hwc2_config_t conf
         if (mState == VrrControllerState::kDisable) {
             return;
         }
+        exitHibernateLocked();
         mState = VrrControllerState::kRendering;
         dropEventLocked(VrrControllerEventType::kSystemRenderingTimeout);
 
@@ -354,6 +372,8 @@ void VariableRefreshRateController::preSetPowerMode(int32_t powerMode) {
         if (mPowerMode == powerMode) {
             return;
         }
+        // Restore the rendering settings first so the new power mode is applied on top of them.
+        exitHibernateLocked();
         switch (powerMode) {
             case HWC_POWER_MODE_DOZE:
             case HWC_POWER_MODE_DOZE_SUSPEND: {
@@ -513,6 +533,7 @@ void VariableRefreshRateController::setPresentTimeoutController(uint32_t control
     PresentTimeoutControllerType newDefaultControllerType =
             static_cast<PresentTimeoutControllerType>(controllerType);
     if (newDefaultControllerType != mDefaultPresentTimeoutController) {
+        exitHibernateLocked();
         mDefaultPresentTimeoutController = newDefaultControllerType;
         PresentTimeoutControllerType oldControllerType = mPresentTimeoutController;
         if (mDefaultPresentTimeoutController == PresentTimeoutControllerType::kHardware) {
@@ -555,6 +576,7 @@ int VariableRefreshRateController::setFixedRefreshRateRange(
             return NO_ERROR;
         }
     }
+    exitHibernateLocked();
     uint32_t command = getCurrentRefreshControlStateLocked();
     mMinimumRefreshRate = minimumRefreshRate;
     mMaximumRefreshRateTimeoutNs = minLockTimeForPeakRefreshRate;
@@ -682,6 +704,11 @@ void VariableRefreshRateController::onPresent(int fence) {
                         ->onPresent(mRecord.mPendingCurrentPresentTime.value().mTime,
                                     getPresentFrameFlag());
             }
+            const auto& presentEvent = mRecord.mPendingCurrentPresentTime.value();
+            mPresentTrace.record(PresentTraceEventType::kPresent, presentEvent.mTime,
+                                 presentEvent.mDuration);
+            mPolicyScorer.onPresent(presentEvent.mTime, presentEvent.mDuration);
+            mAdaptivePresentTimeoutScheduler.onPresent(presentEvent.mTime, presentEvent.mDuration);
             mRecord.mPresentHistory.next() = mRecord.mPendingCurrentPresentTime.value();
         }
         if (mState == VrrControllerState::kDisable) {
@@ -689,8 +716,7 @@ void VariableRefreshRateController::onPresent(int fence) {
         } else if (mState == VrrControllerState::kHibernate) {
             LOG(WARNING) << "VrrController: Present during hibernation without prior notification "
                             "via notifyExpectedPresent.";
-            mState = VrrControllerState::kRendering;
-            dropEventLocked(VrrControllerEventType::kHibernateTimeout);
+            exitHibernateLocked();
         }
 
         if ((mMaximumRefreshRateTimeoutNs > 0) && (mMinimumRefreshRate > 1)) {
@@ -768,17 +794,26 @@ void VariableRefreshRateController::onPresent(int fence) {
         } else {
             timeoutNs = kDefaultSystemPresentTimeoutNs;
         }
+        dropEventLocked(VrrControllerEventType::kSystemRenderingTimeout);
         postEvent(VrrControllerEventType::kSystemRenderingTimeout,
                   getSteadyClockTimeNs() + timeoutNs);
         if (shouldHandleVendorRenderingTimeout()) {
             // Post next frame insertion event.
-            int64_t firstTimeOutNs;
-            if (mVendorPresentTimeoutOverride) {
-                firstTimeOutNs = mVendorPresentTimeoutOverride.value().mTimeoutNs;
+            int64_t firstTimeOutNs = getPresentTimeoutNsLocked();
+            mPendingAdaptiveSchedule = std::nullopt;
+            if (mAdaptivePresentTimeoutEnabled) {
+                mPendingAdaptiveSchedule =
+                        mAdaptivePresentTimeoutScheduler
+                                .getSchedule(firstTimeOutNs,
+                                             getStaticPresentTimeoutScheduleLocked());
+            }
+            if (mPendingAdaptiveSchedule.has_value()) {
+                // The adaptive schedule is relative to the present itself, and its first task is
+                // executed by |kVendorRenderingTimeoutInit|.
+                firstTimeOutNs = mPendingAdaptiveSchedule.value().front();
             } else {
-                firstTimeOutNs = mPresentTimeoutEventHandler->getPresentTimeoutNs();
+                mPendingVendorRenderingTimeoutTasks.baseTimeNs += firstTimeOutNs;
             }
-            mPendingVendorRenderingTimeoutTasks.baseTimeNs += firstTimeOutNs;
             firstTimeOutNs -= kDefaultAheadOfTimeNs;
             if (firstTimeOutNs >= 0) {
                 auto vendorPresentTimeoutNs =
@@ -804,6 +839,8 @@ void VariableRefreshRateController::setExpectedPresentTime(int64_t timestampNano
     cancelPresentTimeoutHandlingLocked();
     mPendingVendorRenderingTimeoutTasks.baseTimeNs = timestampNanos;
     mRecord.mPendingCurrentPresentTime = {mVrrActiveConfig, timestampNanos, frameIntervalNs};
+    mPresentTrace.record(PresentTraceEventType::kExpectedPresentTime, timestampNanos,
+                         frameIntervalNs);
 }
 
 void VariableRefreshRateController::onVsync(int64_t timestampNanos,
@@ -818,6 +855,7 @@ void VariableRefreshRateController::cancelPresentTimeoutHandlingLocked() {
     dropEventLocked(VrrControllerEventType::kVendorRenderingTimeoutInit);
     dropEventLocked(VrrControllerEventType::kVendorRenderingTimeoutPost);
     mPendingVendorRenderingTimeoutTasks.reset();
+    mPendingAdaptiveSchedule = std::nullopt;
 }
 
 void VariableRefreshRateController::dropEventLocked() {
@@ -859,6 +897,21 @@ std::string VariableRefreshRateController::dumpEventQueueLocked() {
 void VariableRefreshRateController::dump(String8& result, const std::vector<std::string>& args) {
     result.appendFormat("\nVariableRefreshRateStatistic: \n");
     mVariableRefreshRateStatistic->dump(result, args);
+
+    const std::lock_guard<std::mutex> lock(mMutex);
+    result.appendFormat("\nVrrController: state = %s, hibernate count = %" PRIu64
+                        ", hibernate duration = %" PRId64 "ms\n",
+                        getStateName(mState).c_str(), mHibernateState.getCount(),
+                        mHibernateState.getDurationNs(getSteadyClockTimeNs()) /
+                                kMillisecondToNanoSecond);
+    result.appendFormat("\nVrrPolicyScore: %s\n", mPolicyScorer.getScore().toString().c_str());
+    result.appendFormat("%s (%s)\n", mAdaptivePresentTimeoutScheduler.dump().c_str(),
+                        mAdaptivePresentTimeoutEnabled ? "enabled" : "disabled");
+    // The present trace is only dumped on request since it can be long.
+    if (std::find(args.begin(), args.end(), "trace") != args.end()) {
+        result.appendFormat("\nVrrPresentTrace (type,timeNs,frameIntervalNs): \n%s",
+                            mPresentTrace.dump().c_str());
+    }
 }
 
 uint32_t VariableRefreshRateController::getCurrentRefreshControlStateLocked() const {
@@ -900,6 +953,33 @@ int64_t VariableRefreshRateController::getLastFenceSignalTimeUnlocked(int fd) {
     return timestamp;
 }
 
+int64_t VariableRefreshRateController::getPresentTimeoutNsLocked() const {
+    if (mVendorPresentTimeoutOverride) {
+        return mVendorPresentTimeoutOverride.value().mTimeoutNs;
+    }
+    return mPresentTimeoutEventHandler ? mPresentTimeoutEventHandler->getPresentTimeoutNs() : 0;
+}
+
+std::vector<int64_t> VariableRefreshRateController::getStaticPresentTimeoutScheduleLocked() const {
+    std::vector<int64_t> schedule;
+    // Verify whether a present timeout override exists, and if so, execute it first.
+    if (mVendorPresentTimeoutOverride) {
+        const auto& params = mVendorPresentTimeoutOverride.value();
+        int64_t whenFromNowNs = 0;
+        for (const auto& [count, intervalNs] : params.mSchedule) {
+            for (uint32_t j = 0; j < count; ++j) {
+                schedule.push_back(whenFromNowNs);
+                whenFromNowNs += intervalNs;
+            }
+        }
+    } else if (mPresentTimeoutEventHandler) {
+        for (const auto& event : mPresentTimeoutEventHandler->getHandleEvents()) {
+            schedule.push_back(event.mWhenNs);
+        }
+    }
+    return schedule;
+}
+
 int64_t VariableRefreshRateController::getNextEventTimeLocked() const {
     if (mEventQueue.mPriorityQueue.empty()) {
         LOG(WARNING) << "VrrController: event queue should NOT be empty.";
@@ -933,32 +1013,76 @@ void VariableRefreshRateController::handleCadenceChange() {
     mRecord.mNextExpectedPresentTime = std::nullopt;
 }
 
-void VariableRefreshRateController::handleResume() {
-    ATRACE_CALL();
-    if (!mRecord.mNextExpectedPresentTime.has_value()) {
-        LOG(WARNING)
-                << "VrrController: resume occurs without the expected present timing information.";
-        return;
-    }
-    // TODO(b/305311281): handle panel resume.
-    mRecord.mNextExpectedPresentTime = std::nullopt;
-}
-
 void VariableRefreshRateController::handleHibernate() {
     ATRACE_CALL();
     if (mFrameRateReporter) {
         mFrameRateReporter->reset();
     }
-    // TODO(b/305311206): handle entering panel hibernate.
-    postEvent(VrrControllerEventType::kHibernateTimeout,
-              getSteadyClockTimeNs() + kDefaultWakeUpTimeInPowerSaving);
+    // The panel keeps itself refreshed while hibernating, so no software frame insertion is
+    // needed and the controller thread stays asleep until the next present or notification.
+    cancelPresentTimeoutHandlingLocked();
+    dropEventLocked(VrrControllerEventType::kHibernateTimeout);
+    mPreHibernatePresentTimeoutController = mPresentTimeoutController;
+
+    // When the minimum refresh rate is active, the hardware is already in auto mode with the
+    // requested rate; leave it untouched.
+    std::optional<uint32_t> refreshControl;
+    uint32_t lowestRefreshRate = 1;
+    if (mFileNode && !isMinimumRefreshRateActive()) {
+        uint32_t command = 0;
+        if (mFileNode->getLastWrittenValue(kRefreshControlNodeName, command) != NO_ERROR) {
+            command = 0;
+        }
+        refreshControl = command;
+        const auto& validRefreshRates = mValidRefreshRates[mVrrActiveConfig];
+        if (!validRefreshRates.empty()) {
+            lowestRefreshRate = validRefreshRates.front();
+        }
+    }
+    auto hibernateCommand =
+            mHibernateState.enter(getSteadyClockTimeNs(), refreshControl, lowestRefreshRate);
+    if (!hibernateCommand.has_value()) {
+        return;
+    }
+    if (!mFileNode->writeValue(kRefreshControlNodeName, hibernateCommand.value())) {
+        LOG(ERROR) << "VrrController: write file node error, command = "
+                   << hibernateCommand.value();
+        return;
+    }
+    mHibernateState.onPanelReprogrammed();
+    mPresentTimeoutController = PresentTimeoutControllerType::kHardware;
 }
 
 void VariableRefreshRateController::handleStayHibernate() {
     ATRACE_CALL();
-    // TODO(b/305311698): handle keeping panel hibernate.
-    postEvent(VrrControllerEventType::kHibernateTimeout,
-              getSteadyClockTimeNs() + kDefaultWakeUpTimeInPowerSaving);
+    // Hibernate no longer posts periodic wakeups; a stale timeout is simply dropped.
+    LOG(WARNING) << "VrrController: unexpected hibernate timeout while hibernating.";
+}
+
+void VariableRefreshRateController::exitHibernateLocked() {
+    if (mState != VrrControllerState::kHibernate) {
+        return;
+    }
+    ATRACE_CALL();
+    dropEventLocked(VrrControllerEventType::kHibernateTimeout);
+    auto refreshControl = mHibernateState.exit(getSteadyClockTimeNs());
+    if (refreshControl.has_value()) {
+        if (!mFileNode->writeValue(kRefreshControlNodeName, refreshControl.value())) {
+            LOG(ERROR) << "VrrController: write file node error, command = "
+                       << refreshControl.value();
+        }
+        mPresentTimeoutController = mPreHibernatePresentTimeoutController;
+    }
+    mState = VrrControllerState::kRendering;
+    // Re-arm the rendering timeout so that we hibernate again if the announced frame never comes.
+    dropEventLocked(VrrControllerEventType::kSystemRenderingTimeout);
+    const auto& vrrConfig = mVrrConfigs[mVrrActiveConfig];
+    if (vrrConfig.isFullySupported) {
+        postEvent(VrrControllerEventType::kSystemRenderingTimeout,
+                  getSteadyClockTimeNs() + vrrConfig.notifyExpectedPresentConfig->TimeoutNs);
+    }
+    // Some callers don't wake the controller thread, which may wait on an empty queue.
+    mCondition.notify_all();
 }
 
 void VariableRefreshRateController::handlePresentTimeout() {
@@ -995,6 +1119,8 @@ void VariableRefreshRateController::handlePresentTimeout() {
                 ->onNonPresentRefresh(getSteadyClockTimeNs(),
                                       RefreshSource::kRefreshSourceFrameInsertion);
     }
+    mPresentTrace.record(PresentTraceEventType::kFrameInsertion, getSteadyClockTimeNs());
+    mPolicyScorer.onFrameInsertion(getSteadyClockTimeNs());
     mPendingVendorRenderingTimeoutTasks.scheduleNextTask();
 }
 
@@ -1148,37 +1274,21 @@ void VariableRefreshRateController::threadBody() {
                     }
                     case VrrControllerEventType::kVendorRenderingTimeoutInit: {
                         if (mPresentTimeoutEventHandler) {
-                            size_t numberOfIntervals = 0;
-                            // Verify whether a present timeout override exists, and if so, execute
-                            // it first.
-                            if (mVendorPresentTimeoutOverride) {
-                                const auto& params = mVendorPresentTimeoutOverride.value();
-                                int64_t whenFromNowNs = 0;
-                                for (int i = 0; i < params.mSchedule.size(); ++i) {
-                                    numberOfIntervals += params.mSchedule[i].first;
-                                }
-                                if (numberOfIntervals > 0) {
-                                    mPendingVendorRenderingTimeoutTasks.reserveSpace(
-                                            numberOfIntervals);
-                                    for (int i = 0; i < params.mSchedule.size(); ++i) {
-                                        uint32_t intervalNs = params.mSchedule[i].second;
-                                        for (int j = 0; j < params.mSchedule[i].first; ++j) {
-                                            mPendingVendorRenderingTimeoutTasks.addTask(
-                                                    whenFromNowNs);
-                                            whenFromNowNs += intervalNs;
-                                        }
-                                    }
-                                }
+                            // Prefer the adaptive schedule planned at present time, which already
+                            // falls back to the static one; otherwise, use the static schedule,
+                            // with the present timeout override taking precedence.
+                            std::vector<int64_t> schedule;
+                            if (mPendingAdaptiveSchedule.has_value()) {
+                                schedule = std::move(mPendingAdaptiveSchedule.value());
+                                mPendingAdaptiveSchedule = std::nullopt;
                             } else {
-                                auto handleEvents = mPresentTimeoutEventHandler->getHandleEvents();
-                                if (!handleEvents.empty()) {
-                                    numberOfIntervals = handleEvents.size();
-                                    mPendingVendorRenderingTimeoutTasks.reserveSpace(
-                                            numberOfIntervals);
-                                    for (int i = 0; i < handleEvents.size(); ++i) {
-                                        mPendingVendorRenderingTimeoutTasks.addTask(
-                                                handleEvents[i].mWhenNs);
-                                    }
+                                schedule = getStaticPresentTimeoutScheduleLocked();
+                            }
+                            size_t numberOfIntervals = schedule.size();
+                            if (numberOfIntervals > 0) {
+                                mPendingVendorRenderingTimeoutTasks.reserveSpace(numberOfIntervals);
+                                for (const auto& whenNs : schedule) {
+                                    mPendingVendorRenderingTimeoutTasks.addTask(whenNs);
                                 }
                             }
                             if (numberOfIntervals > 0) {
@@ -1216,12 +1326,6 @@ void VariableRefreshRateController::threadBody() {
                         handleStayHibernate();
                         break;
                     }
-                    case VrrControllerEventType::kNotifyExpectedPresentConfig: {
-                        handleResume();
-                        mState = VrrControllerState::kRendering;
-                        stateChanged = true;
-                        break;
-                    }
                     default: {
                         break;
                     }
@@ -29,9 +29,12 @@
 #include "EventQueue.h"
 #include "ExternalEventHandlerLoader.h"
 #include "FileNode.h"
+#include "PanelHibernateState.h"
+#include "PresentTimeout/AdaptivePresentTimeoutScheduler.h"
 #include "Power/DisplayStateResidencyWatcher.h"
 #include "RefreshRateCalculator/RefreshRateCalculator.h"
 #include "RingBuffer.h"
+#include "Statistics/PresentTrace.h"
 #include "Statistics/VariableRefreshRateStatistic.h"
 #include "Utils.h"
 #include "display/common/DisplayConfigurationOwner.h"
@@ -286,6 +289,13 @@ private:
 
     int64_t getNextEventTimeLocked() const;
 
+    // Returns the first present timeout of the static (vendor) schedule.
+    int64_t getPresentTimeoutNsLocked() const;
+
+    // Returns the frame insertion times of the static (vendor) schedule, relative to the first
+    // present timeout.
+    std::vector<int64_t> getStaticPresentTimeoutScheduleLocked() const;
+
     int getPresentFrameFlag() const {
         int flag = 0;
         // Is Yuv.
@@ -309,10 +319,13 @@ private:
 
     // Functions responsible for state machine transitions.
     void handleCadenceChange();
-    void handleResume();
     void handleHibernate();
     void handleStayHibernate();
 
+    // Leave the hibernate state immediately, restoring the refresh control settings that were in
+    // effect before entering it. No-op if the controller is not hibernating.
+    void exitHibernateLocked();
+
     void handleCallbackEventLocked(VrrControllerEvent& event) {
         if (event.mFunctor) {
             event.mFunctor();
@@ -366,6 +379,12 @@ private:
     ExternalEventHandler* mPresentTimeoutEventHandler = nullptr;
     std::optional<PresentTimeoutSettings> mVendorPresentTimeoutOverride;
 
+    bool mAdaptivePresentTimeoutEnabled = true;
+    AdaptivePresentTimeoutScheduler mAdaptivePresentTimeoutScheduler;
+    // Insertion times relative to the last present, consumed by the next
+    // |kVendorRenderingTimeoutInit| event.
+    std::optional<std::vector<int64_t>> mPendingAdaptiveSchedule;
+
     std::string mPanelName;
 
     // Refresh rate indicator.
@@ -381,6 +400,10 @@ private:
     std::shared_ptr<DisplayStateResidencyWatcher> mResidencyWatcher;
     std::shared_ptr<VariableRefreshRateStatistic> mVariableRefreshRateStatistic;
 
+    // Present trace and policy score of the controller, reported in dump.
+    PresentTrace mPresentTrace;
+    VrrPolicyScorer mPolicyScorer;
+
     std::shared_ptr<CommonDisplayContextProvider> mDisplayContextProvider;
 
     bool mEnabled = false;
@@ -402,6 +425,12 @@ private:
     std::optional<TimedEvent> mMinimumRefreshRateTimeoutEvent;
     MinimumRefreshRatePresentStates mMinimumRefreshRatePresentStates = kMinRefreshRateUnset;
 
+    // Hibernate bookkeeping. The present timeout controller is restored on exit only if hibernate
+    // reprogrammed the panel.
+    PanelHibernateState mHibernateState;
+    PresentTimeoutControllerType mPreHibernatePresentTimeoutController =
+            PresentTimeoutControllerType::kSoftware;
+
     std::vector<std::shared_ptr<RefreshRateChangeListener>> mRefreshRateChangeListeners;
 
     PendingVendorRenderingTimeoutTasks mPendingVendorRenderingTimeoutTasks;
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <tuple>
+
+#include "../PresentTimeout/AdaptivePresentTimeoutScheduler.h"
+
+namespace android::hardware::graphics::composer {
+namespace {
+
+constexpr int64_t kMillisecondNs = 1000000;
+constexpr int64_t kTe240HzNs = 1000000000 / 240;
+constexpr int64_t kTe60HzNs = 1000000000 / 60;
+
+void presentEvery(AdaptivePresentTimeoutScheduler& scheduler, int64_t intervalNs, int count,
+                  int64_t startNs = 0) {
+    for (int i = 0; i < count; ++i) {
+        scheduler.onPresent(startNs + i * intervalNs, static_cast<int32_t>(intervalNs));
+    }
+}
+
+TEST(AdaptivePresentTimeoutSchedulerTest, StaticUntilEnoughSamples) {
+    AdaptivePresentTimeoutScheduler scheduler;
+    scheduler.setTeInterval(kTe240HzNs);
+    presentEvery(scheduler, 100 * kMillisecondNs, 8);
+    EXPECT_FALSE(scheduler.getSchedule(33 * kMillisecondNs, {0}).has_value());
+
+    scheduler.onPresent(800 * kMillisecondNs, 100 * kMillisecondNs);
+    EXPECT_TRUE(scheduler.getSchedule(33 * kMillisecondNs, {0}).has_value());
+}
+
+TEST(AdaptivePresentTimeoutSchedulerTest, StaticForFastCadence) {
+    AdaptivePresentTimeoutScheduler scheduler;
+    scheduler.setTeInterval(kTe240HzNs);
+    presentEvery(scheduler, 4 * kTe240HzNs, 32);
+    EXPECT_FALSE(scheduler.getSchedule(33 * kMillisecondNs, {0}).has_value());
+}
+
+TEST(AdaptivePresentTimeoutSchedulerTest, StaticForUnstableCadence) {
+    AdaptivePresentTimeoutScheduler scheduler;
+    scheduler.setTeInterval(kTe240HzNs);
+    int64_t timeNs = 0;
+    for (int i = 0; i < 32; ++i) {
+        timeNs += (i % 2) ? 50 * kMillisecondNs : 150 * kMillisecondNs;
+        scheduler.onPresent(timeNs, 100 * kMillisecondNs);
+    }
+    EXPECT_FALSE(scheduler.getSchedule(33 * kMillisecondNs, {0}).has_value());
+}
+
+TEST(AdaptivePresentTimeoutSchedulerTest, CadenceChangeRestartsLearning) {
+    AdaptivePresentTimeoutScheduler scheduler;
+    scheduler.setTeInterval(kTe240HzNs);
+    presentEvery(scheduler, 100 * kMillisecondNs, 16);
+    ASSERT_TRUE(scheduler.getSchedule(33 * kMillisecondNs, {0}).has_value());
+
+    scheduler.onPresent(1600 * kMillisecondNs, 41666666);
+    EXPECT_FALSE(scheduler.getSchedule(33 * kMillisecondNs, {0}).has_value());
+}
+
+TEST(AdaptivePresentTimeoutSchedulerTest, FallbackFollowsLastInsertion) {
+    AdaptivePresentTimeoutScheduler scheduler;
+    scheduler.setTeInterval(kTe240HzNs);
+    presentEvery(scheduler, 100 * kMillisecondNs, 16);
+
+    const int64_t timeoutNs = 33 * kMillisecondNs;
+    const std::vector<int64_t> staticSchedule = {0, timeoutNs, 2 * timeoutNs};
+    auto schedule = scheduler.getSchedule(timeoutNs, staticSchedule);
+    ASSERT_TRUE(schedule.has_value());
+    ASSERT_GT(schedule->size(), staticSchedule.size());
+
+    const size_t numAdaptive = schedule->size() - staticSchedule.size();
+    const int64_t lastAdaptiveNs = (*schedule)[numAdaptive - 1];
+    for (size_t i = 0; i < staticSchedule.size(); ++i) {
+        EXPECT_EQ((*schedule)[numAdaptive + i], lastAdaptiveNs + timeoutNs + staticSchedule[i]);
+    }
+}
+
+// (frame interval, present timeout, TE interval)
+class AdaptiveScheduleGapTest
+      : public testing::TestWithParam<std::tuple<int64_t, int64_t, int64_t>> {};
+
+TEST_P(AdaptiveScheduleGapTest, GapsStayWithinTimeout) {
+    const auto [intervalNs, timeoutNs, teNs] = GetParam();
+    AdaptivePresentTimeoutScheduler scheduler;
+    scheduler.setTeInterval(teNs);
+    presentEvery(scheduler, intervalNs, 32);
+
+    auto schedule = scheduler.getSchedule(timeoutNs, {});
+    ASSERT_TRUE(schedule.has_value());
+    ASSERT_FALSE(schedule->empty());
+
+    int64_t lastNs = 0;
+    for (const auto& whenNs : schedule.value()) {
+        EXPECT_EQ(whenNs % teNs, 0) << whenNs;
+        EXPECT_LE(whenNs - lastNs, timeoutNs) << whenNs;
+        lastNs = whenNs;
+    }
+    EXPECT_LE(intervalNs - lastNs, timeoutNs);
+    EXPECT_LT(lastNs, intervalNs);
+
+    // One insertion less would need a TE aligned spacing longer than the timeout.
+    const int64_t maxSpacingNs = (timeoutNs / teNs) * teNs;
+    EXPECT_GT(intervalNs, static_cast<int64_t>(schedule->size()) * maxSpacingNs);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+        Cadences, AdaptiveScheduleGapTest,
+        testing::Values(std::make_tuple(118 * kMillisecondNs, 40 * kMillisecondNs, kTe60HzNs),
+                        std::make_tuple(100 * kMillisecondNs, 33 * kMillisecondNs, kTe240HzNs),
+                        std::make_tuple(41666666, 33 * kMillisecondNs, kTe240HzNs),
+                        std::make_tuple(41666666, 40 * kMillisecondNs, kTe240HzNs),
+                        std::make_tuple(1000 * kMillisecondNs, 33 * kMillisecondNs, kTe240HzNs),
+                        std::make_tuple(250 * kMillisecondNs, 50 * kMillisecondNs, kTe60HzNs)));
+
+} // namespace
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "../PanelHibernateState.h"
+#include "../interface/Panel_def.h"
+
+namespace android::hardware::graphics::composer {
+namespace {
+
+constexpr int64_t kMillisecondNs = 1000000;
+constexpr uint32_t kLowestRefreshRate = 1;
+// MRR v1 with a 60 Hz minimum refresh rate and 3 pending frame insertions.
+constexpr uint32_t kRefreshControl = kPanelRefreshCtrlMrrV1OverV2 |
+        (60 << kPanelRefreshCtrlMinimumRefreshRateOffset) |
+        (3 << kPanelRefreshCtrlFrameInsertionFrameCountOffset);
+
+TEST(PanelHibernateStateTest, EnterProgramsSelfRefreshAtLowestRate) {
+    PanelHibernateState state;
+    auto command = state.enter(0, kRefreshControl, kLowestRefreshRate);
+    ASSERT_TRUE(command.has_value());
+    EXPECT_TRUE(state.isHibernating());
+    EXPECT_EQ(state.getCount(), 1u);
+
+    EXPECT_EQ(command.value(),
+              kPanelRefreshCtrlMrrV1OverV2 | kPanelRefreshCtrlFrameInsertionAutoMode |
+                      (kLowestRefreshRate << kPanelRefreshCtrlMinimumRefreshRateOffset));
+}
+
+TEST(PanelHibernateStateTest, ExitRestoresRefreshControl) {
+    PanelHibernateState state;
+    ASSERT_TRUE(state.enter(0, kRefreshControl, kLowestRefreshRate).has_value());
+    state.onPanelReprogrammed();
+
+    auto command = state.exit(500 * kMillisecondNs);
+    ASSERT_TRUE(command.has_value());
+    EXPECT_EQ(command.value(), kRefreshControl);
+    EXPECT_FALSE(state.isHibernating());
+}
+
+TEST(PanelHibernateStateTest, FailedReprogramRestoresNothing) {
+    PanelHibernateState state;
+    ASSERT_TRUE(state.enter(0, kRefreshControl, kLowestRefreshRate).has_value());
+
+    EXPECT_FALSE(state.exit(500 * kMillisecondNs).has_value());
+    EXPECT_FALSE(state.isHibernating());
+    EXPECT_EQ(state.getDurationNs(500 * kMillisecondNs), 500 * kMillisecondNs);
+}
+
+TEST(PanelHibernateStateTest, PanelLeftUntouched) {
+    PanelHibernateState state;
+    EXPECT_FALSE(state.enter(0, std::nullopt, kLowestRefreshRate).has_value());
+    state.onPanelReprogrammed();
+    EXPECT_TRUE(state.isHibernating());
+    EXPECT_FALSE(state.exit(100 * kMillisecondNs).has_value());
+    EXPECT_EQ(state.getCount(), 1u);
+}
+
+TEST(PanelHibernateStateTest, ResidencyAccumulatesAcrossHibernates) {
+    PanelHibernateState state;
+    state.enter(100 * kMillisecondNs, kRefreshControl, kLowestRefreshRate);
+    state.onPanelReprogrammed();
+    state.exit(400 * kMillisecondNs);
+    EXPECT_EQ(state.getDurationNs(1000 * kMillisecondNs), 300 * kMillisecondNs);
+
+    state.enter(1000 * kMillisecondNs, kRefreshControl, kLowestRefreshRate);
+    // The ongoing hibernate is part of the residency reported in dump.
+    EXPECT_EQ(state.getDurationNs(1200 * kMillisecondNs), 500 * kMillisecondNs);
+    state.exit(1500 * kMillisecondNs);
+    EXPECT_EQ(state.getDurationNs(2000 * kMillisecondNs), 800 * kMillisecondNs);
+    EXPECT_EQ(state.getCount(), 2u);
+}
+
+// A present and an expected present notification both resume; the second one must not restore
+// the refresh control again nor count residency twice.
+TEST(PanelHibernateStateTest, SecondExitIsNoop) {
+    PanelHibernateState state;
+    state.enter(0, kRefreshControl, kLowestRefreshRate);
+    state.onPanelReprogrammed();
+    ASSERT_TRUE(state.exit(200 * kMillisecondNs).has_value());
+
+    EXPECT_FALSE(state.exit(300 * kMillisecondNs).has_value());
+    EXPECT_EQ(state.getDurationNs(300 * kMillisecondNs), 200 * kMillisecondNs);
+}
+
+// A rendering timeout that was already dequeued when hibernate was entered must not restart it.
+TEST(PanelHibernateStateTest, SecondEnterIsIgnored) {
+    PanelHibernateState state;
+    state.enter(0, kRefreshControl, kLowestRefreshRate);
+    state.onPanelReprogrammed();
+
+    EXPECT_FALSE(state.enter(100 * kMillisecondNs, kLowestRefreshRate, kLowestRefreshRate)
+                         .has_value());
+    EXPECT_EQ(state.getCount(), 1u);
+    auto command = state.exit(200 * kMillisecondNs);
+    ASSERT_TRUE(command.has_value());
+    EXPECT_EQ(command.value(), kRefreshControl);
+    EXPECT_EQ(state.getDurationNs(200 * kMillisecondNs), 200 * kMillisecondNs);
+}
+
+TEST(PanelHibernateStateTest, ReprogramAfterExitIsIgnored) {
+    PanelHibernateState state;
+    state.enter(0, kRefreshControl, kLowestRefreshRate);
+    state.exit(100 * kMillisecondNs);
+    state.onPanelReprogrammed();
+
+    state.enter(200 * kMillisecondNs, std::nullopt, kLowestRefreshRate);
+    EXPECT_FALSE(state.exit(300 * kMillisecondNs).has_value());
+}
+
+} // namespace
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+#include <iostream>
+#include <sstream>
+
+#include "PresentTraceReplayer.h"
+
+namespace android::hardware::graphics::composer {
+namespace {
+
+constexpr int64_t kTeIntervalNs = 1000000000 / 240;
+// A 120 Hz panel.
+constexpr int64_t kScanTimeNs = 2 * kTeIntervalNs;
+constexpr int64_t kMillisecondNs = 1000000;
+
+const char* const kCorpus[] = {
+        "video_24fps.trace", "animation_10fps.trace", "scrolling.trace",
+        "game_60fps.trace",  "idle_clock.trace",
+};
+
+// A static schedule that keeps inserting a frame every present timeout for one second.
+PresentTimeoutPolicy makePolicy(int64_t presentTimeoutNs, bool adaptive) {
+    PresentTimeoutPolicy policy;
+    policy.mTeIntervalNs = kTeIntervalNs;
+    policy.mScanTimeNs = kScanTimeNs;
+    policy.mPresentTimeoutNs = presentTimeoutNs;
+    for (int64_t whenNs = 0; whenNs < 1000 * kMillisecondNs; whenNs += presentTimeoutNs) {
+        policy.mStaticSchedule.push_back(whenNs);
+    }
+    policy.mAdaptive = adaptive;
+    return policy;
+}
+
+std::string getTracePath(const char* name) {
+    return android::base::GetExecutableDirectory() + "/test/traces/" + name;
+}
+
+std::vector<PresentTraceEvent> makePresents(int64_t startNs, int64_t intervalNs, int count) {
+    std::vector<PresentTraceEvent> events;
+    for (int i = 0; i < count; ++i) {
+        events.push_back({.mType = PresentTraceEventType::kPresent,
+                          .mTimeNs = startNs + i * intervalNs,
+                          .mFrameIntervalNs = static_cast<int32_t>(intervalNs)});
+    }
+    return events;
+}
+
+TEST(PresentTraceTest, ParsesDump) {
+    PresentTrace trace;
+    trace.record(PresentTraceEventType::kExpectedPresentTime, 1000, 16666666);
+    trace.record(PresentTraceEventType::kPresent, 1000, 16666666);
+    trace.record(PresentTraceEventType::kFrameInsertion, 34000);
+
+    std::istringstream is("# comment\n\n" + trace.dump() + "9,1,1\n2,bad\n");
+    auto events = PresentTrace::parse(is);
+    ASSERT_EQ(events.size(), 3u);
+    EXPECT_EQ(events[0].mType, PresentTraceEventType::kExpectedPresentTime);
+    EXPECT_EQ(events[1].mType, PresentTraceEventType::kPresent);
+    EXPECT_EQ(events[1].mTimeNs, 1000);
+    EXPECT_EQ(events[1].mFrameIntervalNs, 16666666);
+    EXPECT_EQ(events[2].mType, PresentTraceEventType::kFrameInsertion);
+    EXPECT_EQ(events[2].mTimeNs, 34000);
+}
+
+TEST(PresentTraceReplayerTest, NoInsertionBelowPresentTimeout) {
+    PresentTraceReplayer replayer(makePolicy(33 * kMillisecondNs, false));
+    auto score = replayer.replay(makePresents(0, 4 * kTeIntervalNs, 60));
+
+    EXPECT_EQ(score.mNumPresents, 60u);
+    EXPECT_EQ(score.mNumInsertedFrames, 0u);
+    EXPECT_EQ(score.mNumJudderEvents, 0u);
+    EXPECT_EQ(score.mNumLongGaps, 0u);
+}
+
+TEST(PresentTraceReplayerTest, InsertionRightBeforePresentDelaysIt) {
+    // The static insertion 36 ms after each present is scanned from 37.5 ms, and keeps the panel
+    // busy when the next frame arrives at 41.7 ms.
+    PresentTraceReplayer replayer(makePolicy(36 * kMillisecondNs, false));
+    auto score = replayer.replay(makePresents(0, 10 * kTeIntervalNs, 48));
+
+    EXPECT_GT(score.mNumInsertedFrames, 0u);
+    EXPECT_GT(score.mNumJudderEvents, 0u);
+
+    // The adaptive schedule inserts in the middle of the frame once it learned the cadence.
+    PresentTraceReplayer adaptiveReplayer(makePolicy(36 * kMillisecondNs, true));
+    auto adaptiveScore = adaptiveReplayer.replay(makePresents(0, 10 * kTeIntervalNs, 48));
+    EXPECT_LT(adaptiveScore.mNumJudderEvents, score.mNumJudderEvents);
+}
+
+// Replays the corpus with the static and the adaptive schedules. The scores are printed so that the
+// test doubles as a benchmark of the present timeout policy.
+TEST(PresentTraceReplayerTest, AdaptiveScheduleOnCorpus) {
+    for (const int64_t presentTimeoutNs : {33 * kMillisecondNs, 40 * kMillisecondNs}) {
+        for (const char* name : kCorpus) {
+            VrrPolicyScore staticScore, adaptiveScore;
+            PresentTraceReplayer staticReplayer(makePolicy(presentTimeoutNs, false));
+            ASSERT_TRUE(staticReplayer.replayFile(getTracePath(name), &staticScore)) << name;
+            PresentTraceReplayer adaptiveReplayer(makePolicy(presentTimeoutNs, true));
+            ASSERT_TRUE(adaptiveReplayer.replayFile(getTracePath(name), &adaptiveScore)) << name;
+            ASSERT_GT(staticScore.mNumPresents, 0u) << name;
+
+            std::cout << name << " (timeout " << presentTimeoutNs / kMillisecondNs << "ms)\n"
+                      << "  static:   " << staticScore.toString() << "\n"
+                      << "  adaptive: " << adaptiveScore.toString() << "\n";
+
+            EXPECT_EQ(adaptiveScore.mNumPresents, staticScore.mNumPresents) << name;
+            EXPECT_LE(adaptiveScore.mNumJudderEvents, staticScore.mNumJudderEvents) << name;
+            EXPECT_LE(adaptiveScore.mNumLongGaps, staticScore.mNumLongGaps) << name;
+        }
+    }
+}
+
+} // namespace
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PresentTraceReplayer.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace android::hardware::graphics::composer {
+
+VrrPolicyScore PresentTraceReplayer::replay(const std::vector<PresentTraceEvent>& events) {
+    VrrPolicyScorer scorer;
+    scorer.setTeInterval(mPolicy.mTeIntervalNs);
+    // A refresh requested at the present timeout starts on the next TE.
+    int64_t maxRefreshGapNs = mPolicy.mPresentTimeoutNs;
+    if (mPolicy.mTeIntervalNs > 0) {
+        maxRefreshGapNs = ((maxRefreshGapNs + mPolicy.mTeIntervalNs - 1) / mPolicy.mTeIntervalNs) *
+                mPolicy.mTeIntervalNs;
+    }
+    scorer.setMaxRefreshGap(maxRefreshGapNs);
+    mScheduler.reset();
+    mScheduler.setTeInterval(mPolicy.mTeIntervalNs);
+
+    std::vector<const PresentTraceEvent*> presents;
+    for (const auto& event : events) {
+        if (event.mType == PresentTraceEventType::kPresent) {
+            presents.push_back(&event);
+        }
+    }
+
+    int64_t scanDoneNs = -1;
+    for (size_t i = 0; i < presents.size(); ++i) {
+        const int64_t presentTimeNs = std::max(presents[i]->mTimeNs, scanDoneNs);
+        scorer.onPresent(presentTimeNs, presents[i]->mFrameIntervalNs);
+        // Like the controller, the scheduler learns from the expected present times.
+        mScheduler.onPresent(presents[i]->mTimeNs, presents[i]->mFrameIntervalNs);
+        scanDoneNs = presentTimeNs + mPolicy.mScanTimeNs;
+
+        // The insertions still pending when the next frame arrives are cancelled.
+        const int64_t nextPresentTimeNs =
+                (i + 1 < presents.size()) ? presents[i + 1]->mTimeNs : presentTimeNs;
+        for (const auto& whenNs : getInsertionTimes(presentTimeNs)) {
+            if (whenNs >= nextPresentTimeNs) break;
+            // The inserted refresh starts on the first TE after the request, once the previous
+            // refresh is scanned out.
+            int64_t refreshTimeNs = std::max(whenNs, scanDoneNs);
+            if (mPolicy.mTeIntervalNs > 0) {
+                const int64_t numTe = (refreshTimeNs - presentTimeNs + mPolicy.mTeIntervalNs - 1) /
+                        mPolicy.mTeIntervalNs;
+                refreshTimeNs = presentTimeNs + numTe * mPolicy.mTeIntervalNs;
+            }
+            if (refreshTimeNs >= nextPresentTimeNs) break;
+            scorer.onFrameInsertion(refreshTimeNs);
+            scanDoneNs = refreshTimeNs + mPolicy.mScanTimeNs;
+        }
+    }
+    return scorer.getScore();
+}
+
+bool PresentTraceReplayer::replayFile(const std::string& path, VrrPolicyScore* score) {
+    std::ifstream is(path);
+    if (!is.is_open()) {
+        return false;
+    }
+    *score = replay(PresentTrace::parse(is));
+    return true;
+}
+
+std::vector<int64_t> PresentTraceReplayer::getInsertionTimes(int64_t presentTimeNs) {
+    std::vector<int64_t> times;
+    if (mPolicy.mAdaptive) {
+        auto schedule = mScheduler.getSchedule(mPolicy.mPresentTimeoutNs, mPolicy.mStaticSchedule);
+        if (schedule.has_value()) {
+            for (const auto& whenNs : schedule.value()) {
+                times.push_back(presentTimeNs + whenNs);
+            }
+            return times;
+        }
+    }
+    for (const auto& whenNs : mPolicy.mStaticSchedule) {
+        times.push_back(presentTimeNs + mPolicy.mPresentTimeoutNs + whenNs);
+    }
+    return times;
+}
+
+} // namespace android::hardware::graphics::composer
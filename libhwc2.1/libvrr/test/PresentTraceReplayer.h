@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../PresentTimeout/AdaptivePresentTimeoutScheduler.h"
+#include "../Statistics/PresentTrace.h"
+
+namespace android::hardware::graphics::composer {
+
+// Present timeout settings of the VRR controller, in the terms of
+// |VariableRefreshRateController::getPresentTimeoutNsLocked| and
+// |VariableRefreshRateController::getStaticPresentTimeoutScheduleLocked|.
+typedef struct PresentTimeoutPolicy {
+    int64_t mTeIntervalNs = 0;
+    // Time the panel takes to scan out one refresh, i.e. the minimum frame interval.
+    int64_t mScanTimeNs = 0;
+    int64_t mPresentTimeoutNs = 0;
+    // Frame insertion times relative to the first present timeout.
+    std::vector<int64_t> mStaticSchedule;
+    bool mAdaptive = false;
+} PresentTimeoutPolicy;
+
+// |PresentTraceReplayer| replays the presents of a trace on a virtual clock through the present
+// timeout handling of the VRR controller and scores the refreshes with |VrrPolicyScorer|.
+//
+// After every present, the frame insertions of the static schedule, or of the adaptive schedule
+// when it applies, are issued until the next present of the trace. Frame insertions recorded in
+// the trace are ignored since they were produced by the policy of the device. Refreshes start on
+// TE and the panel is busy for |mScanTimeNs| after each of them, so an insertion issued right
+// before a present delays the present.
+class PresentTraceReplayer {
+public:
+    explicit PresentTraceReplayer(const PresentTimeoutPolicy& policy) : mPolicy(policy) {}
+
+    VrrPolicyScore replay(const std::vector<PresentTraceEvent>& events);
+
+    // Replays the trace stored in |path|. Returns false if it cannot be read.
+    bool replayFile(const std::string& path, VrrPolicyScore* score);
+
+private:
+    std::vector<int64_t> getInsertionTimes(int64_t presentTimeNs);
+
+    PresentTimeoutPolicy mPolicy;
+    AdaptivePresentTimeoutScheduler mScheduler;
+};
+
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "IdleTeAlignmentPolicy.h"
+
+namespace {
+
+constexpr int64_t kMillisecondNs = 1000000;
+constexpr int64_t kVsyncPeriodNs = 16666666;
+constexpr uint64_t kDisplayArea = 1080 * 2400;
+// A blinking cursor, well under 1% of the display.
+constexpr uint64_t kCursorArea = 4 * 60;
+constexpr int64_t kIdleEnterNs = 1000 * kMillisecondNs;
+
+TEST(IdleTeAlignmentPolicyTest, FramesAreNotAlignedUntilIdle) {
+    IdleTeAlignmentPolicy policy;
+    EXPECT_FALSE(policy.onFrame(false, false, kCursorArea, kDisplayArea));
+    EXPECT_EQ(policy.alignPresentTime(kIdleEnterNs + 20 * kMillisecondNs, kVsyncPeriodNs),
+              kIdleEnterNs + 20 * kMillisecondNs);
+
+    /* A panel without idle TE doesn't enter idle */
+    policy.onIdleEnter(0, kIdleEnterNs);
+    EXPECT_FALSE(policy.isIdle());
+}
+
+TEST(IdleTeAlignmentPolicyTest, SmallUpdateIsAlignedToIdleTe) {
+    IdleTeAlignmentPolicy policy;
+    policy.onIdleEnter(30, kIdleEnterNs);
+    ASSERT_TRUE(policy.isIdle());
+
+    const int64_t idleTePeriodNs = 1000000000 / 30;
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(policy.onFrame(false, false, kCursorArea, kDisplayArea));
+        const int64_t expectedPresentNs = kIdleEnterNs + i * idleTePeriodNs + 20 * kMillisecondNs;
+        EXPECT_EQ(policy.alignPresentTime(expectedPresentNs, kVsyncPeriodNs),
+                  kIdleEnterNs + (i + 1) * idleTePeriodNs);
+    }
+    EXPECT_TRUE(policy.isIdle());
+
+    /* A frame already on an idle TE is not moved */
+    EXPECT_TRUE(policy.onFrame(false, false, kCursorArea, kDisplayArea));
+    EXPECT_EQ(policy.alignPresentTime(kIdleEnterNs + 5 * idleTePeriodNs, 0),
+              kIdleEnterNs + 5 * idleTePeriodNs);
+}
+
+TEST(IdleTeAlignmentPolicyTest, DelayIsBounded) {
+    IdleTeAlignmentPolicy policy;
+    /* At 1 Hz, the next idle TE is up to a second away */
+    policy.onIdleEnter(1, kIdleEnterNs);
+    EXPECT_TRUE(policy.onFrame(false, false, kCursorArea, kDisplayArea));
+    const int64_t expectedPresentNs = kIdleEnterNs + 10 * kMillisecondNs;
+    EXPECT_EQ(policy.alignPresentTime(expectedPresentNs, kVsyncPeriodNs), expectedPresentNs);
+
+    /* The bound is what is left of the vsync once the commit was nudged */
+    IdleTeAlignmentPolicy policy30Hz;
+    policy30Hz.onIdleEnter(30, kIdleEnterNs);
+    EXPECT_TRUE(policy30Hz.onFrame(false, false, kCursorArea, kDisplayArea));
+    EXPECT_EQ(policy30Hz.alignPresentTime(kIdleEnterNs + 20 * kMillisecondNs, 10 * kMillisecondNs),
+              kIdleEnterNs + 20 * kMillisecondNs);
+}
+
+TEST(IdleTeAlignmentPolicyTest, SubstantiveFrameLeavesIdle) {
+    struct Frame {
+        bool geometryChanged;
+        bool m2mUpdated;
+        uint64_t damagedArea;
+    };
+    for (const auto& frame : {Frame{true, false, kCursorArea}, Frame{false, true, kCursorArea},
+                              Frame{false, false, kDisplayArea / 50}}) {
+        IdleTeAlignmentPolicy policy;
+        policy.onIdleEnter(30, kIdleEnterNs);
+        EXPECT_FALSE(policy.onFrame(frame.geometryChanged, frame.m2mUpdated, frame.damagedArea,
+                                    kDisplayArea));
+        EXPECT_FALSE(policy.isIdle());
+        EXPECT_EQ(policy.alignPresentTime(kIdleEnterNs + 20 * kMillisecondNs, kVsyncPeriodNs),
+                  kIdleEnterNs + 20 * kMillisecondNs);
+
+        /* Small updates are not aligned again until the next idle enter */
+        EXPECT_FALSE(policy.onFrame(false, false, kCursorArea, kDisplayArea));
+    }
+}
+
+TEST(IdleTeAlignmentPolicyTest, ResetLeavesIdle) {
+    IdleTeAlignmentPolicy policy;
+    policy.onIdleEnter(30, kIdleEnterNs);
+    EXPECT_TRUE(policy.onFrame(false, false, kCursorArea, kDisplayArea));
+    policy.reset();
+    EXPECT_FALSE(policy.isIdle());
+    EXPECT_EQ(policy.alignPresentTime(kIdleEnterNs + 20 * kMillisecondNs, kVsyncPeriodNs),
+              kIdleEnterNs + 20 * kMillisecondNs);
+}
+
+} // namespace
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "M2mCompressionPolicy.h"
+
+namespace {
+
+/* Frames after which the policy may change its decision */
+constexpr int kMinFramesBetweenSwitch = 60;
+
+/* Feeds |numFrames| frames where M2M regenerates the output every |lifetime| frames */
+void runLifetime(M2mCompressionPolicy& policy, int lifetime, int numFrames) {
+    for (int i = 0; i < numFrames; i++) {
+        policy.onFrame((i % lifetime) == 0);
+    }
+}
+
+TEST(M2mCompressionPolicyTest, SavingsGrowWithLifetime) {
+    /* Encoding a single-use output costs more than the DRAM traffic it saves */
+    EXPECT_LT(M2mCompressionPolicy::getCompressionSavings(1.0f), 0.0f);
+    EXPECT_GT(M2mCompressionPolicy::getCompressionSavings(10.0f), 0.0f);
+    float last = M2mCompressionPolicy::getCompressionSavings(1.0f);
+    for (float lifetime = 2.0f; lifetime <= 16.0f; lifetime += 1.0f) {
+        float savings = M2mCompressionPolicy::getCompressionSavings(lifetime);
+        EXPECT_GT(savings, last) << lifetime;
+        last = savings;
+    }
+}
+
+TEST(M2mCompressionPolicyTest, RegeneratedEveryFrameGoesLinear) {
+    M2mCompressionPolicy policy;
+    EXPECT_TRUE(policy.shouldCompress());
+
+    runLifetime(policy, 1, kMinFramesBetweenSwitch - 1);
+    /* The decision never changes before the minimum number of frames */
+    EXPECT_TRUE(policy.shouldCompress());
+
+    runLifetime(policy, 1, 1);
+    EXPECT_FALSE(policy.shouldCompress());
+    EXPECT_FLOAT_EQ(policy.getAverageLifetime(), 1.0f);
+}
+
+TEST(M2mCompressionPolicyTest, StaticOutputGoesBackToCompressed) {
+    M2mCompressionPolicy policy;
+    runLifetime(policy, 1, kMinFramesBetweenSwitch);
+    ASSERT_FALSE(policy.shouldCompress());
+
+    /* An output that stays static outlives the average before M2M replaces it */
+    policy.onFrame(true);
+    runLifetime(policy, kMinFramesBetweenSwitch * 2, kMinFramesBetweenSwitch);
+    EXPECT_TRUE(policy.shouldCompress());
+}
+
+TEST(M2mCompressionPolicyTest, LongLifetimeStaysCompressed) {
+    M2mCompressionPolicy policy;
+    runLifetime(policy, 8, kMinFramesBetweenSwitch * 10);
+    EXPECT_TRUE(policy.shouldCompress());
+    EXPECT_GT(policy.getAverageLifetime(), 7.0f);
+}
+
+TEST(M2mCompressionPolicyTest, MarginKeepsDecisionNearBreakEven) {
+    /* Find the first integer lifetime where compression saves energy */
+    int breakEven = 1;
+    while (M2mCompressionPolicy::getCompressionSavings(breakEven) <= 0.0f) breakEven++;
+
+    /* Right at break-even, the savings are within the margin in both directions */
+    M2mCompressionPolicy compressed;
+    runLifetime(compressed, breakEven, kMinFramesBetweenSwitch * 10);
+    EXPECT_TRUE(compressed.shouldCompress());
+
+    M2mCompressionPolicy linear;
+    runLifetime(linear, 1, kMinFramesBetweenSwitch);
+    ASSERT_FALSE(linear.shouldCompress());
+    runLifetime(linear, breakEven, kMinFramesBetweenSwitch * 10);
+    EXPECT_FALSE(linear.shouldCompress());
+}
+
+} // namespace
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "RotationPlanner.h"
+
+namespace {
+
+exynos_image makeImage(uint32_t w, uint32_t h, uint32_t transform = 0,
+                       uint32_t compressionType = COMP_TYPE_NONE) {
+    exynos_image image;
+    image.w = w;
+    image.h = h;
+    image.format = HAL_PIXEL_FORMAT_RGBA_8888;
+    image.transform = transform;
+    image.compressionInfo.type = compressionType;
+    return image;
+}
+
+const exynos_image kSrc = makeImage(1000, 1000, HAL_TRANSFORM_ROT_90);
+const exynos_image kDst = makeImage(1000, 1000);
+
+TEST(RotationPlannerTest, M2mCostGrowsWithContentRatio) {
+    const float dppCost = RotationPlanner::getDppRotationCost(kSrc, kDst);
+    EXPECT_GT(dppCost, 0.0f);
+    /* M2M still fetches its output every refresh */
+    EXPECT_GT(RotationPlanner::getM2mRotationCost(kSrc, kDst, 0.0f), 0.0f);
+    EXPECT_LT(RotationPlanner::getM2mRotationCost(kSrc, kDst, 0.1f), dppCost);
+    EXPECT_GT(RotationPlanner::getM2mRotationCost(kSrc, kDst, 1.0f), dppCost);
+}
+
+TEST(RotationPlannerTest, NewLayerMovesToM2mOnceItsRateIsKnown) {
+    RotationPlanner planner;
+    /* The frame rate of a new layer is not known: it counts as updated every refresh */
+    EXPECT_FALSE(planner.preferM2m(kSrc, kDst, 0.0f));
+    EXPECT_FALSE(planner.preferM2m(kSrc, kDst, 0.0f));
+    EXPECT_EQ(planner.getNumEvaluations(), 1u);
+
+    EXPECT_TRUE(planner.preferM2m(kSrc, kDst, 0.1f));
+    EXPECT_EQ(planner.getNumEvaluations(), 2u);
+    EXPECT_EQ(planner.getNumSwitches(), 1u);
+}
+
+TEST(RotationPlannerTest, RateJitterDoesNotReevaluate) {
+    RotationPlanner planner;
+    ASSERT_TRUE(planner.preferM2m(kSrc, kDst, 0.1f));
+    for (float ratio : {0.11f, 0.09f, 0.12f, 0.1f}) {
+        EXPECT_TRUE(planner.preferM2m(kSrc, kDst, ratio)) << ratio;
+    }
+    EXPECT_EQ(planner.getNumEvaluations(), 1u);
+}
+
+TEST(RotationPlannerTest, FullRateGoesBackToDpp) {
+    RotationPlanner planner;
+    ASSERT_TRUE(planner.preferM2m(kSrc, kDst, 0.1f));
+    EXPECT_FALSE(planner.preferM2m(kSrc, kDst, 1.0f));
+    /* A ratio above 1 is clamped */
+    EXPECT_FALSE(planner.preferM2m(kSrc, kDst, 2.0f));
+    EXPECT_EQ(planner.getNumEvaluations(), 2u);
+    EXPECT_EQ(planner.getNumSwitches(), 1u);
+}
+
+TEST(RotationPlannerTest, M2mIsKeptUntilItStopsSaving) {
+    /* At a quarter of the refresh rate M2M saves less than the margin to move to it */
+    const exynos_image dst = makeImage(1000, 850);
+    const float dppCost = RotationPlanner::getDppRotationCost(kSrc, dst);
+    const float m2mCost = RotationPlanner::getM2mRotationCost(kSrc, dst, 0.25f);
+    ASSERT_LT(m2mCost, dppCost);
+    ASSERT_GT(m2mCost, dppCost * 0.9f);
+
+    RotationPlanner fresh;
+    EXPECT_FALSE(fresh.preferM2m(kSrc, dst, 0.25f));
+
+    RotationPlanner planner;
+    ASSERT_TRUE(planner.preferM2m(kSrc, dst, 0.1f));
+    EXPECT_TRUE(planner.preferM2m(kSrc, dst, 0.25f));
+    EXPECT_FALSE(planner.preferM2m(kSrc, dst, 0.5f));
+}
+
+TEST(RotationPlannerTest, GeometryChangeReevaluates) {
+    RotationPlanner planner;
+    ASSERT_TRUE(planner.preferM2m(kSrc, kDst, 0.1f));
+
+    /* DPU fetches compressed buffers by blocks, so rotating them in DPP is cheap */
+    const exynos_image afbc = makeImage(1000, 1000, HAL_TRANSFORM_ROT_90, COMP_TYPE_AFBC);
+    EXPECT_FALSE(planner.preferM2m(afbc, kDst, 0.1f));
+    EXPECT_EQ(planner.getNumEvaluations(), 2u);
+}
+
+} // namespace
@@ -0,0 +1,298 @@
+/*
+ * Copyright Samsung Electronics Co.,LTD.
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "JpegStreamParser.h"
+
+#include "hwjpeg-internal.h"
+
+#define JPEG_MARKER_SIZE 2
+#define JPEG_SEGMENT_LENFIELD_SIZE 2
+
+void CJpegStreamParser::Initialize() {
+    m_state = STATE_SOI;
+    m_nOffset = 0;
+    m_bMarkerPrefix = false;
+    m_marker = 0;
+    m_nSegmentOffset = 0;
+    m_nSegmentLength = 0;
+    m_nSegmentFilled = 0;
+
+    m_nComponents = 0;
+    m_nWidth = 0;
+    m_nHeight = 0;
+    m_bFrameFound = false;
+    m_iHorizontalFactor = 1;
+    m_iVerticalFactor = 1;
+
+    m_nRestartInterval = 0;
+    m_nScanOffset = 0;
+    m_nEOIOffset = 0;
+    m_DQTOffsets.clear();
+    m_DHTOffsets.clear();
+    m_RestartOffsets.clear();
+}
+
+size_t CJpegStreamParser::GetLength(const unsigned char *addr) {
+    size_t len = static_cast<size_t>(*addr++) * 0x100;
+    return len + *addr;
+}
+
+bool CJpegStreamParser::Parse(unsigned char *streambase, size_t length) {
+    Initialize();
+
+    if (!Feed(streambase, length, true)) return false;
+
+    if (!m_bFrameFound) {
+        ALOGE("Incomplete JPEG Stream");
+        return false;
+    }
+
+    return true;
+}
+
+// Called with the marker of a segment. Returns false if the marker is not expected.
+bool CJpegStreamParser::StartSegment(unsigned char marker) {
+    m_marker = marker;
+    m_nSegmentOffset = m_nOffset - JPEG_MARKER_SIZE;
+
+    if ((marker >= 0xD0) && (marker <= 0xD7)) { // RSTn out of the scan data
+        ALOGE("Unexpected RST%d found at %zu", marker & 0x7, m_nSegmentOffset);
+        return false;
+    } else if (marker == 0xD9) { // EOI
+        if (m_nScanOffset == 0) {
+            ALOGE("Unexpected EOI found at %zu", m_nSegmentOffset);
+            return false;
+        }
+        m_nEOIOffset = m_nSegmentOffset;
+        m_state = STATE_DONE;
+        return true;
+    } else if ((marker == 0xCC) || (marker == 0xDC)) { // DAC and DNL
+        ALOGE("Unsupported JPEG stream: found marker 0xFF%02X", marker);
+        return false;
+    } else if ((marker != 0xC4) && ((marker & 0xF0) == 0xC0) && (marker != 0xC0)) {
+        ALOGE("SOF%d is not supported (offset %zu)", marker & 0xF, m_nSegmentOffset);
+        return false;
+    }
+
+    m_nSegmentFilled = 0;
+    m_state = STATE_LENGTH;
+    return true;
+}
+
+// Called when the length field or the whole copied segment is fed
+bool CJpegStreamParser::EndSegment() {
+    if (m_state == STATE_LENGTH) {
+        m_nSegmentLength = GetLength(m_Segment);
+        if (m_nSegmentLength < JPEG_SEGMENT_LENFIELD_SIZE) {
+            ALOGE("Invalid length %zu is read at offset %zu", m_nSegmentLength,
+                  m_nSegmentOffset + JPEG_MARKER_SIZE);
+            return false;
+        }
+
+        if (m_marker == 0xDB) m_DQTOffsets.push_back(m_nSegmentOffset);
+        if (m_marker == 0xC4) m_DHTOffsets.push_back(m_nSegmentOffset);
+
+        if ((m_marker == 0xC0) || (m_marker == 0xDD) || (m_marker == 0xDA)) {
+            if (m_nSegmentLength > MAX_BUFFERED_SEGMENT) {
+                ALOGE("Too large segment of marker 0xFF%02X (%zu bytes)", m_marker,
+                      m_nSegmentLength);
+                return false;
+            }
+            m_state = STATE_SEGMENT;
+        } else {
+            m_state = STATE_SKIP;
+        }
+
+        if (m_nSegmentFilled < m_nSegmentLength) return true;
+    }
+
+    m_state = STATE_MARKER;
+
+    if (m_marker == 0xC0) {
+        if (m_bFrameFound) {
+            ALOGE("Multiple frame headers found at %zu", m_nSegmentOffset);
+            return false;
+        }
+        if (!ParseFrame(m_Segment)) return false;
+        m_bFrameFound = true;
+    } else if (m_marker == 0xDD) { // DRI
+        if (m_nSegmentLength < 4) {
+            ALOGE("Too small DRI segment");
+            return false;
+        }
+        m_nRestartInterval = static_cast<unsigned short>(GetLength(m_Segment + 2));
+    } else if (m_marker == 0xDA) { // SOS
+        if (!m_bFrameFound) {
+            ALOGE("SOS found at %zu before the frame header", m_nSegmentOffset);
+            return false;
+        }
+        if (m_nScanOffset != 0) {
+            ALOGE("Multiple scans are not supported (offset %zu)", m_nSegmentOffset);
+            return false;
+        }
+        m_nScanOffset = m_nOffset;
+        m_state = STATE_SCAN;
+    }
+
+    return true;
+}
+
+// Walks the entropy-coded data. Returns the number of bytes consumed.
+size_t CJpegStreamParser::FeedScan(const unsigned char *data, size_t len) {
+    size_t pos = 0;
+
+    while (pos < len) {
+        if (!m_bMarkerPrefix) {
+            const void *ff = memchr(data + pos, 0xFF, len - pos);
+            if (ff == NULL) return len;
+            pos = PTR_DIFF(data, ff) + 1;
+            m_bMarkerPrefix = true;
+            continue;
+        }
+
+        unsigned char marker = data[pos++];
+        if (marker == 0xFF) continue; // fill byte
+        m_bMarkerPrefix = false;
+        if (marker == 0x00) continue; // stuffed zero byte
+
+        if ((marker >= 0xD0) && (marker <= 0xD7)) {
+            m_RestartOffsets.push_back(m_nOffset + pos - JPEG_MARKER_SIZE);
+            continue;
+        }
+
+        // The scan data ends at any other marker
+        m_nOffset += pos;
+        if (!StartSegment(marker)) m_state = STATE_ERROR;
+        m_nOffset -= pos;
+        return pos;
+    }
+
+    return pos;
+}
+
+bool CJpegStreamParser::Feed(const unsigned char *data, size_t len, bool until_frame) {
+    while ((len > 0) && !(until_frame && m_bFrameFound)) {
+        size_t consumed = 1;
+
+        switch (m_state) {
+            case STATE_SOI:
+                if (*data != ((m_nOffset == 0) ? 0xFF : 0xD8)) {
+                    ALOGE("Not a valid JPEG stream (offset %zu, byte %02x)", m_nOffset, *data);
+                    m_state = STATE_ERROR;
+                } else if (m_nOffset == 1) {
+                    m_state = STATE_MARKER;
+                }
+                break;
+            case STATE_MARKER:
+                if (!m_bMarkerPrefix) {
+                    if (*data != 0xFF) {
+                        ALOGE("Corrupted JPEG stream at %zu", m_nOffset);
+                        m_state = STATE_ERROR;
+                    }
+                    m_bMarkerPrefix = true;
+                } else if (*data != 0xFF) { // 0xFF before a marker is a fill byte
+                    m_bMarkerPrefix = false;
+                    m_nOffset++;
+                    if (!StartSegment(*data)) m_state = STATE_ERROR;
+                    m_nOffset--;
+                }
+                break;
+            case STATE_LENGTH:
+            case STATE_SEGMENT:
+                m_Segment[m_nSegmentFilled++] = *data;
+                if ((m_nSegmentFilled == ((m_state == STATE_LENGTH) ? JPEG_SEGMENT_LENFIELD_SIZE
+                                                                    : m_nSegmentLength))) {
+                    m_nOffset++;
+                    if (!EndSegment()) m_state = STATE_ERROR;
+                    m_nOffset--;
+                }
+                break;
+            case STATE_SKIP:
+                consumed = min(len, m_nSegmentLength - m_nSegmentFilled);
+                m_nSegmentFilled += consumed;
+                if (m_nSegmentFilled == m_nSegmentLength) m_state = STATE_MARKER;
+                break;
+            case STATE_SCAN:
+                consumed = FeedScan(data, len);
+                break;
+            case STATE_DONE:
+                return true; // trailing bytes after EOI are ignored
+            case STATE_ERROR:
+            default:
+                return false;
+        }
+
+        if (m_state == STATE_ERROR) return false;
+
+        data += consumed;
+        len -= consumed;
+        m_nOffset += consumed;
+    }
+
+    return m_state != STATE_ERROR;
+}
+
+bool CJpegStreamParser::ParseFrame(const unsigned char *addr) { // 2 bytes of length
+    // 1 byte of bits per sample
+    // 2 bytes of height
+    // 2 bytes of width
+    // 1 byte of number of components
+    // n * 3 byte component specifications
+    if (GetLength(addr) < 17) {
+        ALOGE("SOF0 should include all three components");
+        return false;
+    }
+    addr += 2; // skip length
+
+    if (*addr != 8) { // bits per sample
+        ALOGE("Bits Per Sample should be 8 but it is %d", *addr);
+        return false;
+    }
+    addr++;
+
+    m_nHeight = static_cast<unsigned short>(GetLength(addr));
+    if ((m_nHeight < 8) || (m_nHeight > 16383)) {
+        ALOGE("Height %d is not supported", m_nHeight);
+        return false;
+    }
+    addr += 2;
+
+    m_nWidth = static_cast<unsigned short>(GetLength(addr));
+    if ((m_nWidth < 8) || (m_nWidth > 16383)) {
+        ALOGE("Width %d is not supported", m_nWidth);
+        return false;
+    }
+    addr += 2;
+
+    m_nComponents = *addr;
+    if (m_nComponents != 3) {
+        ALOGE("Number of components should be 3 but it is %d", m_nComponents);
+        return false;
+    }
+    addr++;
+
+    // Only the first component is needed to find chroma subsampling factor
+    addr++; // skip component identifier
+    if ((*addr != 0x11) && (*addr != 0x21) && (*addr != 0x12) && (*addr != 0x22)) {
+        ALOGE("Invalid Luma sampling factor %#02x", *addr);
+        return false;
+    }
+    m_iHorizontalFactor = *addr >> 4;
+    m_iVerticalFactor = *addr & 0xF;
+
+    return true;
+}
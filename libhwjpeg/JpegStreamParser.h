@@ -0,0 +1,113 @@
+/*
+ * Copyright Samsung Electronics Co.,LTD.
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __HARDWARE_EXYNOS_JPEG_STREAM_PARSER_H__
+#define __HARDWARE_EXYNOS_JPEG_STREAM_PARSER_H__
+
+#include <cstddef>
+#include <vector>
+
+/*
+ * CJpegStreamParser - finds the frame header and the locations of the segments of a JPEG stream
+ *
+ * The stream can be given in chunks of any size with Feed(). The frame information is
+ * available as soon as SOF0 is fed, before the rest of the stream is read. Only the
+ * headers of SOF0, DRI and SOS are copied, so the parser never keeps more than
+ * MAX_BUFFERED_SEGMENT bytes of the stream. The offsets of DQT, DHT, the scan data and
+ * the restart markers in the scan data are recorded for later random access.
+ */
+class CJpegStreamParser {
+private:
+    enum {
+        STATE_SOI,     // expecting SOI
+        STATE_MARKER,  // expecting a marker
+        STATE_LENGTH,  // reading the length field of a segment
+        STATE_SEGMENT, // copying a segment to m_Segment
+        STATE_SKIP,    // skipping a segment
+        STATE_SCAN,    // walking the entropy-coded data
+        STATE_DONE,    // EOI is found
+        STATE_ERROR,
+    };
+
+    // SOF0 of three components is the largest segment to copy
+    static const size_t MAX_BUFFERED_SEGMENT = 64;
+
+    int m_state;
+    size_t m_nOffset;        // offset in the stream of the next byte to feed
+    bool m_bMarkerPrefix;    // 0xFF is fed and its marker is not yet
+    unsigned char m_marker;  // marker of the current segment
+    size_t m_nSegmentOffset; // offset of the marker of the current segment
+    size_t m_nSegmentLength; // value of the length field of the current segment
+    size_t m_nSegmentFilled; // bytes of the current segment fed including the length field
+    unsigned char m_Segment[MAX_BUFFERED_SEGMENT];
+
+    unsigned char m_nComponents;
+    unsigned short m_nWidth;
+    unsigned short m_nHeight;
+    bool m_bFrameFound;
+
+    unsigned short m_nRestartInterval;
+    size_t m_nScanOffset; // offset of the first byte of the entropy-coded data
+    size_t m_nEOIOffset;
+    std::vector<size_t> m_DQTOffsets;
+    std::vector<size_t> m_DHTOffsets;
+    std::vector<size_t> m_RestartOffsets; // offsets of RSTn markers in the scan data
+
+    void Initialize();
+    static size_t GetLength(const unsigned char *addr);
+    bool ParseFrame(const unsigned char *addr);
+    bool StartSegment(unsigned char marker);
+    bool EndSegment();
+    size_t FeedScan(const unsigned char *data, size_t len);
+
+public:
+    unsigned char m_iHorizontalFactor;
+    unsigned char m_iVerticalFactor;
+
+    CJpegStreamParser() { Initialize(); }
+    ~CJpegStreamParser() {}
+
+    // Parses the whole stream in @streambase to the frame header
+    bool Parse(unsigned char *streambase, size_t length);
+
+    // Starts parsing a new stream with Feed()
+    void Reset() { Initialize(); }
+
+    /*
+     * Feed - parses the next @len bytes of the stream
+     * @return: false if the stream is corrupted or not supported
+     *
+     * If @until_frame is true, parsing stops right after the frame header and the rest
+     * of @data is ignored.
+     */
+    bool Feed(const unsigned char *data, size_t len, bool until_frame = false);
+
+    bool IsFrameFound() { return m_bFrameFound; }
+    bool IsScanFound() { return m_nScanOffset != 0; }
+    bool IsComplete() { return m_state == STATE_DONE; }
+
+    unsigned int GetWidth() { return m_nWidth; }
+    unsigned int GetHeight() { return m_nHeight; }
+    unsigned int GetNumComponents() { return m_nComponents; }
+    unsigned int GetRestartInterval() { return m_nRestartInterval; }
+    size_t GetScanOffset() { return m_nScanOffset; }
+    size_t GetEOIOffset() { return m_nEOIOffset; }
+    const std::vector<size_t> &GetDQTOffsets() { return m_DQTOffsets; }
+    const std::vector<size_t> &GetDHTOffsets() { return m_DHTOffsets; }
+    const std::vector<size_t> &GetRestartOffsets() { return m_RestartOffsets; }
+};
+
+#endif //__HARDWARE_EXYNOS_JPEG_STREAM_PARSER_H__
@@ -47,6 +47,8 @@ CHWJpegV4L2Compressor::CHWJpegV4L2Compressor()
     m_v4l2DstBuffer.m.planes = m_v4l2DstPlanes;
 
     m_uiControlsToSet = 0;
+    m_uiControlsApplied = 0;
+    m_bQTableApplied = false;
 
     m_bEnableHWFC = false;
 
@@ -80,6 +82,18 @@ int CHWJpegV4L2Compressor::unlock() {
     return file_lock_.unlock();
 }
 
+// Controls are applied on the next compression only if their values are changed
+void CHWJpegV4L2Compressor::SetControl(unsigned int idx, __u32 id, __s32 value) {
+    if (!!(m_uiControlsApplied & (1 << idx)) && (m_v4l2Controls[idx].id == id) &&
+        (m_v4l2Controls[idx].value == value))
+        return;
+
+    m_v4l2Controls[idx].id = id;
+    m_v4l2Controls[idx].value = value;
+    m_uiControlsToSet |= 1 << idx;
+    m_uiControlsApplied &= ~(1 << idx);
+}
+
 bool CHWJpegV4L2Compressor::SetChromaSampFactor(unsigned int horizontal, unsigned int vertical) {
     __s32 value;
     switch ((horizontal << 4) | vertical) {
@@ -104,9 +118,7 @@ bool CHWJpegV4L2Compressor::SetChromaSampFactor(unsigned int horizontal, unsigne
             return false;
     }
 
-    m_v4l2Controls[HWJPEG_CTRL_CHROMFACTOR].id = V4L2_CID_JPEG_CHROMA_SUBSAMPLING;
-    m_v4l2Controls[HWJPEG_CTRL_CHROMFACTOR].value = value;
-    m_uiControlsToSet |= 1 << HWJPEG_CTRL_CHROMFACTOR;
+    SetControl(HWJPEG_CTRL_CHROMFACTOR, V4L2_CID_JPEG_CHROMA_SUBSAMPLING, value);
 
     return true;
 }
@@ -123,21 +135,22 @@ bool CHWJpegV4L2Compressor::SetQuality(unsigned int quality_factor, unsigned int
     }
 
     if (quality_factor > 0) {
-        m_v4l2Controls[HWJPEG_CTRL_QFACTOR].id = V4L2_CID_JPEG_COMPRESSION_QUALITY;
-        m_v4l2Controls[HWJPEG_CTRL_QFACTOR].value = static_cast<__s32>(quality_factor);
-        m_uiControlsToSet |= 1 << HWJPEG_CTRL_QFACTOR;
+        SetControl(HWJPEG_CTRL_QFACTOR, V4L2_CID_JPEG_COMPRESSION_QUALITY,
+                   static_cast<__s32>(quality_factor));
     }
 
     if (quality_factor2 > 0) {
-        m_v4l2Controls[HWJPEG_CTRL_QFACTOR2].id = V4L2_CID_JPEG_SEC_COMP_QUALITY;
-        m_v4l2Controls[HWJPEG_CTRL_QFACTOR2].value = static_cast<__s32>(quality_factor2);
-        m_uiControlsToSet |= 1 << HWJPEG_CTRL_QFACTOR2;
+        SetControl(HWJPEG_CTRL_QFACTOR2, V4L2_CID_JPEG_SEC_COMP_QUALITY,
+                   static_cast<__s32>(quality_factor2));
     }
 
     return true;
 }
 
 bool CHWJpegV4L2Compressor::SetQuality(const unsigned char qtable[]) {
+    if (m_bQTableApplied && (memcmp(m_QTableApplied, qtable, sizeof(m_QTableApplied)) == 0))
+        return true;
+
     v4l2_ext_controls ctrls;
     v4l2_ext_control ctrl;
 
@@ -149,14 +162,21 @@ bool CHWJpegV4L2Compressor::SetQuality(const unsigned char qtable[]) {
     ctrls.count = 1;
 
     ctrl.id = V4L2_CID_JPEG_QTABLES2;
-    ctrl.size = 128; /* two quantization tables */
+    ctrl.size = sizeof(m_QTableApplied); /* two quantization tables */
     ctrl.p_u8 = const_cast<unsigned char *>(qtable);
 
+    m_bQTableApplied = false;
+    // The tables replace the ones by the quality factor which should be applied again
+    m_uiControlsApplied &= ~(1 << HWJPEG_CTRL_QFACTOR);
+
     if (ioctl(GetDeviceFD(), VIDIOC_S_EXT_CTRLS, &ctrls) < 0) {
         ALOGERR("Failed to configure %u controls", ctrls.count);
         return false;
     }
 
+    memcpy(m_QTableApplied, qtable, sizeof(m_QTableApplied));
+    m_bQTableApplied = true;
+
     return true;
 }
 
@@ -173,9 +193,7 @@ bool CHWJpegV4L2Compressor::SetPadding(const unsigned char padding[], unsigned i
         padding_value |= padding[i];
     }
 
-    m_v4l2Controls[HWJPEG_CTRL_PADDING].id = V4L2_CID_JPEG_PADDING;
-    m_v4l2Controls[HWJPEG_CTRL_PADDING].value = static_cast<__s32>(padding_value);
-    m_uiControlsToSet |= 1 << HWJPEG_CTRL_PADDING;
+    SetControl(HWJPEG_CTRL_PADDING, V4L2_CID_JPEG_PADDING, static_cast<__s32>(padding_value));
 
     return true;
 }
@@ -198,9 +216,8 @@ bool CHWJpegV4L2Compressor::SetPadding2(const unsigned char padding[], unsigned
         padding_value |= padding[i];
     }
 
-    m_v4l2Controls[HWJPEG_CTRL_PADDING2].id = V4L2_CID_JPEG_SEC_PADDING;
-    m_v4l2Controls[HWJPEG_CTRL_PADDING2].value = static_cast<__s32>(padding_value);
-    m_uiControlsToSet |= 1 << HWJPEG_CTRL_PADDING2;
+    SetControl(HWJPEG_CTRL_PADDING2, V4L2_CID_JPEG_SEC_PADDING,
+               static_cast<__s32>(padding_value));
 
     return true;
 }
@@ -496,6 +513,7 @@ bool CHWJpegV4L2Compressor::UpdateControls() {
     ctrls.ctrl_class = V4L2_CTRL_CLASS_JPEG;
     ctrls.controls = ctrl;
     unsigned int idx_ctrl = 0;
+    unsigned int controls_to_apply = m_uiControlsToSet;
     while (m_uiControlsToSet != 0) {
         if (m_uiControlsToSet & (1 << idx_ctrl)) {
             ctrl[ctrls.count].id = m_v4l2Controls[idx_ctrl].id;
@@ -513,11 +531,15 @@ bool CHWJpegV4L2Compressor::UpdateControls() {
         ctrls.count++;
     }
 
+    if (!!(controls_to_apply & (1 << HWJPEG_CTRL_QFACTOR))) m_bQTableApplied = false;
+
     if (ioctl(GetDeviceFD(), VIDIOC_S_EXT_CTRLS, &ctrls) < 0) {
         ALOGERR("Failed to configure %u controls", ctrls.count);
         return false;
     }
 
+    m_uiControlsApplied |= controls_to_apply;
+
     return true;
 }
 
@@ -755,7 +777,13 @@ void CHWJpegV4L2Compressor::Release() {
 /********* D E C O M P R E S S I O N   S U P P O R T **************************/
 /******************************************************************************/
 
-CHWJpegV4L2Decompressor::CHWJpegV4L2Decompressor() : CHWJpegDecompressor("/dev/video12") {
+CHWJpegV4L2Decompressor::CHWJpegV4L2Decompressor()
+      : CHWJpegDecompressor("/dev/video12"),
+        m_uiCaptureBuffers(0),
+        m_uiStreamBuffers(0),
+        m_uiRequestedBuffers(0),
+        m_uiQueued(0),
+        m_uiInFlight(0) {
     m_v4l2Format.type = 0; // inidication of uninitialized state
 
     memset(&m_v4l2DstBuffer, 0, sizeof(m_v4l2DstBuffer));
@@ -773,10 +801,12 @@ CHWJpegV4L2Decompressor::CHWJpegV4L2Decompressor() : CHWJpegDecompressor("/dev/v
 }
 
 CHWJpegV4L2Decompressor::~CHWJpegV4L2Decompressor() {
+    DrainDecompression();
+    CancelStream();
     CancelCapture();
 }
 
-bool CHWJpegV4L2Decompressor::PrepareCapture() {
+bool CHWJpegV4L2Decompressor::PrepareCapture(unsigned int count) {
     if (m_v4l2DstBuffer.length < m_v4l2Format.fmt.pix.sizeimage) {
         ALOGE("The size of the buffer %u is smaller than required %u", m_v4l2DstBuffer.length,
               m_v4l2Format.fmt.pix.sizeimage);
@@ -788,7 +818,7 @@ bool CHWJpegV4L2Decompressor::PrepareCapture() {
     v4l2_requestbuffers reqbufs;
 
     memset(&reqbufs, 0, sizeof(reqbufs));
-    reqbufs.count = 1;
+    reqbufs.count = count;
     reqbufs.memory = m_v4l2DstBuffer.memory;
     reqbufs.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
@@ -797,6 +827,8 @@ bool CHWJpegV4L2Decompressor::PrepareCapture() {
         return false;
     }
 
+    m_uiCaptureBuffers = reqbufs.count;
+
     if (ioctl(GetDeviceFD(), VIDIOC_STREAMON, &reqbufs.type) < 0) {
         ALOGERR("Failed to STREAMON for the decompressed image");
         reqbufs.count = 0;
@@ -833,6 +865,12 @@ bool CHWJpegV4L2Decompressor::SetImageFormat(unsigned int v4l2_fmt, unsigned int
             return true;
     }
 
+    // The capture stream is stopped for the new format
+    if (m_uiInFlight > 0) {
+        ALOGE("Unable to change the image format while %u streams are in flight", m_uiInFlight);
+        return false;
+    }
+
     CancelCapture();
 
     memset(&m_v4l2Format, 0, sizeof(m_v4l2Format));
@@ -851,6 +889,17 @@ bool CHWJpegV4L2Decompressor::SetImageFormat(unsigned int v4l2_fmt, unsigned int
 }
 
 bool CHWJpegV4L2Decompressor::SetImageBuffer(char *buffer, size_t len_buffer) {
+    if (m_v4l2DstBuffer.memory != V4L2_MEMORY_USERPTR) {
+        // The buffers of the capture stream are allocated for the other memory type
+        if (m_uiInFlight > 0) {
+            ALOGE("Unable to switch to userptr buffer while %u streams are in flight",
+                  m_uiInFlight);
+            return false;
+        }
+
+        CancelCapture();
+    }
+
     m_v4l2DstBuffer.m.userptr = reinterpret_cast<unsigned long>(buffer);
     m_v4l2DstBuffer.bytesused = m_v4l2Format.fmt.pix.sizeimage;
     m_v4l2DstBuffer.length = len_buffer;
@@ -860,6 +909,16 @@ bool CHWJpegV4L2Decompressor::SetImageBuffer(char *buffer, size_t len_buffer) {
 }
 
 bool CHWJpegV4L2Decompressor::SetImageBuffer(int buffer, size_t len_buffer) {
+    if (m_v4l2DstBuffer.memory != V4L2_MEMORY_DMABUF) {
+        if (m_uiInFlight > 0) {
+            ALOGE("Unable to switch to dmabuf buffer while %u streams are in flight",
+                  m_uiInFlight);
+            return false;
+        }
+
+        CancelCapture();
+    }
+
     m_v4l2DstBuffer.m.fd = buffer;
     m_v4l2DstBuffer.bytesused = m_v4l2Format.fmt.pix.sizeimage;
     m_v4l2DstBuffer.length = len_buffer;
@@ -868,7 +927,7 @@ bool CHWJpegV4L2Decompressor::SetImageBuffer(int buffer, size_t len_buffer) {
     return true;
 }
 
-bool CHWJpegV4L2Decompressor::PrepareStream() {
+bool CHWJpegV4L2Decompressor::PrepareStream(unsigned int count) {
     if (TestFlag(HWJPEG_FLAG_OUTPUT_READY)) return true;
 
     /*
@@ -880,7 +939,7 @@ bool CHWJpegV4L2Decompressor::PrepareStream() {
     v4l2_requestbuffers rb;
     memset(&rb, 0, sizeof(rb));
 
-    rb.count = 1;
+    rb.count = count;
     rb.memory = V4L2_MEMORY_USERPTR;
     rb.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
 
@@ -890,6 +949,8 @@ bool CHWJpegV4L2Decompressor::PrepareStream() {
         return false;
     }
 
+    m_uiStreamBuffers = rb.count;
+
     if (ioctl(GetDeviceFD(), VIDIOC_STREAMON, &rb.type) < 0) {
         ALOGERR("Failed to STREAMON for the JPEG stream.");
 
@@ -921,9 +982,61 @@ void CHWJpegV4L2Decompressor::CancelStream() {
     ClearFlag(HWJPEG_FLAG_OUTPUT_READY);
 }
 
-bool CHWJpegV4L2Decompressor::QBufAndWait(const char *buffer, size_t len) {
+void CHWJpegV4L2Decompressor::DrainDecompression() {
+    while (m_uiInFlight > 0) {
+        if (!WaitForDecompression())
+            ALOGE("Failed to decompress a stream in flight during draining");
+    }
+}
+
+unsigned int CHWJpegV4L2Decompressor::GetMaxInFlight() {
+    // Before streaming, the number of buffers the driver allows is not known yet
+    if (!TestFlag(HWJPEG_FLAG_CAPTURE_READY) || !TestFlag(HWJPEG_FLAG_OUTPUT_READY))
+        return MAX_INFLIGHT_IMAGES;
+
+    unsigned int count = min(m_uiCaptureBuffers, m_uiStreamBuffers);
+    return (count > 0) ? count : 1;
+}
+
+bool CHWJpegV4L2Decompressor::QueueDecompress(const char *buffer, size_t len) {
+    return QueueStream(buffer, len, MAX_INFLIGHT_IMAGES);
+}
+
+bool CHWJpegV4L2Decompressor::QueueStream(const char *buffer, size_t len,
+                                          unsigned int num_buffers) {
+    if (m_v4l2Format.type == 0) {
+        ALOGE("Decompressed image format is not specified");
+        return false;
+    }
+
+    if (m_v4l2DstBuffer.length == 0) {
+        ALOGE("Decompressed image buffer is not specified");
+        return false;
+    }
+
+    // The queues of Decompress() have a single buffer. They are allocated again for
+    // pipelining once nothing is in flight.
+    if ((m_uiRequestedBuffers < num_buffers) && (m_uiInFlight == 0)) {
+        CancelStream();
+        CancelCapture();
+    }
+
+    if (!TestFlag(HWJPEG_FLAG_CAPTURE_READY) && !TestFlag(HWJPEG_FLAG_OUTPUT_READY))
+        m_uiRequestedBuffers = num_buffers;
+
+    // Do not change the order of PrepareCapture() and PrepareStream().
+    // Otherwise, decompression will fail.
+    if (!PrepareCapture(m_uiRequestedBuffers) || !PrepareStream(m_uiRequestedBuffers))
+        return false;
+
+    if (m_uiInFlight >= GetMaxInFlight()) {
+        ALOGE("Too many streams in flight (%u)", m_uiInFlight);
+        return false;
+    }
+
     v4l2_buffer buf;
     memset(&buf, 0, sizeof(buf));
+    buf.index = m_uiQueued % GetMaxInFlight();
     buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
     buf.memory = V4L2_MEMORY_USERPTR;
     buf.bytesused = len;
@@ -935,48 +1048,66 @@ bool CHWJpegV4L2Decompressor::QBufAndWait(const char *buffer, size_t len) {
         return false;
     }
 
-    if (ioctl(GetDeviceFD(), VIDIOC_QBUF, &m_v4l2DstBuffer) < 0) {
+    v4l2_buffer dst = m_v4l2DstBuffer;
+    dst.index = buf.index;
+
+    if (ioctl(GetDeviceFD(), VIDIOC_QBUF, &dst) < 0) {
+        // The queued stream would be decompressed to the image buffer of the next one
+        ALOGERR("Failed to QBUF for the decompressed image (%u streams cancelled)",
+                m_uiInFlight);
         CancelStream();
-        ALOGERR("Failed to QBUF for the decompressed image");
+        CancelCapture();
+        m_uiInFlight = 0;
         return false;
     }
 
-    bool ret = true;
+    m_uiQueued++;
+    m_uiInFlight++;
 
-    if (ioctl(GetDeviceFD(), VIDIOC_DQBUF, &buf) < 0) {
-        ALOGERR("Failed to DQBUF of the stream buffer");
-        ret = false;
+    return true;
+}
+
+bool CHWJpegV4L2Decompressor::WaitForDecompression() {
+    if (m_uiInFlight == 0) {
+        ALOGE("No stream is queued for decompression");
+        return false;
     }
 
-    buf.type = m_v4l2DstBuffer.type;
-    buf.memory = m_v4l2DstBuffer.memory;
+    v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    buf.memory = V4L2_MEMORY_USERPTR;
 
-    if (ioctl(GetDeviceFD(), VIDIOC_DQBUF, &buf) < 0) {
-        ALOGERR("Failed to DQBUF of the image buffer");
-        ret = false;
+    bool dequeued = ioctl(GetDeviceFD(), VIDIOC_DQBUF, &buf) == 0;
+    if (!dequeued) {
+        ALOGERR("Failed to DQBUF of the stream buffer");
+    } else {
+        buf.type = m_v4l2DstBuffer.type;
+        buf.memory = m_v4l2DstBuffer.memory;
+        dequeued = ioctl(GetDeviceFD(), VIDIOC_DQBUF, &buf) == 0;
+        if (!dequeued)
+            ALOGERR("Failed to DQBUF of the image buffer");
+    }
+
+    if (!dequeued) {
+        // The pairing of the streams and the images in the queues is lost
+        ALOGE("%u streams in flight are cancelled", m_uiInFlight);
+        CancelStream();
+        CancelCapture();
+        m_uiInFlight = 0;
+        return false;
     }
 
     m_uiHWDelay = buf.reserved2;
+    m_uiInFlight--;
 
-    return ret;
+    return true;
 }
 
 bool CHWJpegV4L2Decompressor::Decompress(const char *buffer, size_t len) {
-    if (m_v4l2Format.type == 0) {
-        ALOGE("Decompressed image format is not specified");
-        return false;
-    }
-
-    if (m_v4l2DstBuffer.length == 0) {
-        ALOGE("Decompressed image buffer is not specified");
-        return false;
-    }
+    DrainDecompression();
 
-    // Do not change the order of PrepareCapture() and PrepareStream().
-    // Otherwise, decompression will fail.
-    if (!PrepareCapture() || !PrepareStream()) return false;
+    if (!QueueStream(buffer, len, 1)) return false;
 
-    if (!QBufAndWait(buffer, len)) return false;
-
-    return true;
+    return WaitForDecompression();
 }
@@ -435,6 +435,8 @@ public:
      * it has strict limitation that the downscaling factor should be one of
      * 1, 2, 4 and 8. If the specified decompressed image size is not one of
      * the compressed image size divided by 1, 2, 4 or 8, decompression should fail.
+     * Changing the format fails while streams queued by QueueDecompress() are in
+     * flight. Wait for them with WaitForDecompression() first.
      */
     virtual bool SetImageFormat(unsigned int v4l2_fmt, unsigned int width, unsigned int height) = 0;
 
@@ -444,6 +446,9 @@ public:
      * @len_buffer[in] : size of the buffer
      * @return          : true if buffer configuration is successful.
      *                    false, otherwise.
+     *
+     * Switching from a dmabuf buffer to a userptr buffer fails while streams are
+     * in flight like SetImageFormat().
      */
     virtual bool SetImageBuffer(char *buffer, size_t len_buffer) = 0;
 
@@ -453,6 +458,9 @@ public:
      * @len_buffer[in] : size of the buffer
      * @return          : true if buffer configuration is successful.
      *                    false, otherwise.
+     *
+     * Switching from a userptr buffer to a dmabuf buffer fails while streams are
+     * in flight like SetImageFormat().
      */
     virtual bool SetImageBuffer(int buffer, size_t len_buffer) = 0;
 
@@ -520,8 +528,43 @@ public:
      * at the start. If @buffer is start with SOS marker, DHT, DQT and chroma
      * subsampling factors should be separately configured with SetDHT(), SetDQT() and
      * SetChromaSampFactor(), respectively.
+     * The streams queued by QueueDecompress() are waited for before @buffer is
+     * queued, and their results are discarded.
      */
     virtual bool Decompress(const char *buffer, size_t len) = 0;
+
+    /*
+     * GetMaxInFlight - The number of images that can be queued at the same time
+     */
+    virtual unsigned int GetMaxInFlight() { return 1; }
+
+    /*
+     * GetNumInFlight - The number of images queued and not yet waited for
+     */
+    virtual unsigned int GetNumInFlight() = 0;
+
+    /*
+     * QueueDecompress - Queue the given JPEG stream for decompression without waiting
+     * @buffer[in] : The buffer of JPEG stream.
+     * @len[in] : The length of the JPEG stream. It includes EOI marker.
+     * @return : true if the stream is queued. false, otherwise.
+     *
+     * The image buffer configured by SetImageBuffer() is used for the stream and
+     * another image buffer can be configured for the next stream right after this
+     * function returns. @buffer and the image buffer should be valid until
+     * WaitForDecompression() returns for the stream. Up to GetMaxInFlight() streams
+     * can be queued and their image format and buffer type should be the same.
+     * If queueing fails, the streams already queued may be cancelled as well. Check
+     * GetNumInFlight() for the streams that are still in flight.
+     */
+    virtual bool QueueDecompress(const char *buffer, size_t len) = 0;
+
+    /*
+     * WaitForDecompression - Wait for the oldest queued stream to be decompressed
+     * @return : true if the decompression of the oldest stream succeeded.
+     *           false, otherwise or if there is no stream queued.
+     */
+    virtual bool WaitForDecompression() = 0;
 };
 
 class CHWJpegFlagManager {
@@ -574,6 +617,11 @@ class CAPABILITY("CHWJpegV4L2Compressor") CHWJpegV4L2Compressor : public CHWJpeg
     } m_v4l2Controls[HWJPEG_CTRL_NUM];
 
     unsigned int m_uiControlsToSet;
+    // Set if the value in m_v4l2Controls is known to be applied to the driver
+    unsigned int m_uiControlsApplied;
+    // The quantization tables applied by SetQuality(qtable) if m_bQTableApplied
+    unsigned char m_QTableApplied[128];
+    bool m_bQTableApplied;
     // H/W delay of the last compressoin in usec.
     // Only valid after Compression() successes.
     unsigned int m_uiHWDelay;
@@ -598,6 +646,8 @@ class CAPABILITY("CHWJpegV4L2Compressor") CHWJpegV4L2Compressor : public CHWJpeg
                 TO_SEC_IMG_SIZE(m_v4l2Format.fmt.pix_mp.height)) != 0;
     }
 
+    void SetControl(unsigned int idx, __u32 id, __s32 value);
+
     // V4L2 Helpers
     bool TryFormat() REQUIRES(this);
     bool SetFormat() REQUIRES(this);
@@ -654,17 +704,27 @@ class CHWJpegV4L2Decompressor : public CHWJpegDecompressor, private CHWJpegFlagM
         HWJPEG_FLAG_CAPTURE_READY = 0x20, /* the capture stream is ready */
     };
 
+    /* The number of buffers requested to each queue for pipelined decompression */
+    static const unsigned int MAX_INFLIGHT_IMAGES = 4;
+
     unsigned int m_uiHWDelay;
 
     v4l2_format m_v4l2Format;
     v4l2_buffer m_v4l2DstBuffer; /* multi-planar foramt is not supported */
 
-    bool PrepareCapture();
+    unsigned int m_uiCaptureBuffers; /* the number of buffers allocated by REQBUFS */
+    unsigned int m_uiStreamBuffers;
+    unsigned int m_uiRequestedBuffers; /* the number of buffers requested to both queues */
+    unsigned int m_uiQueued;         /* the number of streams queued so far */
+    unsigned int m_uiInFlight;
+
+    bool PrepareCapture(unsigned int count);
     void CancelCapture();
 
-    bool PrepareStream();
+    bool PrepareStream(unsigned int count);
     void CancelStream();
-    bool QBufAndWait(const char *buffer, size_t len);
+    void DrainDecompression();
+    bool QueueStream(const char *buffer, size_t len, unsigned int num_buffers);
 
 public:
     CHWJpegV4L2Decompressor();
@@ -673,6 +733,10 @@ public:
     virtual bool SetImageBuffer(char *buffer, size_t len_buffer);
     virtual bool SetImageBuffer(int buffer, size_t len_buffer);
     virtual bool Decompress(const char *buffer, size_t len);
+    virtual unsigned int GetMaxInFlight();
+    virtual unsigned int GetNumInFlight() { return m_uiInFlight; }
+    virtual bool QueueDecompress(const char *buffer, size_t len);
+    virtual bool WaitForDecompression();
 
     unsigned int GetHWDelay() { return m_uiHWDelay; }
 };
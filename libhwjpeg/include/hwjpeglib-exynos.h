@@ -135,9 +135,31 @@ bool hwjpeg_dmabuf_dst(hwjpeg_decompress_ptr cinfo, int outfd[], size_t outsize[
  * should be also integers. The results should be also even number according to the
  * output image format configured by hwjpeg_config_image_format().
  * Otherwise, the decompression will fail.
+ * If HWJPEG does not support downscaling, the image is decompressed in the full size and
+ * downscaled by CPU. It is only supported for RGB24 and RGB32 formats.
  */
 void hwjpeg_set_downscale_factor(hwjpeg_decompress_ptr cinfo, unsigned int factor);
 
+/*
+ * hwjpeg_set_roi - configure the region of the image to output
+ *
+ * @cinfo: decompressor instance handle
+ * @left: horizontal offset of the region in the downscaled image
+ * @top: vertical offset of the region in the downscaled image
+ * @width: width of the region. 0 to output the whole image, @left and @top are ignored then.
+ * @height: height of the region
+ *
+ * The region is in the coordinates of the image downscaled by the factor configured by
+ * hwjpeg_set_downscale_factor(). @cinfo->output_width and @cinfo->output_height are the
+ * size of the region after hwjpeg_read_header() and the output buffer needs to store only
+ * the region. The region should be aligned to the chroma subsampling of the output image
+ * format and NV12, NV21, RGB and packed YUV422 formats are supported.
+ * HWJPEG decompresses the whole image to an internal buffer and the region is copied by CPU,
+ * so the decompression takes as long as without a region.
+ */
+void hwjpeg_set_roi(hwjpeg_decompress_ptr cinfo, unsigned int left, unsigned int top,
+                    unsigned int width, unsigned int height);
+
 /*
  * hwjpeg_read_header - reads the headers of the compressed JPEG stream
  *
@@ -149,6 +171,42 @@ void hwjpeg_set_downscale_factor(hwjpeg_decompress_ptr cinfo, unsigned int facto
  */
 bool hwjpeg_read_header(hwjpeg_decompress_ptr cinfo);
 
+/*
+ * hwjpeg_feed_stream - parses a chunk of the compressed JPEG stream while it is being read
+ *
+ * @cinfo: decompressor instance handle
+ * @data: the next chunk of the stream
+ * @len: the length in bytes of @data
+ * @return: -1 on failure.
+ *          0 if the frame header is not found yet.
+ *          1 if the frame header is found. The fields of @cinfo are available and HWJPEG
+ *            is configured for the image.
+ *          2 if EOI is found. The restart index is available.
+ *
+ * The chunks are given in the order of the stream and the first chunk after EOI or a
+ * failure starts a new stream. Since HWJPEG is configured as soon as the frame header is
+ * fed, configuring the output image format overlaps reading the rest of the stream. After
+ * the whole stream is read, it still should be given to hwjpeg_mem_src() or
+ * hwjpeg_dmabuf_src() followed by hwjpeg_read_header() and hwjpeg_start_decompress()
+ * which find HWJPEG configured already.
+ */
+int hwjpeg_feed_stream(hwjpeg_decompress_ptr cinfo, const unsigned char *data, size_t len);
+
+/*
+ * hwjpeg_get_restart_index - get the locations in the stream fed by hwjpeg_feed_stream()
+ *
+ * @cinfo: decompressor instance handle
+ * @scan_offset: offset of the first byte of the entropy-coded data from SOI
+ * @restart_interval: the number of MCUs between restart markers. 0 if DRI is not found.
+ * @offsets: the offsets of the restart markers from SOI in the order of the stream.
+ *           Valid until the next call to hwjpeg_feed_stream().
+ * @num_offsets: the number of elements in @offsets
+ * @return: false if the whole stream is not fed.
+ */
+bool hwjpeg_get_restart_index(hwjpeg_decompress_ptr cinfo, size_t *scan_offset,
+                              unsigned int *restart_interval, const size_t **offsets,
+                              size_t *num_offsets);
+
 /*
  * hwjpeg_has_enough_stream_buffer - Confirm if the stream buffer is enough
  *
@@ -177,6 +235,49 @@ bool hwjpeg_start_decompress(hwjpeg_decompress_ptr cinfo);
  */
 void hwjpeg_destroy_decompress(hwjpeg_decompress_ptr cinfo);
 
+/*
+ * hwjpeg_decompress_job - a compressed JPEG stream and its output buffer in a batch
+ */
+typedef struct hwjpeg_decompress_job {
+    unsigned char *inbuffer;    /* the buffer that contains the compressed JPEG stream */
+    size_t insize;              /* the length in bytes of @inbuffer including EOI */
+    unsigned char *outbuffer;   /* the buffer to store decompressed image if @outfd < 0 */
+    int outfd;                  /* the file descriptor of the buffer to store decompressed image */
+    size_t outsize;             /* the length in bytes of @outbuffer or @outfd */
+    unsigned int output_width;  /* width of the output image, filled by the decompressor */
+    unsigned int output_height; /* height of the output image, filled by the decompressor */
+    void *user_data;            /* not touched by the decompressor */
+} hwjpeg_decompress_job;
+
+/*
+ * hwjpeg_decompress_done_t - completion of a job in a batch
+ *
+ * @job: the job that is completed
+ * @success: false if the decompression of @job failed
+ * @priv: @priv given to hwjpeg_decompress_batch()
+ */
+typedef void (*hwjpeg_decompress_done_t)(hwjpeg_decompress_job *job, bool success, void *priv);
+
+/*
+ * hwjpeg_decompress_batch - decompresses several JPEG streams with overlapped processing
+ *
+ * @cinfo: decompressor instance handle
+ * @jobs: the array of the streams and their output buffers
+ * @num_jobs: the number of elements in @jobs
+ * @done: the function called on the completion of each job
+ * @priv: the argument to @done
+ * @return: false if any of the jobs failed.
+ *
+ * The output format and the downscaling factor of @cinfo apply to every job.
+ * Instead of hwjpeg_read_header() and hwjpeg_start_decompress() for each stream,
+ * the headers of the jobs are read while the previous jobs are decompressed, and
+ * HWJPEG keeps its configuration between the consecutive jobs of the same output
+ * size. @done is called in the order of @jobs before this function returns.
+ * The buffers of a job should be valid until @done is called for the job.
+ */
+bool hwjpeg_decompress_batch(hwjpeg_decompress_ptr cinfo, hwjpeg_decompress_job jobs[],
+                             unsigned int num_jobs, hwjpeg_decompress_done_t done, void *priv);
+
 };     /* extern "C" */
 #endif /* __cplusplus */
 
@@ -26,8 +26,11 @@
 #include <unistd.h>
 
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <vector>
 
+#include "JpegStreamParser.h"
 #include "hwjpeg-internal.h"
 
 #define ALOGERR(fmt, args...) ((void)ALOG(LOG_ERROR, LOG_TAG, fmt " [%s]", ##args, strerror(errno)))
@@ -36,186 +39,6 @@
 #define ROUND_UP(val, denom) ROUND_DOWN((val) + (denom)-1, denom)
 #define TO_MASK(val) ((val)-1)
 
-class CJpegStreamParser {
-private:
-    unsigned char *m_pStreamBase;
-    size_t m_nStreamSize;
-
-    unsigned char m_nComponents;
-    unsigned short m_nWidth;
-    unsigned short m_nHeight;
-
-    void Initialize();
-    size_t GetLength(unsigned char *addr);
-    bool ParseFrame(unsigned char *addr);
-
-    ptrdiff_t GetOffset(unsigned char *addr) {
-        unsigned long beg = reinterpret_cast<unsigned long>(m_pStreamBase);
-        unsigned long cur = reinterpret_cast<unsigned long>(addr);
-        return static_cast<ptrdiff_t>(cur - beg);
-    }
-
-public:
-    unsigned char m_iHorizontalFactor;
-    unsigned char m_iVerticalFactor;
-
-    CJpegStreamParser() : m_pStreamBase(NULL), m_nStreamSize(0) {}
-    ~CJpegStreamParser() {}
-
-    bool Parse(unsigned char *streambase, size_t length);
-
-    int GetImageFormat();
-    unsigned int GetWidth() { return m_nWidth; }
-    unsigned int GetHeight() { return m_nHeight; }
-    unsigned int GetNumComponents() { return m_nComponents; }
-};
-
-void CJpegStreamParser::Initialize() {
-    m_nComponents = 0;
-    m_nWidth = 0;
-    m_nHeight = 0;
-    m_iHorizontalFactor = 1;
-    m_iVerticalFactor = 1;
-}
-
-size_t CJpegStreamParser::GetLength(unsigned char *addr) {
-    size_t len = static_cast<size_t>(*addr++) * 0x100;
-    return len + *addr;
-}
-
-bool CJpegStreamParser::Parse(unsigned char *streambase, size_t length) {
-    Initialize();
-
-    m_pStreamBase = streambase;
-    m_nStreamSize = length;
-
-    unsigned char *addr = m_pStreamBase;
-    size_t filelen = m_nStreamSize;
-
-    // Finding SOI (xFFD8)
-    if ((filelen < 2) || (addr[0] != 0xFF) || (addr[1] != 0xD8)) {
-        ALOGE("Not a valid JPEG stream (len %zu, marker %02x%02x", filelen, addr[0], addr[1]);
-        return false;
-    }
-    addr += 2;
-    filelen -= 2;
-
-    while (true) { // DHT, DQT, SOF, SOS
-        if (filelen < 2) {
-            ALOGE("Incomplete JPEG Stream");
-            return false;
-        }
-
-        if (*addr++ != 0xFF) {
-            ALOGE("Corrupted JPEG stream");
-            return false;
-        }
-
-        unsigned char marker = *addr++;
-        filelen -= 2;
-
-        if ((marker != 0xC4) && ((marker & 0xF0) == 0xC0)) { // SOFn
-            if (marker != 0xC0) {
-                ALOGE("SOF%d is not supported (offset %zu)", marker & 0xF, m_nStreamSize - filelen);
-                return false;
-            }
-
-            if (filelen < 2 || filelen < GetLength(addr)) {
-                ALOGE("Too small SOF0 segment");
-                return false;
-            }
-
-            if (!ParseFrame(addr)) return false;
-
-            return true;             // this is the successful exit point
-        } else if (marker == 0xD9) { // EOI
-            // This will not meet.
-            ALOGE("Unexpected EOI found at %td\n", GetOffset(addr - 2));
-            return false;
-        } else {
-            if ((marker == 0xCC) || (marker == 0xDC)) { // DAC and DNL
-                ALOGE("Unsupported JPEG stream: found marker 0xFF%02X", marker);
-                return false;
-            }
-
-            if (filelen < 2 || filelen < GetLength(addr)) {
-                ALOGE("Corrupted JPEG stream");
-                return false;
-            }
-        }
-
-        if (filelen < 2 || GetLength(addr) == 0) {
-            ALOGE("Invalid length 0 is read at offset %td", GetOffset(addr));
-            return false;
-        }
-
-        if (filelen < GetLength(addr)) {
-            ALOGE("Corrupted JPEG Stream");
-            return false;
-        }
-
-        filelen -= GetLength(addr);
-        addr += GetLength(addr);
-    }
-
-    // NEVER REACH HERE
-
-    ALOGE("Unable to find the frame header");
-
-    return false;
-}
-
-bool CJpegStreamParser::ParseFrame(unsigned char *addr) { // 2 bytes of length
-    // 1 byte of bits per sample
-    // 2 bytes of height
-    // 2 bytes of width
-    // 1 byte of number of components
-    // n * 3 byte component specifications
-    if (GetLength(addr) < 17) {
-        ALOGE("SOF0 should include all three components");
-        return false;
-    }
-    addr += 2; // skip length
-
-    if (*addr != 8) { // bits per sample
-        ALOGE("Bits Per Sample should be 8 but it is %d", *addr);
-        return false;
-    }
-    addr++;
-
-    m_nHeight = static_cast<unsigned short>(GetLength(addr));
-    if ((m_nHeight < 8) || (m_nHeight > 16383)) {
-        ALOGE("Height %d is not supported", m_nHeight);
-        return false;
-    }
-    addr += 2;
-
-    m_nWidth = static_cast<unsigned short>(GetLength(addr));
-    if ((m_nWidth < 8) || (m_nWidth > 16383)) {
-        ALOGE("Width %d is not supported", m_nWidth);
-        return false;
-    }
-    addr += 2;
-
-    m_nComponents = *addr;
-    if (m_nComponents != 3) {
-        ALOGE("Number of components should be 3 but it is %d", m_nComponents);
-        return false;
-    }
-    addr++;
-
-    // Only the first component is needed to find chroma subsampling factor
-    addr++; // skip component identifier
-    if ((*addr != 0x11) && (*addr != 0x21) && (*addr != 0x12) && (*addr != 0x22)) {
-        ALOGE("Invalid Luma sampling factor %#02x", *addr);
-        return false;
-    }
-    m_iHorizontalFactor = *addr >> 4;
-    m_iVerticalFactor = *addr & 0xF;
-
-    return true;
-}
-
 class CLibhwjpegDecompressor : public hwjpeg_decompressor_struct {
     enum {
         HWJPG_FLAG_NEED_MUNMAP = 1,
@@ -230,6 +53,29 @@ class CLibhwjpegDecompressor : public hwjpeg_decompressor_struct {
     size_t m_nDummyBytes;
 
     CJpegStreamParser m_jpegStreamParser;
+    // Parses the stream given by FeedStream() while it is being read
+    CJpegStreamParser m_jpegStreamFeeder;
+    bool m_bFeedFailed;
+
+    // The buffer configured by the user for the decompressed image
+    char *m_pImageBuffer;
+    int m_iImageBuffer;
+    size_t m_nImageLength;
+
+    // The region of the downscaled image to output. m_nRoiWidth is 0 if not configured.
+    unsigned int m_nRoiLeft;
+    unsigned int m_nRoiTop;
+    unsigned int m_nRoiWidth;
+    unsigned int m_nRoiHeight;
+
+    // The size of the image decompressed by HWJPEG and the downscaling factor left to CPU
+    unsigned int m_nDecodedWidth;
+    unsigned int m_nDecodedHeight;
+    unsigned int m_nSWScaleFactor;
+
+    // HWJPEG decompresses to this buffer if the image needs cropping or downscaling by CPU
+    char *m_pScratchBuffer;
+    size_t m_nScratchLength;
 
 public:
     CLibhwjpegDecompressor() : m_flags(0) {
@@ -251,6 +97,24 @@ public:
         m_nStreamLength = 0;
         m_nDummyBytes = 0;
 
+        m_pImageBuffer = NULL;
+        m_iImageBuffer = -1;
+        m_nImageLength = 0;
+
+        m_nRoiLeft = 0;
+        m_nRoiTop = 0;
+        m_nRoiWidth = 0;
+        m_nRoiHeight = 0;
+
+        m_nDecodedWidth = 0;
+        m_nDecodedHeight = 0;
+        m_nSWScaleFactor = 1;
+
+        m_pScratchBuffer = NULL;
+        m_nScratchLength = 0;
+
+        m_bFeedFailed = false;
+
         m_hwjpeg = new CHWJpegV4L2Decompressor;
         if (!m_hwjpeg || !*m_hwjpeg) {
             ALOGE("Failed to create HWJPEG decompressor");
@@ -261,6 +125,8 @@ public:
     ~CLibhwjpegDecompressor() {
         delete m_hwjpeg;
 
+        free(m_pScratchBuffer);
+
         if (!!(m_flags & HWJPG_FLAG_NEED_MUNMAP))
             munmap(m_pStreamBuffer, m_nStreamLength + m_nDummyBytes);
     }
@@ -352,7 +218,11 @@ public:
             return false;
         }
 
-        return m_hwjpeg->SetImageBuffer(reinterpret_cast<char *>(buffer[0]), len[0]);
+        m_pImageBuffer = reinterpret_cast<char *>(buffer[0]);
+        m_iImageBuffer = -1;
+        m_nImageLength = len[0];
+
+        return true;
     }
 
     bool SetImageBuffer(int buffer[3], size_t len[3], unsigned int num_bufs) {
@@ -361,40 +231,61 @@ public:
             return false;
         }
 
-        return m_hwjpeg->SetImageBuffer(buffer[0], len[0]);
+        m_pImageBuffer = NULL;
+        m_iImageBuffer = buffer[0];
+        m_nImageLength = len[0];
+
+        return true;
     }
 
     void SetDownscaleFactor(unsigned int factor) { scale_factor = factor; }
 
+    void SetRegion(unsigned int left, unsigned int top, unsigned int width, unsigned int height) {
+        // Without a width the whole image is output: an offset would be applied to it
+        if (width == 0) {
+            left = 0;
+            top = 0;
+            height = 0;
+        }
+        m_nRoiLeft = left;
+        m_nRoiTop = top;
+        m_nRoiWidth = width;
+        m_nRoiHeight = height;
+    }
+
     bool PrepareDecompression();
     bool Decompress();
+    int FeedStream(const unsigned char *data, size_t len);
+    bool GetRestartIndex(size_t *scan_offset, unsigned int *restart_interval,
+                         const size_t **offsets, size_t *num_offsets);
+    bool DecompressBatch(hwjpeg_decompress_job jobs[], unsigned int num_jobs,
+                         hwjpeg_decompress_done_t done, void *priv);
 
     bool IsEnoughStreamBuffer() { return true; }
-};
-
-bool CLibhwjpegDecompressor::PrepareDecompression() {
-    if (!m_hwjpeg) {
-        ALOGE("device node is not opened!");
-        return false;
-    }
 
-    if ((scale_factor != 1) && (scale_factor != 2) && (scale_factor != 4) && (scale_factor != 8)) {
-        ALOGE("Invalid downscaling factor %d", scale_factor);
-        return false;
-    }
+private:
+    bool ParseStream(unsigned char *stream, size_t len);
+    bool ApplyFrameInfo(CJpegStreamParser &parser);
+    bool ConfigureOutput();
+    bool NeedPostProcess() { return (m_nRoiWidth != 0) || (m_nSWScaleFactor != 1); }
+    bool PreparePostProcess();
+    bool PostProcess(char *dst);
+    bool CompleteJobs(hwjpeg_decompress_job jobs[], unsigned int *head, unsigned int end,
+                      hwjpeg_decompress_done_t done, void *priv);
+};
 
-    if (m_pStreamBuffer == NULL) {
-        ALOGE("No stream buffer is configured");
-        return false;
-    }
+bool CLibhwjpegDecompressor::ParseStream(unsigned char *stream, size_t len) {
+    if (!m_jpegStreamParser.Parse(stream, len)) return false;
 
-    if (!m_jpegStreamParser.Parse(m_pStreamBuffer, m_nStreamLength)) return false;
+    return ApplyFrameInfo(m_jpegStreamParser);
+}
 
-    image_width = m_jpegStreamParser.GetWidth();
-    image_height = m_jpegStreamParser.GetHeight();
-    num_components = m_jpegStreamParser.GetNumComponents();
-    chroma_h_samp_factor = m_jpegStreamParser.m_iHorizontalFactor;
-    chroma_v_samp_factor = m_jpegStreamParser.m_iVerticalFactor;
+bool CLibhwjpegDecompressor::ApplyFrameInfo(CJpegStreamParser &parser) {
+    image_width = parser.GetWidth();
+    image_height = parser.GetHeight();
+    num_components = parser.GetNumComponents();
+    chroma_h_samp_factor = parser.m_iHorizontalFactor;
+    chroma_v_samp_factor = parser.m_iVerticalFactor;
 
     if (((image_width % (chroma_h_samp_factor * scale_factor)) != 0) ||
         ((image_height % (chroma_v_samp_factor * scale_factor)) != 0)) {
@@ -406,18 +297,198 @@ bool CLibhwjpegDecompressor::PrepareDecompression() {
 
     output_width = image_width / scale_factor;
     output_height = image_height / scale_factor;
+    m_nDecodedWidth = output_width;
+    m_nDecodedHeight = output_height;
+    m_nSWScaleFactor = 1;
 
+    return true;
+}
+
+bool CLibhwjpegDecompressor::ConfigureOutput() {
     if (!m_hwjpeg->SetStreamPixelSize(image_width, image_height)) {
         ALOGE("Failed to configure stream pixel size (%ux%u)", image_width, image_height);
         return false;
     }
 
-    if (!m_hwjpeg->SetImageFormat(output_format, output_width, output_height)) {
-        ALOGE("Failed to configure image format (%ux%u/%08X)", output_width, output_height,
+    if (!m_hwjpeg->SetImageFormat(output_format, m_nDecodedWidth, m_nDecodedHeight)) {
+        ALOGE("Failed to configure image format (%ux%u/%08X)", m_nDecodedWidth, m_nDecodedHeight,
               output_format);
         return false;
     }
 
+    return true;
+}
+
+// The number of bytes of a pixel of single-plane RGB and YUV422 formats. 0 for the others.
+static unsigned int GetPackedPixelBytes(__u32 fmt) {
+    switch (fmt) {
+        case V4L2_PIX_FMT_RGB32:
+        case V4L2_PIX_FMT_BGR32:
+            return 4;
+        case V4L2_PIX_FMT_RGB24:
+        case V4L2_PIX_FMT_BGR24:
+            return 3;
+        case V4L2_PIX_FMT_RGB565:
+        case V4L2_PIX_FMT_YUYV:
+        case V4L2_PIX_FMT_YVYU:
+        case V4L2_PIX_FMT_UYVY:
+        case V4L2_PIX_FMT_VYUY:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+static bool IsPackedYUV422(__u32 fmt) {
+    return (fmt == V4L2_PIX_FMT_YUYV) || (fmt == V4L2_PIX_FMT_YVYU) ||
+            (fmt == V4L2_PIX_FMT_UYVY) || (fmt == V4L2_PIX_FMT_VYUY);
+}
+
+static bool IsNV12(__u32 fmt) {
+    return (fmt == V4L2_PIX_FMT_NV12) || (fmt == V4L2_PIX_FMT_NV21);
+}
+
+bool CLibhwjpegDecompressor::PreparePostProcess() {
+    unsigned int bpp = GetPackedPixelBytes(output_format);
+
+    if ((scale_factor != 1) && !m_hwjpeg->IsDeviceCapability(V4L2_CAP_EXYNOS_JPEG_DOWNSCALING)) {
+        // Averaging bytes works only if every byte of a pixel is a separate component
+        if (bpp < 3) {
+            ALOGE("Downscaling of format %08X is not supported without HWJPEG downscaling",
+                  output_format);
+            return false;
+        }
+
+        m_nDecodedWidth = image_width;
+        m_nDecodedHeight = image_height;
+        m_nSWScaleFactor = scale_factor;
+    }
+
+    if (m_nRoiWidth != 0) {
+        if ((m_nRoiHeight == 0) || (m_nRoiLeft + m_nRoiWidth > output_width) ||
+            (m_nRoiTop + m_nRoiHeight > output_height)) {
+            ALOGE("Region %ux%u@(%u,%u) is out of the image %ux%u", m_nRoiWidth, m_nRoiHeight,
+                  m_nRoiLeft, m_nRoiTop, output_width, output_height);
+            return false;
+        }
+
+        bool odd_x = ((m_nRoiLeft | m_nRoiWidth) & 1) != 0;
+        bool odd_y = ((m_nRoiTop | m_nRoiHeight) & 1) != 0;
+        if ((bpp == 0) && !IsNV12(output_format)) {
+            ALOGE("Region is not supported for format %08X", output_format);
+            return false;
+        } else if ((IsPackedYUV422(output_format) && odd_x) ||
+                   (IsNV12(output_format) && (odd_x || odd_y))) {
+            ALOGE("Region %ux%u@(%u,%u) is not aligned to the chroma of format %08X",
+                  m_nRoiWidth, m_nRoiHeight, m_nRoiLeft, m_nRoiTop, output_format);
+            return false;
+        }
+
+        output_width = m_nRoiWidth;
+        output_height = m_nRoiHeight;
+    }
+
+    if (!NeedPostProcess()) return true;
+
+    // Enough for the padding of the image to MCU by the driver
+    size_t len = ROUND_UP(m_nDecodedWidth, 16) * ROUND_UP(m_nDecodedHeight, 16);
+    len = (bpp == 0) ? len * 3 / 2 : len * bpp;
+
+    if (m_nScratchLength < len) {
+        free(m_pScratchBuffer);
+        m_pScratchBuffer = reinterpret_cast<char *>(malloc(len));
+        if (m_pScratchBuffer == NULL) {
+            ALOGE("Failed to allocate %zu bytes for cropping or downscaling", len);
+            m_nScratchLength = 0;
+            return false;
+        }
+        m_nScratchLength = len;
+    }
+
+    return true;
+}
+
+// Copies the region and downscales by m_nSWScaleFactor from the scratch buffer to @dst
+bool CLibhwjpegDecompressor::PostProcess(char *dst) {
+    unsigned int bpp = GetPackedPixelBytes(output_format);
+    unsigned int factor = m_nSWScaleFactor;
+    size_t required = static_cast<size_t>(output_width) * output_height;
+    required = (bpp == 0) ? required * 3 / 2 : required * bpp;
+
+    if (m_nImageLength < required) {
+        ALOGE("Too small image buffer %zu bytes for %ux%u/%08X", m_nImageLength, output_width,
+              output_height, output_format);
+        return false;
+    }
+
+    if (bpp == 0) { // NV12 and NV21 without downscaling by CPU
+        const char *src = m_pScratchBuffer;
+        for (unsigned int y = 0; y < output_height; y++)
+            memcpy(dst + y * output_width,
+                   src + (m_nRoiTop + y) * m_nDecodedWidth + m_nRoiLeft, output_width);
+
+        src += m_nDecodedWidth * m_nDecodedHeight;
+        dst += output_width * output_height;
+        for (unsigned int y = 0; y < output_height / 2; y++)
+            memcpy(dst + y * output_width,
+                   src + (m_nRoiTop / 2 + y) * m_nDecodedWidth + m_nRoiLeft, output_width);
+
+        return true;
+    }
+
+    size_t src_stride = m_nDecodedWidth * bpp;
+    size_t dst_stride = output_width * bpp;
+
+    if (factor == 1) {
+        for (unsigned int y = 0; y < output_height; y++)
+            memcpy(dst + y * dst_stride,
+                   m_pScratchBuffer + (m_nRoiTop + y) * src_stride + m_nRoiLeft * bpp,
+                   dst_stride);
+        return true;
+    }
+
+    // Every output pixel is the average of the factor x factor pixels it covers
+    for (unsigned int y = 0; y < output_height; y++) {
+        const unsigned char *src = reinterpret_cast<unsigned char *>(m_pScratchBuffer) +
+                (m_nRoiTop + y) * factor * src_stride + m_nRoiLeft * factor * bpp;
+        unsigned char *out = reinterpret_cast<unsigned char *>(dst) + y * dst_stride;
+
+        for (unsigned int x = 0; x < output_width; x++) {
+            for (unsigned int c = 0; c < bpp; c++) {
+                unsigned int sum = 0;
+                for (unsigned int j = 0; j < factor; j++)
+                    for (unsigned int i = 0; i < factor; i++)
+                        sum += src[j * src_stride + i * bpp + c];
+                out[c] = static_cast<unsigned char>(sum / (factor * factor));
+            }
+            src += factor * bpp;
+            out += bpp;
+        }
+    }
+
+    return true;
+}
+
+bool CLibhwjpegDecompressor::PrepareDecompression() {
+    if (!m_hwjpeg) {
+        ALOGE("device node is not opened!");
+        return false;
+    }
+
+    if ((scale_factor != 1) && (scale_factor != 2) && (scale_factor != 4) && (scale_factor != 8)) {
+        ALOGE("Invalid downscaling factor %d", scale_factor);
+        return false;
+    }
+
+    if (m_pStreamBuffer == NULL) {
+        ALOGE("No stream buffer is configured");
+        return false;
+    }
+
+    if (!ParseStream(m_pStreamBuffer, m_nStreamLength) || !PreparePostProcess() ||
+        !ConfigureOutput())
+        return false;
+
     m_bPrepared = true;
 
     return true;
@@ -436,14 +507,190 @@ bool CLibhwjpegDecompressor::Decompress() {
 
     m_bPrepared = false;
 
+    if ((m_pImageBuffer == NULL) && (m_iImageBuffer < 0)) {
+        ALOGE("No image buffer is configured");
+        return false;
+    }
+
+    bool ret;
+    if (NeedPostProcess())
+        ret = m_hwjpeg->SetImageBuffer(m_pScratchBuffer, m_nScratchLength);
+    else if (m_pImageBuffer != NULL)
+        ret = m_hwjpeg->SetImageBuffer(m_pImageBuffer, m_nImageLength);
+    else
+        ret = m_hwjpeg->SetImageBuffer(m_iImageBuffer, m_nImageLength);
+    if (!ret) return false;
+
     if (!m_hwjpeg->Decompress(reinterpret_cast<char *>(m_pStreamBuffer), m_nStreamLength)) {
         ALOGE("Failed to decompress");
         return false;
     }
 
+    if (!NeedPostProcess()) return true;
+
+    if (m_pImageBuffer != NULL) return PostProcess(m_pImageBuffer);
+
+    char *dst = reinterpret_cast<char *>(
+            mmap(NULL, m_nImageLength, PROT_READ | PROT_WRITE, MAP_SHARED, m_iImageBuffer, 0));
+    if (dst == MAP_FAILED) {
+        ALOGERR("Failed to mmap %zu bytes of dmabuf fd %d", m_nImageLength, m_iImageBuffer);
+        return false;
+    }
+
+    ret = PostProcess(dst);
+
+    munmap(dst, m_nImageLength);
+
+    return ret;
+}
+
+int CLibhwjpegDecompressor::FeedStream(const unsigned char *data, size_t len) {
+    if (!m_hwjpeg) {
+        ALOGE("device node is not opened!");
+        return -1;
+    }
+
+    // The first chunk of a new stream
+    if (m_bFeedFailed || m_jpegStreamFeeder.IsComplete()) {
+        m_jpegStreamFeeder.Reset();
+        m_bFeedFailed = false;
+    }
+
+    bool found = m_jpegStreamFeeder.IsFrameFound();
+
+    if (!m_jpegStreamFeeder.Feed(data, len)) {
+        m_bFeedFailed = true;
+        return -1;
+    }
+
+    if (!m_jpegStreamFeeder.IsFrameFound()) return 0;
+
+    // Configure HWJPEG once, while the rest of the stream is read
+    if (!found) {
+        if ((scale_factor != 1) && (scale_factor != 2) && (scale_factor != 4) &&
+            (scale_factor != 8)) {
+            ALOGE("Invalid downscaling factor %d", scale_factor);
+            m_bFeedFailed = true;
+            return -1;
+        }
+
+        if (!ApplyFrameInfo(m_jpegStreamFeeder) || !PreparePostProcess() || !ConfigureOutput()) {
+            m_bFeedFailed = true;
+            return -1;
+        }
+    }
+
+    return m_jpegStreamFeeder.IsComplete() ? 2 : 1;
+}
+
+bool CLibhwjpegDecompressor::GetRestartIndex(size_t *scan_offset, unsigned int *restart_interval,
+                                             const size_t **offsets, size_t *num_offsets) {
+    if (!m_jpegStreamFeeder.IsComplete()) {
+        ALOGE("The stream is not completely fed");
+        return false;
+    }
+
+    *scan_offset = m_jpegStreamFeeder.GetScanOffset();
+    *restart_interval = m_jpegStreamFeeder.GetRestartInterval();
+    *offsets = m_jpegStreamFeeder.GetRestartOffsets().data();
+    *num_offsets = m_jpegStreamFeeder.GetRestartOffsets().size();
+
     return true;
 }
 
+// Waits for the jobs from *head to end in the queue order and reports them to @done
+bool CLibhwjpegDecompressor::CompleteJobs(hwjpeg_decompress_job jobs[], unsigned int *head,
+                                          unsigned int end, hwjpeg_decompress_done_t done,
+                                          void *priv) {
+    bool ret = true;
+
+    // The jobs that are no longer in flight are cancelled by a failure of queueing
+    for (; (end - *head) > m_hwjpeg->GetNumInFlight(); (*head)++) {
+        done(&jobs[*head], false, priv);
+        ret = false;
+    }
+
+    for (; *head < end; (*head)++) {
+        bool success = m_hwjpeg->WaitForDecompression();
+        done(&jobs[*head], success, priv);
+        ret = ret && success;
+    }
+
+    return ret;
+}
+
+bool CLibhwjpegDecompressor::DecompressBatch(hwjpeg_decompress_job jobs[], unsigned int num_jobs,
+                                             hwjpeg_decompress_done_t done, void *priv) {
+    if (!m_hwjpeg) {
+        ALOGE("device node is not opened!");
+        return false;
+    }
+
+    if ((scale_factor != 1) && (scale_factor != 2) && (scale_factor != 4) && (scale_factor != 8)) {
+        ALOGE("Invalid downscaling factor %d", scale_factor);
+        return false;
+    }
+
+    if ((m_nRoiWidth != 0) ||
+        ((scale_factor != 1) && !m_hwjpeg->IsDeviceCapability(V4L2_CAP_EXYNOS_JPEG_DOWNSCALING))) {
+        ALOGE("Region or downscaling by CPU is not supported for batch decompression");
+        return false;
+    }
+
+    // Pending results of a previous hwjpeg_start_decompress() are not for the jobs
+    m_bPrepared = false;
+
+    bool ret = true;
+    unsigned int head = 0; // the oldest job that is not reported yet
+    unsigned int cur_width = 0, cur_height = 0;
+    bool cur_dmabuf = false;
+
+    for (unsigned int i = 0; i < num_jobs; i++) {
+        hwjpeg_decompress_job *job = &jobs[i];
+        bool dmabuf = job->outfd >= 0;
+
+        if (!ParseStream(job->inbuffer, job->insize)) {
+            ret = CompleteJobs(jobs, &head, i, done, priv) && ret;
+            done(job, false, priv);
+            head = i + 1;
+            ret = false;
+            continue;
+        }
+
+        job->output_width = output_width;
+        job->output_height = output_height;
+
+        // HWJPEG refuses to change the image format or the buffer type with jobs in flight
+        if ((head < i) && ((output_width != cur_width) || (output_height != cur_height) ||
+                           (dmabuf != cur_dmabuf)))
+            ret = CompleteJobs(jobs, &head, i, done, priv) && ret;
+
+        cur_width = output_width;
+        cur_height = output_height;
+        cur_dmabuf = dmabuf;
+
+        if ((i - head) >= m_hwjpeg->GetMaxInFlight())
+            ret = CompleteJobs(jobs, &head, i - m_hwjpeg->GetMaxInFlight() + 1, done, priv) && ret;
+
+        bool queued = ConfigureOutput();
+        if (queued)
+            queued = dmabuf ? m_hwjpeg->SetImageBuffer(job->outfd, job->outsize)
+                            : m_hwjpeg->SetImageBuffer(reinterpret_cast<char *>(job->outbuffer),
+                                                       job->outsize);
+        if (queued)
+            queued = m_hwjpeg->QueueDecompress(reinterpret_cast<char *>(job->inbuffer),
+                                               job->insize);
+        if (!queued) {
+            ret = CompleteJobs(jobs, &head, i, done, priv) && ret;
+            done(job, false, priv);
+            head = i + 1;
+            ret = false;
+        }
+    }
+
+    return CompleteJobs(jobs, &head, num_jobs, done, priv) && ret;
+}
+
 hwjpeg_decompress_ptr hwjpeg_create_decompress() {
     hwjpeg_decompress_ptr p = new CLibhwjpegDecompressor();
     if (!p) ALOGE("Failed to create decompress struct");
@@ -505,3 +752,27 @@ bool hwjpeg_has_enough_stream_buffer(hwjpeg_decompress_ptr cinfo) {
     CLibhwjpegDecompressor *decomp = reinterpret_cast<CLibhwjpegDecompressor *>(cinfo);
     return decomp->IsEnoughStreamBuffer();
 }
+
+bool hwjpeg_decompress_batch(hwjpeg_decompress_ptr cinfo, hwjpeg_decompress_job jobs[],
+                             unsigned int num_jobs, hwjpeg_decompress_done_t done, void *priv) {
+    CLibhwjpegDecompressor *decomp = reinterpret_cast<CLibhwjpegDecompressor *>(cinfo);
+    return decomp->DecompressBatch(jobs, num_jobs, done, priv);
+}
+
+void hwjpeg_set_roi(hwjpeg_decompress_ptr cinfo, unsigned int left, unsigned int top,
+                    unsigned int width, unsigned int height) {
+    CLibhwjpegDecompressor *decomp = reinterpret_cast<CLibhwjpegDecompressor *>(cinfo);
+    decomp->SetRegion(left, top, width, height);
+}
+
+int hwjpeg_feed_stream(hwjpeg_decompress_ptr cinfo, const unsigned char *data, size_t len) {
+    CLibhwjpegDecompressor *decomp = reinterpret_cast<CLibhwjpegDecompressor *>(cinfo);
+    return decomp->FeedStream(data, len);
+}
+
+bool hwjpeg_get_restart_index(hwjpeg_decompress_ptr cinfo, size_t *scan_offset,
+                              unsigned int *restart_interval, const size_t **offsets,
+                              size_t *num_offsets) {
+    CLibhwjpegDecompressor *decomp = reinterpret_cast<CLibhwjpegDecompressor *>(cinfo);
+    return decomp->GetRestartIndex(scan_offset, restart_interval, offsets, num_offsets);
+}
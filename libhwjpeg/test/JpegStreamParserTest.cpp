@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "JpegStreamParser.h"
+
+namespace {
+
+using Stream = std::vector<unsigned char>;
+
+void Append(Stream *stream, std::initializer_list<unsigned char> bytes) {
+    stream->insert(stream->end(), bytes);
+}
+
+// Appends a segment of @marker with @payload after its length field
+void AppendSegment(Stream *stream, unsigned char marker, const Stream &payload) {
+    size_t len = payload.size() + 2;
+    Append(stream, {0xFF, marker, static_cast<unsigned char>(len >> 8),
+                    static_cast<unsigned char>(len & 0xFF)});
+    stream->insert(stream->end(), payload.begin(), payload.end());
+}
+
+Stream MakeFrameHeader(unsigned int width, unsigned int height, unsigned char components,
+                       unsigned char luma_factor) {
+    Stream sof = {8,
+                  static_cast<unsigned char>(height >> 8),
+                  static_cast<unsigned char>(height & 0xFF),
+                  static_cast<unsigned char>(width >> 8),
+                  static_cast<unsigned char>(width & 0xFF),
+                  components};
+    for (unsigned char i = 0; i < components; i++)
+        Append(&sof, {static_cast<unsigned char>(i + 1),
+                      static_cast<unsigned char>((i == 0) ? luma_factor : 0x11),
+                      static_cast<unsigned char>(i ? 1 : 0)});
+    return sof;
+}
+
+struct TestStream {
+    Stream data;
+    size_t dqt;
+    size_t dht;
+    size_t scan;
+    std::vector<size_t> restarts;
+    size_t eoi;
+};
+
+// A 640x480 YUV420 stream with a restart interval of 4 and two restart markers
+TestStream MakeStream() {
+    TestStream s;
+    Append(&s.data, {0xFF, 0xD8});
+    AppendSegment(&s.data, 0xE0, Stream(14, 0)); // APP0
+    s.dqt = s.data.size();
+    AppendSegment(&s.data, 0xDB, Stream(65, 1));
+    AppendSegment(&s.data, 0xC0, MakeFrameHeader(640, 480, 3, 0x22));
+    s.dht = s.data.size();
+    AppendSegment(&s.data, 0xC4, Stream(29, 2));
+    AppendSegment(&s.data, 0xDD, {0x00, 0x04});
+    AppendSegment(&s.data, 0xDA, {3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0});
+    s.scan = s.data.size();
+    // entropy-coded data with stuffed zero bytes and fill bytes
+    Append(&s.data, {0x12, 0xFF, 0x00, 0x34, 0x56});
+    s.restarts.push_back(s.data.size());
+    Append(&s.data, {0xFF, 0xD0, 0x78, 0xFF, 0x00});
+    s.restarts.push_back(s.data.size() + 1);
+    Append(&s.data, {0xFF, 0xFF, 0xD1, 0x9A});
+    s.eoi = s.data.size();
+    Append(&s.data, {0xFF, 0xD9});
+    return s;
+}
+
+void ExpectStream(CJpegStreamParser &parser, const TestStream &s) {
+    EXPECT_TRUE(parser.IsFrameFound());
+    EXPECT_TRUE(parser.IsScanFound());
+    EXPECT_TRUE(parser.IsComplete());
+    EXPECT_EQ(parser.GetWidth(), 640u);
+    EXPECT_EQ(parser.GetHeight(), 480u);
+    EXPECT_EQ(parser.GetNumComponents(), 3u);
+    EXPECT_EQ(parser.m_iHorizontalFactor, 2);
+    EXPECT_EQ(parser.m_iVerticalFactor, 2);
+    EXPECT_EQ(parser.GetRestartInterval(), 4u);
+    EXPECT_EQ(parser.GetDQTOffsets(), std::vector<size_t>{s.dqt});
+    EXPECT_EQ(parser.GetDHTOffsets(), std::vector<size_t>{s.dht});
+    EXPECT_EQ(parser.GetScanOffset(), s.scan);
+    EXPECT_EQ(parser.GetRestartOffsets(), s.restarts);
+    EXPECT_EQ(parser.GetEOIOffset(), s.eoi);
+}
+
+bool FeedInChunks(CJpegStreamParser &parser, const Stream &data, size_t chunk) {
+    parser.Reset();
+    for (size_t pos = 0; pos < data.size(); pos += chunk) {
+        if (!parser.Feed(data.data() + pos, std::min(chunk, data.size() - pos))) return false;
+    }
+    return true;
+}
+
+TEST(JpegStreamParserTest, ParseStopsAtFrameHeader) {
+    TestStream s = MakeStream();
+    CJpegStreamParser parser;
+
+    ASSERT_TRUE(parser.Parse(s.data.data(), s.data.size()));
+    EXPECT_TRUE(parser.IsFrameFound());
+    EXPECT_FALSE(parser.IsScanFound());
+    EXPECT_EQ(parser.GetWidth(), 640u);
+    EXPECT_EQ(parser.GetHeight(), 480u);
+    EXPECT_EQ(parser.m_iHorizontalFactor, 2);
+    EXPECT_EQ(parser.m_iVerticalFactor, 2);
+}
+
+TEST(JpegStreamParserTest, FeedFindsSegmentsInAnyChunkSize) {
+    TestStream s = MakeStream();
+    CJpegStreamParser parser;
+
+    for (size_t chunk : {size_t(1), size_t(2), size_t(3), size_t(7), s.data.size()}) {
+        SCOPED_TRACE(chunk);
+        ASSERT_TRUE(FeedInChunks(parser, s.data, chunk));
+        ExpectStream(parser, s);
+    }
+}
+
+TEST(JpegStreamParserTest, FrameIsFoundBeforeTheStreamEnds) {
+    TestStream s = MakeStream();
+    CJpegStreamParser parser;
+
+    // SOI, APP0, DQT and SOF0
+    size_t sof_end = s.dht;
+    ASSERT_TRUE(parser.Feed(s.data.data(), sof_end - 1));
+    EXPECT_FALSE(parser.IsFrameFound());
+    ASSERT_TRUE(parser.Feed(s.data.data() + sof_end - 1, 1));
+    EXPECT_TRUE(parser.IsFrameFound());
+    EXPECT_FALSE(parser.IsComplete());
+
+    ASSERT_TRUE(parser.Feed(s.data.data() + sof_end, s.data.size() - sof_end));
+    ExpectStream(parser, s);
+}
+
+TEST(JpegStreamParserTest, BytesAfterEOIAreIgnored) {
+    TestStream s = MakeStream();
+    Append(&s.data, {0x00, 0xFF, 0x12});
+    CJpegStreamParser parser;
+
+    ASSERT_TRUE(FeedInChunks(parser, s.data, 1));
+    ExpectStream(parser, s);
+}
+
+TEST(JpegStreamParserTest, IncompleteStreamIsNotParsed) {
+    TestStream s = MakeStream();
+    CJpegStreamParser parser;
+
+    EXPECT_FALSE(parser.Parse(s.data.data(), s.dht - 1));
+    EXPECT_FALSE(parser.IsFrameFound());
+}
+
+class JpegStreamParserRejectTest : public ::testing::Test {
+protected:
+    bool Parse(Stream data) {
+        CJpegStreamParser parser;
+        return FeedInChunks(parser, data, 1);
+    }
+};
+
+TEST_F(JpegStreamParserRejectTest, NoSOI) {
+    Stream data = {0xFF, 0xD9};
+    EXPECT_FALSE(Parse(data));
+}
+
+TEST_F(JpegStreamParserRejectTest, ProgressiveFrame) {
+    Stream data = {0xFF, 0xD8};
+    AppendSegment(&data, 0xC2, MakeFrameHeader(640, 480, 3, 0x22));
+    EXPECT_FALSE(Parse(data));
+}
+
+TEST_F(JpegStreamParserRejectTest, GrayscaleFrame) {
+    Stream data = {0xFF, 0xD8};
+    AppendSegment(&data, 0xC0, MakeFrameHeader(640, 480, 1, 0x11));
+    EXPECT_FALSE(Parse(data));
+}
+
+TEST_F(JpegStreamParserRejectTest, InvalidSamplingFactor) {
+    Stream data = {0xFF, 0xD8};
+    AppendSegment(&data, 0xC0, MakeFrameHeader(640, 480, 3, 0x41));
+    EXPECT_FALSE(Parse(data));
+}
+
+TEST_F(JpegStreamParserRejectTest, TooSmallImage) {
+    Stream data = {0xFF, 0xD8};
+    AppendSegment(&data, 0xC0, MakeFrameHeader(4, 480, 3, 0x22));
+    EXPECT_FALSE(Parse(data));
+}
+
+TEST_F(JpegStreamParserRejectTest, MultipleFrameHeaders) {
+    Stream data = {0xFF, 0xD8};
+    AppendSegment(&data, 0xC0, MakeFrameHeader(640, 480, 3, 0x22));
+    AppendSegment(&data, 0xC0, MakeFrameHeader(640, 480, 3, 0x22));
+    EXPECT_FALSE(Parse(data));
+}
+
+TEST_F(JpegStreamParserRejectTest, ScanBeforeFrameHeader) {
+    Stream data = {0xFF, 0xD8};
+    AppendSegment(&data, 0xDA, {3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0});
+    EXPECT_FALSE(Parse(data));
+}
+
+TEST_F(JpegStreamParserRejectTest, EOIBeforeScan) {
+    Stream data = {0xFF, 0xD8};
+    AppendSegment(&data, 0xC0, MakeFrameHeader(640, 480, 3, 0x22));
+    Append(&data, {0xFF, 0xD9});
+    EXPECT_FALSE(Parse(data));
+}
+
+TEST_F(JpegStreamParserRejectTest, RestartMarkerOutOfScan) {
+    Stream data = {0xFF, 0xD8, 0xFF, 0xD0};
+    EXPECT_FALSE(Parse(data));
+}
+
+TEST_F(JpegStreamParserRejectTest, InvalidSegmentLength) {
+    Stream data = {0xFF, 0xD8, 0xFF, 0xDB, 0x00, 0x01};
+    EXPECT_FALSE(Parse(data));
+}
+
+TEST_F(JpegStreamParserRejectTest, TooLargeSegmentToCopy) {
+    Stream data = {0xFF, 0xD8};
+    AppendSegment(&data, 0xDD, Stream(100, 0));
+    EXPECT_FALSE(Parse(data));
+}
+
+TEST_F(JpegStreamParserRejectTest, GarbageBetweenSegments) {
+    Stream data = {0xFF, 0xD8, 0x12};
+    EXPECT_FALSE(Parse(data));
+}
+
+} // namespace
@@ -23,7 +23,8 @@ LOCAL_EXPORT_C_INCLUDE_DIRS := $(LOCAL_PATH)/include
 
 LOCAL_C_INCLUDES := $(LOCAL_PATH)/include
 
-LOCAL_SRC_FILES := libscaler.cpp libscaler-v4l2.cpp libscalerblend-v4l2.cpp libscaler-m2m1shot.cpp libscaler-swscaler.cpp
+LOCAL_SRC_FILES := libscaler.cpp libscaler-v4l2.cpp libscalerblend-v4l2.cpp libscaler-m2m1shot.cpp libscaler-swscaler.cpp \
+	libscaler-mapcache.cpp libscaler-jobqueue.cpp libscalerblend-graph.cpp
 ifeq ($(BOARD_USES_SCALER_M2M1SHOT), true)
 LOCAL_CFLAGS += -DSCALER_USE_M2M1SHOT
 endif
@@ -43,3 +44,29 @@ ifeq ($(BOARD_USES_VENDORIMAGE), true)
 endif
 
 include $(BUILD_SHARED_LIBRARY)
+
+include $(CLEAR_VARS)
+
+LOCAL_SHARED_LIBRARIES := liblog libutils libcutils
+LOCAL_HEADER_LIBRARIES := libcutils_headers libsystem_headers libhardware_headers google_hal_headers
+
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/include $(LOCAL_PATH)
+
+LOCAL_SRC_FILES := libscaler-mapcache.cpp libscaler-swscaler.cpp libscaler-jobqueue.cpp \
+	libscalerblend-graph.cpp \
+	test/BlendGraphTest.cpp \
+	test/JobQueueTest.cpp \
+	test/MapCacheTest.cpp \
+	test/SWScalerTest.cpp
+
+LOCAL_MODULE_TAGS := optional
+LOCAL_MODULE := libexynosscaler_test
+LOCAL_LICENSE_KINDS := SPDX-license-identifier-Apache-2.0
+LOCAL_LICENSE_CONDITIONS := notice
+LOCAL_NOTICE_FILE := $(LOCAL_PATH)/NOTICE
+
+ifeq ($(BOARD_USES_VENDORIMAGE), true)
+    LOCAL_PROPRIETARY_MODULE := true
+endif
+
+include $(BUILD_NATIVE_TEST)
@@ -160,6 +160,23 @@ struct SrcBlendInfo {
 	struct CSC_Spec cscspec;
 };
 
+/*
+ * An overlay layer to be blended by exynos_sc_config_blend_layers().
+ * Position, size and stride are in the same units as SrcBlendInfo.
+ */
+struct exynos_sc_blend_layer {
+	int fd;                 /* dmabuf of the overlay */
+	unsigned int fmt;       /* HAL pixel format */
+	unsigned int hpos;
+	unsigned int vpos;
+	unsigned int width;
+	unsigned int height;
+	unsigned int stride;    /* in pixels */
+	unsigned int premulti;
+	enum SRC_BL_OP blop;
+	struct SrcGlobalAlpha globalalpha;
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -455,6 +472,161 @@ int exynos_sc_config_blend_exclusive(
     exynos_sc_img *dst_img,
     struct SrcBlendInfo  *srcblendinfo);
 
+/*!
+ * Create a pool of overlay buffers for exynos_sc_config_blend_layers()
+ *
+ * \ingroup exynos_scaler
+ *
+ * \return
+ *   blend graph handle, or NULL on failure
+ */
+void *exynos_sc_create_blend_graph(void);
+
+void exynos_sc_destroy_blend_graph(
+    void *graph);
+
+/*!
+ * Add a dmabuf to the pool of a blend graph. Several layers are flattened to
+ * a buffer of the pool that is large enough for 4 bytes per pixel of their
+ * bounding rectangle.
+ *
+ * \ingroup exynos_scaler
+ *
+ * \param graph
+ *   blend graph handle [in]
+ *
+ * \param fd
+ *   dmabuf owned by the caller until the graph is destroyed [in]
+ *
+ * \param len
+ *   size of the dmabuf in bytes [in]
+ *
+ * \return
+ *   error code
+ */
+int exynos_sc_add_blend_graph_buffer(
+    void *graph,
+    int fd,
+    size_t len);
+
+/*!
+ * Plan the blending of several layers onto the source image into passes of
+ * the source blending.
+ *
+ * A single visible layer is blended directly from its buffer. Consecutive
+ * layers blended with SRC_BL_OP_SRC_OVER in RGBA_8888 or BGRA_8888 are
+ * flattened into a buffer of the pool of the graph and blended in one pass.
+ * Any other layer takes a pass of its own. The plan replaces the previous
+ * plan of the graph.
+ *
+ * \ingroup exynos_scaler
+ *
+ * \param graph
+ *   blend graph handle [in]
+ *
+ * \param layers
+ *   layers to blend, the first one at the bottom [in]
+ *
+ * \param num_passes
+ *   number of passes of the plan [out]
+ *
+ * \return
+ *   error code
+ */
+int exynos_sc_plan_blend_layers(
+    void *graph,
+    const struct exynos_sc_blend_layer *layers,
+    unsigned int num_layers,
+    unsigned int *num_passes);
+
+/*!
+ * Configure the source blending of a blend handle for a pass of the plan of
+ * exynos_sc_plan_blend_layers().
+ *
+ * The passes should run in order. A pass blends onto the result of the
+ * previous one: the destination of a pass is the source image of the next
+ * one, so the destinations of all passes but the last are frames of the
+ * format and the size of the source image owned by the caller. Only the last
+ * pass should scale, so that the positions of the layers stay in the
+ * coordinates of the source image.
+ *
+ * \ingroup exynos_scaler
+ *
+ * \param pass
+ *   index of the pass. Starts from 0 [in]
+ *
+ * \param cscspec
+ *   color space conversion of the overlay. Can be NULL [in]
+ *
+ * \param blend_fd
+ *   dmabuf of the overlay to be given to the source blending [out]
+ *
+ * \return
+ *   error code
+ */
+int exynos_sc_config_blend_pass(
+    void *handle,
+    void *graph,
+    unsigned int pass,
+    exynos_sc_img *src_img,
+    exynos_sc_img *dst_img,
+    struct CSC_Spec *cscspec,
+    int *blend_fd);
+
+/*!
+ * Configure the source blending of a blend handle to blend several layers
+ * onto the source image in one pass. Fails if the layers need more passes,
+ * see exynos_sc_plan_blend_layers().
+ *
+ * \ingroup exynos_scaler
+ *
+ * \param layers
+ *   layers to blend, the first one at the bottom [in]
+ *
+ * \param cscspec
+ *   color space conversion of the overlay. Can be NULL [in]
+ *
+ * \param blend_fd
+ *   dmabuf of the overlay to be given to the source blending [out]
+ *
+ * \return
+ *   error code
+ */
+int exynos_sc_config_blend_layers(
+    void *handle,
+    void *graph,
+    exynos_sc_img *src_img,
+    exynos_sc_img *dst_img,
+    const struct exynos_sc_blend_layer *layers,
+    unsigned int num_layers,
+    struct CSC_Spec *cscspec,
+    int *blend_fd);
+
+/*!
+ * Return the overlay from exynos_sc_config_blend_layers() or
+ * exynos_sc_config_blend_pass() to the pool after its pass is done. An overlay
+ * that is not from the pool is ignored.
+ *
+ * \ingroup exynos_scaler
+ */
+void exynos_sc_put_blend_graph_buffer(
+    void *graph,
+    int blend_fd);
+
+/*!
+ * Drop the CPU mappings that the S/W scaling and blending paths keep of a
+ * dmabuf. A mapping holds a reference to the dmabuf, so call this before
+ * freeing a buffer given to a frame that was scaled or blended by the CPU.
+ * Mappings not invalidated are dropped once they are not used for a while.
+ *
+ * \ingroup exynos_scaler
+ *
+ * \param fd
+ *   dmabuf to be freed by the caller [in]
+ */
+void exynos_sc_invalidate_buffer(
+    int fd);
+
 int exynos_sc_wait_frame_done_exclusive
 (void *handle);
 
@@ -531,6 +703,136 @@ bool exynos_sc_copy_pixels(
     struct exynos_sc_pxinfo *pxinfo,
     int dev_num);
 
+/*!
+ * Completion of a pixel copy queued by exynos_sc_queue_copy_pixels()
+ *
+ * \ingroup exynos_scaler
+ *
+ * \param pxinfo
+ *   information for pixel data copy given to exynos_sc_queue_copy_pixels() [in]
+ *
+ * \param success
+ *   false if the copy failed [in]
+ *
+ * \param priv
+ *   priv given to exynos_sc_queue_copy_pixels() [in]
+ */
+typedef void (*exynos_sc_copy_done_t)(struct exynos_sc_pxinfo *pxinfo, bool success, void *priv);
+
+/*!
+ * Capabilities of a H/W that runs pixel copies queued by exynos_sc_queue_copy_pixels()
+ *
+ * \ingroup exynos_scaler
+ */
+#define EXYNOS_SC_COPY_FMT(pxfmt) (1U << ((pxfmt) - EXYNOS_SC_FMT_RGB32))
+
+struct exynos_sc_copy_caps {
+    unsigned int formats;        // EXYNOS_SC_COPY_FMT() of each supported pxfmt
+    unsigned int max_downscale;  // 1 if downscaling is not supported
+    unsigned int max_upscale;    // 1 if upscaling is not supported
+    unsigned int min_src_width;  // of the source crop
+    unsigned int min_src_height;
+    unsigned int min_dst_width;  // of the destination crop
+    unsigned int min_dst_height;
+    bool rotate;                 // 90 and 270 degree rotations are supported
+};
+
+/*!
+ * H/W that runs pixel copies queued by exynos_sc_queue_copy_pixels()
+ *
+ * \ingroup exynos_scaler
+ */
+struct exynos_sc_copy_backend {
+    const char *name;            // unique name of the H/W instance
+    struct exynos_sc_copy_caps caps;
+    // runs the pixel copy of pxinfo. Called on the worker thread of the backend only
+    bool (*run)(void *priv, struct exynos_sc_pxinfo *pxinfo);
+    void *priv;                  // argument to run
+};
+
+/*!
+ * Add a H/W to the process-wide queue of pixel copies
+ *
+ * \ingroup exynos_scaler
+ *
+ * \param backend
+ *   description of the H/W. It is copied [in]
+ *
+ * \return
+ *   false if the description is invalid. Adding a backend with the same name
+ *   again has no effect.
+ */
+bool exynos_sc_add_copy_backend(
+    const struct exynos_sc_copy_backend *backend);
+
+/*!
+ * Add a Scaler H/W instance to the process-wide queue of pixel copies
+ *
+ * \ingroup exynos_scaler
+ *
+ * \param dev_num
+ *   Scaler H/W instance number. Starts from 0 [in]
+ *
+ * \return
+ *   false if the instance cannot be opened.
+ */
+bool exynos_sc_add_copy_device(
+    int dev_num);
+
+/*!
+ * Queue a pixel copy to the least loaded H/W in the queue that supports it
+ *
+ * \ingroup exynos_scaler
+ *
+ * \param pxinfo
+ *   information for pixel data copy. It should be valid until done is called [in]
+ *
+ * \param done
+ *   called on a worker thread of the queue when the copy is finished. Can be NULL [in]
+ *
+ * \param priv
+ *   argument to done [in]
+ *
+ * \param token
+ *   groups the copy with the other copies queued with the same token for
+ *   exynos_sc_wait_copy_pixels(). Any value, e.g. the address of an object of
+ *   the caller [in]
+ *
+ * \return
+ *   false if no H/W in the queue supports the copy.
+ */
+bool exynos_sc_queue_copy_pixels(
+    struct exynos_sc_pxinfo *pxinfo,
+    exynos_sc_copy_done_t done,
+    void *priv,
+    const void *token);
+
+/*!
+ * Wait for the pixel copies queued with token to finish
+ *
+ * \ingroup exynos_scaler
+ *
+ * \param token
+ *   token given to exynos_sc_queue_copy_pixels(). The copies may be queued by
+ *   any thread [in]
+ */
+void exynos_sc_wait_copy_pixels(
+    const void *token);
+
+/*!
+ * Convert a pixel format for pixel copy to V4L2
+ *
+ * \ingroup exynos_scaler
+ *
+ * \param pxfmt
+ *   enum SC_FMT_PXINFO [in]
+ *
+ * \return
+ *   V4L2 pixel format or 0 if pxfmt is unknown.
+ */
+unsigned int exynos_sc_pxfmt_to_v4l2(
+    unsigned int pxfmt);
+
 int hal_pixfmt_to_v4l2(int hal_pixel_format);
 
 #ifdef __cplusplus
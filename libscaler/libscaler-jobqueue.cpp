@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "libscaler-jobqueue.h"
+
+CScalerJobQueue &CScalerJobQueue::Instance()
+{
+    static CScalerJobQueue *queue = new CScalerJobQueue();
+    return *queue;
+}
+
+CScalerJobQueue::~CScalerJobQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bStop = true;
+    }
+    m_cond.notify_all();
+
+    for (auto &dev : m_devices)
+        dev->worker.join();
+}
+
+static bool SupportsFormat(const struct exynos_sc_copy_caps &caps, unsigned int pxfmt)
+{
+    if ((pxfmt < EXYNOS_SC_FMT_RGB32) || (pxfmt - EXYNOS_SC_FMT_RGB32 >= 32))
+        return false;
+
+    return (caps.formats & (1U << (pxfmt - EXYNOS_SC_FMT_RGB32))) != 0;
+}
+
+static bool SupportsScale(unsigned int src, unsigned int dst,
+                          unsigned int max_downscale, unsigned int max_upscale)
+{
+    if (src > dst)
+        return src <= static_cast<unsigned long>(dst) * max_downscale;
+
+    return dst <= static_cast<unsigned long>(src) * max_upscale;
+}
+
+bool CScalerJobQueue::Supports(const struct exynos_sc_copy_caps &caps,
+                               const struct exynos_sc_pxinfo &pxinfo)
+{
+    if (!SupportsFormat(caps, pxinfo.src.pxfmt) || !SupportsFormat(caps, pxinfo.dst.pxfmt))
+        return false;
+
+    if ((pxinfo.rotate % 90) != 0)
+        return false;
+
+    bool rot90 = (pxinfo.rotate % 180) != 0;
+    if (rot90 && !caps.rotate)
+        return false;
+
+    if ((pxinfo.src.crop_width < caps.min_src_width) ||
+            (pxinfo.src.crop_height < caps.min_src_height) ||
+            (pxinfo.dst.crop_width < caps.min_dst_width) ||
+            (pxinfo.dst.crop_height < caps.min_dst_height))
+        return false;
+
+    unsigned int dst_width = rot90 ? pxinfo.dst.crop_height : pxinfo.dst.crop_width;
+    unsigned int dst_height = rot90 ? pxinfo.dst.crop_width : pxinfo.dst.crop_height;
+
+    return SupportsScale(pxinfo.src.crop_width, dst_width, caps.max_downscale, caps.max_upscale) &&
+           SupportsScale(pxinfo.src.crop_height, dst_height, caps.max_downscale, caps.max_upscale);
+}
+
+bool CScalerJobQueue::AddBackend(const struct exynos_sc_copy_backend &backend)
+{
+    if ((backend.name == NULL) || (backend.run == NULL) ||
+            (backend.caps.max_downscale == 0) || (backend.caps.max_upscale == 0)) {
+        SC_LOGE("Invalid copy backend '%s'", backend.name ? backend.name : "");
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto &dev : m_devices) {
+        if (dev->name == backend.name)
+            return true;
+    }
+
+    std::unique_ptr<Device> dev(new Device());
+    dev->name = backend.name;
+    dev->backend = backend;
+    dev->backend.name = dev->name.c_str();
+    dev->load = 0;
+
+    dev->worker = std::thread(&CScalerJobQueue::Worker, this, dev.get());
+    m_devices.push_back(std::move(dev));
+
+    return true;
+}
+
+bool CScalerJobQueue::HasBackend(const char *name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto &dev : m_devices) {
+        if (dev->name == name)
+            return true;
+    }
+
+    return false;
+}
+
+bool CScalerJobQueue::Queue(struct exynos_sc_pxinfo *pxinfo,
+                            exynos_sc_copy_done_t done, void *priv, const void *token)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Device *target = NULL;
+    for (auto &dev : m_devices) {
+        if (!Supports(dev->backend.caps, *pxinfo))
+            continue;
+        if ((target == NULL) || (dev->load < target->load))
+            target = dev.get();
+    }
+
+    if (target == NULL) {
+        SC_LOGE("No H/W in the job queue supports the copy of %ux%u (fmt %#x) to %ux%u (fmt %#x)",
+                pxinfo->src.crop_width, pxinfo->src.crop_height, pxinfo->src.pxfmt,
+                pxinfo->dst.crop_width, pxinfo->dst.crop_height, pxinfo->dst.pxfmt);
+        return false;
+    }
+
+    unsigned long cost =
+        static_cast<unsigned long>(pxinfo->src.crop_width) * pxinfo->src.crop_height +
+        static_cast<unsigned long>(pxinfo->dst.crop_width) * pxinfo->dst.crop_height;
+
+    target->jobs.push_back({pxinfo, done, priv, cost, token});
+    target->load += cost;
+    m_pending[token]++;
+
+    m_cond.notify_all();
+
+    return true;
+}
+
+void CScalerJobQueue::WaitIdle(const void *token)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condIdle.wait(lock, [this, token] { return m_pending.count(token) == 0; });
+}
+
+void CScalerJobQueue::Worker(Device *dev)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+        m_cond.wait(lock, [this, dev] { return m_bStop || !dev->jobs.empty(); });
+        if (dev->jobs.empty())
+            return;
+
+        std::deque<Job> jobs;
+        jobs.swap(dev->jobs);
+
+        for (auto &job : jobs) {
+            lock.unlock();
+            bool success = dev->backend.run(dev->backend.priv, job.pxinfo);
+            SC_LOGE_IF(!success, "Failed to copy pixels on %s", dev->name.c_str());
+            if (job.done)
+                job.done(job.pxinfo, success, job.priv);
+            lock.lock();
+
+            dev->load -= job.cost;
+            if (--m_pending[job.token] == 0)
+                m_pending.erase(job.token);
+            m_condIdle.notify_all();
+        }
+    }
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __LIBSCALER_JOBQUEUE_H__
+#define __LIBSCALER_JOBQUEUE_H__
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <exynos_scaler.h>
+
+#include "libscaler-common.h"
+
+/*
+ * Process-wide queue of pixel copy jobs over the H/W backends added to it.
+ *
+ * Each backend is driven by its own worker thread. A job goes to the backend
+ * with the least pending work among the backends whose capabilities cover the
+ * job. The work is measured in the pixels of the jobs queued to a backend, so
+ * the users of the queue share the H/W without knowing about each other. A
+ * worker takes all the jobs queued to it at once and runs them back to back.
+ * Jobs complete in the order they are queued to a backend, but not across
+ * backends.
+ *
+ * Jobs are grouped by the token given to Queue(), so that WaitIdle() waits for
+ * the jobs of a client regardless of the thread that queued them.
+ *
+ * The queue of Instance() is never destroyed, so that its workers are not
+ * joined while the process runs the static destructors.
+ */
+class CScalerJobQueue {
+    struct Job {
+        struct exynos_sc_pxinfo *pxinfo;
+        exynos_sc_copy_done_t done;
+        void *priv;
+        unsigned long cost;
+        const void *token;
+    };
+
+    struct Device {
+        std::string name;
+        struct exynos_sc_copy_backend backend;
+        std::deque<Job> jobs;
+        unsigned long load; // pixels of the queued and the running jobs
+        std::thread worker;
+    };
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;     // jobs are queued
+    std::condition_variable m_condIdle; // a job is completed
+    std::vector<std::unique_ptr<Device>> m_devices;
+    std::map<const void *, unsigned int> m_pending; // unfinished jobs per token
+    bool m_bStop;
+
+    void Worker(Device *dev);
+public:
+    CScalerJobQueue() : m_bStop(false) { }
+    ~CScalerJobQueue();
+
+    static CScalerJobQueue &Instance();
+
+    static bool Supports(const struct exynos_sc_copy_caps &caps,
+                         const struct exynos_sc_pxinfo &pxinfo);
+
+    bool AddBackend(const struct exynos_sc_copy_backend &backend);
+    bool HasBackend(const char *name);
+    bool Queue(struct exynos_sc_pxinfo *pxinfo, exynos_sc_copy_done_t done, void *priv,
+               const void *token);
+    /* Waits for the jobs queued with @token */
+    void WaitIdle(const void *token);
+};
+
+#endif //__LIBSCALER_JOBQUEUE_H__
@@ -25,6 +25,7 @@
  * - 2014.05.08 : Cho KyongHo (pullip.cho@samsung.com) \n
  *   Create
  */
+#include <cerrno>
 #include <cstring>
 #include <unistd.h>
 #include <fcntl.h>
@@ -35,6 +36,7 @@
 
 #include "libscaler-common.h"
 #include "libscaler-m2m1shot.h"
+#include "libscaler-mapcache.h"
 #include "libscaler-swscaler.h"
 
 using namespace std;
@@ -79,7 +81,8 @@ const static PixFormat g_pixfmt_table[] = {
 };
 
 
-CScalerM2M1SHOT::CScalerM2M1SHOT(int devid, int __UNUSED__ drm) : m_iFD(-1)
+CScalerM2M1SHOT::CScalerM2M1SHOT(int devid, int __UNUSED__ drm)
+    : m_iFD(-1), m_bSrcSecure(false), m_bDstSecure(false)
 {
     memset(&m_task, 0, sizeof(m_task));
 
@@ -104,20 +107,44 @@ CScalerM2M1SHOT::~CScalerM2M1SHOT()
         close(m_iFD);
 }
 
+/*
+ * Errors of M2M1SHOT_IOC_PROCESS for a format or a scaling ratio the H/W
+ * does not support. Any other error is returned to the caller as is.
+ */
+static bool IsSWFallbackError(int err)
+{
+    return (err == EINVAL) || (err == ERANGE) || (err == EOPNOTSUPP);
+}
+
 bool CScalerM2M1SHOT::Run()
 {
     int ret;
 
+    if (m_iFD < 0) {
+        SC_LOGE("M2M1SHOT device is not opened");
+        return false;
+    }
+
     if (LibScaler::UnderOne16thScaling(
                 m_task.fmt_out.crop.width, m_task.fmt_out.crop.height,
                 m_task.fmt_cap.crop.width, m_task.fmt_cap.crop.height,
-                m_task.op.rotate))
+                m_task.op.rotate)) {
+        if (m_bSrcSecure || m_bDstSecure) {
+            SC_LOGE("Scaling under 1/16 is not supported for secure buffers");
+            return false;
+        }
         return RunSWScaling();
+    }
 
     ret = ioctl(m_iFD, M2M1SHOT_IOC_PROCESS, &m_task);
     if (ret < 0) {
-        SC_LOGERR("Failed to process the given M2M1SHOT task");
-        return false;
+        int err = errno;
+        if (m_bSrcSecure || m_bDstSecure || !IsSWFallbackError(err)) {
+            SC_LOGERR("Failed to process the given M2M1SHOT task");
+            return false;
+        }
+        SC_LOGERR("Failed to process the given M2M1SHOT task, trying S/W scaling");
+        return RunSWScaling();
     }
 
     return true;
@@ -233,17 +260,70 @@ bool CScalerM2M1SHOT::SetRotate(int rot, int hflip, int vflip) {
     return true;
 }
 
-static bool GetBuffer(m2m1shot_buffer &buf, char *addr[])
+/*
+ * S/W scaling accesses the whole image of every plane. Check it against the
+ * crop, the format and the size of each buffer before mapping them since the
+ * task may be what the kernel has just rejected.
+ */
+static bool CheckSWBuffer(const m2m1shot_pix_format &fmt, const m2m1shot_buffer &buf)
+{
+    if ((fmt.crop.left < 0) || (fmt.crop.top < 0) ||
+            (fmt.crop.width == 0) || (fmt.crop.height == 0) ||
+            (fmt.crop.left + fmt.crop.width > fmt.width) ||
+            (fmt.crop.top + fmt.crop.height > fmt.height)) {
+        SC_LOGE("crop %ux%u@(%d, %d) exceeds image %ux%u", fmt.crop.width, fmt.crop.height,
+                fmt.crop.left, fmt.crop.top, fmt.width, fmt.height);
+        return false;
+    }
+
+    const PixFormat *pixfmt = NULL;
+    for (size_t i = 0; i < ARRSIZE(g_pixfmt_table); i++) {
+        if (g_pixfmt_table[i].pixfmt == fmt.fmt) {
+            pixfmt = &g_pixfmt_table[i];
+            break;
+        }
+    }
+
+    if (!pixfmt || (buf.num_planes != pixfmt->planes)) {
+        SC_LOGE("%d planes do not match format %#x", buf.num_planes, fmt.fmt);
+        return false;
+    }
+
+    for (int i = 0; i < buf.num_planes; i++) {
+        size_t len = (static_cast<size_t>(pixfmt->bit_pp[i]) * fmt.width * fmt.height) / 8;
+        if (buf.plane[i].len < len) {
+            SC_LOGE("Plane %d has %zu bytes for %ux%u of format %#x", i, buf.plane[i].len,
+                    fmt.width, fmt.height, fmt.fmt);
+            return false;
+        }
+
+        if (buf.type == M2M1SHOT_BUFFER_DMABUF) {
+            off_t size = lseek(buf.plane[i].fd, 0, SEEK_END);
+            if ((size < 0) || (static_cast<size_t>(size) < buf.plane[i].len)) {
+                SC_LOGE("Plane %d (FD %d) is smaller than %zu bytes", i, buf.plane[i].fd,
+                        buf.plane[i].len);
+                return false;
+            }
+        } else if ((buf.type != M2M1SHOT_BUFFER_USERPTR) || (buf.plane[i].userptr == 0)) {
+            SC_LOGE("Plane %d has no buffer", i);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool GetBuffer(m2m1shot_buffer &buf, char *addr[], bool write)
 {
+    CDmabufMapCache &cache = CDmabufMapCache::Instance();
+
     for (int i = 0; i < buf.num_planes; i++) {
             if (buf.type == M2M1SHOT_BUFFER_DMABUF) {
-                addr[i] = reinterpret_cast<char *>(mmap(NULL, buf.plane[i].len,
-                                 PROT_READ | PROT_WRITE, MAP_SHARED,
-                                 buf.plane[i].fd, 0));
-                if (addr[i] == MAP_FAILED) {
+                addr[i] = cache.Get(buf.plane[i].fd, buf.plane[i].len, write);
+                if (addr[i] == NULL) {
                     SC_LOGE("Failed to map FD %d", buf.plane[i].fd);
                     while (i-- > 0)
-                        munmap(addr[i], buf.plane[i].len);
+                        cache.Put(buf.plane[i].fd);
                     return false;
                 }
             } else {
@@ -254,26 +334,97 @@ static bool GetBuffer(m2m1shot_buffer &buf, char *addr[])
     return true;
 }
 
-static void PutBuffer(m2m1shot_buffer &buf, char *addr[])
+static void PutBuffer(m2m1shot_buffer &buf, char *addr[] __UNUSED__)
 {
     for (int i = 0; i < buf.num_planes; i++) {
         if (buf.type == M2M1SHOT_BUFFER_DMABUF)
-            munmap(addr[i], buf.plane[i].len);
+            CDmabufMapCache::Instance().Put(buf.plane[i].fd);
     }
 }
 
-bool CScalerM2M1SHOT::RunSWScaling()
+static bool IsSWScalingFormat(unsigned int fmt)
+{
+    switch (fmt) {
+        case V4L2_PIX_FMT_YUYV:
+        case V4L2_PIX_FMT_YVYU:
+        case V4L2_PIX_FMT_NV12M:
+        case V4L2_PIX_FMT_NV21M:
+        case V4L2_PIX_FMT_NV12:
+        case V4L2_PIX_FMT_NV21:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool CScalerM2M1SHOT::RunSWConversion()
 {
-    if (m_task.fmt_cap.fmt != m_task.fmt_out.fmt) {
-        SC_LOGE("Source and target image format must be the same");
+    if (!CScalerSW_Generic::IsFormatSupported(m_task.fmt_out.fmt) ||
+            !CScalerSW_Generic::IsFormatSupported(m_task.fmt_cap.fmt)) {
+        SC_LOGE("Format %x -> %x is not supported for S/W Scaling",
+                m_task.fmt_out.fmt, m_task.fmt_cap.fmt);
         return false;
     }
 
-    if (m_task.op.rotate != 0) {
-        SC_LOGE("Rotation is not allowed for S/W Scaling");
+    SC_LOGI("Running S/W Scaler: %dx%d -> %dx%d, format %x -> %x, rotation %d",
+            m_task.fmt_out.crop.width, m_task.fmt_out.crop.height,
+            m_task.fmt_cap.crop.width, m_task.fmt_cap.crop.height,
+            m_task.fmt_out.fmt, m_task.fmt_cap.fmt, m_task.op.rotate);
+
+    char *src[3] = {NULL, NULL, NULL};
+    char *dst[3] = {NULL, NULL, NULL};
+
+    if (!GetBuffer(m_task.buf_out, src, false))
+        return false;
+
+    if (!GetBuffer(m_task.buf_cap, dst, true)) {
+        PutBuffer(m_task.buf_out, src);
         return false;
     }
 
+    if ((m_task.buf_out.num_planes == 1) &&
+            ((m_task.fmt_out.fmt == V4L2_PIX_FMT_NV12) || (m_task.fmt_out.fmt == V4L2_PIX_FMT_NV21)))
+        src[1] = src[0] + m_task.fmt_out.width * m_task.fmt_out.height;
+
+    if ((m_task.buf_cap.num_planes == 1) &&
+            ((m_task.fmt_cap.fmt == V4L2_PIX_FMT_NV12) || (m_task.fmt_cap.fmt == V4L2_PIX_FMT_NV21)))
+        dst[1] = dst[0] + m_task.fmt_cap.width * m_task.fmt_cap.height;
+
+    CScalerSW_Generic swsc(m_task.fmt_out.fmt, src, m_task.fmt_cap.fmt, dst);
+
+    swsc.SetRotate(m_task.op.rotate, !!(m_task.op.op & M2M1SHOT_OP_FLIP_HORI),
+            !!(m_task.op.op & M2M1SHOT_OP_FLIP_VIRT));
+    swsc.SetCSC(!!(m_task.op.op & M2M1SHOT_OP_CSC_709),
+            !!(m_task.op.op & M2M1SHOT_OP_CSC_WIDE));
+
+    swsc.SetSrcRect(m_task.fmt_out.crop.left, m_task.fmt_out.crop.top,
+            m_task.fmt_out.crop.width, m_task.fmt_out.crop.height,
+            m_task.fmt_out.width);
+
+    swsc.SetDstRect(m_task.fmt_cap.crop.left, m_task.fmt_cap.crop.top,
+            m_task.fmt_cap.crop.width, m_task.fmt_cap.crop.height,
+            m_task.fmt_cap.width);
+
+    bool ret = swsc.Scale();
+
+    PutBuffer(m_task.buf_out, src);
+    PutBuffer(m_task.buf_cap, dst);
+
+    return ret;
+}
+
+bool CScalerM2M1SHOT::RunSWScaling()
+{
+    if (!CheckSWBuffer(m_task.fmt_out, m_task.buf_out) ||
+            !CheckSWBuffer(m_task.fmt_cap, m_task.buf_cap))
+        return false;
+
+    /* Format conversion, rotation and flip take the slower generic path */
+    if ((m_task.fmt_cap.fmt != m_task.fmt_out.fmt) || !IsSWScalingFormat(m_task.fmt_out.fmt) ||
+            (m_task.op.rotate != 0) ||
+            (m_task.op.op & (M2M1SHOT_OP_FLIP_HORI | M2M1SHOT_OP_FLIP_VIRT)))
+        return RunSWConversion();
+
     SC_LOGI("Running S/W Scaler: %dx%d -> %dx%d",
             m_task.fmt_out.crop.width, m_task.fmt_out.crop.height,
             m_task.fmt_cap.crop.width, m_task.fmt_cap.crop.height);
@@ -284,10 +435,10 @@ bool CScalerM2M1SHOT::RunSWScaling()
     switch (m_task.fmt_cap.fmt) {
         case V4L2_PIX_FMT_YUYV:
         case V4L2_PIX_FMT_YVYU:
-            if (!GetBuffer(m_task.buf_out, src))
+            if (!GetBuffer(m_task.buf_out, src, false))
                 return false;
 
-            if (!GetBuffer(m_task.buf_cap, dst)) {
+            if (!GetBuffer(m_task.buf_cap, dst, true)) {
                 PutBuffer(m_task.buf_out, src);
                 return false;
             }
@@ -298,10 +449,10 @@ bool CScalerM2M1SHOT::RunSWScaling()
         case V4L2_PIX_FMT_NV21M:
         case V4L2_PIX_FMT_NV12:
         case V4L2_PIX_FMT_NV21:
-            if (!GetBuffer(m_task.buf_out, src))
+            if (!GetBuffer(m_task.buf_out, src, false))
                 return false;
 
-            if (!GetBuffer(m_task.buf_cap, dst)) {
+            if (!GetBuffer(m_task.buf_cap, dst, true)) {
                 PutBuffer(m_task.buf_out, src);
                 return false;
             }
@@ -314,7 +465,6 @@ bool CScalerM2M1SHOT::RunSWScaling()
 
             swsc = new CScalerSW_NV12(src[0], src[1], dst[0], dst[1]);
             break;
-        case V4L2_PIX_FMT_UYVY: // TODO: UYVY is not implemented yet.
         default:
             SC_LOGE("Format %x is not supported", m_task.fmt_out.fmt);
             return false;
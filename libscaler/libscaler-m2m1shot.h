@@ -32,6 +32,8 @@
 
 class CScalerM2M1SHOT {
     int m_iFD;
+    bool m_bSrcSecure;
+    bool m_bDstSecure;
     m2m1shot m_task;
 
     bool SetFormat(m2m1shot_pix_format &fmt, m2m1shot_buffer &buf,
@@ -41,6 +43,7 @@ class CScalerM2M1SHOT {
     bool SetAddr(m2m1shot_buffer &buf, void *addr[SC_NUM_OF_PLANES], int mem_type);
 
     bool RunSWScaling();
+    bool RunSWConversion();
 public:
     CScalerM2M1SHOT(int devid, int allow_drm = 0);
     ~CScalerM2M1SHOT();
@@ -98,8 +101,12 @@ public:
         m_task.reserved[0] = (unsigned long)framerate;
     }
 
+    /* Secure buffers are never accessed by S/W scaling */
+    inline void SetDRM(bool drm) { m_bSrcSecure = m_bDstSecure = drm; }
+    inline void SetSrcDRM(bool drm) { m_bSrcSecure = drm; }
+    inline void SetDstDRM(bool drm) { m_bDstSecure = drm; }
+
     /* No effect in M2M1SHOT */
-    inline void SetDRM(bool __UNUSED__ drm) { }
     inline void SetSrcPremultiplied(bool __UNUSED__ premultiplied) { }
     inline void SetDstPremultiplied(bool __UNUSED__ premultiplied) { }
     inline void SetSrcCacheable(bool __UNUSED__ cacheable) { }
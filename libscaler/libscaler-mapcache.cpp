@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <linux/dma-buf.h>
+
+#include "libscaler-mapcache.h"
+
+/* Mappings of two 4K NV12 frames and their scaled copies */
+#define MAPCACHE_DEFAULT_BUDGET (64 * 1024 * 1024)
+/* A buffer not used by several frames at any frame rate is likely released */
+#define MAPCACHE_DEFAULT_IDLE_TIMEOUT std::chrono::milliseconds(500)
+
+CDmabufMapCache::CDmabufMapCache(size_t budget, std::chrono::steady_clock::duration idle_timeout)
+    : m_nMappedSize(0), m_nBudget(budget), m_idleTimeout(idle_timeout)
+{
+}
+
+CDmabufMapCache::~CDmabufMapCache()
+{
+    for (auto &entry : m_entries)
+        munmap(entry.map, entry.maplen);
+}
+
+CDmabufMapCache &CDmabufMapCache::Instance()
+{
+    static CDmabufMapCache cache(MAPCACHE_DEFAULT_BUDGET, MAPCACHE_DEFAULT_IDLE_TIMEOUT);
+    return cache;
+}
+
+std::list<CDmabufMapCache::Entry>::iterator CDmabufMapCache::Find(const struct stat &st,
+                                                                   off_t offset)
+{
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if ((it->dev == st.st_dev) && (it->ino == st.st_ino) && (it->offset == offset))
+            return it;
+    }
+
+    return m_entries.end();
+}
+
+std::list<CDmabufMapCache::Entry>::iterator CDmabufMapCache::Unmap(
+        std::list<Entry>::iterator it)
+{
+    munmap(it->map, it->maplen);
+    m_nMappedSize -= it->maplen;
+    return m_entries.erase(it);
+}
+
+bool CDmabufMapCache::Sync(int fd, bool start, bool write)
+{
+    struct dma_buf_sync sync;
+    sync.flags = (start ? DMA_BUF_SYNC_START : DMA_BUF_SYNC_END) |
+                 (write ? DMA_BUF_SYNC_RW : DMA_BUF_SYNC_READ);
+    if (ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync) < 0) {
+        /* Not every exporter implements the sync ioctl */
+        SC_LOGD("DMA_BUF_IOCTL_SYNC is not available for FD %d", fd);
+        return false;
+    }
+
+    return true;
+}
+
+void CDmabufMapCache::Trim(std::chrono::steady_clock::time_point now)
+{
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if ((it->refcount == 0) && (now - it->last_used >= m_idleTimeout))
+            it = Unmap(it);
+        else
+            ++it;
+    }
+
+    for (auto it = m_entries.end(); (m_nMappedSize > m_nBudget) && (it != m_entries.begin());) {
+        --it;
+        if (it->refcount == 0)
+            it = Unmap(it);
+    }
+}
+
+char *CDmabufMapCache::Get(int fd, size_t len, bool write, off_t offset)
+{
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        SC_LOGERR("Failed to stat FD %d", fd);
+        return NULL;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = Find(st, offset);
+    if ((it != m_entries.end()) && ((it->len < len) || (write && !it->write)) &&
+            (it->refcount == 0)) {
+        /* Mapped for a smaller size or read-only: map again */
+        Unmap(it);
+        it = m_entries.end();
+    }
+
+    if (it == m_entries.end()) {
+        /* mmap() takes a page aligned offset */
+        static const off_t page_mask = sysconf(_SC_PAGESIZE) - 1;
+        off_t mapoffset = offset & ~page_mask;
+        size_t maplen = len + (offset - mapoffset);
+
+        char *map = reinterpret_cast<char *>(mmap(NULL, maplen,
+                        write ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, mapoffset));
+        if (map == MAP_FAILED) {
+            SC_LOGERR("Failed to map FD %d", fd);
+            return NULL;
+        }
+
+        m_entries.push_front({st.st_dev, st.st_ino, offset, len, map, maplen, 0, write, {}});
+        m_nMappedSize += maplen;
+        it = m_entries.begin();
+    } else if ((it->len < len) || (write && !it->write)) {
+        SC_LOGE("FD %d is in use with a smaller or read-only mapping", fd);
+        return NULL;
+    } else {
+        m_entries.splice(m_entries.begin(), m_entries, it);
+    }
+
+    it->refcount++;
+    it->last_used = std::chrono::steady_clock::now();
+    Sync(fd, true, write);
+
+    return it->map + (it->maplen - it->len);
+}
+
+void CDmabufMapCache::Put(int fd, off_t offset)
+{
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        SC_LOGERR("Failed to stat FD %d", fd);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = Find(st, offset);
+    if ((it == m_entries.end()) || (it->refcount == 0)) {
+        SC_LOGE("FD %d is not mapped by the cache", fd);
+        return;
+    }
+
+    Sync(fd, false, it->write);
+    it->refcount--;
+    it->last_used = std::chrono::steady_clock::now();
+
+    Trim(it->last_used);
+}
+
+void CDmabufMapCache::Invalidate(int fd)
+{
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        SC_LOGERR("Failed to stat FD %d", fd);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if ((it->dev != st.st_dev) || (it->ino != st.st_ino)) {
+            ++it;
+        } else if (it->refcount > 0) {
+            SC_LOGE("FD %d is invalidated while in use", fd);
+            ++it;
+        } else {
+            it = Unmap(it);
+        }
+    }
+}
+
+size_t CDmabufMapCache::GetMappedSize()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return m_nMappedSize;
+}
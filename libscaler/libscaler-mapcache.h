@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __LIBSCALER_MAPCACHE_H__
+#define __LIBSCALER_MAPCACHE_H__
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <chrono>
+#include <list>
+#include <mutex>
+
+#include "libscaler-common.h"
+
+/*
+ * Process-wide cache of CPU mappings of dmabufs for the S/W scaling paths.
+ *
+ * Get() returns a mapping of @len bytes from @offset of the dmabuf and
+ * brackets the CPU access with DMA_BUF_IOCTL_SYNC. Every Get() must be paired
+ * with a Put() of the same fd and offset. Mappings are keyed by the inode of
+ * the dmabuf and the offset, so that the planes of one dmabuf and the dups of
+ * an fd share the cache entries.
+ *
+ * A mapping keeps its dmabuf alive, so a cached entry never refers to a freed
+ * buffer, but it pins the memory of a buffer that its owner released. The
+ * owner drops the mappings with Invalidate(), exynos_sc_invalidate_buffer()
+ * for the clients, before it frees the buffer. Mappings whose owner does not
+ * are unmapped once they are not used for @idle_timeout, or in least recently
+ * used order once the total mapped size exceeds @budget.
+ */
+class CDmabufMapCache {
+    struct Entry {
+        dev_t dev;
+        ino_t ino;
+        off_t offset;
+        size_t len;
+        char *map;      // page aligned start of the mapping
+        size_t maplen;
+        int refcount;
+        bool write;
+        std::chrono::steady_clock::time_point last_used;
+    };
+
+    std::mutex m_mutex;
+    std::list<Entry> m_entries; // most recently used first
+    size_t m_nMappedSize;
+    const size_t m_nBudget;
+    const std::chrono::steady_clock::duration m_idleTimeout;
+
+    std::list<Entry>::iterator Find(const struct stat &st, off_t offset);
+    std::list<Entry>::iterator Unmap(std::list<Entry>::iterator it);
+    void Trim(std::chrono::steady_clock::time_point now);
+    static bool Sync(int fd, bool start, bool write);
+public:
+    CDmabufMapCache(size_t budget, std::chrono::steady_clock::duration idle_timeout);
+    ~CDmabufMapCache();
+
+    static CDmabufMapCache &Instance();
+
+    char *Get(int fd, size_t len, bool write, off_t offset = 0);
+    void Put(int fd, off_t offset = 0);
+    /* Unmaps every offset of the dmabuf of @fd */
+    void Invalidate(int fd);
+    size_t GetMappedSize();
+};
+
+#endif //__LIBSCALER_MAPCACHE_H__
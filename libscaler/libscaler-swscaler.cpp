@@ -1,3 +1,5 @@
+#include <linux/videodev2.h>
+
 #include "libscaler-swscaler.h"
 
 void CScalerSW::Clear() {
@@ -104,3 +106,325 @@ bool CScalerSW_NV12::Scale() {
 
     return true;
 }
+
+enum {
+    SW_FMT_UNSUPPORTED,
+    SW_FMT_YUV420,
+    SW_FMT_YUV422,
+    SW_FMT_RGB,
+};
+
+static int GetFormatClass(unsigned int format) {
+    switch (format) {
+        case V4L2_PIX_FMT_NV12:
+        case V4L2_PIX_FMT_NV21:
+        case V4L2_PIX_FMT_NV12M:
+        case V4L2_PIX_FMT_NV21M:
+            return SW_FMT_YUV420;
+        case V4L2_PIX_FMT_YUYV:
+        case V4L2_PIX_FMT_YVYU:
+        case V4L2_PIX_FMT_UYVY:
+            return SW_FMT_YUV422;
+        case V4L2_PIX_FMT_RGB32:
+        case V4L2_PIX_FMT_BGR32:
+        case V4L2_PIX_FMT_RGB565:
+            return SW_FMT_RGB;
+        default:
+            return SW_FMT_UNSUPPORTED;
+    }
+}
+
+static inline int Clamp8(int v) {
+    return (v < 0) ? 0 : ((v > 255) ? 255 : v);
+}
+
+static inline int ToQ10(double v) {
+    return static_cast<int>((v * 1024) + ((v < 0) ? -0.5 : 0.5));
+}
+
+CScalerSW_Generic::CScalerSW_Generic(unsigned int srcFormat, char *src[3],
+                                     unsigned int dstFormat, char *dst[3])
+    : m_nSrcFormat(srcFormat), m_nDstFormat(dstFormat),
+      m_nRotate(0), m_bHFlip(false), m_bVFlip(false) {
+    for (int i = 0; i < 3; i++) {
+        m_pSrc[i] = src[i];
+        m_pDst[i] = dst[i];
+    }
+    SetCSC(false, false);
+}
+
+void CScalerSW_Generic::SetCSC(bool bt709, bool wide) {
+    const double kr = bt709 ? 0.2126 : 0.299;
+    const double kb = bt709 ? 0.0722 : 0.114;
+    const double kg = 1.0 - kr - kb;
+    const double yscale = wide ? 1.0 : (219.0 / 255.0);
+    const double cscale = wide ? 1.0 : (224.0 / 255.0);
+
+    m_nYOffset = wide ? 0 : 16;
+
+    m_nYuv2Rgb[0] = ToQ10(1.0 / yscale);
+    m_nYuv2Rgb[1] = ToQ10(2 * (1 - kr) / cscale);
+    m_nYuv2Rgb[2] = ToQ10(-2 * (1 - kb) * kb / kg / cscale);
+    m_nYuv2Rgb[3] = ToQ10(-2 * (1 - kr) * kr / kg / cscale);
+    m_nYuv2Rgb[4] = ToQ10(2 * (1 - kb) / cscale);
+
+    const double u = cscale / (2 * (1 - kb));
+    const double v = cscale / (2 * (1 - kr));
+    m_nRgb2Yuv[0] = ToQ10(kr * yscale);
+    m_nRgb2Yuv[1] = ToQ10(kg * yscale);
+    m_nRgb2Yuv[2] = ToQ10(kb * yscale);
+    m_nRgb2Yuv[3] = ToQ10(-kr * u);
+    m_nRgb2Yuv[4] = ToQ10(-kg * u);
+    m_nRgb2Yuv[5] = ToQ10((1 - kb) * u);
+    m_nRgb2Yuv[6] = ToQ10((1 - kr) * v);
+    m_nRgb2Yuv[7] = ToQ10(-kg * v);
+    m_nRgb2Yuv[8] = ToQ10(-kb * v);
+}
+
+bool CScalerSW_Generic::IsFormatSupported(unsigned int format) {
+    return GetFormatClass(format) != SW_FMT_UNSUPPORTED;
+}
+
+// pix[] is Y, Cb, Cr for YUV formats and R, G, B for RGB formats
+void CScalerSW_Generic::ReadPixel(unsigned int x, unsigned int y, int pix[3]) const {
+    const unsigned char *p;
+
+    switch (m_nSrcFormat) {
+        case V4L2_PIX_FMT_NV12:
+        case V4L2_PIX_FMT_NV12M:
+        case V4L2_PIX_FMT_NV21:
+        case V4L2_PIX_FMT_NV21M: {
+            bool nv21 = (m_nSrcFormat == V4L2_PIX_FMT_NV21) ||
+                        (m_nSrcFormat == V4L2_PIX_FMT_NV21M);
+            pix[0] = reinterpret_cast<unsigned char *>(m_pSrc[0])[y * m_nSrcStride + x];
+            p = reinterpret_cast<unsigned char *>(m_pSrc[1]) + (y / 2) * m_nSrcStride + (x & ~1);
+            pix[1] = p[nv21 ? 1 : 0];
+            pix[2] = p[nv21 ? 0 : 1];
+            break;
+        }
+        case V4L2_PIX_FMT_YUYV:
+        case V4L2_PIX_FMT_YVYU:
+            p = reinterpret_cast<unsigned char *>(m_pSrc[0]) + (y * m_nSrcStride + (x & ~1)) * 2;
+            pix[0] = p[(x & 1) * 2];
+            pix[1] = p[(m_nSrcFormat == V4L2_PIX_FMT_YUYV) ? 1 : 3];
+            pix[2] = p[(m_nSrcFormat == V4L2_PIX_FMT_YUYV) ? 3 : 1];
+            break;
+        case V4L2_PIX_FMT_UYVY:
+            p = reinterpret_cast<unsigned char *>(m_pSrc[0]) + (y * m_nSrcStride + (x & ~1)) * 2;
+            pix[0] = p[(x & 1) * 2 + 1];
+            pix[1] = p[0];
+            pix[2] = p[2];
+            break;
+        case V4L2_PIX_FMT_RGB32:
+        case V4L2_PIX_FMT_BGR32:
+            p = reinterpret_cast<unsigned char *>(m_pSrc[0]) + (y * m_nSrcStride + x) * 4;
+            pix[0] = p[(m_nSrcFormat == V4L2_PIX_FMT_RGB32) ? 0 : 2];
+            pix[1] = p[1];
+            pix[2] = p[(m_nSrcFormat == V4L2_PIX_FMT_RGB32) ? 2 : 0];
+            break;
+        case V4L2_PIX_FMT_RGB565: {
+            p = reinterpret_cast<unsigned char *>(m_pSrc[0]) + (y * m_nSrcStride + x) * 2;
+            unsigned int v = p[0] | (p[1] << 8);
+            pix[0] = ((v >> 8) & 0xF8) | ((v >> 13) & 0x7);
+            pix[1] = ((v >> 3) & 0xFC) | ((v >> 9) & 0x3);
+            pix[2] = ((v << 3) & 0xF8) | ((v >> 2) & 0x7);
+            break;
+        }
+    }
+}
+
+void CScalerSW_Generic::WritePixel(unsigned int x, unsigned int y, const int pix[3]) const {
+    unsigned char *p;
+
+    switch (m_nDstFormat) {
+        case V4L2_PIX_FMT_NV12:
+        case V4L2_PIX_FMT_NV12M:
+        case V4L2_PIX_FMT_NV21:
+        case V4L2_PIX_FMT_NV21M:
+            reinterpret_cast<unsigned char *>(m_pDst[0])[y * m_nDstStride + x] = pix[0];
+            if (((x | y) & 1) == 0) {
+                bool nv21 = (m_nDstFormat == V4L2_PIX_FMT_NV21) ||
+                            (m_nDstFormat == V4L2_PIX_FMT_NV21M);
+                p = reinterpret_cast<unsigned char *>(m_pDst[1]) + (y / 2) * m_nDstStride + x;
+                p[nv21 ? 1 : 0] = pix[1];
+                p[nv21 ? 0 : 1] = pix[2];
+            }
+            break;
+        case V4L2_PIX_FMT_YUYV:
+        case V4L2_PIX_FMT_YVYU:
+            p = reinterpret_cast<unsigned char *>(m_pDst[0]) + (y * m_nDstStride + (x & ~1)) * 2;
+            p[(x & 1) * 2] = pix[0];
+            if ((x & 1) == 0) {
+                p[(m_nDstFormat == V4L2_PIX_FMT_YUYV) ? 1 : 3] = pix[1];
+                p[(m_nDstFormat == V4L2_PIX_FMT_YUYV) ? 3 : 1] = pix[2];
+            }
+            break;
+        case V4L2_PIX_FMT_UYVY:
+            p = reinterpret_cast<unsigned char *>(m_pDst[0]) + (y * m_nDstStride + (x & ~1)) * 2;
+            p[(x & 1) * 2 + 1] = pix[0];
+            if ((x & 1) == 0) {
+                p[0] = pix[1];
+                p[2] = pix[2];
+            }
+            break;
+        case V4L2_PIX_FMT_RGB32:
+        case V4L2_PIX_FMT_BGR32:
+            p = reinterpret_cast<unsigned char *>(m_pDst[0]) + (y * m_nDstStride + x) * 4;
+            p[(m_nDstFormat == V4L2_PIX_FMT_RGB32) ? 0 : 2] = pix[0];
+            p[1] = pix[1];
+            p[(m_nDstFormat == V4L2_PIX_FMT_RGB32) ? 2 : 0] = pix[2];
+            p[3] = 0xFF;
+            break;
+        case V4L2_PIX_FMT_RGB565: {
+            p = reinterpret_cast<unsigned char *>(m_pDst[0]) + (y * m_nDstStride + x) * 2;
+            unsigned int v = ((pix[0] & 0xF8) << 8) | ((pix[1] & 0xFC) << 3) | (pix[2] >> 3);
+            p[0] = v & 0xFF;
+            p[1] = v >> 8;
+            break;
+        }
+    }
+}
+
+void CScalerSW_Generic::ConvertPixel(int pix[3]) const {
+    bool srcRGB = GetFormatClass(m_nSrcFormat) == SW_FMT_RGB;
+    bool dstRGB = GetFormatClass(m_nDstFormat) == SW_FMT_RGB;
+
+    if (srcRGB == dstRGB)
+        return;
+
+    int c0 = pix[0], c1 = pix[1], c2 = pix[2];
+    if (srcRGB) {
+        const int *m = m_nRgb2Yuv;
+        pix[0] = Clamp8(((m[0] * c0 + m[1] * c1 + m[2] * c2 + 512) >> 10) + m_nYOffset);
+        pix[1] = Clamp8(((m[3] * c0 + m[4] * c1 + m[5] * c2 + 512) >> 10) + 128);
+        pix[2] = Clamp8(((m[6] * c0 + m[7] * c1 + m[8] * c2 + 512) >> 10) + 128);
+    } else {
+        const int *m = m_nYuv2Rgb;
+        int y = m[0] * (c0 - m_nYOffset);
+        c1 -= 128;
+        c2 -= 128;
+        pix[0] = Clamp8((y + m[1] * c2 + 512) >> 10);
+        pix[1] = Clamp8((y + m[2] * c1 + m[3] * c2 + 512) >> 10);
+        pix[2] = Clamp8((y + m[4] * c1 + 512) >> 10);
+    }
+}
+
+// fx and fy are 16.16 fixed point coordinates in the source image
+void CScalerSW_Generic::SamplePixel(int64_t fx, int64_t fy, int pix[3]) const {
+    unsigned int x0 = static_cast<unsigned int>(fx >> 16);
+    unsigned int y0 = static_cast<unsigned int>(fy >> 16);
+    unsigned int x1 = LibScaler::min(x0 + 1, m_nSrcLeft + m_nSrcWidth - 1);
+    unsigned int y1 = LibScaler::min(y0 + 1, m_nSrcTop + m_nSrcHeight - 1);
+    int wx = static_cast<int>((fx >> 8) & 0xFF);
+    int wy = static_cast<int>((fy >> 8) & 0xFF);
+    int p00[3], p10[3], p01[3], p11[3];
+
+    ReadPixel(x0, y0, p00);
+    if ((wx | wy) == 0) {
+        pix[0] = p00[0];
+        pix[1] = p00[1];
+        pix[2] = p00[2];
+        return;
+    }
+    ReadPixel(x1, y0, p10);
+    ReadPixel(x0, y1, p01);
+    ReadPixel(x1, y1, p11);
+
+    for (int i = 0; i < 3; i++) {
+        int top = p00[i] * (256 - wx) + p10[i] * wx;
+        int bottom = p01[i] * (256 - wx) + p11[i] * wx;
+        pix[i] = (top * (256 - wy) + bottom * wy + 32768) >> 16;
+    }
+}
+
+#define SW_TILE_SIZE 32
+
+bool CScalerSW_Generic::Scale() {
+    int srcClass = GetFormatClass(m_nSrcFormat);
+    int dstClass = GetFormatClass(m_nDstFormat);
+
+    if ((srcClass == SW_FMT_UNSUPPORTED) || (dstClass == SW_FMT_UNSUPPORTED)) {
+        SC_LOGE("Format %x -> %x is not supported", m_nSrcFormat, m_nDstFormat);
+        return false;
+    }
+
+    if ((m_nRotate != 0) && (m_nRotate != 90) && (m_nRotate != 180) && (m_nRotate != 270)) {
+        SC_LOGE("Rotation degree %d is not supported", m_nRotate);
+        return false;
+    }
+
+    if ((m_nSrcWidth == 0) || (m_nSrcHeight == 0) || (m_nDstWidth == 0) || (m_nDstHeight == 0)) {
+        SC_LOGE("Invalid size %ux%u -> %ux%u", m_nSrcWidth, m_nSrcHeight,
+                m_nDstWidth, m_nDstHeight);
+        return false;
+    }
+
+    if ((dstClass == SW_FMT_YUV420) &&
+            (((m_nDstLeft | m_nDstTop | m_nDstWidth | m_nDstHeight) % 2) != 0)) {
+        SC_LOGE("Both of width and height of YUV420 should be even");
+        return false;
+    }
+
+    if ((dstClass == SW_FMT_YUV422) && (((m_nDstLeft | m_nDstWidth) % 2) != 0)) {
+        SC_LOGE("Width of YUV422 should be even");
+        return false;
+    }
+
+    const bool swapped = (m_nRotate == 90) || (m_nRotate == 270);
+    const int64_t rotWidth = swapped ? m_nSrcHeight : m_nSrcWidth;
+    const int64_t rotHeight = swapped ? m_nSrcWidth : m_nSrcHeight;
+    const int64_t maxX = static_cast<int64_t>(m_nSrcWidth - 1) << 16;
+    const int64_t maxY = static_cast<int64_t>(m_nSrcHeight - 1) << 16;
+    const int64_t maxRotX = (rotWidth - 1) << 16;
+    const int64_t maxRotY = (rotHeight - 1) << 16;
+
+    // Tiles keep the source rows of rotated reads in the cache
+    for (unsigned int ty = 0; ty < m_nDstHeight; ty += SW_TILE_SIZE) {
+        unsigned int th = LibScaler::min(m_nDstHeight - ty, static_cast<unsigned int>(SW_TILE_SIZE));
+        for (unsigned int tx = 0; tx < m_nDstWidth; tx += SW_TILE_SIZE) {
+            unsigned int tw = LibScaler::min(m_nDstWidth - tx, static_cast<unsigned int>(SW_TILE_SIZE));
+            for (unsigned int v = ty; v < ty + th; v++) {
+                // Center of the destination pixel in the rotated source
+                int64_t ry = (((2 * v + 1) * rotHeight) << 15) / m_nDstHeight - (1 << 15);
+                ry = (ry < 0) ? 0 : ((ry > maxRotY) ? maxRotY : ry);
+
+                for (unsigned int u = tx; u < tx + tw; u++) {
+                    int64_t rx = (((2 * u + 1) * rotWidth) << 15) / m_nDstWidth - (1 << 15);
+                    rx = (rx < 0) ? 0 : ((rx > maxRotX) ? maxRotX : rx);
+
+                    int64_t sx, sy;
+                    switch (m_nRotate) {
+                        case 90:
+                            sx = ry;
+                            sy = maxY - rx;
+                            break;
+                        case 180:
+                            sx = maxX - rx;
+                            sy = maxY - ry;
+                            break;
+                        case 270:
+                            sx = maxX - ry;
+                            sy = rx;
+                            break;
+                        default:
+                            sx = rx;
+                            sy = ry;
+                            break;
+                    }
+                    if (m_bHFlip)
+                        sx = maxX - sx;
+                    if (m_bVFlip)
+                        sy = maxY - sy;
+
+                    int pix[3];
+                    SamplePixel(sx + (static_cast<int64_t>(m_nSrcLeft) << 16),
+                                sy + (static_cast<int64_t>(m_nSrcTop) << 16), pix);
+                    ConvertPixel(pix);
+                    WritePixel(m_nDstLeft + u, m_nDstTop + v, pix);
+                }
+            }
+        }
+    }
+
+    return true;
+}
@@ -1,6 +1,8 @@
 #ifndef __LIBSCALER_SWSCALER_H__
 #define __LIBSCALER_SWSCALER_H__
 
+#include <cstdint>
+
 #include "libscaler-common.h"
 
 class CScalerSW {
@@ -58,4 +60,44 @@ class CScalerSW_NV12: public CScalerSW {
         virtual bool Scale();
 };
 
+/*
+ * S/W scaler for any pair of the supported formats with rotation, flip,
+ * color space conversion and bilinear filtering. It is slower than the format
+ * specific scalers above and is used when those can't handle the request.
+ *
+ * Supported formats: V4L2_PIX_FMT_NV12(M), NV21(M), YUYV, YVYU, UYVY, RGB32,
+ * BGR32 and RGB565. Destination chroma of subsampled formats is taken from
+ * the top-left pixel of each chroma block.
+ */
+class CScalerSW_Generic: public CScalerSW {
+        unsigned int m_nSrcFormat;
+        unsigned int m_nDstFormat;
+        int m_nRotate;
+        bool m_bHFlip;
+        bool m_bVFlip;
+        /* Q10 fixed point YUV->RGB (yr, vr, ug, vg, ub) and RGB->YUV (3x3) matrices */
+        int m_nYuv2Rgb[5];
+        int m_nRgb2Yuv[9];
+        int m_nYOffset;
+
+        void ReadPixel(unsigned int x, unsigned int y, int pix[3]) const;
+        void WritePixel(unsigned int x, unsigned int y, const int pix[3]) const;
+        void ConvertPixel(int pix[3]) const;
+        void SamplePixel(int64_t fx, int64_t fy, int pix[3]) const;
+    public:
+        CScalerSW_Generic(unsigned int srcFormat, char *src[3],
+                          unsigned int dstFormat, char *dst[3]);
+
+        /* Clockwise rotation in degrees, and flips applied to the source */
+        void SetRotate(int rotate, bool hflip, bool vflip) {
+            m_nRotate = rotate;
+            m_bHFlip = hflip;
+            m_bVFlip = vflip;
+        }
+        void SetCSC(bool bt709, bool wide);
+
+        static bool IsFormatSupported(unsigned int format);
+        virtual bool Scale();
+};
+
 #endif //__LIBSCALER_SWSCALER_H__
@@ -34,6 +34,7 @@
 #include <sys/mman.h>
 
 #include "libscaler-v4l2.h"
+#include "libscaler-mapcache.h"
 #include "libscaler-swscaler.h"
 
 
@@ -514,17 +515,18 @@ bool CScalerV4L2::DQBuf(FrameInfo &frm)
     return true;
 }
 
-static bool GetBuffer(CScalerV4L2::FrameInfo &frm, char *addr[])
+static bool GetBuffer(CScalerV4L2::FrameInfo &frm, char *addr[], bool write)
 {
+    CDmabufMapCache &cache = CDmabufMapCache::Instance();
+
     for (int i = 0; i < frm.out_num_planes; i++) {
         if (frm.memory == V4L2_MEMORY_DMABUF) {
-            addr[i] = reinterpret_cast<char *>(mmap(NULL, frm.out_plane_size[i],
-                        PROT_READ | PROT_WRITE, MAP_SHARED,
-                        static_cast<int>(reinterpret_cast<long>(frm.addr[i])), 0));
-            if (addr[i] == MAP_FAILED) {
+            addr[i] = cache.Get(static_cast<int>(reinterpret_cast<long>(frm.addr[i])),
+                                frm.out_plane_size[i], write);
+            if (addr[i] == NULL) {
                 SC_LOGE("Failed to map FD %ld", reinterpret_cast<long>(frm.addr[i]));
                 while (i-- > 0)
-                    munmap(addr[i], frm.out_plane_size[i]);
+                    cache.Put(static_cast<int>(reinterpret_cast<long>(frm.addr[i])));
                 return false;
             }
         } else {
@@ -535,11 +537,12 @@ static bool GetBuffer(CScalerV4L2::FrameInfo &frm, char *addr[])
     return true;
 }
 
-static void PutBuffer(CScalerV4L2::FrameInfo &frm, char *addr[])
+static void PutBuffer(CScalerV4L2::FrameInfo &frm, char *addr[] __UNUSED__)
 {
     for (int i = 0; i < frm.out_num_planes; i++) {
         if (frm.memory == V4L2_MEMORY_DMABUF) {
-            munmap(addr[i], frm.out_plane_size[i]);
+            CDmabufMapCache::Instance().Put(
+                    static_cast<int>(reinterpret_cast<long>(frm.addr[i])));
         }
     }
 }
@@ -571,10 +574,10 @@ bool CScalerV4L2::RunSWScaling()
             m_frmDst.out_num_planes = 1;
             m_frmDst.out_plane_size[0] = m_frmDst.width * m_frmDst.height * 2;
 
-            if (!GetBuffer(m_frmSrc, src))
+            if (!GetBuffer(m_frmSrc, src, false))
                 return false;
 
-            if (!GetBuffer(m_frmDst, dst)) {
+            if (!GetBuffer(m_frmDst, dst, true)) {
                 PutBuffer(m_frmSrc, src);
                 return false;
             }
@@ -590,10 +593,10 @@ bool CScalerV4L2::RunSWScaling()
             m_frmSrc.out_plane_size[1] = m_frmSrc.out_plane_size[0] / 2;
             m_frmDst.out_plane_size[1] = m_frmDst.out_plane_size[0] / 2;
 
-            if (!GetBuffer(m_frmSrc, src))
+            if (!GetBuffer(m_frmSrc, src, false))
                 return false;
 
-            if (!GetBuffer(m_frmDst, dst)) {
+            if (!GetBuffer(m_frmDst, dst, true)) {
                 PutBuffer(m_frmSrc, src);
                 return false;
             }
@@ -609,10 +612,10 @@ bool CScalerV4L2::RunSWScaling()
             m_frmSrc.out_plane_size[0] += m_frmSrc.out_plane_size[0] / 2;
             m_frmDst.out_plane_size[0] += m_frmDst.out_plane_size[0] / 2;
 
-            if (!GetBuffer(m_frmSrc, src))
+            if (!GetBuffer(m_frmSrc, src, false))
                 return false;
 
-            if (!GetBuffer(m_frmDst, dst)) {
+            if (!GetBuffer(m_frmDst, dst, true)) {
                 PutBuffer(m_frmSrc, src);
                 return false;
             }
@@ -32,6 +32,7 @@
 #include <sys/types.h>
 #include <sys/ioctl.h>
 #include <errno.h>
+#include <stdio.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <system/graphics.h>
@@ -40,8 +41,11 @@
 
 #include "libscaler-common.h"
 #include "libscalerblend-v4l2.h"
+#include "libscalerblend-graph.h"
 #include "libscaler-v4l2.h"
 #include "libscaler-m2m1shot.h"
+#include "libscaler-mapcache.h"
+#include "libscaler-jobqueue.h"
 
 int hal_pixfmt_to_v4l2(int hal_pixel_format)
 {
@@ -183,16 +187,11 @@ static bool find_pixel(unsigned int sc_pxfmt, unsigned int __out *v4l2_pxfmt)
     return false;
 }
 
-bool exynos_sc_copy_pixels(exynos_sc_pxinfo *pxinfo, int dev_num)
+static bool exynos_sc_run_copy_pixels(CScalerM2M1SHOT &sc, exynos_sc_pxinfo *pxinfo)
 {
     unsigned int srcfmt;
     unsigned int dstfmt;
 
-    CScalerM2M1SHOT sc(dev_num);
-
-    if (!sc.Valid())
-        return false;
-
     if (!find_pixel(pxinfo->src.pxfmt, &srcfmt))
         return false;
 
@@ -236,6 +235,80 @@ bool exynos_sc_copy_pixels(exynos_sc_pxinfo *pxinfo, int dev_num)
     return sc.Run();
 }
 
+bool exynos_sc_copy_pixels(exynos_sc_pxinfo *pxinfo, int dev_num)
+{
+    CScalerM2M1SHOT sc(dev_num);
+
+    if (!sc.Valid())
+        return false;
+
+    return exynos_sc_run_copy_pixels(sc, pxinfo);
+}
+
+unsigned int exynos_sc_pxfmt_to_v4l2(unsigned int pxfmt)
+{
+    unsigned int v4l2_pxfmt;
+
+    return find_pixel(pxfmt, &v4l2_pxfmt) ? v4l2_pxfmt : 0;
+}
+
+static bool exynos_sc_run_queued_copy(void *priv, exynos_sc_pxinfo *pxinfo)
+{
+    return exynos_sc_run_copy_pixels(*reinterpret_cast<CScalerM2M1SHOT *>(priv), pxinfo);
+}
+
+bool exynos_sc_add_copy_backend(const exynos_sc_copy_backend *backend)
+{
+    return CScalerJobQueue::Instance().AddBackend(*backend);
+}
+
+bool exynos_sc_add_copy_device(int dev_num)
+{
+    char name[16];
+    snprintf(name, sizeof(name), "scaler%d", dev_num);
+
+    if (CScalerJobQueue::Instance().HasBackend(name))
+        return true;
+
+    // The instance stays open as long as the queue which is never destroyed
+    CScalerM2M1SHOT *sc = new CScalerM2M1SHOT(dev_num);
+    if (!sc->Valid()) {
+        SC_LOGE("Failed to open Scaler instance %d for the job queue", dev_num);
+        delete sc;
+        return false;
+    }
+
+    exynos_sc_copy_backend backend;
+    backend.name = name;
+    backend.caps.formats = EXYNOS_SC_COPY_FMT(EXYNOS_SC_FMT_RGB32) |
+                           EXYNOS_SC_COPY_FMT(EXYNOS_SC_FMT_BGR32) |
+                           EXYNOS_SC_COPY_FMT(EXYNOS_SC_FMT_RGB565) |
+                           EXYNOS_SC_COPY_FMT(EXYNOS_SC_FMT_RGB555X) |
+                           EXYNOS_SC_COPY_FMT(EXYNOS_SC_FMT_RGB444);
+    backend.caps.max_downscale = 16;
+    backend.caps.max_upscale = 8;
+    backend.caps.min_src_width = 16;
+    backend.caps.min_src_height = 16;
+    backend.caps.min_dst_width = 16;
+    backend.caps.min_dst_height = 16;
+    backend.caps.rotate = true;
+    backend.run = exynos_sc_run_queued_copy;
+    backend.priv = sc;
+
+    return CScalerJobQueue::Instance().AddBackend(backend);
+}
+
+bool exynos_sc_queue_copy_pixels(exynos_sc_pxinfo *pxinfo, exynos_sc_copy_done_t done, void *priv,
+                                 const void *token)
+{
+    return CScalerJobQueue::Instance().Queue(pxinfo, done, priv, token);
+}
+
+void exynos_sc_wait_copy_pixels(const void *token)
+{
+    CScalerJobQueue::Instance().WaitIdle(token);
+}
+
 #ifdef SCALER_USE_M2M1SHOT
 typedef CScalerM2M1SHOT CScalerNonStream;
 #else
@@ -331,7 +404,7 @@ int exynos_sc_set_src_format(
 
     sc->SetSrcPremultiplied(premultiplied != 0);
     sc->SetSrcCacheable(cacheable != 0);
-    sc->SetDRM(mode_drm != 0);
+    sc->SetSrcDRM(mode_drm != 0);
 
     if (!sc->SetSrcFormat(width, height, v4l2_colorformat))
         return -1;
@@ -358,7 +431,7 @@ int exynos_sc_set_dst_format(
 
     sc->SetDstPremultiplied(premultiplied != 0);
     sc->SetDstCacheable(cacheable != 0);
-    sc->SetDRM(mode_drm != 0);
+    sc->SetDstDRM(mode_drm != 0);
 
     if (!sc->SetDstFormat(width, height, v4l2_colorformat))
         return -1;
@@ -754,6 +827,119 @@ int exynos_sc_config_blend_exclusive(
     return 0;
 }
 
+void *exynos_sc_create_blend_graph(void)
+{
+    return reinterpret_cast<void *>(new CScalerBlendGraph());
+}
+
+void exynos_sc_destroy_blend_graph(void *graph)
+{
+    delete reinterpret_cast<CScalerBlendGraph *>(graph);
+}
+
+int exynos_sc_add_blend_graph_buffer(void *graph, int fd, size_t len)
+{
+    if (graph == NULL) {
+        SC_LOGE("NULL blend graph handle");
+        return -1;
+    }
+
+    return reinterpret_cast<CScalerBlendGraph *>(graph)->AddBuffer(fd, len) ? 0 : -1;
+}
+
+int exynos_sc_plan_blend_layers(
+    void *graph,
+    const struct exynos_sc_blend_layer *layers,
+    unsigned int num_layers,
+    unsigned int *num_passes)
+{
+    if (graph == NULL) {
+        SC_LOGE("NULL blend graph handle");
+        return -1;
+    }
+
+    CScalerBlendGraph *blend = reinterpret_cast<CScalerBlendGraph *>(graph);
+
+    if (!blend->Plan(layers, num_layers))
+        return -1;
+
+    *num_passes = blend->GetNumPasses();
+
+    return 0;
+}
+
+int exynos_sc_config_blend_pass(
+    void *handle,
+    void *graph,
+    unsigned int pass,
+    exynos_sc_img *src_img,
+    exynos_sc_img *dst_img,
+    struct CSC_Spec *cscspec,
+    int *blend_fd)
+{
+    if (graph == NULL) {
+        SC_LOGE("NULL blend graph handle");
+        return -1;
+    }
+
+    CScalerBlendGraph *blend = reinterpret_cast<CScalerBlendGraph *>(graph);
+    CScalerBlendGraph::Pass plan;
+
+    if (!blend->GetPass(pass, &plan))
+        return -1;
+
+    if (cscspec)
+        plan.info.cscspec = *cscspec;
+
+    if (exynos_sc_config_blend_exclusive(handle, src_img, dst_img, &plan.info) < 0) {
+        blend->PutBuffer(plan.blend_fd);
+        return -1;
+    }
+
+    *blend_fd = plan.blend_fd;
+
+    return 0;
+}
+
+int exynos_sc_config_blend_layers(
+    void *handle,
+    void *graph,
+    exynos_sc_img *src_img,
+    exynos_sc_img *dst_img,
+    const struct exynos_sc_blend_layer *layers,
+    unsigned int num_layers,
+    struct CSC_Spec *cscspec,
+    int *blend_fd)
+{
+    unsigned int num_passes;
+
+    if (exynos_sc_plan_blend_layers(graph, layers, num_layers, &num_passes) < 0)
+        return -1;
+
+    if (num_passes > 1) {
+        CScalerBlendGraph *blend = reinterpret_cast<CScalerBlendGraph *>(graph);
+        CScalerBlendGraph::Pass plan;
+
+        SC_LOGE("%u layers need %u passes", num_layers, num_passes);
+        for (unsigned int i = 0; (i < num_passes) && blend->GetPass(i, &plan); i++)
+            blend->PutBuffer(plan.blend_fd);
+        return -1;
+    }
+
+    return exynos_sc_config_blend_pass(handle, graph, 0, src_img, dst_img, cscspec, blend_fd);
+}
+
+void exynos_sc_put_blend_graph_buffer(void *graph, int blend_fd)
+{
+    if (graph)
+        reinterpret_cast<CScalerBlendGraph *>(graph)->PutBuffer(blend_fd);
+}
+
+void exynos_sc_invalidate_buffer(int fd)
+{
+    CDmabufMapCache::Instance().Invalidate(fd);
+}
+
 int exynos_sc_wait_frame_done_exclusive(
         void *handle)
 {
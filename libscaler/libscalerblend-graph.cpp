@@ -0,0 +1,291 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <system/graphics.h>
+
+#include <algorithm>
+
+#include "libscaler-mapcache.h"
+#include "libscalerblend-graph.h"
+
+#define BLEND_BYTES_PER_PIXEL 4
+#define BLEND_ALPHA_BYTE 3
+
+static inline unsigned int div255(unsigned int val)
+{
+    val += 128;
+    return (val + (val >> 8)) >> 8;
+}
+
+static bool is_flattenable_fmt(unsigned int fmt)
+{
+    /* The alpha is the last byte of both */
+    return (fmt == HAL_PIXEL_FORMAT_RGBA_8888) || (fmt == HAL_PIXEL_FORMAT_BGRA_8888);
+}
+
+static bool is_flattenable(const exynos_sc_blend_layer &layer)
+{
+    return (layer.blop == SRC_BL_OP_SRC_OVER) && is_flattenable_fmt(layer.fmt);
+}
+
+static bool is_visible(const exynos_sc_blend_layer &layer)
+{
+    if ((layer.width == 0) || (layer.height == 0))
+        return false;
+
+    /* Any other operation may change the video under a transparent layer */
+    return (layer.blop != SRC_BL_OP_SRC_OVER) ||
+           !layer.globalalpha.enable || (layer.globalalpha.val != 0);
+}
+
+CScalerBlendGraph::~CScalerBlendGraph()
+{
+    for (auto &buf : m_buffers)
+        CDmabufMapCache::Instance().Invalidate(buf.fd);
+}
+
+bool CScalerBlendGraph::AddBuffer(int fd, size_t len)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto &buf : m_buffers) {
+        if (buf.fd == fd) {
+            SC_LOGE("FD %d is already in the blend buffer pool", fd);
+            return false;
+        }
+    }
+
+    m_buffers.push_back({fd, len, false});
+
+    return true;
+}
+
+int CScalerBlendGraph::GetBuffer(size_t len)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    /* The smallest one to leave larger buffers for larger overlays */
+    Buffer *found = NULL;
+    for (auto &buf : m_buffers) {
+        if (!buf.busy && (buf.len >= len) && (!found || (buf.len < found->len)))
+            found = &buf;
+    }
+
+    if (!found)
+        return -1;
+
+    found->busy = true;
+
+    return found->fd;
+}
+
+void CScalerBlendGraph::PutBuffer(int fd)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto &buf : m_buffers) {
+        if (buf.fd == fd) {
+            buf.busy = false;
+            return;
+        }
+    }
+}
+
+/* SRC_OVER of @layer onto the premultiplied overlay @dst at (@x, @y) */
+static void flatten_layer(char *dst, unsigned int dst_stride, unsigned int x, unsigned int y,
+                          const char *src, const exynos_sc_blend_layer &layer)
+{
+    unsigned int galpha = layer.globalalpha.enable ? std::min(layer.globalalpha.val, 255U) : 255;
+
+    for (unsigned int i = 0; i < layer.height; i++) {
+        const unsigned char *s = reinterpret_cast<const unsigned char *>(src) +
+                                 static_cast<size_t>(layer.stride) * i * BLEND_BYTES_PER_PIXEL;
+        unsigned char *d = reinterpret_cast<unsigned char *>(dst) +
+                           (static_cast<size_t>(dst_stride) * (y + i) + x) * BLEND_BYTES_PER_PIXEL;
+
+        for (unsigned int j = 0; j < layer.width; j++) {
+            unsigned int alpha = div255(s[BLEND_ALPHA_BYTE] * galpha);
+            unsigned int inv = 255 - alpha;
+
+            for (int c = 0; c < BLEND_ALPHA_BYTE; c++) {
+                unsigned int color = div255(s[c] * (layer.premulti ? galpha : alpha));
+                d[c] = static_cast<unsigned char>(std::min(color + div255(d[c] * inv), 255U));
+            }
+            d[BLEND_ALPHA_BYTE] = static_cast<unsigned char>(alpha + div255(d[BLEND_ALPHA_BYTE] * inv));
+
+            s += BLEND_BYTES_PER_PIXEL;
+            d += BLEND_BYTES_PER_PIXEL;
+        }
+    }
+}
+
+bool CScalerBlendGraph::Flatten(const std::vector<const exynos_sc_blend_layer *> &layers,
+                                Pass *pass)
+{
+    unsigned int left = layers[0]->hpos;
+    unsigned int top = layers[0]->vpos;
+    unsigned int right = 0;
+    unsigned int bottom = 0;
+
+    for (auto layer : layers) {
+        left = std::min(left, layer->hpos);
+        top = std::min(top, layer->vpos);
+        right = std::max(right, layer->hpos + layer->width);
+        bottom = std::max(bottom, layer->vpos + layer->height);
+    }
+
+    unsigned int width = right - left;
+    unsigned int height = bottom - top;
+    size_t len = static_cast<size_t>(width) * height * BLEND_BYTES_PER_PIXEL;
+
+    int fd = GetBuffer(len);
+    if (fd < 0) {
+        SC_LOGE("No free blend buffer of %zu bytes for %zu layers", len, layers.size());
+        return false;
+    }
+
+    CDmabufMapCache &mapcache = CDmabufMapCache::Instance();
+    /* Pool buffers stay mapped, the graph invalidates them when it is destroyed */
+    char *dst = mapcache.Get(fd, len, true);
+    if (!dst) {
+        PutBuffer(fd);
+        return false;
+    }
+
+    memset(dst, 0, len);
+
+    bool success = true;
+    for (auto layer : layers) {
+        size_t srclen = static_cast<size_t>(layer->stride) * layer->height * BLEND_BYTES_PER_PIXEL;
+        const char *src = mapcache.Get(layer->fd, srclen, false);
+        if (!src) {
+            success = false;
+            break;
+        }
+
+        flatten_layer(dst, width, layer->hpos - left, layer->vpos - top, src, *layer);
+        mapcache.Put(layer->fd);
+    }
+
+    mapcache.Put(fd);
+
+    if (!success) {
+        PutBuffer(fd);
+        return false;
+    }
+
+    memset(&pass->info, 0, sizeof(pass->info));
+    pass->info.blop = SRC_BL_OP_SRC_OVER;
+    pass->info.srcblendfmt = layers[0]->fmt;
+    pass->info.srcblendhpos = left;
+    pass->info.srcblendvpos = top;
+    pass->info.srcblendpremulti = 1;
+    pass->info.srcblendstride = width;
+    pass->info.srcblendwidth = width;
+    pass->info.srcblendheight = height;
+    pass->info.globalalpha.enable = 0;
+    pass->info.globalalpha.val = 0xff;
+    pass->blend_fd = fd;
+
+    return true;
+}
+
+static void set_layer_pass(const exynos_sc_blend_layer &layer, CScalerBlendGraph::Pass *pass)
+{
+    memset(&pass->info, 0, sizeof(pass->info));
+    pass->info.blop = layer.blop;
+    pass->info.srcblendfmt = layer.fmt;
+    pass->info.srcblendhpos = layer.hpos;
+    pass->info.srcblendvpos = layer.vpos;
+    pass->info.srcblendpremulti = layer.premulti;
+    pass->info.srcblendstride = layer.stride;
+    pass->info.srcblendwidth = layer.width;
+    pass->info.srcblendheight = layer.height;
+    pass->info.globalalpha = layer.globalalpha;
+    pass->blend_fd = layer.fd;
+}
+
+bool CScalerBlendGraph::Plan(const exynos_sc_blend_layer *layers, unsigned int num_layers)
+{
+    std::vector<Pass> passes;
+
+    if (num_layers == 0) {
+        SC_LOGE("No layer to blend");
+        return false;
+    }
+
+    std::vector<const exynos_sc_blend_layer *> visible;
+    for (unsigned int i = 0; i < num_layers; i++) {
+        if (is_visible(layers[i]))
+            visible.push_back(&layers[i]);
+    }
+
+    /* The H/W blends one overlay in any case: keep a transparent one */
+    if (visible.empty())
+        visible.push_back(&layers[0]);
+
+    /* Each run of layers that can be flattened together takes a pass */
+    for (size_t i = 0; i < visible.size();) {
+        size_t end = i + 1;
+        if (is_flattenable(*visible[i])) {
+            while ((end < visible.size()) && is_flattenable(*visible[end]) &&
+                    (visible[end]->fmt == visible[i]->fmt))
+                end++;
+        }
+
+        Pass pass;
+        if (end - i == 1) {
+            set_layer_pass(*visible[i], &pass);
+        } else {
+            std::vector<const exynos_sc_blend_layer *> run(visible.begin() + i,
+                                                           visible.begin() + end);
+            if (!Flatten(run, &pass)) {
+                for (auto &done : passes)
+                    PutBuffer(done.blend_fd);
+                return false;
+            }
+        }
+
+        passes.push_back(pass);
+        i = end;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_passes.swap(passes);
+
+    return true;
+}
+
+unsigned int CScalerBlendGraph::GetNumPasses()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return static_cast<unsigned int>(m_passes.size());
+}
+
+bool CScalerBlendGraph::GetPass(unsigned int index, Pass *pass)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (index >= m_passes.size()) {
+        SC_LOGE("Pass %u is not in the plan of %zu passes", index, m_passes.size());
+        return false;
+    }
+
+    *pass = m_passes[index];
+
+    return true;
+}
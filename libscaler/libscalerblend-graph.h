@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __LIBSCALERBLEND_GRAPH_H__
+#define __LIBSCALERBLEND_GRAPH_H__
+
+#include <mutex>
+#include <vector>
+
+#include <exynos_scaler.h>
+
+#include "libscaler-common.h"
+
+/*
+ * Plans the blending of several overlay layers onto a video frame with the
+ * source blending of Scaler, which blends one overlay per pass.
+ *
+ * A single visible layer is blended directly from its own buffer. Consecutive
+ * layers blended with SRC_BL_OP_SRC_OVER in the same 32-bit RGB format are
+ * flattened by CPU into one premultiplied overlay covering all of them, since
+ * SRC_OVER is associative, and blended in one pass. Overlays are small compared
+ * to the video, so flattening them costs far less than chaining passes through
+ * intermediate video frames. Any other layer gets a pass of its own, and the
+ * passes are chained by the user in the order of the plan. The flattened
+ * overlays are written to the dmabufs the user added to the pool, and a pool
+ * buffer is in use until the user puts it back after its pass is done.
+ */
+class CScalerBlendGraph {
+public:
+    struct Pass {
+        struct SrcBlendInfo info; /* only the blending fields are set */
+        int blend_fd;
+    };
+
+private:
+    struct Buffer {
+        int fd;
+        size_t len;
+        bool busy;
+    };
+
+    std::mutex m_mutex;
+    std::vector<Buffer> m_buffers;
+    std::vector<Pass> m_passes; /* the last plan */
+
+    int GetBuffer(size_t len);
+    bool Flatten(const std::vector<const exynos_sc_blend_layer *> &layers, Pass *pass);
+public:
+    ~CScalerBlendGraph();
+
+    bool AddBuffer(int fd, size_t len);
+    /* Putting an fd that is not in the pool is allowed and ignored */
+    void PutBuffer(int fd);
+
+    /*
+     * Splits the blending of @layers in order, the first layer at the bottom,
+     * into passes. The plan replaces the previous one of the graph.
+     */
+    bool Plan(const exynos_sc_blend_layer *layers, unsigned int num_layers);
+
+    unsigned int GetNumPasses();
+    bool GetPass(unsigned int index, Pass *pass);
+};
+
+#endif //__LIBSCALERBLEND_GRAPH_H__
@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <system/graphics.h>
+
+#include "libscaler-mapcache.h"
+#include "libscalerblend-graph.h"
+
+namespace {
+
+const unsigned int kBpp = 4;
+const unsigned int kVideoWidth = 48;
+const unsigned int kVideoHeight = 32;
+
+using Image = std::vector<unsigned char>;
+
+/*
+ * S/W reference of SRC_OVER of a layer onto a premultiplied image, in
+ * floating point: the result of the Scaler blending that the plans are
+ * checked against.
+ */
+void ReferenceBlendOver(Image *dst, unsigned int dst_stride, const unsigned char *src,
+                        const exynos_sc_blend_layer &layer)
+{
+    float galpha = layer.globalalpha.enable ? std::min(layer.globalalpha.val, 255U) / 255.0f : 1.0f;
+
+    for (unsigned int i = 0; i < layer.height; i++) {
+        for (unsigned int j = 0; j < layer.width; j++) {
+            const unsigned char *s = src + (static_cast<size_t>(layer.stride) * i + j) * kBpp;
+            unsigned char *d = dst->data() +
+                    (static_cast<size_t>(dst_stride) * (layer.vpos + i) + layer.hpos + j) * kBpp;
+            float alpha = s[3] / 255.0f * galpha;
+
+            for (int c = 0; c < 3; c++) {
+                float color = s[c] / 255.0f * (layer.premulti ? galpha : alpha);
+                float blended = color + d[c] / 255.0f * (1.0f - alpha);
+                d[c] = static_cast<unsigned char>(std::lround(std::min(blended, 1.0f) * 255.0f));
+            }
+            float blended = alpha + d[3] / 255.0f * (1.0f - alpha);
+            d[3] = static_cast<unsigned char>(std::lround(blended * 255.0f));
+        }
+    }
+}
+
+class BlendGraphTest : public ::testing::Test {
+protected:
+    void TearDown() override
+    {
+        for (int fd : m_fds) {
+            CDmabufMapCache::Instance().Invalidate(fd);
+            close(fd);
+        }
+    }
+
+    int CreateBuffer(const Image &content)
+    {
+        int fd = memfd_create("blend-graph-test", 0);
+        EXPECT_GE(fd, 0);
+        EXPECT_EQ(ftruncate(fd, content.size()), 0);
+        EXPECT_EQ(pwrite(fd, content.data(), content.size(), 0),
+                  static_cast<ssize_t>(content.size()));
+        m_fds.push_back(fd);
+        return fd;
+    }
+
+    Image ReadBuffer(int fd, size_t len)
+    {
+        Image content(len);
+        EXPECT_EQ(pread(fd, content.data(), len, 0), static_cast<ssize_t>(len));
+        return content;
+    }
+
+    Image RandomImage(unsigned int width, unsigned int height)
+    {
+        Image image(static_cast<size_t>(width) * height * kBpp);
+        for (auto &byte : image)
+            byte = static_cast<unsigned char>(m_random());
+        return image;
+    }
+
+    exynos_sc_blend_layer MakeLayer(unsigned int hpos, unsigned int vpos, unsigned int width,
+                                    unsigned int height, unsigned int fmt = HAL_PIXEL_FORMAT_RGBA_8888)
+    {
+        exynos_sc_blend_layer layer = {};
+        m_layerPixels.push_back(RandomImage(width, height));
+        layer.fd = CreateBuffer(m_layerPixels.back());
+        layer.fmt = fmt;
+        layer.hpos = hpos;
+        layer.vpos = vpos;
+        layer.width = width;
+        layer.height = height;
+        layer.stride = width;
+        layer.blop = SRC_BL_OP_SRC_OVER;
+        layer.globalalpha.val = 0xff;
+        return layer;
+    }
+
+    int AddPoolBuffer(CScalerBlendGraph &graph, size_t len)
+    {
+        int fd = CreateBuffer(Image(len, 0));
+        EXPECT_TRUE(graph.AddBuffer(fd, len));
+        return fd;
+    }
+
+    std::mt19937 m_random{1234};
+    std::vector<Image> m_layerPixels;
+    std::vector<int> m_fds;
+};
+
+TEST_F(BlendGraphTest, SingleLayerIsBlendedDirectly)
+{
+    CScalerBlendGraph graph;
+    exynos_sc_blend_layer layers[] = {MakeLayer(0, 0, 8, 8), MakeLayer(4, 4, 8, 8)};
+    layers[0].globalalpha = {1, 0}; // culled
+    layers[1].premulti = 1;
+
+    ASSERT_TRUE(graph.Plan(layers, 2));
+    ASSERT_EQ(graph.GetNumPasses(), 1u);
+
+    CScalerBlendGraph::Pass pass;
+    ASSERT_TRUE(graph.GetPass(0, &pass));
+    EXPECT_EQ(pass.blend_fd, layers[1].fd);
+    EXPECT_EQ(pass.info.srcblendhpos, 4u);
+    EXPECT_EQ(pass.info.srcblendpremulti, 1u);
+    EXPECT_FALSE(graph.GetPass(1, &pass));
+}
+
+TEST_F(BlendGraphTest, FlattenedOverlayMatchesReference)
+{
+    CScalerBlendGraph graph;
+    int pool = AddPoolBuffer(graph, kVideoWidth * kVideoHeight * kBpp);
+
+    exynos_sc_blend_layer layers[] = {
+            MakeLayer(2, 3, 20, 10),
+            MakeLayer(10, 6, 24, 20),
+            MakeLayer(30, 1, 16, 30),
+    };
+    layers[1].premulti = 1;
+    // premultiplied pixels can not have a color above their alpha
+    for (size_t i = 0; i < m_layerPixels[1].size(); i += kBpp)
+        for (int c = 0; c < 3; c++)
+            m_layerPixels[1][i + c] = std::min(m_layerPixels[1][i + c], m_layerPixels[1][i + 3]);
+    ASSERT_EQ(pwrite(layers[1].fd, m_layerPixels[1].data(), m_layerPixels[1].size(), 0),
+              static_cast<ssize_t>(m_layerPixels[1].size()));
+    layers[2].globalalpha = {1, 0x80};
+
+    ASSERT_TRUE(graph.Plan(layers, 3));
+    ASSERT_EQ(graph.GetNumPasses(), 1u);
+    CScalerBlendGraph::Pass pass;
+    ASSERT_TRUE(graph.GetPass(0, &pass));
+    EXPECT_EQ(pass.blend_fd, pool);
+    EXPECT_EQ(pass.info.blop, SRC_BL_OP_SRC_OVER);
+    EXPECT_EQ(pass.info.srcblendpremulti, 1u);
+    EXPECT_EQ(pass.info.srcblendhpos, 2u);
+    EXPECT_EQ(pass.info.srcblendvpos, 1u);
+    EXPECT_EQ(pass.info.srcblendwidth, 44u);
+    EXPECT_EQ(pass.info.srcblendheight, 30u);
+
+    Image video = RandomImage(kVideoWidth, kVideoHeight);
+    for (size_t i = 3; i < video.size(); i += kBpp)
+        video[i] = 0xff;
+
+    Image expected = video;
+    for (int i = 0; i < 3; i++)
+        ReferenceBlendOver(&expected, kVideoWidth, m_layerPixels[i].data(), layers[i]);
+
+    Image flattened = ReadBuffer(pass.blend_fd,
+                                 pass.info.srcblendwidth * pass.info.srcblendheight * kBpp);
+    exynos_sc_blend_layer overlay = {};
+    overlay.hpos = pass.info.srcblendhpos;
+    overlay.vpos = pass.info.srcblendvpos;
+    overlay.width = pass.info.srcblendwidth;
+    overlay.height = pass.info.srcblendheight;
+    overlay.stride = pass.info.srcblendstride;
+    overlay.premulti = pass.info.srcblendpremulti;
+    Image blended = video;
+    ReferenceBlendOver(&blended, kVideoWidth, flattened.data(), overlay);
+
+    for (size_t i = 0; i < blended.size(); i++)
+        ASSERT_NEAR(blended[i], expected[i], 2) << "byte " << i;
+
+    graph.PutBuffer(pass.blend_fd);
+}
+
+TEST_F(BlendGraphTest, OtherOperationsAreChained)
+{
+    CScalerBlendGraph graph;
+    int pool = AddPoolBuffer(graph, kVideoWidth * kVideoHeight * kBpp);
+
+    exynos_sc_blend_layer layers[] = {
+            MakeLayer(0, 0, 8, 8), MakeLayer(4, 4, 8, 8),
+            MakeLayer(0, 0, 16, 16), MakeLayer(8, 8, 8, 8),
+    };
+    layers[2].blop = SRC_BL_OP_DST_OVER;
+
+    ASSERT_TRUE(graph.Plan(layers, 4));
+    ASSERT_EQ(graph.GetNumPasses(), 3u);
+
+    CScalerBlendGraph::Pass pass;
+    ASSERT_TRUE(graph.GetPass(0, &pass));
+    EXPECT_EQ(pass.blend_fd, pool);
+    EXPECT_EQ(pass.info.srcblendwidth, 12u);
+    ASSERT_TRUE(graph.GetPass(1, &pass));
+    EXPECT_EQ(pass.blend_fd, layers[2].fd);
+    EXPECT_EQ(pass.info.blop, SRC_BL_OP_DST_OVER);
+    ASSERT_TRUE(graph.GetPass(2, &pass));
+    EXPECT_EQ(pass.blend_fd, layers[3].fd);
+}
+
+TEST_F(BlendGraphTest, MixedFormatsAreChained)
+{
+    CScalerBlendGraph graph;
+    AddPoolBuffer(graph, kVideoWidth * kVideoHeight * kBpp);
+
+    exynos_sc_blend_layer layers[] = {
+            MakeLayer(0, 0, 8, 8, HAL_PIXEL_FORMAT_RGBA_8888),
+            MakeLayer(4, 4, 8, 8, HAL_PIXEL_FORMAT_BGRA_8888),
+            MakeLayer(0, 0, 8, 8, HAL_PIXEL_FORMAT_RGB_565),
+    };
+
+    ASSERT_TRUE(graph.Plan(layers, 3));
+    ASSERT_EQ(graph.GetNumPasses(), 3u);
+
+    CScalerBlendGraph::Pass pass;
+    for (unsigned int i = 0; i < 3; i++) {
+        ASSERT_TRUE(graph.GetPass(i, &pass));
+        EXPECT_EQ(pass.blend_fd, layers[i].fd);
+        EXPECT_EQ(pass.info.srcblendfmt, layers[i].fmt);
+    }
+}
+
+TEST_F(BlendGraphTest, FailedPlanReturnsPoolBuffers)
+{
+    CScalerBlendGraph graph;
+    int pool = AddPoolBuffer(graph, kVideoWidth * kVideoHeight * kBpp);
+
+    // two runs to flatten but a single pool buffer
+    exynos_sc_blend_layer layers[] = {
+            MakeLayer(0, 0, 8, 8), MakeLayer(4, 4, 8, 8),
+            MakeLayer(0, 0, 8, 8, HAL_PIXEL_FORMAT_RGB_565),
+            MakeLayer(0, 0, 8, 8), MakeLayer(4, 4, 8, 8),
+    };
+    EXPECT_FALSE(graph.Plan(layers, 5));
+
+    ASSERT_TRUE(graph.Plan(layers, 3));
+    CScalerBlendGraph::Pass pass;
+    ASSERT_TRUE(graph.GetPass(0, &pass));
+    EXPECT_EQ(pass.blend_fd, pool);
+}
+
+} // namespace
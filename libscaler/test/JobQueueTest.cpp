@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <future>
+
+#include <gtest/gtest.h>
+
+#include "libscaler-jobqueue.h"
+
+namespace {
+
+const unsigned int kAllFormats =
+        EXYNOS_SC_COPY_FMT(EXYNOS_SC_FMT_RGB32) | EXYNOS_SC_COPY_FMT(EXYNOS_SC_FMT_BGR32) |
+        EXYNOS_SC_COPY_FMT(EXYNOS_SC_FMT_RGB565) | EXYNOS_SC_COPY_FMT(EXYNOS_SC_FMT_RGB555X) |
+        EXYNOS_SC_COPY_FMT(EXYNOS_SC_FMT_RGB444);
+
+struct exynos_sc_copy_caps MakeCaps()
+{
+    struct exynos_sc_copy_caps caps = {};
+    caps.formats = kAllFormats;
+    caps.max_downscale = 4;
+    caps.max_upscale = 2;
+    caps.min_src_width = 8;
+    caps.min_src_height = 8;
+    caps.min_dst_width = 8;
+    caps.min_dst_height = 8;
+    caps.rotate = true;
+    return caps;
+}
+
+struct exynos_sc_pxinfo MakeCopy(unsigned int src_w, unsigned int src_h,
+                                 unsigned int dst_w, unsigned int dst_h)
+{
+    struct exynos_sc_pxinfo pxinfo = {};
+    pxinfo.src.width = pxinfo.src.crop_width = src_w;
+    pxinfo.src.height = pxinfo.src.crop_height = src_h;
+    pxinfo.src.pxfmt = EXYNOS_SC_FMT_RGB32;
+    pxinfo.dst.width = pxinfo.dst.crop_width = dst_w;
+    pxinfo.dst.height = pxinfo.dst.crop_height = dst_h;
+    pxinfo.dst.pxfmt = EXYNOS_SC_FMT_RGB32;
+    return pxinfo;
+}
+
+/* A H/W whose copies do not finish until it is opened */
+class FakeBackend {
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_bOpen = true;
+public:
+    std::atomic<int> runs{0};
+    std::string name;
+    struct exynos_sc_copy_caps caps = MakeCaps();
+
+    explicit FakeBackend(const char *__name) : name(__name) { }
+
+    void Close()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bOpen = false;
+    }
+
+    void Open()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bOpen = true;
+        m_cond.notify_all();
+    }
+
+    static bool Run(void *priv, struct exynos_sc_pxinfo *)
+    {
+        FakeBackend *self = reinterpret_cast<FakeBackend *>(priv);
+        std::unique_lock<std::mutex> lock(self->m_mutex);
+        self->m_cond.wait(lock, [self] { return self->m_bOpen; });
+        self->runs++;
+        return true;
+    }
+
+    struct exynos_sc_copy_backend Get()
+    {
+        struct exynos_sc_copy_backend backend;
+        backend.name = name.c_str();
+        backend.caps = caps;
+        backend.run = Run;
+        backend.priv = this;
+        return backend;
+    }
+};
+
+TEST(JobQueueTest, SupportsChecksFormats)
+{
+    struct exynos_sc_copy_caps caps = MakeCaps();
+    caps.formats = EXYNOS_SC_COPY_FMT(EXYNOS_SC_FMT_RGB32);
+    struct exynos_sc_pxinfo pxinfo = MakeCopy(64, 64, 64, 64);
+
+    EXPECT_TRUE(CScalerJobQueue::Supports(caps, pxinfo));
+    pxinfo.dst.pxfmt = EXYNOS_SC_FMT_RGB565;
+    EXPECT_FALSE(CScalerJobQueue::Supports(caps, pxinfo));
+    pxinfo.dst.pxfmt = 0;
+    EXPECT_FALSE(CScalerJobQueue::Supports(caps, pxinfo));
+}
+
+TEST(JobQueueTest, SupportsChecksScaleLimits)
+{
+    struct exynos_sc_copy_caps caps = MakeCaps();
+
+    EXPECT_TRUE(CScalerJobQueue::Supports(caps, MakeCopy(64, 64, 16, 16)));
+    EXPECT_FALSE(CScalerJobQueue::Supports(caps, MakeCopy(64, 64, 15, 16)));
+    EXPECT_TRUE(CScalerJobQueue::Supports(caps, MakeCopy(64, 64, 128, 128)));
+    EXPECT_FALSE(CScalerJobQueue::Supports(caps, MakeCopy(64, 64, 128, 129)));
+    EXPECT_FALSE(CScalerJobQueue::Supports(caps, MakeCopy(64, 7, 64, 8)));
+    EXPECT_FALSE(CScalerJobQueue::Supports(caps, MakeCopy(64, 8, 64, 7)));
+}
+
+TEST(JobQueueTest, SupportsChecksRotation)
+{
+    struct exynos_sc_copy_caps caps = MakeCaps();
+    // 8x downscale of the width without rotation and 4x downscale with rotation
+    struct exynos_sc_pxinfo pxinfo = MakeCopy(128, 16, 16, 32);
+
+    EXPECT_FALSE(CScalerJobQueue::Supports(caps, pxinfo));
+    pxinfo.rotate = 180;
+    EXPECT_FALSE(CScalerJobQueue::Supports(caps, pxinfo));
+    pxinfo.rotate = 90;
+    EXPECT_TRUE(CScalerJobQueue::Supports(caps, pxinfo));
+    pxinfo.rotate = 270;
+    EXPECT_TRUE(CScalerJobQueue::Supports(caps, pxinfo));
+    caps.rotate = false;
+    EXPECT_FALSE(CScalerJobQueue::Supports(caps, pxinfo));
+
+    pxinfo = MakeCopy(64, 64, 64, 64);
+    pxinfo.rotate = 180;
+    EXPECT_TRUE(CScalerJobQueue::Supports(caps, pxinfo));
+    pxinfo.rotate = 45;
+    EXPECT_FALSE(CScalerJobQueue::Supports(caps, pxinfo));
+}
+
+TEST(JobQueueTest, RejectsInvalidBackend)
+{
+    CScalerJobQueue queue;
+    FakeBackend fake("fake");
+    struct exynos_sc_copy_backend backend = fake.Get();
+    backend.caps.max_downscale = 0;
+    EXPECT_FALSE(queue.AddBackend(backend));
+    backend = fake.Get();
+    backend.run = NULL;
+    EXPECT_FALSE(queue.AddBackend(backend));
+    EXPECT_FALSE(queue.HasBackend("fake"));
+
+    EXPECT_TRUE(queue.AddBackend(fake.Get()));
+    EXPECT_TRUE(queue.AddBackend(fake.Get()));
+    EXPECT_TRUE(queue.HasBackend("fake"));
+}
+
+TEST(JobQueueTest, QueueGoesToCapableBackend)
+{
+    CScalerJobQueue queue;
+    FakeBackend rgb32("rgb32"), rgb565("rgb565");
+    rgb32.caps.formats = EXYNOS_SC_COPY_FMT(EXYNOS_SC_FMT_RGB32);
+    rgb565.caps.formats = EXYNOS_SC_COPY_FMT(EXYNOS_SC_FMT_RGB565);
+
+    struct exynos_sc_pxinfo copy565 = MakeCopy(64, 64, 64, 64);
+    copy565.src.pxfmt = copy565.dst.pxfmt = EXYNOS_SC_FMT_RGB565;
+    EXPECT_FALSE(queue.Queue(&copy565, NULL, NULL, &queue));
+
+    ASSERT_TRUE(queue.AddBackend(rgb32.Get()));
+    ASSERT_TRUE(queue.AddBackend(rgb565.Get()));
+
+    struct exynos_sc_pxinfo copy32 = MakeCopy(64, 64, 64, 64);
+    for (int i = 0; i < 3; i++) {
+        ASSERT_TRUE(queue.Queue(&copy565, NULL, NULL, &queue));
+        ASSERT_TRUE(queue.Queue(&copy32, NULL, NULL, &queue));
+    }
+    queue.WaitIdle(&queue);
+
+    EXPECT_EQ(rgb32.runs, 3);
+    EXPECT_EQ(rgb565.runs, 3);
+}
+
+TEST(JobQueueTest, QueueGoesToLeastLoadedBackend)
+{
+    CScalerJobQueue queue;
+    FakeBackend first("first"), second("second");
+    first.Close();
+    second.Close();
+    ASSERT_TRUE(queue.AddBackend(first.Get()));
+    ASSERT_TRUE(queue.AddBackend(second.Get()));
+
+    struct exynos_sc_pxinfo large = MakeCopy(256, 256, 256, 256);
+    struct exynos_sc_pxinfo small = MakeCopy(16, 16, 16, 16);
+    ASSERT_TRUE(queue.Queue(&large, NULL, NULL, &queue));
+    for (int i = 0; i < 4; i++)
+        ASSERT_TRUE(queue.Queue(&small, NULL, NULL, &queue));
+
+    first.Open();
+    second.Open();
+    queue.WaitIdle(&queue);
+
+    EXPECT_EQ(first.runs + second.runs, 5);
+    EXPECT_EQ(std::min(first.runs, second.runs), 1);
+}
+
+TEST(JobQueueTest, WaitIdleWaitsForItsTokenOnly)
+{
+    CScalerJobQueue queue;
+    FakeBackend blocked("blocked"), open("open");
+    blocked.caps.formats = EXYNOS_SC_COPY_FMT(EXYNOS_SC_FMT_RGB32);
+    open.caps.formats = EXYNOS_SC_COPY_FMT(EXYNOS_SC_FMT_RGB565);
+    blocked.Close();
+    ASSERT_TRUE(queue.AddBackend(blocked.Get()));
+    ASSERT_TRUE(queue.AddBackend(open.Get()));
+
+    int client_a, client_b;
+    struct exynos_sc_pxinfo copy32 = MakeCopy(64, 64, 64, 64);
+    struct exynos_sc_pxinfo copy565 = MakeCopy(64, 64, 64, 64);
+    copy565.src.pxfmt = copy565.dst.pxfmt = EXYNOS_SC_FMT_RGB565;
+
+    // The jobs of a client are queued from another thread than the one waiting for them
+    std::thread([&] {
+        ASSERT_TRUE(queue.Queue(&copy32, NULL, NULL, &client_a));
+        ASSERT_TRUE(queue.Queue(&copy565, NULL, NULL, &client_b));
+    }).join();
+
+    auto wait_a = std::async(std::launch::async, [&] { queue.WaitIdle(&client_a); });
+    queue.WaitIdle(&client_b);
+    EXPECT_EQ(open.runs, 1);
+    EXPECT_EQ(wait_a.wait_for(std::chrono::milliseconds(50)), std::future_status::timeout);
+
+    blocked.Open();
+    wait_a.wait();
+    EXPECT_EQ(blocked.runs, 1);
+}
+
+TEST(JobQueueTest, DoneIsCalledForEachJob)
+{
+    CScalerJobQueue queue;
+    FakeBackend fake("fake");
+    ASSERT_TRUE(queue.AddBackend(fake.Get()));
+
+    std::atomic<int> done{0};
+    auto callback = [](struct exynos_sc_pxinfo *, bool success, void *priv) {
+        if (success)
+            (*reinterpret_cast<std::atomic<int> *>(priv))++;
+    };
+
+    struct exynos_sc_pxinfo pxinfo = MakeCopy(64, 64, 64, 64);
+    for (int i = 0; i < 8; i++)
+        ASSERT_TRUE(queue.Queue(&pxinfo, callback, &done, &queue));
+    queue.WaitIdle(&queue);
+
+    EXPECT_EQ(done, 8);
+}
+
+} // namespace
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "libscaler-mapcache.h"
+
+namespace {
+
+/* memfd stands in for a dmabuf: it has its own inode and can be mapped */
+class MapCacheTest : public ::testing::Test {
+protected:
+    static constexpr auto kNoTimeout = std::chrono::hours(1);
+
+    void SetUp() override { m_nPageSize = sysconf(_SC_PAGESIZE); }
+
+    void TearDown() override
+    {
+        for (int fd : m_fds)
+            close(fd);
+    }
+
+    int CreateBuffer(size_t len, char fill)
+    {
+        int fd = memfd_create("mapcache-test", 0);
+        EXPECT_GE(fd, 0);
+        EXPECT_EQ(ftruncate(fd, len), 0);
+        char *addr = reinterpret_cast<char *>(
+                mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+        EXPECT_NE(addr, MAP_FAILED);
+        for (size_t i = 0; i < len; i++)
+            addr[i] = fill + static_cast<char>(i / m_nPageSize);
+        munmap(addr, len);
+        m_fds.push_back(fd);
+        return fd;
+    }
+
+    size_t m_nPageSize;
+    std::vector<int> m_fds;
+};
+
+TEST_F(MapCacheTest, KeepsMappingAfterLastPut)
+{
+    CDmabufMapCache cache(16 * m_nPageSize, kNoTimeout);
+    int fd = CreateBuffer(m_nPageSize, 'a');
+
+    char *addr = cache.Get(fd, m_nPageSize, true);
+    ASSERT_NE(addr, nullptr);
+    addr[1] = 'z';
+    cache.Put(fd);
+    EXPECT_EQ(cache.GetMappedSize(), m_nPageSize);
+
+    char *again = cache.Get(fd, m_nPageSize, false);
+    EXPECT_EQ(again, addr);
+    EXPECT_EQ(again[1], 'z');
+    cache.Put(fd);
+}
+
+TEST_F(MapCacheTest, KeysOnOffset)
+{
+    CDmabufMapCache cache(16 * m_nPageSize, kNoTimeout);
+    int fd = CreateBuffer(3 * m_nPageSize, 'a');
+    const off_t offset = m_nPageSize + 16;
+
+    const char *first = cache.Get(fd, m_nPageSize, false);
+    const char *second = cache.Get(fd, 16, false, offset);
+    ASSERT_NE(first, nullptr);
+    ASSERT_NE(second, nullptr);
+    EXPECT_NE(first, second);
+    EXPECT_EQ(first[0], 'a');
+    EXPECT_EQ(second[0], 'b');
+    cache.Put(fd, offset);
+    cache.Put(fd);
+
+    /* A dup of the fd shares the entries */
+    int dupfd = dup(fd);
+    m_fds.push_back(dupfd);
+    EXPECT_EQ(cache.Get(dupfd, 16, false, offset), second);
+    cache.Put(dupfd, offset);
+}
+
+TEST_F(MapCacheTest, InvalidateDropsEveryOffset)
+{
+    CDmabufMapCache cache(16 * m_nPageSize, kNoTimeout);
+    int fd = CreateBuffer(3 * m_nPageSize, 'a');
+    int other = CreateBuffer(m_nPageSize, 'x');
+
+    ASSERT_NE(cache.Get(fd, m_nPageSize, false), nullptr);
+    ASSERT_NE(cache.Get(fd, m_nPageSize, false, 2 * m_nPageSize), nullptr);
+    ASSERT_NE(cache.Get(other, m_nPageSize, false), nullptr);
+    cache.Put(fd);
+    cache.Put(fd, 2 * m_nPageSize);
+    cache.Put(other);
+    EXPECT_EQ(cache.GetMappedSize(), 3 * m_nPageSize);
+
+    cache.Invalidate(fd);
+    EXPECT_EQ(cache.GetMappedSize(), m_nPageSize);
+
+    /* A buffer in use stays mapped */
+    ASSERT_NE(cache.Get(other, m_nPageSize, false), nullptr);
+    cache.Invalidate(other);
+    EXPECT_EQ(cache.GetMappedSize(), m_nPageSize);
+    cache.Put(other);
+    cache.Invalidate(other);
+    EXPECT_EQ(cache.GetMappedSize(), 0u);
+}
+
+TEST_F(MapCacheTest, DropsIdleMappings)
+{
+    CDmabufMapCache cache(16 * m_nPageSize, std::chrono::milliseconds(0));
+    int fd = CreateBuffer(m_nPageSize, 'a');
+    int other = CreateBuffer(m_nPageSize, 'x');
+
+    ASSERT_NE(cache.Get(fd, m_nPageSize, false), nullptr);
+    ASSERT_NE(cache.Get(other, m_nPageSize, false), nullptr);
+    cache.Put(other);
+    /* The buffer still in use is not dropped */
+    EXPECT_EQ(cache.GetMappedSize(), m_nPageSize);
+    cache.Put(fd);
+    EXPECT_EQ(cache.GetMappedSize(), 0u);
+}
+
+TEST_F(MapCacheTest, TrimsLeastRecentlyUsedToBudget)
+{
+    CDmabufMapCache cache(2 * m_nPageSize, kNoTimeout);
+    int fds[] = {CreateBuffer(m_nPageSize, 'a'), CreateBuffer(m_nPageSize, 'b'),
+                 CreateBuffer(m_nPageSize, 'c')};
+
+    for (int fd : fds) {
+        ASSERT_NE(cache.Get(fd, m_nPageSize, false), nullptr);
+        cache.Put(fd);
+    }
+    EXPECT_EQ(cache.GetMappedSize(), 2 * m_nPageSize);
+
+    /* The first buffer was dropped, the last two are still mapped */
+    cache.Invalidate(fds[1]);
+    cache.Invalidate(fds[2]);
+    EXPECT_EQ(cache.GetMappedSize(), 0u);
+}
+
+TEST_F(MapCacheTest, RemapsForLargerOrWritableAccess)
+{
+    CDmabufMapCache cache(16 * m_nPageSize, kNoTimeout);
+    int fd = CreateBuffer(2 * m_nPageSize, 'a');
+
+    ASSERT_NE(cache.Get(fd, m_nPageSize, false), nullptr);
+    /* Not while the smaller mapping is in use */
+    EXPECT_EQ(cache.Get(fd, 2 * m_nPageSize, true), nullptr);
+    cache.Put(fd);
+
+    char *addr = cache.Get(fd, 2 * m_nPageSize, true);
+    ASSERT_NE(addr, nullptr);
+    EXPECT_EQ(addr[m_nPageSize], 'b');
+    addr[0] = 'z';
+    cache.Put(fd);
+    EXPECT_EQ(cache.GetMappedSize(), 2 * m_nPageSize);
+}
+
+} // namespace
@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <linux/videodev2.h>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "libscaler-swscaler.h"
+
+namespace {
+
+typedef std::vector<unsigned char> Image;
+
+/* Converts a single pixel of @src in @srcFormat to @dstFormat */
+Image ConvertPixel(unsigned int srcFormat, const Image &src, unsigned int dstFormat,
+                   bool bt709, bool wide)
+{
+    /* 2x2 so that the pixel is a whole chroma block of any format */
+    Image srcImage, dstImage;
+    Image srcChroma, dstChroma;
+    size_t bpp = ((dstFormat == V4L2_PIX_FMT_RGB32) || (dstFormat == V4L2_PIX_FMT_BGR32)) ? 4 : 2;
+    if ((srcFormat == V4L2_PIX_FMT_NV12) || (srcFormat == V4L2_PIX_FMT_NV21)) {
+        srcImage.assign(4, src[0]);
+        srcChroma = {src[1], src[2], src[1], src[2]};
+    } else {
+        for (int i = 0; i < 4; i++)
+            srcImage.insert(srcImage.end(), src.begin(), src.end());
+    }
+    if (dstFormat == V4L2_PIX_FMT_NV12) {
+        bpp = 1;
+        dstChroma.resize(4);
+    }
+    dstImage.resize(4 * bpp);
+
+    char *srcPlanes[3] = {reinterpret_cast<char *>(srcImage.data()),
+                          reinterpret_cast<char *>(srcChroma.data()), NULL};
+    char *dstPlanes[3] = {reinterpret_cast<char *>(dstImage.data()),
+                          reinterpret_cast<char *>(dstChroma.data()), NULL};
+    CScalerSW_Generic scaler(srcFormat, srcPlanes, dstFormat, dstPlanes);
+    scaler.SetCSC(bt709, wide);
+    scaler.SetSrcRect(0, 0, 2, 2, 2);
+    scaler.SetDstRect(0, 0, 2, 2, 2);
+    EXPECT_TRUE(scaler.Scale());
+
+    if (dstFormat == V4L2_PIX_FMT_NV12)
+        return {dstImage[0], dstChroma[0], dstChroma[1]};
+    return Image(dstImage.begin(), dstImage.begin() + bpp);
+}
+
+Image RgbToYuv(unsigned char r, unsigned char g, unsigned char b, bool bt709, bool wide)
+{
+    return ConvertPixel(V4L2_PIX_FMT_RGB32, {r, g, b, 0xFF}, V4L2_PIX_FMT_NV12, bt709, wide);
+}
+
+Image YuvToRgb(unsigned char y, unsigned char u, unsigned char v, bool bt709, bool wide)
+{
+    Image rgb = ConvertPixel(V4L2_PIX_FMT_NV12, {y, u, v}, V4L2_PIX_FMT_RGB32, bt709, wide);
+    return {rgb[0], rgb[1], rgb[2]};
+}
+
+/* Reference conversion in floating point, rounded to the nearest code */
+Image RefRgbToYuv(int r, int g, int b, bool bt709, bool wide)
+{
+    const double kr = bt709 ? 0.2126 : 0.299;
+    const double kb = bt709 ? 0.0722 : 0.114;
+    const double kg = 1.0 - kr - kb;
+    const double yscale = wide ? 1.0 : (219.0 / 255.0);
+    const double cscale = wide ? 1.0 : (224.0 / 255.0);
+    const double y = kr * r + kg * g + kb * b;
+    auto clamp = [](double v) {
+        return static_cast<unsigned char>((v < 0) ? 0 : ((v > 255) ? 255 : (v + 0.5)));
+    };
+    return {clamp(y * yscale + (wide ? 0 : 16)),
+            clamp((b - y) / (2 * (1 - kb)) * cscale + 128),
+            clamp((r - y) / (2 * (1 - kr)) * cscale + 128)};
+}
+
+const unsigned char kColors[][3] = {
+    {255, 0, 0}, {0, 255, 0}, {0, 0, 255}, {255, 255, 0},
+    {0, 255, 255}, {255, 0, 255}, {128, 64, 32}, {17, 200, 99},
+};
+
+TEST(SWScalerTest, RgbToYuvGolden)
+{
+    /* BT.601 limited range */
+    EXPECT_EQ(RgbToYuv(255, 255, 255, false, false), Image({235, 128, 128}));
+    EXPECT_EQ(RgbToYuv(0, 0, 0, false, false), Image({16, 128, 128}));
+    EXPECT_EQ(RgbToYuv(128, 128, 128, false, false), Image({126, 128, 128}));
+    EXPECT_EQ(RgbToYuv(255, 0, 0, false, false), Image({81, 90, 240}));
+    /* BT.709 limited range */
+    EXPECT_EQ(RgbToYuv(255, 0, 0, true, false), Image({63, 102, 240}));
+    /* BT.601 full range, Cr of red is clamped */
+    EXPECT_EQ(RgbToYuv(255, 255, 255, false, true), Image({255, 128, 128}));
+    EXPECT_EQ(RgbToYuv(255, 0, 0, false, true), Image({76, 85, 255}));
+}
+
+TEST(SWScalerTest, RgbToYuvMatchesReference)
+{
+    /* Q10 coefficients are off the reference by at most one code */
+    for (int bt709 = 0; bt709 < 2; bt709++) {
+        for (int wide = 0; wide < 2; wide++) {
+            for (auto &c : kColors) {
+                Image yuv = RgbToYuv(c[0], c[1], c[2], bt709, wide);
+                Image ref = RefRgbToYuv(c[0], c[1], c[2], bt709, wide);
+                for (int i = 0; i < 3; i++) {
+                    EXPECT_NEAR(yuv[i], ref[i], 1) << "bt709 " << bt709 << " wide " << wide
+                            << " rgb " << int(c[0]) << "," << int(c[1]) << "," << int(c[2]);
+                }
+            }
+        }
+    }
+}
+
+TEST(SWScalerTest, YuvToRgbGolden)
+{
+    EXPECT_EQ(YuvToRgb(235, 128, 128, false, false), Image({255, 255, 255}));
+    EXPECT_EQ(YuvToRgb(16, 128, 128, false, false), Image({0, 0, 0}));
+    EXPECT_EQ(YuvToRgb(126, 128, 128, false, false), Image({128, 128, 128}));
+    EXPECT_EQ(YuvToRgb(255, 128, 128, false, true), Image({255, 255, 255}));
+    /* Out of gamut values are clamped */
+    EXPECT_EQ(YuvToRgb(0, 128, 128, false, false), Image({0, 0, 0}));
+    EXPECT_EQ(YuvToRgb(255, 128, 128, false, false), Image({255, 255, 255}));
+    EXPECT_EQ(YuvToRgb(128, 255, 255, false, false), Image({255, 0, 255}));
+}
+
+TEST(SWScalerTest, RoundTripMatchesReference)
+{
+    for (int bt709 = 0; bt709 < 2; bt709++) {
+        for (int wide = 0; wide < 2; wide++) {
+            for (auto &c : kColors) {
+                Image ref = RefRgbToYuv(c[0], c[1], c[2], bt709, wide);
+                Image rgb = YuvToRgb(ref[0], ref[1], ref[2], bt709, wide);
+                /* The YUV codes are rounded, more for the limited range */
+                for (int i = 0; i < 3; i++) {
+                    EXPECT_NEAR(rgb[i], c[i], wide ? 2 : 3) << "bt709 " << bt709 << " wide "
+                            << wide << " channel " << i;
+                }
+            }
+        }
+    }
+}
+
+TEST(SWScalerTest, PackedFormatOrder)
+{
+    EXPECT_EQ(ConvertPixel(V4L2_PIX_FMT_RGB32, {255, 0, 0, 0xFF}, V4L2_PIX_FMT_UYVY, false,
+                           false),
+              Image({90, 81}));
+    EXPECT_EQ(ConvertPixel(V4L2_PIX_FMT_RGB32, {255, 0, 0, 0xFF}, V4L2_PIX_FMT_YUYV, false,
+                           false),
+              Image({81, 90}));
+    EXPECT_EQ(ConvertPixel(V4L2_PIX_FMT_RGB32, {255, 0, 0, 0xFF}, V4L2_PIX_FMT_YVYU, false,
+                           false),
+              Image({81, 240}));
+    /* BGR32 stores blue first, alpha is opaque */
+    EXPECT_EQ(ConvertPixel(V4L2_PIX_FMT_RGB32, {10, 20, 30, 0}, V4L2_PIX_FMT_BGR32, false, false),
+              Image({30, 20, 10, 0xFF}));
+    /* RGB565 expands to 8 bits by replicating the high bits */
+    EXPECT_EQ(ConvertPixel(V4L2_PIX_FMT_RGB565, {0x00, 0xF8}, V4L2_PIX_FMT_RGB32, false, false),
+              Image({255, 0, 0, 0xFF}));
+    EXPECT_EQ(ConvertPixel(V4L2_PIX_FMT_RGB565, {0x1F, 0x04}, V4L2_PIX_FMT_RGB32, false, false),
+              Image({0, 130, 255, 0xFF}));
+}
+
+/* Scales a single row of gray RGB32 pixels */
+Image ScaleRow(const Image &row, unsigned int dstWidth)
+{
+    Image src, dst(dstWidth * 4);
+    for (unsigned char v : row)
+        src.insert(src.end(), {v, v, v, 0xFF});
+    char *srcPlanes[3] = {reinterpret_cast<char *>(src.data()), NULL, NULL};
+    char *dstPlanes[3] = {reinterpret_cast<char *>(dst.data()), NULL, NULL};
+    CScalerSW_Generic scaler(V4L2_PIX_FMT_RGB32, srcPlanes, V4L2_PIX_FMT_RGB32, dstPlanes);
+    scaler.SetSrcRect(0, 0, row.size(), 1, row.size());
+    scaler.SetDstRect(0, 0, dstWidth, 1, dstWidth);
+    EXPECT_TRUE(scaler.Scale());
+
+    Image out;
+    for (unsigned int i = 0; i < dstWidth; i++)
+        out.push_back(dst[i * 4]);
+    return out;
+}
+
+TEST(SWScalerTest, BilinearGolden)
+{
+    /* Pixel centers are aligned, edges are clamped */
+    EXPECT_EQ(ScaleRow({0, 255}, 4), Image({0, 64, 191, 255}));
+    EXPECT_EQ(ScaleRow({0, 100, 200}, 6), Image({0, 25, 75, 125, 175, 200}));
+    EXPECT_EQ(ScaleRow({0, 64, 128, 192}, 2), Image({32, 160}));
+    EXPECT_EQ(ScaleRow({10, 20, 30}, 3), Image({10, 20, 30}));
+}
+
+TEST(SWScalerTest, RotateAndFlipGolden)
+{
+    /* 4x2 source, the pixel values are their indices. Flips apply to the source. */
+    const unsigned int w = 4, h = 2;
+    Image src;
+    for (unsigned int i = 0; i < w * h; i++)
+        src.insert(src.end(), {static_cast<unsigned char>(i), 0, 0, 0xFF});
+
+    struct {
+        int rotate;
+        bool hflip, vflip;
+        Image expected;
+    } cases[] = {
+        {90, false, false, {4, 0, 5, 1, 6, 2, 7, 3}},
+        {180, false, false, {7, 6, 5, 4, 3, 2, 1, 0}},
+        {270, false, false, {3, 7, 2, 6, 1, 5, 0, 4}},
+        {0, true, false, {3, 2, 1, 0, 7, 6, 5, 4}},
+        {0, false, true, {4, 5, 6, 7, 0, 1, 2, 3}},
+        {90, true, false, {7, 3, 6, 2, 5, 1, 4, 0}},
+    };
+
+    for (auto &c : cases) {
+        bool swapped = (c.rotate == 90) || (c.rotate == 270);
+        unsigned int dw = swapped ? h : w, dh = swapped ? w : h;
+        Image dst(dw * dh * 4);
+        char *srcPlanes[3] = {reinterpret_cast<char *>(src.data()), NULL, NULL};
+        char *dstPlanes[3] = {reinterpret_cast<char *>(dst.data()), NULL, NULL};
+        CScalerSW_Generic scaler(V4L2_PIX_FMT_RGB32, srcPlanes, V4L2_PIX_FMT_RGB32, dstPlanes);
+        scaler.SetRotate(c.rotate, c.hflip, c.vflip);
+        scaler.SetSrcRect(0, 0, w, h, w);
+        scaler.SetDstRect(0, 0, dw, dh, dw);
+        ASSERT_TRUE(scaler.Scale());
+
+        Image out;
+        for (unsigned int i = 0; i < dw * dh; i++)
+            out.push_back(dst[i * 4]);
+        EXPECT_EQ(out, c.expected) << c.rotate << " " << c.hflip << " " << c.vflip;
+    }
+}
+
+TEST(SWScalerTest, NV21SwapsChroma)
+{
+    Image nv12 = ConvertPixel(V4L2_PIX_FMT_NV12, {81, 90, 240}, V4L2_PIX_FMT_RGB32, false, false);
+    Image nv21 = ConvertPixel(V4L2_PIX_FMT_NV21, {81, 240, 90}, V4L2_PIX_FMT_RGB32, false, false);
+    EXPECT_EQ(nv12, nv21);
+    EXPECT_GE(nv12[0], 254);
+}
+
+TEST(SWScalerTest, RejectsOddSubsampledRects)
+{
+    Image src(16 * 4), dst(16 * 2);
+    char *srcPlanes[3] = {reinterpret_cast<char *>(src.data()), NULL, NULL};
+    char *dstPlanes[3] = {reinterpret_cast<char *>(dst.data()), NULL, NULL};
+    CScalerSW_Generic scaler(V4L2_PIX_FMT_RGB32, srcPlanes, V4L2_PIX_FMT_YUYV, dstPlanes);
+    scaler.SetSrcRect(0, 0, 4, 4, 4);
+    scaler.SetDstRect(0, 0, 3, 4, 4);
+    EXPECT_FALSE(scaler.Scale());
+    scaler.SetDstRect(0, 0, 4, 3, 4);
+    EXPECT_TRUE(scaler.Scale());
+    scaler.SetRotate(45, false, false);
+    EXPECT_FALSE(scaler.Scale());
+}
+
+} // namespace